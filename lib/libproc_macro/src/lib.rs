@@ -173,6 +173,9 @@ pub fn main(macros: &[MacroDesc])
     //::env_logger::init();
 
     let mac_name = ::std::env::args().nth(1).expect("Was not passed a macro name");
+    if mac_name == "--server" {
+        return run_server(macros);
+    }
     //eprintln!("Searching for macro {}\r", mac_name);
     for m in macros
     {
@@ -194,3 +197,44 @@ pub fn main(macros: &[MacroDesc])
     panic!("Unknown macro name '{}'", mac_name);
 }
 
+/// Handle macro invocations until the compiler closes stdin
+///
+/// Each request is the macro name (as a length-prefixed string), answered with a status byte (0 if the macro exists),
+/// followed by the same token stream exchange as a single invocation.
+fn run_server(macros: &[MacroDesc])
+{
+    use std::io::Write;
+    let stdin = ::std::io::stdin();
+    let stdout = ::std::io::stdout();
+    stdout.lock().write(&[0]).expect("Stdout write error?");
+    stdout.lock().flush().expect("Stdout write error?");
+    loop
+    {
+        let mac_name = match crate::protocol::Reader::new(stdin.lock()).read_string_opt()
+            {
+            Some(v) => v,
+            None => break,
+            };
+        match macros.iter().find(|m| m.name == mac_name)
+        {
+        Some(m) => {
+            stdout.lock().write(&[0]).expect("Stdout write error?");
+            stdout.lock().flush().expect("Stdout write error?");
+            debug!("Waiting for input to {}\r", mac_name);
+            let input = crate::serialisation::recv_token_stream(stdin.lock());
+            debug!("INPUT = `{}`\r", input);
+            let output = (m.handler)( input );
+            debug!("OUTPUT = `{}`\r", output);
+            crate::serialisation::send_token_stream(stdout.lock(), output);
+            stdout.lock().flush().expect("Stdout write error?");
+            },
+        None => {
+            note!("Unknown macro name '{}'", mac_name);
+            stdout.lock().write(&[1]).expect("Stdout write error?");
+            stdout.lock().flush().expect("Stdout write error?");
+            },
+        }
+    }
+    note!("Server done");
+}
+
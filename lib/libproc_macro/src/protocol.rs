@@ -70,18 +70,35 @@ impl<R: ::std::io::Read> Reader<R>
         Err(e) => panic!("Error reading from stdin - {}", e),
         }
     }
+    /// Read a length-prefixed string, returning `None` if the stream has ended
+    pub fn read_string_opt(&mut self) -> Option<String>
+    {
+        let first = match self.getb()
+            {
+            Some(b) => b,
+            None => return None,
+            };
+        let size = self.get_u128v_from(first);
+        let raw = self.get_byte_vec_sized(size);
+        Some(String::from_utf8(raw).expect("Invalid UTF-8 passed from compiler"))
+    }
+
     fn get_u128v(&mut self) -> u128 {
+        let b = self.getb().unwrap();
+        self.get_u128v_from(b)
+    }
+    fn get_u128v_from(&mut self, mut b: u8) -> u128 {
         let mut ofs = 0;
         let mut raw_rv = 0u128;
         loop
         {
-            let b = self.getb().unwrap();
             raw_rv |= ((b & 0x7F) as u128) << ofs;
             if b < 128 {
                 break;
             }
             assert!(ofs < 18*7);  // at most 18 bytes needed for a i128
             ofs += 7;
+            b = self.getb().unwrap();
         }
         raw_rv
     }
@@ -97,6 +114,9 @@ impl<R: ::std::io::Read> Reader<R>
     }
     fn get_byte_vec(&mut self) -> Vec<u8> {
         let size = self.get_u128v();
+        self.get_byte_vec_sized(size)
+    }
+    fn get_byte_vec_sized(&mut self, size: u128) -> Vec<u8> {
         assert!(size < (1<<30));
         let size = size as usize;
         let mut buf = vec![0u8; size];
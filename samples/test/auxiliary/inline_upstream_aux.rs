@@ -0,0 +1,26 @@
+// Small non-generic `#[inline]` functions, only available downstream as saved MIR
+
+#[inline]
+pub fn add_one(v: u32) -> u32 {
+    v + 1
+}
+
+#[inline]
+pub fn select(flag: bool, a: u32, b: u32) -> u32 {
+    if flag { add_one(a) } else { b }
+}
+
+/// Generic, and too large to be inlined into `wrap` here - so it's monomorphised downstream
+pub fn mix<T: ::std::ops::Add<Output=T> + Copy + PartialOrd>(v: T, w: T) -> T {
+    let a = v + w;
+    let b = a + v;
+    let c = b + w;
+    let d = c + a;
+    let e = d + b;
+    if v < w { e + c } else { d + a }
+}
+
+#[inline]
+pub fn wrap(v: u32) -> u32 {
+    if v < 10 { mix(v, 5) } else { v }
+}
@@ -0,0 +1,24 @@
+// compile-flags: -Z share-generics
+
+pub fn sum<T: Copy + ::std::ops::Add<Output=T>>(v: &[T], init: T) -> T {
+    let mut acc = init;
+    for &x in v {
+        acc = acc + x;
+    }
+    acc
+}
+
+#[inline]
+pub fn double<T: Copy + ::std::ops::Add<Output=T>>(v: T) -> T {
+    v + v
+}
+
+// Instantiated here, so downstream crates can reuse these copies
+pub fn use_generics() -> u32 {
+    sum(&[1u32, 2, 3], 0) + double(4u32)
+}
+
+// Address of this crate's `sum::<u32>`, compared against the downstream crate's view of it
+pub fn sum_u32_ptr() -> fn(&[u32], u32) -> u32 {
+    sum::<u32>
+}
@@ -0,0 +1,10 @@
+// aux-build:inline_upstream_aux.rs
+//
+// Inlining of upstream non-generic functions (which have no HIR, only saved MIR)
+extern crate inline_upstream_aux;
+
+fn main() {
+    assert_eq!(inline_upstream_aux::add_one(41), 42);
+    assert_eq!(inline_upstream_aux::select(true, 1, 5), 2);
+    assert_eq!(inline_upstream_aux::select(false, 1, 5), 5);
+}
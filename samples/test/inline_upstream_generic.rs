@@ -0,0 +1,10 @@
+// aux-build:inline_upstream_aux.rs
+//
+// Inlining an upstream function whose saved MIR is the only caller of a local monomorphisation (`mix::<u32>`)
+// - The monomorphisation must be processed before the function it gets inlined into
+extern crate inline_upstream_aux;
+
+fn main() {
+    assert_eq!(inline_upstream_aux::wrap(3), 51);
+    assert_eq!(inline_upstream_aux::wrap(12), 12);
+}
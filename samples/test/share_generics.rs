@@ -0,0 +1,19 @@
+// aux-build:share_generics_aux.rs
+// compile-flags: -Z share-generics
+//
+// Monomorphisations shared from an upstream crate (`sum::<u32>`), alongside local ones (`sum::<i64>`) and
+// `#[inline]` functions (always emitted locally).
+// - The shared instance must be the one used (a local copy would have a different address)
+extern crate share_generics_aux;
+
+use share_generics_aux::{sum, double};
+
+fn main() {
+    assert_eq!(share_generics_aux::use_generics(), 14);
+    assert_eq!(sum(&[4u32, 5, 6], 1), 16);
+    let local_sum_u32: fn(&[u32], u32) -> u32 = sum::<u32>;
+    assert!(local_sum_u32 as usize == share_generics_aux::sum_u32_ptr() as usize, "sum::<u32> wasn't shared");
+    assert_eq!(sum(&[-4i64, 5, -6], 0), -5);
+    assert_eq!(double(21u32), 42);
+    assert_eq!(double(1.5f64), 3.0);
+}
@@ -52,6 +52,12 @@ namespace {
         //    iterate_module(*anon, fcn);
         //}
     }
+    /// Check if a crate file can be loaded
+    /// - Only the metadata (`.hir`) is needed, the library itself may still be being generated (pipelined builds)
+    bool crate_file_exists(const ::std::string& path)
+    {
+        return ::std::ifstream(path).good() || ::std::ifstream(path + ".hir").good();
+    }
 }
 
 
@@ -153,7 +159,7 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
     if(basename == "" && it != g_crate_overrides.end())
     {
         path = it->second;
-        if( !::std::ifstream(path).good() ) {
+        if( !crate_file_exists(path) ) {
             ERROR(sp, E0000, "Unable to open crate '" << name << "' at path " << path);
         }
         DEBUG("path = " << path << " (--extern)");
@@ -167,7 +173,7 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
         {
             path = p + "/" + basename;
 
-            if( ::std::ifstream(path).good() ) {
+            if( crate_file_exists(path) ) {
                 // Ensure that if this is loaded, it yields the right name (otherwise skip)
                 auto n = HIR_Deserialise_JustName(path);
                 if( n == name ) {
@@ -175,7 +181,7 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
                 }
             }
         }
-        if( !::std::ifstream(path).good() ) {
+        if( !crate_file_exists(path) ) {
             ERROR(sp, E0000, "Unable to locate crate '" << name << "' with filename " << basename << " in search directories");
         }
         DEBUG("path = " << path << " (basename)");
@@ -192,11 +198,11 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
         for(const auto& p : g_crate_load_dirs)
         {
             path = p + "/" + direct_filename;
-            if( ::std::ifstream(path).good() ) {
+            if( crate_file_exists(path) ) {
                 paths.push_back(path);
             }
             path = p + "/" + direct_filename_so;
-            if( ::std::ifstream(path).good() ) {
+            if( crate_file_exists(path) ) {
                 paths.push_back(path);
             }
             path = "";
@@ -255,7 +261,7 @@ RcString Crate::load_extern_crate(Span sp, const RcString& name, const ::std::st
         if( paths.size() > 1 ) {
             ERROR(sp, E0000, "Multiple options for crate '" << name << "' in search directories - " << paths);
         }
-        if( paths.size() == 0 || !::std::ifstream(paths.front()).good() ) {
+        if( paths.size() == 0 || !crate_file_exists(paths.front()) ) {
             ERROR(sp, E0000, "Unable to locate crate '" << name << "' in search directories");
         }
         path = paths.front();
@@ -12,13 +12,137 @@
 #include <iomanip>
 #include <common.hpp>   // FmtEscaped
 #include <cstring>	// strchr
+#include <cstdlib>
+#include <atomic>
+#include <vector>
+#include <fstream>
+#include <new>
+#ifdef _WIN32
+# define NOGDI
+# include <Windows.h>
+# include <Psapi.h>
+# pragma comment(lib, "psapi.lib")
+#else
+# include <sys/resource.h>
+# include <unistd.h>
+#endif
 
 
-int g_debug_indent_level = 0;
+thread_local int g_debug_indent_level = 0;
 bool g_debug_enabled = true;
 ::std::string g_cur_phase;
 ::std::set< ::std::string>    g_debug_disable_map;
 
+namespace {
+    // Allocation counters, updated by the global `operator new` below (only once `--timings-out` is given)
+    ::std::atomic<bool> s_count_allocs;
+    ::std::atomic<uint64_t> s_alloc_count;
+    ::std::atomic<uint64_t> s_alloc_bytes;
+
+    struct PhaseTimings {
+        ::std::string   name;
+        double  wall_s;
+        double  cpu_s;
+        uint64_t    rss_cur_kb;
+        uint64_t    rss_peak_kb;
+        uint64_t    alloc_count;
+        uint64_t    alloc_bytes;
+    };
+    ::std::string   s_timings_path;
+    ::std::vector<PhaseTimings> s_timings;
+
+    /// Returns (current RSS, peak RSS) in KiB, zero if not available on this platform
+    ::std::pair<uint64_t,uint64_t> get_rss_kb()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS pmc;
+        if( GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) )
+            return ::std::make_pair( static_cast<uint64_t>(pmc.WorkingSetSize / 1024), static_cast<uint64_t>(pmc.PeakWorkingSetSize / 1024) );
+        return ::std::make_pair(0, 0);
+#else
+        uint64_t    cur = 0;
+        uint64_t    peak = 0;
+        struct rusage   ru;
+        if( getrusage(RUSAGE_SELF, &ru) == 0 ) {
+# ifdef __APPLE__
+            peak = ru.ru_maxrss / 1024; // Bytes on OSX
+# else
+            peak = ru.ru_maxrss;
+# endif
+        }
+        if( FILE* fp = fopen("/proc/self/statm", "r") ) {
+            unsigned long   size, resident;
+            if( fscanf(fp, "%lu %lu", &size, &resident) == 2 )
+                cur = static_cast<uint64_t>(resident) * (sysconf(_SC_PAGESIZE) / 1024);
+            fclose(fp);
+        }
+        return ::std::make_pair(cur, peak);
+#endif
+    }
+
+    void write_timings()
+    {
+        ::std::ofstream os(s_timings_path);
+        if( !os.good() ) {
+            ::std::cerr << "WARN: Unable to open timings file '" << s_timings_path << "'" << ::std::endl;
+            return ;
+        }
+        bool is_csv = s_timings_path.size() > 4 && s_timings_path.compare(s_timings_path.size() - 4, 4, ".csv") == 0;
+        os << ::std::fixed << ::std::setprecision(6);
+        if( is_csv )
+        {
+            os << "phase,wall_s,cpu_s,rss_kb,peak_rss_kb,allocs,alloc_bytes\n";
+            for(const auto& t : s_timings)
+            {
+                os << "\"" << t.name << "\"," << t.wall_s << "," << t.cpu_s << "," << t.rss_cur_kb << "," << t.rss_peak_kb
+                    << "," << t.alloc_count << "," << t.alloc_bytes << "\n";
+            }
+        }
+        else
+        {
+            os << "[\n";
+            for(size_t i = 0; i < s_timings.size(); i ++)
+            {
+                const auto& t = s_timings[i];
+                os << "  {\"phase\": \"" << FmtEscaped(t.name) << "\""
+                    << ", \"wall_s\": " << t.wall_s << ", \"cpu_s\": " << t.cpu_s
+                    << ", \"rss_kb\": " << t.rss_cur_kb << ", \"peak_rss_kb\": " << t.rss_peak_kb
+                    << ", \"allocs\": " << t.alloc_count << ", \"alloc_bytes\": " << t.alloc_bytes
+                    << "}" << (i + 1 < s_timings.size() ? "," : "") << "\n";
+            }
+            os << "]\n";
+        }
+    }
+}
+
+void* operator new(size_t size)
+{
+    if( s_count_allocs.load(::std::memory_order_relaxed) )
+    {
+        s_alloc_count.fetch_add(1, ::std::memory_order_relaxed);
+        s_alloc_bytes.fetch_add(size, ::std::memory_order_relaxed);
+    }
+    if( size == 0 )
+        size = 1;
+    while(true)
+    {
+        if( void* rv = malloc(size) )
+            return rv;
+        auto handler = ::std::get_new_handler();
+        if( !handler )
+            throw ::std::bad_alloc();
+        handler();
+    }
+}
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void* ptr, size_t ) noexcept
+{
+    free(ptr);
+}
+
 TraceLog::TraceLog(const char* tag, ::std::function<void(::std::ostream&)> info_cb, ::std::function<void(::std::ostream&)> ret):
     m_tag(tag),
     m_ret(ret)
@@ -88,18 +212,44 @@ DebugTimedPhase::DebugTimedPhase(const char* name):
     ::std::cout << m_name << ": V V V" << ::std::endl;
     g_cur_phase = m_name;
     g_debug_enabled = debug_enabled_update();
+    m_alloc_count_start = s_alloc_count.load(::std::memory_order_relaxed);
+    m_alloc_bytes_start = s_alloc_bytes.load(::std::memory_order_relaxed);
+    m_wall_start = ::std::chrono::steady_clock::now();
     m_start = clock();
 }
 DebugTimedPhase::~DebugTimedPhase()
 {
     auto end = clock();
+    auto wall_end = ::std::chrono::steady_clock::now();
     g_cur_phase = "";
     g_debug_enabled = debug_enabled_update();
 
-    // TODO: Show wall time too?
-    ::std::cout << "(" << ::std::fixed << ::std::setprecision(2) << static_cast<double>(end - m_start) / static_cast<double>(CLOCKS_PER_SEC) << " s) ";
+    double cpu_s = static_cast<double>(end - m_start) / static_cast<double>(CLOCKS_PER_SEC);
+    double wall_s = ::std::chrono::duration<double>(wall_end - m_wall_start).count();
+    ::std::cout << "(" << ::std::fixed << ::std::setprecision(2) << cpu_s << " s, " << wall_s << " s wall) ";
     ::std::cout << m_name << ": DONE";
     ::std::cout << ::std::endl;
+
+    if( !s_timings_path.empty() )
+    {
+        auto rss = get_rss_kb();
+        s_timings.push_back(PhaseTimings {
+            m_name, wall_s, cpu_s, rss.first, rss.second,
+            s_alloc_count.load(::std::memory_order_relaxed) - m_alloc_count_start,
+            s_alloc_bytes.load(::std::memory_order_relaxed) - m_alloc_bytes_start
+            });
+    }
+}
+
+void debug_set_timings_output(const char* path)
+{
+    if( s_timings_path.empty() )
+    {
+        // Written at exit, so early exits (e.g. on error) still produce a file
+        ::std::atexit(write_timings);
+    }
+    s_timings_path = path;
+    s_count_allocs.store(true, ::std::memory_order_relaxed);
 }
 
 extern void debug_init_phases(const char* env_var_name, std::initializer_list<const char*> il)
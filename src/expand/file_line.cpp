@@ -11,13 +11,13 @@
 #include <ast/crate.hpp>
 
 namespace {
-    const Span& get_top_span(const Span& sp) {
-        auto* top_span = &sp;
-        while((*top_span)->parent_span != Span())
+    Span get_top_span(const Span& sp) {
+        auto top_span = sp;
+        while(top_span->parent_span != Span())
         {
-            top_span = &(*top_span)->parent_span;
+            top_span = top_span->parent_span;
         }
-        return *top_span;
+        return top_span;
     }
 }
 
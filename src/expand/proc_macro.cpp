@@ -22,6 +22,7 @@
 # include <unistd.h>    // read/write/pipe
 # include <spawn.h>
 # include <sys/wait.h>
+# include <fcntl.h>   // fcntl
 #endif
 
 #if defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__) || defined(__DragonFly__) || defined(__APPLE__)
@@ -173,22 +174,19 @@ enum class FragType
     Block = 6,
     Pattern = 7,
 };
-struct ProcMacroInv:
-    public TokenStream
+/// A running proc macro executable
+///
+/// In server mode (`<exe> --server`) the process stays alive for the whole compilation and handles every invocation
+/// of that executable's macros, each request being the macro name followed by the usual token exchange. Otherwise
+/// (`<exe> <macro name>`, used if the executable doesn't support server mode) it handles a single invocation.
+struct ProcMacroHost
 {
-    Span    m_parent_span;
-    const ::HIR::ProcMacro& m_proc_macro_desc;
-    ::std::ofstream m_dump_file_out;
-    ::std::ofstream m_dump_file_res;
+    const bool  m_is_server;
+    /// Set when an invocation didn't read the entire response, the process can't be used for another request
+    bool    m_desync = false;
 
     struct Handles
     {
-        //~Handles();
-        Handles() {}
-        Handles(Handles&&);
-        Handles(const Handles&) = delete;
-        Handles& operator=(Handles&&) = delete;
-        Handles& operator=(const Handles&) = delete;
 #ifdef _WIN32
         HANDLE  child_handle;
         HANDLE  child_stdin;
@@ -201,6 +199,32 @@ struct ProcMacroInv:
         // NOTE: stderr stays as our stderr
 #endif
     } handles;
+
+    ProcMacroHost(const Span& sp, const char* executable, const char* arg, bool is_server);
+    ProcMacroHost(const ProcMacroHost&) = delete;
+    ProcMacroHost& operator=(const ProcMacroHost&) = delete;
+    ~ProcMacroHost();
+
+    /// Get a host for an invocation of the named macro (starting a server for this executable if not yet running)
+    static ::std::shared_ptr<ProcMacroHost> get(const Span& sp, const char* executable, const RcString& macro_name);
+
+    /// Read the status byte sent by the child (on startup, and in response to a server request)
+    bool check_good();
+    /// Returns false on error
+    bool write(const void* val, size_t size);
+    /// Returns the number of bytes read (0 on EOF, negative on error)
+    int64_t read(void* val, size_t size);
+};
+
+struct ProcMacroInv:
+    public TokenStream
+{
+    Span    m_parent_span;
+    const ::HIR::ProcMacro& m_proc_macro_desc;
+    ::std::ofstream m_dump_file_out;
+    ::std::ofstream m_dump_file_res;
+
+    ::std::shared_ptr<ProcMacroHost>    m_host;
     bool    m_eof_hit = false;
 
 public:
@@ -1122,8 +1146,87 @@ ProcMacroInv::ProcMacroInv(const Span& sp, AST::Edition edition, const char* exe
     {
         DEBUG("Set MRUSTC_DUMP_PROCMACRO=dump_prefix to dump to `dump_prefix-NNN-{out,res}.bin`");
     }
+    m_host = ProcMacroHost::get(sp, executable, proc_macro_desc.name);
+}
+ProcMacroInv::~ProcMacroInv()
+{
+    if( m_host && m_host->m_is_server && !m_eof_hit )
+    {
+        DEBUG("Response not fully read, proc macro server will be restarted");
+        m_host->m_desync = true;
+    }
+}
+bool ProcMacroInv::check_good()
+{
+    if( m_host->m_is_server )
+    {
+        // Request the macro by name, the server replies with a status byte
+        const auto& name = m_proc_macro_desc.name;
+        uint8_t len_buf[10];
+        size_t  len_len = 0;
+        for(size_t v = name.size(); ; v >>= 7)
+        {
+            len_buf[len_len++] = static_cast<uint8_t>(v & 0x7F) | (v >= 128 ? 0x80 : 0);
+            if( v < 128 )
+                break;
+        }
+        if( !m_host->write(len_buf, len_len) || !m_host->write(name.c_str(), name.size()) )
+        {
+            DEBUG("Error sending request to proc macro server");
+            m_host->m_desync = true;
+            return false;
+        }
+    }
+    if( !m_host->check_good() )
+    {
+        m_host->m_desync = true;
+        return false;
+    }
+    return true;
+}
+
+::std::shared_ptr<ProcMacroHost> ProcMacroHost::get(const Span& sp, const char* executable, const RcString& macro_name)
+{
+    // Servers live until the end of the compilation (destroyed on exit, which closes their stdin)
+    static ::std::map< ::std::string, ::std::shared_ptr<ProcMacroHost> >  s_servers;
+    // Executables that failed to start as a server (e.g. built against an older libproc_macro)
+    static ::std::set< ::std::string>   s_no_server;
+
+    if( !getenv("MRUSTC_PROCMACRO_NO_SERVER") && s_no_server.count(executable) == 0 )
+    {
+        auto it = s_servers.find(executable);
+        if( it != s_servers.end() && it->second->m_desync )
+        {
+            DEBUG("Restarting proc macro server for " << executable);
+            s_servers.erase(it);
+            it = s_servers.end();
+        }
+        if( it == s_servers.end() )
+        {
+            auto host = ::std::make_shared<ProcMacroHost>(sp, executable, "--server", true);
+            if( host->check_good() )
+            {
+                it = s_servers.insert(::std::make_pair(::std::string(executable), mv$(host))).first;
+            }
+            else
+            {
+                DEBUG("`" << executable << "` doesn't support server mode, using a process per invocation");
+                s_no_server.insert(executable);
+            }
+        }
+        if( it != s_servers.end() )
+        {
+            return it->second;
+        }
+    }
+    return ::std::make_shared<ProcMacroHost>(sp, executable, macro_name.c_str(), false);
+}
+
+ProcMacroHost::ProcMacroHost(const Span& sp, const char* executable, const char* arg, bool is_server):
+    m_is_server(is_server)
+{
 #ifdef _WIN32
-    std::string commandline = std::string{ executable } + " " + proc_macro_desc.name.c_str();
+    std::string commandline = std::string{ executable } + " " + arg;
     DEBUG(commandline);
 
     HANDLE stdin_read = INVALID_HANDLE_VALUE;
@@ -1199,7 +1302,7 @@ ProcMacroInv::ProcMacroInv(const Span& sp, AST::Edition edition, const char* exe
     posix_spawn_file_actions_addclose(&file_actions, stdout_pipes[0]);
     posix_spawn_file_actions_addclose(&file_actions, stdout_pipes[1]);
 
-    char*   argv[3] = { const_cast<char*>(executable), const_cast<char*>(proc_macro_desc.name.c_str()), nullptr };
+    char*   argv[3] = { const_cast<char*>(executable), const_cast<char*>(arg), nullptr };
     DEBUG(argv[0] << " " << argv[1]);
     //char*   envp[] = { nullptr };
     int rv = posix_spawn(&this->handles.child_pid, executable, &file_actions, nullptr, argv, environ);
@@ -1212,75 +1315,34 @@ ProcMacroInv::ProcMacroInv(const Span& sp, AST::Edition edition, const char* exe
     // Close the ends we don't care about.
     close(stdin_pipes[0]);
     close(stdout_pipes[1]);
+    // Don't leak our ends into later children (a server only exits once every copy of its stdin is closed)
+    fcntl(this->handles.child_stdin, F_SETFD, FD_CLOEXEC);
+    fcntl(this->handles.child_stdout, F_SETFD, FD_CLOEXEC);
 
 #endif
 }
-ProcMacroInv::Handles::Handles(Handles&& x):
-#ifdef _WIN32
-    child_handle(x.child_handle),
-    child_stdin(x.child_stdin),
-    child_stdout(x.child_stdout)
-#else
-    child_pid(x.child_pid),
-    child_stdin(x.child_stdin),
-    child_stdout(x.child_stdout)
-#endif
-{
-#ifdef _WIN32
-    x.child_handle = INVALID_HANDLE_VALUE;
-    x.child_stdin = INVALID_HANDLE_VALUE;
-    x.child_stdout = INVALID_HANDLE_VALUE;
-#else
-    x.child_pid = 0;
-    x.child_stdin = -1;
-    x.child_stdout = -1;
-#endif
-    DEBUG("");
-}
-#if 0
-ProcMacroInv::Handles& ProcMacroInv::Handles::operator=(Handles&& x)
-{
-#ifdef _WIN32
-    child_handle = x.child_handle;
-    child_stdin  = x.child_stdin;
-    child_stdout = x.child_stdout;
-    x.child_handle = INVALID_HANDLE_VALUE;
-    x.child_stdin = INVALID_HANDLE_VALUE;
-    x.child_stdout = INVALID_HANDLE_VALUE;
-#else
-    child_pid = x.child_pid;
-    child_stdin = x.child_stdin;
-    child_stdout = x.child_stdout;
-
-    x.child_pid = 0;
-#endif
-    DEBUG("");
-    return *this;
-}
-#endif
-ProcMacroInv::~ProcMacroInv()
+ProcMacroHost::~ProcMacroHost()
 {
+    // Close both pipes before waiting, so the child sees EOF on its input (server) and can't block writing unread output
 #ifdef _WIN32
     if( this->handles.child_handle != INVALID_HANDLE_VALUE )
     {
-        DEBUG("Waiting for child to terminate");
-        WaitForSingleObject(this->handles.child_handle, INFINITE);
-        CloseHandle(this->handles.child_stdout);
         CloseHandle(this->handles.child_stdin);
+        CloseHandle(this->handles.child_stdout);
+        WaitForSingleObject(this->handles.child_handle, INFINITE);
         CloseHandle(this->handles.child_handle);
     }
 #else
     if( this->handles.child_pid != 0 )
     {
-        DEBUG("Waiting for child " << this->handles.child_pid << " to terminate");
+        close(this->handles.child_stdin);
+        close(this->handles.child_stdout);
         int status;
         waitpid(this->handles.child_pid, &status, 0);
-        close(this->handles.child_stdout);
-        close(this->handles.child_stdin);
     }
 #endif
 }
-bool ProcMacroInv::check_good()
+bool ProcMacroHost::check_good()
 {
     char    v;
 #ifdef _WIN32
@@ -1291,7 +1353,7 @@ bool ProcMacroInv::check_good()
         return false;
     }
 #else
-    int rv = read(this->handles.child_stdout, &v, 1);
+    int rv = ::read(this->handles.child_stdout, &v, 1);
 #endif
     if( rv == 0 )
     {
@@ -1310,6 +1372,27 @@ bool ProcMacroInv::check_good()
         return false;
     return true;
 }
+bool ProcMacroHost::write(const void* val, size_t size)
+{
+#ifdef _WIN32
+    DWORD bytesWritten = 0;
+    return WriteFile(this->handles.child_stdin, val, size, &bytesWritten, nullptr) && bytesWritten == size;
+#else
+    return ::write(this->handles.child_stdin, val, size) == static_cast<ssize_t>(size);
+#endif
+}
+int64_t ProcMacroHost::read(void* val, size_t size)
+{
+#ifdef _WIN32
+    DWORD n = 0;
+    if( !ReadFile(this->handles.child_stdout, val, size, &n, nullptr) )
+        return -1;
+    return n;
+#else
+    return ::read(this->handles.child_stdout, val, size);
+#endif
+}
+
 void ProcMacroInv::send_u8(uint8_t v)
 {
     this->send_bytes_raw(&v, 1);
@@ -1323,14 +1406,15 @@ void ProcMacroInv::send_bytes_raw(const void* val, size_t size)
 {
     if( m_dump_file_out.is_open() )
         m_dump_file_out.write( reinterpret_cast<const char*>(val), size);
+    if( !m_host->write(val, size) )
+    {
+        m_host->m_desync = true;
 #ifdef _WIN32
-    DWORD bytesWritten = 0;
-    if( !WriteFile(this->handles.child_stdin, val, size, &bytesWritten, nullptr) || bytesWritten != size )
         BUG(m_parent_span, "Error writing to child, " << GetLastError());
 #else
-    if( write(this->handles.child_stdin, val, size) != static_cast<ssize_t>(size) )
         BUG(m_parent_span, "Error writing to child, " << strerror(errno));
 #endif
+    }
 }
 void ProcMacroInv::send_v128u(uint64_t val)
 {
@@ -1363,16 +1447,13 @@ void ProcMacroInv::recv_bytes_raw(void* out_void, size_t len)
     size_t  ofs = 0, rem = len;
     while( rem > 0 )
     {
-#ifdef _WIN32
-        DWORD n;
-        ReadFile(this->handles.child_stdout, &val[ofs], rem, &n, nullptr);
-#else
-        auto n = read(this->handles.child_stdout, &val[ofs], rem);
-#endif
+        auto n = m_host->read(&val[ofs], rem);
         if( n == 0 ) {
+            m_host->m_desync = true;
             BUG(this->m_parent_span, "Unexpected EOF while reading from child process");
         }
         if( n < 0 ) {
+            m_host->m_desync = true;
             BUG(this->m_parent_span, "Error while reading from child process");
         }
         assert(static_cast<size_t>(n) <= rem);
@@ -22,6 +22,21 @@
     {
     };
 
+    /// Deferred decode of a MIR blob from crate metadata
+    class LazyMirLoader:
+        public ::MIR::FunctionLoader
+    {
+        ::HIR::serialise::BlobRef   m_blob;
+        RcString    m_crate_name;
+    public:
+        LazyMirLoader(::HIR::serialise::BlobRef blob, RcString crate_name):
+            m_blob(mv$(blob)),
+            m_crate_name(mv$(crate_name))
+        {
+        }
+        ::MIR::Function* load() override;
+    };
+
     class HirDeserialiser
     {
         RcString m_crate_name;
@@ -31,6 +46,10 @@
         HirDeserialiser(::HIR::serialise::Reader& in):
             m_in(in)
         {}
+        HirDeserialiser(::HIR::serialise::Reader& in, RcString crate_name):
+            m_crate_name(mv$(crate_name)),
+            m_in(in)
+        {}
 
         RcString read_istring() { return m_in.read_istring(); }
         ::std::string read_string() { return m_in.read_string(); }
@@ -494,12 +513,13 @@
             auto _ = m_in.open_object("HIR::ExprPtr");
             if( m_in.read_bool() )
             {
-                rv.m_mir = deserialise_mir();
+                // MIR is stored as a blob, decoded on first access
+                rv.m_mir = ::MIR::FunctionPointer( new LazyMirLoader(m_in.raw_skip_blob(), m_crate_name) );
             }
             rv.m_erased_types = deserialise_vec< ::HIR::TypeRef>();
             return rv;
         }
-        ::MIR::FunctionPointer deserialise_mir();
+        ::MIR::Function deserialise_mir_function();
         ::MIR::BasicBlock deserialise_mir_basicblock();
         ::MIR::Statement deserialise_mir_statement();
         ::MIR::Terminator deserialise_mir_terminator();
@@ -741,9 +761,10 @@
                 deserialise_genericparams(),
                 deserialise_fcnargs(),
                 m_in.read_bool(),
-                deserialise_type(),
-                deserialise_exprptr()
+                deserialise_type()
                 };
+            rv.m_inline_hint = static_cast< ::HIR::Function::InlineHint>( m_in.read_tag() );
+            rv.m_code = deserialise_exprptr();
             return rv;
         }
         ::std::vector< ::std::pair< ::HIR::Pattern, ::HIR::TypeRef> >   deserialise_fcnargs()
@@ -1356,7 +1377,7 @@
         return rv;
     }
 
-    ::MIR::FunctionPointer HirDeserialiser::deserialise_mir()
+    ::MIR::Function HirDeserialiser::deserialise_mir_function()
     {
         TRACE_FUNCTION;
 
@@ -1367,7 +1388,22 @@
         rv.drop_flags = deserialise_vec<bool>();
         rv.blocks = deserialise_vec< ::MIR::BasicBlock>( );
 
-        return ::MIR::FunctionPointer( new ::MIR::Function(mv$(rv)) );
+        return rv;
+    }
+    ::MIR::Function* LazyMirLoader::load()
+    {
+        TRACE_FUNCTION_F(m_crate_name);
+        try
+        {
+            ::HIR::serialise::Reader    in { m_blob };
+            HirDeserialiser s { in, m_crate_name };
+            return new ::MIR::Function( s.deserialise_mir_function() );
+        }
+        catch(const ::std::runtime_error& e)
+        {
+            ::std::cerr << "Unable to deserialise MIR from crate " << m_crate_name << ": " << e.what() << ::std::endl;
+            ::std::abort();
+        }
     }
     ::MIR::BasicBlock HirDeserialiser::deserialise_mir_basicblock()
     {
@@ -1560,6 +1596,16 @@
         rv.m_ext_libs = deserialise_vec< ::HIR::ExternLibrary>();
         rv.m_link_paths = deserialise_vec< ::std::string>();
 
+        {
+            size_t n = m_in.read_count();
+            for(size_t i = 0; i < n; i ++)
+            {
+                auto path = deserialise_path();
+                auto symbol = m_in.read_string();
+                rv.m_shared_generics.insert( ::std::make_pair( mv$(path), mv$(symbol) ) );
+            }
+        }
+
         //rv.m_proc_macros = deserialise_vec< ::HIR::ProcMacro>();
 
         return rv;
@@ -6,11 +6,40 @@
  * - HIR expression helper code
  */
 #include <hir/expr.hpp>
+#include <hir/expr_ptr.hpp>
 
 ::HIR::ExprNode::~ExprNode()
 {
 }
 
+void* HIR::ExprNode::operator new(size_t size)
+{
+    // The owning arena (or nullptr for heap allocations) is stored just before the node
+    auto* arena = ::HIR::ExprArena::current();
+    char*   base;
+    if( arena ) {
+        base = static_cast<char*>(arena->allocate(::HIR::ExprArena::NODE_HEADER + size));
+        arena->add_ref();
+    }
+    else {
+        base = static_cast<char*>(::operator new(::HIR::ExprArena::NODE_HEADER + size));
+    }
+    *reinterpret_cast<::HIR::ExprArena**>(base) = arena;
+    return base + ::HIR::ExprArena::NODE_HEADER;
+}
+void HIR::ExprNode::operator delete(void* ptr)
+{
+    if( !ptr )
+        return ;
+    char*   base = static_cast<char*>(ptr) - ::HIR::ExprArena::NODE_HEADER;
+    if( auto* arena = *reinterpret_cast<::HIR::ExprArena**>(base) ) {
+        arena->release();
+    }
+    else {
+        ::operator delete(base);
+    }
+}
+
 #define DEF_VISIT(nt, n, code)   void ::HIR::nt::visit(ExprVisitor& nv) { nv.visit_node(*this); nv.visit(*this); } void ::HIR::ExprVisitorDef::visit(::HIR::nt& n) { code }
 
 void ::HIR::ExprVisitor::visit_node_ptr(::std::unique_ptr< ::HIR::ExprNode>& node_ptr) {
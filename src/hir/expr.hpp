@@ -59,6 +59,10 @@ public:
         m_span( mv$(sp) )
     {}
     virtual ~ExprNode();
+
+    /// Nodes are allocated from the current thread's `ExprArena` (or the heap if there isn't one)
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
 };
 
 typedef ::std::unique_ptr<ExprNode> ExprNodeP;
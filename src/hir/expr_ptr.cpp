@@ -8,17 +8,85 @@
 #include <hir/expr_ptr.hpp>
 #include <hir/expr.hpp>
 #include <hir/expr_state.hpp>
+#include <algorithm>
 
 ::HIR::ExprPtr::ExprPtr(::std::unique_ptr< ::HIR::ExprNode> v):
     node( mv$(v) )
 {
 }
+::HIR::ExprPtr::ExprPtr(::std::unique_ptr< ::HIR::ExprNode> v, ::HIR::ExprArenaRef arena):
+    node( mv$(v) ),
+    m_arena( mv$(arena) )
+{
+}
 ::std::unique_ptr< ::HIR::ExprNode> HIR::ExprPtr::into_unique()
 {
     return node.into_unique();
 }
 
 
+namespace {
+    thread_local ::HIR::ExprArena*  tl_current_arena = nullptr;
+
+    const size_t ARENA_FIRST_CHUNK = 4*1024;
+    const size_t ARENA_MAX_CHUNK = 256*1024;
+}
+
+::HIR::ExprArena::ExprArena():
+    m_refcount(1),
+    m_cur(nullptr),
+    m_end(nullptr),
+    m_next_chunk_size(ARENA_FIRST_CHUNK)
+{
+}
+::HIR::ExprArena::~ExprArena()
+{
+    for(auto* c : m_chunks)
+        ::operator delete(c);
+}
+::HIR::ExprArena* HIR::ExprArena::create()
+{
+    return new ExprArena();
+}
+void HIR::ExprArena::release()
+{
+    if( m_refcount.fetch_sub(1, ::std::memory_order_acq_rel) == 1 )
+    {
+        delete this;
+    }
+}
+void* HIR::ExprArena::allocate(size_t size)
+{
+    // Keep every allocation aligned to the header size (which is the maximum fundamental alignment)
+    size = (size + NODE_HEADER - 1) & ~(NODE_HEADER - 1);
+    if( static_cast<size_t>(m_end - m_cur) < size )
+    {
+        // Chunks double in size (so small trees stay small), larger nodes get their own chunk
+        size_t  chunk_size = ::std::max(m_next_chunk_size, size);
+        if( m_next_chunk_size < ARENA_MAX_CHUNK )
+            m_next_chunk_size *= 2;
+        m_cur = static_cast<char*>(::operator new(chunk_size));
+        m_end = m_cur + chunk_size;
+        m_chunks.push_back(m_cur);
+    }
+    auto* rv = m_cur;
+    m_cur += size;
+    return rv;
+}
+::HIR::ExprArena* HIR::ExprArena::current()
+{
+    return tl_current_arena;
+}
+::HIR::ExprArena::Scope::Scope(ExprArena* arena):
+    m_prev(tl_current_arena)
+{
+    tl_current_arena = arena;
+}
+::HIR::ExprArena::Scope::~Scope()
+{
+    tl_current_arena = m_prev;
+}
+
 ::HIR::ExprPtrInner::ExprPtrInner(::std::unique_ptr< ::HIR::ExprNode> v):
     ptr( v.release() )
 {
@@ -8,6 +8,8 @@
 #pragma once
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <cstddef>
 #include <cassert>
 
 #include <mir/mir_ptr.hpp>
@@ -21,6 +23,61 @@ class ExprNode;
 class Crate;
 class ExprState;
 
+/// Bump allocator for the nodes of one expression tree (used by `ExprNode::operator new`)
+/// - Reference counted: the owning `ExprPtr` holds a reference, as does each live node (so nodes moved to
+///   another tree keep the memory alive)
+/// - Chunks are released all at once when the last reference goes (usually when the tree is replaced after MIR generation)
+/// - Not thread-safe for allocation, only the thread that has the arena active (via `Scope`) may allocate from it
+class ExprArena
+{
+    ::std::atomic<size_t>   m_refcount;
+    ::std::vector<char*>    m_chunks;
+    char*   m_cur;
+    char*   m_end;
+    size_t  m_next_chunk_size;
+
+    ExprArena();
+    ~ExprArena();
+public:
+    /// Space reserved before each node to record the owning arena (keeps the node aligned)
+    static const size_t NODE_HEADER = alignof(::std::max_align_t);
+
+    /// Create a new arena with a single reference
+    static ExprArena* create();
+    void add_ref() { m_refcount.fetch_add(1, ::std::memory_order_relaxed); }
+    void release();
+
+    void* allocate(size_t size);
+
+    /// Arena that new nodes are allocated from on this thread (nullptr means the heap)
+    static ExprArena* current();
+    /// Sets the current arena for the lifetime of the scope
+    class Scope
+    {
+        ExprArena*  m_prev;
+    public:
+        Scope(ExprArena* arena);
+        Scope(const Scope&) = delete;
+        ~Scope();
+    };
+};
+/// Owning reference to an `ExprArena`
+class ExprArenaRef
+{
+    ExprArena*  ptr;
+public:
+    ExprArenaRef(): ptr(nullptr) {}
+    explicit ExprArenaRef(ExprArena* p): ptr(p) {}
+    ExprArenaRef(const ExprArenaRef&) = delete;
+    ExprArenaRef(ExprArenaRef&& x): ptr(x.ptr) { x.ptr = nullptr; }
+    ~ExprArenaRef() { if(ptr) ptr->release(); }
+
+    ExprArenaRef& operator=(const ExprArenaRef&) = delete;
+    ExprArenaRef& operator=(ExprArenaRef&& x) { this->~ExprArenaRef(); ptr = x.ptr; x.ptr = nullptr; return *this; }
+
+    ExprArena* get() const { return ptr; }
+};
+
 class ExprPtrInner
 {
     ::HIR::ExprNode* ptr;
@@ -82,6 +139,8 @@ class ExprPtr
 {
     //::HIR::Path m_path;
     ::HIR::ExprPtrInner node;
+    /// Arena the tree was lowered into (null for trees created elsewhere)
+    ::HIR::ExprArenaRef m_arena;
 
 
 public:
@@ -97,6 +156,7 @@ public:
 public:
     ExprPtr() {}
     ExprPtr(::std::unique_ptr< ::HIR::ExprNode> _);
+    ExprPtr(::std::unique_ptr< ::HIR::ExprNode> _, ::HIR::ExprArenaRef arena);
     ExprPtr(const ExprPtr&) = delete;
     ExprPtr(ExprPtr&&) = default;
     ExprPtr& operator=(ExprPtr&&) = default;
@@ -107,6 +167,11 @@ public:
     ::HIR::ExprNode* get() const { return node.get(); }
     void reset(::HIR::ExprNode* p) { node.reset(p); }
 
+    /// Arena to allocate new nodes for this tree from (can be null)
+    ::HIR::ExprArena* arena() const { return m_arena.get(); }
+    /// Drop the tree's reference to its arena, the memory is released once the nodes are gone
+    void release_arena() { m_arena = ExprArenaRef(); }
+
     const Span& span() const;
           ::HIR::ExprNode& operator*()       { return *node; }
     const ::HIR::ExprNode& operator*() const { return *node; }
@@ -1483,13 +1483,19 @@ namespace {
     }
 
     bool force_emit = false;
+    auto inline_hint = ::HIR::Function::InlineHint::None;
     if( const auto* a = attrs.get("inline") )
     {
-        if( a->has_sub_items() && ::std::any_of(a->items().begin(), a->items().end(), [](const auto& v){ return v.name() == "never"; }) ) {
+        auto has_item = [&](const char* name){
+            return a->has_sub_items() && ::std::any_of(a->items().begin(), a->items().end(), [&](const auto& v){ return v.name() == name; });
+            };
+        if( has_item("never") ) {
             // Inline(never)
+            inline_hint = ::HIR::Function::InlineHint::Never;
         }
         else {
             force_emit = true;
+            inline_hint = has_item("always") ? ::HIR::Function::InlineHint::Always : ::HIR::Function::InlineHint::Hint;
         }
     }
 
@@ -1533,7 +1539,7 @@ namespace {
         linkage.name = p.get_name();
     }
 
-    return ::HIR::Function {
+    ::HIR::Function rv {
         force_emit,
         mv$(linkage),
         receiver,
@@ -1543,6 +1549,8 @@ namespace {
         LowerHIR_Type( f.rettype() ),
         LowerHIR_Expr( f.code() )
         };
+    rv.m_inline_hint = inline_hint;
+    return rv;
 }
 
 void _add_mod_ns_item(::HIR::Module& mod, RcString name, ::HIR::Publicity is_pub,  ::HIR::TypeItem ti) {
@@ -781,6 +781,9 @@ struct LowerHIR_ExprNode_Visitor:
 
 ::HIR::ExprPtr LowerHIR_ExprNode(const ::AST::ExprNode& e)
 {
+    // Each expression tree gets its own arena, freed once the tree is replaced after MIR generation
+    ::HIR::ExprArenaRef arena { ::HIR::ExprArena::create() };
+    ::HIR::ExprArena::Scope arena_scope { arena.get() };
     LowerHIR_ExprNode_Visitor v;
 
     const_cast<::AST::ExprNode*>(&e)->visit( v );
@@ -789,5 +792,5 @@ struct LowerHIR_ExprNode_Visitor:
         BUG(e.span(), typeid(e).name() << " - Yielded a nullptr HIR node");
     }
 
-    return ::HIR::ExprPtr( mv$( v.m_rv ) );
+    return ::HIR::ExprPtr( mv$( v.m_rv ), mv$(arena) );
 }
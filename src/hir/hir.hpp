@@ -261,6 +261,13 @@ public:
         Box,
         Custom,
     };
+    /// `#[inline]` attribute
+    enum class InlineHint {
+        None,
+        Hint,   // `#[inline]`
+        Always, // `#[inline(always)]`
+        Never,  // `#[inline(never)]`
+    };
 
     typedef ::std::vector< ::std::pair< ::HIR::Pattern, ::HIR::TypeRef> >   args_t;
 
@@ -280,6 +287,9 @@ public:
 
     ExprPtr m_code;
 
+    // Used by the MIR inlining cost model
+    InlineHint  m_inline_hint = InlineHint::None;
+
     //::HIR::TypeRef make_ty(const Span& sp, const ::HIR::PathParams& params) const;
 };
 
@@ -676,16 +686,41 @@ public:
     // Placeholder for types created during constant evaluation
     std::vector<std::pair<RcString, std::unique_ptr<VisEnt<TypeItem>> >>  m_new_types;
 
+    /// Coarse key for the head of an un-named type (e.g. `&str` is `Borrow`+`str`), used to index `ImplGroup::non_named`
+    struct ImplHeadKey
+    {
+        /// Detail value for an impl that covers any inner type (e.g. `impl<T> Foo for &T`), or a lookup with an unknown inner type
+        static const unsigned DETAIL_ANY = ~0u;
+        /// Index bucket holding only the blanket (`DETAIL_ANY`) impls for a tag
+        static const unsigned DETAIL_BLANKET = ~0u - 1;
+
+        unsigned tag;
+        unsigned detail;
+
+        bool operator<(const ImplHeadKey& x) const {
+            return tag != x.tag ? tag < x.tag : detail < x.detail;
+        }
+    };
+    /// Obtain the head key for a type, returns false if the type can't be indexed (ivars, generics, unresolved paths)
+    static bool get_impl_head_key(const ::HIR::TypeRef& ty, ImplHeadKey& out);
+
     template<typename T>
     struct ImplGroup
     {
         typedef ::std::vector<T> list_t;
         ::std::map<::HIR::SimplePath, list_t>   named;
-        list_t  non_named; // TODO: use a map of HIR::TypeRef::Data::Tag
+        list_t  non_named;
         list_t  generic;
 
+        /// Index of `non_named` by head key (only populated for the merged `m_all_*` groups, see `build_non_named_index`)
+        /// - `{tag, DETAIL_ANY}` holds every impl with that tag
+        /// - `{tag, d}` holds impls for that exact head, and the blanket impls for the tag
+        /// - `{tag, DETAIL_BLANKET}` holds just the blanket impls for the tag
+        /// Each list keeps the same relative order as `non_named`
+        ::std::map<ImplHeadKey, list_t> non_named_index;
+        bool    non_named_indexed = false;
+
         const list_t* get_list_for_type(const ::HIR::TypeRef& ty) const {
-            static list_t empty;
             if( const auto* p = ty.get_sort_path() ) {
                 auto it = named.find(*p);
                 if( it != named.end() )
@@ -694,7 +729,14 @@ public:
                     return nullptr;
             }
             else {
-                // TODO: Sort these by type tag, use the `Primitive` group if `ty` is Infer
+                ImplHeadKey key;
+                if( non_named_indexed && get_impl_head_key(ty, key) ) {
+                    auto it = non_named_index.find(key);
+                    if( it == non_named_index.end() && key.detail != ImplHeadKey::DETAIL_ANY )
+                        it = non_named_index.find(ImplHeadKey { key.tag, ImplHeadKey::DETAIL_BLANKET });
+                    return it != non_named_index.end() ? &it->second : nullptr;
+                }
+                // Ivars/generics (or no index), search everything
                 return &non_named;
             }
         }
@@ -704,9 +746,60 @@ public:
             }
             else {
                 // TODO: Ivars match with core types
+                assert(!non_named_indexed && "Use push_indexed for indexed impl groups");
                 return non_named;
             }
         }
+
+        /// Add an entry to an indexed group (keeps `non_named_index` valid)
+        void push_indexed(T v) {
+            const auto& ty = v->m_type;
+            if( const auto* p = ty.get_sort_path() ) {
+                named[*p].push_back(v);
+            }
+            else {
+                non_named.push_back(v);
+                if( non_named_indexed )
+                    add_to_index(v);
+            }
+        }
+        /// (Re)build `non_named_index`
+        void build_non_named_index() {
+            non_named_index.clear();
+            non_named_indexed = true;
+            for(const auto& v : non_named) {
+                if( !non_named_indexed )
+                    break;
+                add_to_index(v);
+            }
+        }
+    private:
+        void add_to_index(const T& v) {
+            ImplHeadKey key;
+            if( !get_impl_head_key(v->m_type, key) ) {
+                // Can't classify this impl (e.g. `impl Foo for _`), so fall back to the linear list
+                non_named_index.clear();
+                non_named_indexed = false;
+                return ;
+            }
+            if( key.detail == ImplHeadKey::DETAIL_ANY ) {
+                // Blanket over the inner type: applies to every bucket for this tag
+                non_named_index[ImplHeadKey { key.tag, ImplHeadKey::DETAIL_BLANKET }];
+                non_named_index[ImplHeadKey { key.tag, ImplHeadKey::DETAIL_ANY }];
+                for(auto it = non_named_index.lower_bound(ImplHeadKey { key.tag, 0 }); it != non_named_index.end() && it->first.tag == key.tag; ++it)
+                    it->second.push_back(v);
+            }
+            else {
+                auto it = non_named_index.find(key);
+                if( it == non_named_index.end() ) {
+                    // New exact bucket, seed with the existing blanket impls
+                    auto b = non_named_index.find(ImplHeadKey { key.tag, ImplHeadKey::DETAIL_BLANKET });
+                    it = non_named_index.insert(::std::make_pair(key, b != non_named_index.end() ? b->second : list_t())).first;
+                }
+                it->second.push_back(v);
+                non_named_index[ImplHeadKey { key.tag, ImplHeadKey::DETAIL_ANY }].push_back(v);
+            }
+        }
     };
     /// Impl blocks on just a type, split into three groups
     // - Named type (sorted on the path)
@@ -735,6 +828,9 @@ public:
     ::std::vector<ExternLibrary>    m_ext_libs;
     /// Extra paths for the linker
     ::std::vector<::std::string>    m_link_paths;
+    /// Monomorphised functions emitted (with exported linkage) by this crate, and their symbol names
+    /// - Only populated with `-Z share-generics`, downstream crates then emit a prototype instead of their own copy
+    ::std::map< ::HIR::Path, ::std::string> m_shared_generics;
 
     /// Method called to populate runtime state after deserialisation
     /// See hir/crate_post_load.cpp
@@ -972,6 +972,72 @@ bool ::HIR::TraitImpl::overlaps_with(const Crate& crate, const ::HIR::TraitImpl&
     }
 }
 
+namespace
+{
+    /// Head detail for the inner type of a borrow/pointer/slice/array
+    unsigned get_impl_head_inner(const ::HIR::TypeRef& ty)
+    {
+        TU_MATCH_HDRA( (ty.data()), {)
+        default:
+            return static_cast<unsigned>(ty.data().tag());
+        TU_ARMA(Primitive, te)
+            return 0x100 + static_cast<unsigned>(te);
+        TU_ARMA(Path, te)
+            return te.path.m_data.is_Generic() ? static_cast<unsigned>(ty.data().tag()) : ::HIR::Crate::ImplHeadKey::DETAIL_ANY;
+        TU_ARMA(Infer, te)
+            return ::HIR::Crate::ImplHeadKey::DETAIL_ANY;
+        TU_ARMA(Generic, te)
+            return ::HIR::Crate::ImplHeadKey::DETAIL_ANY;
+        TU_ARMA(ErasedType, te)
+            return ::HIR::Crate::ImplHeadKey::DETAIL_ANY;
+        }
+        throw "";
+    }
+}
+bool ::HIR::Crate::get_impl_head_key(const ::HIR::TypeRef& ty, ImplHeadKey& out)
+{
+    out.tag = static_cast<unsigned>(ty.data().tag());
+    out.detail = 0;
+    TU_MATCH_HDRA( (ty.data()), {)
+    TU_ARMA(Infer, te)
+        return false;
+    TU_ARMA(Generic, te)
+        return false;
+    TU_ARMA(Path, te)
+        return false;
+    TU_ARMA(ErasedType, te)
+        return false;
+    TU_ARMA(Diverge, te) {
+        }
+    TU_ARMA(Primitive, te) {
+        out.detail = static_cast<unsigned>(te);
+        }
+    TU_ARMA(Borrow, te) {
+        out.detail = get_impl_head_inner(te.inner);
+        }
+    TU_ARMA(Pointer, te) {
+        out.detail = get_impl_head_inner(te.inner);
+        }
+    TU_ARMA(Slice, te) {
+        out.detail = get_impl_head_inner(te.inner);
+        }
+    TU_ARMA(Array, te) {
+        out.detail = get_impl_head_inner(te.inner);
+        }
+    TU_ARMA(TraitObject, te) {
+        }
+    TU_ARMA(Tuple, te) {
+        }
+    TU_ARMA(Function, te) {
+        }
+    TU_ARMA(Closure, te) {
+        }
+    TU_ARMA(Generator, te) {
+        }
+    }
+    return true;
+}
+
 namespace
 {
     template<typename ImplType>
@@ -405,6 +405,13 @@
             }
             serialise_vec(crate.m_ext_libs);
             serialise_vec(crate.m_link_paths);
+
+            m_out.write_count(crate.m_shared_generics.size());
+            for(const auto& ent : crate.m_shared_generics)
+            {
+                serialise_path(ent.first);
+                m_out.write_string(ent.second);
+            }
         }
         void serialise(const ::HIR::ExternLibrary& lib)
         {
@@ -703,7 +710,13 @@
             save_mir &= static_cast<bool>(exp.m_mir);
             m_out.write_bool( save_mir );
             if( save_mir ) {
+                // MIR is written as a blob (with its own type cache) so it can be decoded on first use
+                auto saved_types = mv$(m_types);
+                m_types.clear();
+                m_out.open_blob();
                 serialise(*exp.m_mir);
+                m_out.close_blob();
+                m_types = mv$(saved_types);
             }
             serialise_vec( exp.m_erased_types );
         }
@@ -1072,6 +1085,7 @@
                 serialise(a.second);
             m_out.write_bool(fcn.m_variadic);
             serialise(fcn.m_return);
+            m_out.write_tag( static_cast<int>(fcn.m_inline_hint) );
             DEBUG("m_args = " << fcn.m_args);
 
             serialise(fcn.m_code, fcn.m_save_code || fcn.m_const);
@@ -9,6 +9,7 @@
 #include "serialise_lowlevel.hpp"
 #include <zlib.h>
 #include <fstream>
+#include <mutex>
 #include <string.h>   // memcpy
 #include <common.hpp>
 #include <algorithm>
@@ -16,22 +17,59 @@
 namespace HIR {
 namespace serialise {
 
+// Container format:
+// - Header: 8 byte magic
+// - Blocks: independently deflated chunks of the serialised stream (each BLOCK_SIZE bytes uncompressed, except the last)
+// - Index: per block, u32 compressed size then u32 uncompressed size
+// - Trailer: u64 file offset of the index, u32 block count, 8 byte magic
+// Blocks can be decompressed in any order, so a reader can seek to any offset in the stream.
+namespace {
+    const char  FILE_MAGIC[8] = { 'M','R','S','H','I','R','\x02','\0' };
+    const size_t    BLOCK_SIZE = 64*1024;
+    const size_t    TRAILER_SIZE = 8 + 4 + sizeof(FILE_MAGIC);
+
+    void put_u32(uint8_t* dst, uint32_t v) {
+        for(int i = 0; i < 4; i ++)
+            dst[i] = static_cast<uint8_t>(v >> (8*i));
+    }
+    void put_u64(uint8_t* dst, uint64_t v) {
+        for(int i = 0; i < 8; i ++)
+            dst[i] = static_cast<uint8_t>(v >> (8*i));
+    }
+    uint32_t get_u32(const uint8_t* src) {
+        uint32_t rv = 0;
+        for(int i = 0; i < 4; i ++)
+            rv |= static_cast<uint32_t>(src[i]) << (8*i);
+        return rv;
+    }
+    uint64_t get_u64(const uint8_t* src) {
+        uint64_t rv = 0;
+        for(int i = 0; i < 8; i ++)
+            rv |= static_cast<uint64_t>(src[i]) << (8*i);
+        return rv;
+    }
+}
+
 class WriterInner
 {
     ::std::ofstream m_backing;
-    z_stream    m_zstream;
-    ::std::vector<unsigned char> m_buffer;
-
-    unsigned int    m_byte_out_count = 0;
-    unsigned int    m_byte_in_count = 0;
+    // Uncompressed data for the current block
+    ::std::vector<unsigned char> m_block;
+    ::std::vector<unsigned char> m_compressed;
+    // (compressed size, uncompressed size) for each block written
+    ::std::vector< ::std::pair<uint32_t,uint32_t> >  m_index;
+    uint64_t    m_file_ofs;
 public:
     WriterInner(const ::std::string& filename);
     ~WriterInner();
     void write(const void* buf, size_t len);
+private:
+    void flush_block();
 };
 
 Writer::Writer():
-    m_inner(nullptr)
+    m_inner(nullptr),
+    m_in_blob(false)
 {
 }
 Writer::~Writer()
@@ -67,7 +105,11 @@ void Writer::open(const ::std::string& filename)
 }
 void Writer::write(const void* buf, size_t len)
 {
-    if( m_inner ) {
+    if( m_in_blob ) {
+        const auto* p = reinterpret_cast<const uint8_t*>(buf);
+        m_blob_data.insert(m_blob_data.end(), p, p + len);
+    }
+    else if( m_inner ) {
         m_inner->write(buf, len);
     }
     else {
@@ -86,115 +128,118 @@ void Writer::write_string(const RcString& v)
     }
 }
 
+void Writer::open_blob()
+{
+    assert(!m_in_blob);
+    m_in_blob = true;
+    m_blob_data.clear();
+    m_blob_saved_objname_cache = ::std::move(m_objname_cache);
+    m_objname_cache.clear();
+}
+void Writer::close_blob()
+{
+    assert(m_in_blob);
+    m_in_blob = false;
+    m_objname_cache = ::std::move(m_blob_saved_objname_cache);
+    this->raw_write_bytes(m_blob_data.size(), m_blob_data.data());
+    m_blob_data.clear();
+}
+
 
 WriterInner::WriterInner(const ::std::string& filename):
     m_backing( filename, ::std::ios_base::out | ::std::ios_base::binary),
-    m_zstream(),
-    m_buffer( 16*1024 )
-    //m_buffer( 4*1024 )
+    m_file_ofs(0)
 {
-    m_zstream.zalloc = Z_NULL;
-    m_zstream.zfree = Z_NULL;
-    m_zstream.opaque = Z_NULL;
-
-    const int COMPRESSION_LEVEL = Z_BEST_COMPRESSION;
-    int ret = deflateInit(&m_zstream, COMPRESSION_LEVEL);
-    if(ret != Z_OK)
-        throw ::std::runtime_error("zlib init failure");
-
-    m_zstream.avail_out = m_buffer.size();
-    m_zstream.next_out = m_buffer.data();
+    if( !m_backing.is_open() )
+        throw ::std::runtime_error("Unable to open file");
+    m_block.reserve(BLOCK_SIZE);
+    m_backing.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+    m_file_ofs += sizeof(FILE_MAGIC);
 }
 WriterInner::~WriterInner()
 {
-    assert( m_zstream.avail_in == 0 );
+    if( !m_block.empty() )
+        flush_block();
 
-    // Complete the compression
-    int ret;
-    do
+    // Index
+    auto index_ofs = m_file_ofs;
+    for(const auto& e : m_index)
     {
-        ret = deflate(&m_zstream, Z_FINISH);
-        if(ret == Z_STREAM_ERROR) {
-            ::std::cerr << "ERROR: zlib deflate stream error (cleanup)";
-            abort();
-        }
-        if( m_zstream.avail_out != m_buffer.size() )
-        {
-            size_t rem = m_buffer.size() - m_zstream.avail_out;
-            m_byte_out_count += rem;
-            m_backing.write( reinterpret_cast<char*>(m_buffer.data()), rem );
-
-            m_zstream.avail_out = m_buffer.size();
-            m_zstream.next_out = m_buffer.data();
-        }
-    } while(ret == Z_OK);
-    deflateEnd(&m_zstream);
+        uint8_t buf[8];
+        put_u32(buf+0, e.first);
+        put_u32(buf+4, e.second);
+        m_backing.write(reinterpret_cast<char*>(buf), sizeof(buf));
+    }
+    // Trailer
+    uint8_t buf[TRAILER_SIZE];
+    put_u64(buf+0, index_ofs);
+    put_u32(buf+8, static_cast<uint32_t>(m_index.size()));
+    memcpy(buf+12, FILE_MAGIC, sizeof(FILE_MAGIC));
+    m_backing.write(reinterpret_cast<char*>(buf), sizeof(buf));
+    if( !m_backing ) {
+        ::std::cerr << "ERROR: Failed to write crate metadata" << ::std::endl;
+        abort();
+    }
 }
 
 void WriterInner::write(const void* buf, size_t len)
 {
-    m_zstream.avail_in = len;
-    m_zstream.next_in = reinterpret_cast<unsigned char*>( const_cast<void*>(buf) );
-
-    size_t last_avail_in = m_zstream.avail_in;
-
-    // While there's data to compress
-    while( m_zstream.avail_in > 0 )
+    const auto* p = reinterpret_cast<const unsigned char*>(buf);
+    while( len > 0 )
     {
-        assert(m_zstream.avail_out != 0);
-
-        // Compress the data
-        int ret = deflate(&m_zstream, Z_NO_FLUSH);
-        if(ret == Z_STREAM_ERROR)
-            throw ::std::runtime_error("zlib deflate stream error");
-
-        size_t used_this_time = last_avail_in - m_zstream.avail_in;
-        last_avail_in = m_zstream.avail_in;
-        m_byte_in_count += used_this_time;
-
-        // If the entire input wasn't consumed, then it was likely due to a lack of output space
-        // - Flush the output buffer to the file
-        if( m_zstream.avail_in > 0 )
-        {
-            size_t bytes = m_buffer.size() - m_zstream.avail_out;
-            m_backing.write( reinterpret_cast<char*>(m_buffer.data()), bytes );
-            m_byte_out_count += bytes;
-
-            m_zstream.avail_out = m_buffer.size();
-            m_zstream.next_out = m_buffer.data();
-        }
-    }
-
-    // Flush stream contents if the output buffer is full.
-    while( m_zstream.avail_out == 0 )
-    {
-        size_t bytes = m_buffer.size() - m_zstream.avail_out;
-        m_backing.write( reinterpret_cast<char*>(m_buffer.data()), bytes );
-        m_byte_out_count += bytes;
-
-        m_zstream.avail_out = m_buffer.size();
-        m_zstream.next_out = m_buffer.data();
-
-        int ret = deflate(&m_zstream, Z_NO_FLUSH);
-        if(ret == Z_STREAM_ERROR)
-            throw ::std::runtime_error("zlib deflate stream error");
+        size_t space = BLOCK_SIZE - m_block.size();
+        size_t n = ::std::min(space, len);
+        m_block.insert(m_block.end(), p, p + n);
+        p += n;
+        len -= n;
+        if( m_block.size() == BLOCK_SIZE )
+            flush_block();
     }
 }
+void WriterInner::flush_block()
+{
+    uLongf  out_len = compressBound(m_block.size());
+    m_compressed.resize(out_len);
+    int ret = compress2(m_compressed.data(), &out_len, m_block.data(), m_block.size(), Z_BEST_COMPRESSION);
+    if(ret != Z_OK)
+        throw ::std::runtime_error("zlib compress failure");
+    m_backing.write( reinterpret_cast<char*>(m_compressed.data()), out_len );
+    m_file_ofs += out_len;
+    m_index.push_back(::std::make_pair( static_cast<uint32_t>(out_len), static_cast<uint32_t>(m_block.size()) ));
+    m_block.clear();
+}
 
 
 // --------------------------------------------------------------------
 class ReaderInner
 {
+    struct Block {
+        uint64_t    file_ofs;
+        uint32_t    compressed_size;
+        uint32_t    size;
+    };
+    ::std::string   m_filename;
+    // Only open while a `Reader` is active (reopened on demand), so lazily-loaded crates don't hold file handles
     ::std::ifstream m_backing;
-    z_stream    m_zstream;
-    ::std::vector<unsigned char> m_buffer;
-
-    unsigned int    m_byte_out_count = 0;
-    unsigned int    m_byte_in_count = 0;
+    ::std::vector<Block>    m_blocks;
+    size_t  m_total_size;
+
+    // Shared by every `Reader`/`BlobRef` of the file (and lazy MIR loads can happen on any thread), so all
+    // access to the file and the block cache goes through `read`/`close_file` with this held
+    ::std::mutex    m_lock;
+    // Most recently decompressed block
+    size_t  m_cur_block;
+    ::std::vector<unsigned char> m_cur_data;
+    ::std::vector<unsigned char> m_compressed;
 public:
     ReaderInner(const ::std::string& filename);
     ~ReaderInner();
-    size_t read(void* buf, size_t len);
+    /// Read up to `len` bytes from offset `ofs` in the uncompressed stream, returns the number of bytes read
+    size_t read(size_t ofs, void* buf, size_t len);
+    /// Close the file handle (it's reopened by the next `read` that needs a new block)
+    void close_file();
+private:
+    void load_block(size_t idx);
 };
 
 
@@ -219,39 +264,62 @@ size_t ReadBuffer::read(void* dst, size_t len)
         return rem;
     }
 }
-void ReadBuffer::populate(ReaderInner& is)
+size_t ReadBuffer::populate(ReaderInner& is, size_t ofs)
 {
     m_backing.resize( m_backing.capacity(), 0 );
-    auto len = is.read(m_backing.data(), m_backing.size());
+    auto len = is.read(ofs, m_backing.data(), m_backing.size());
     m_backing.resize( len );
     m_ofs = 0;
+    return len;
+}
+void ReadBuffer::clear()
+{
+    m_backing.clear();
+    m_ofs = 0;
 }
 
 
 Reader::Reader(const ::std::string& filename):
-    m_inner( new ReaderInner(filename) ),
+    m_inner( ::std::make_shared<ReaderInner>(filename) ),
     m_buffer(1024),
-    m_pos(0)
+    m_pos(0),
+    m_inner_ofs(0),
+    m_strings( ::std::make_shared< ::std::vector<RcString> >() )
 {
     size_t n_strings = read_count();
-    m_strings.reserve(n_strings);
+    m_strings->reserve(n_strings);
     DEBUG("n_strings = " << n_strings);
     for(size_t i = 0; i < n_strings; i ++)
     {
         auto s = read_string();
-        m_strings.push_back( RcString::new_interned(s) );
+        m_strings->push_back( RcString::new_interned(s) );
     }
 }
+Reader::Reader(const BlobRef& blob):
+    m_inner( blob.file ),
+    m_buffer(1024),
+    m_pos(blob.ofs),
+    m_inner_ofs(blob.ofs),
+    m_strings( blob.strings )
+{
+}
 Reader::~Reader()
 {
-    delete m_inner, m_inner = nullptr;
+    if( m_inner )
+        m_inner->close_file();
 }
 
+void Reader::seek(size_t pos)
+{
+    m_buffer.clear();
+    m_pos = pos;
+    m_inner_ofs = pos;
+}
 void Reader::read(void* buf, size_t len)
 {
     auto used = m_buffer.read(buf, len);
+    m_pos += used;
     if( used == len ) {
-        m_pos += len;
         return ;
     }
     buf = reinterpret_cast<uint8_t*>(buf) + used;
@@ -259,80 +327,117 @@ void Reader::read(void* buf, size_t len)
 
     if( len >= m_buffer.capacity() )
     {
-        m_inner->read(buf, len);
+        used = m_inner->read(m_inner_ofs, buf, len);
+        m_inner_ofs += used;
     }
     else
     {
-        m_buffer.populate( *m_inner );
+        m_inner_ofs += m_buffer.populate( *m_inner, m_inner_ofs );
         used = m_buffer.read(buf, len);
-        if( used != len )
-            throw ::std::runtime_error( FMT("Reader::read - Requested " << len << " bytes from buffer, got " << used) );
     }
+    if( used != len )
+        throw ::std::runtime_error( FMT("Reader::read - Requested " << len << " bytes, got " << used) );
 
     m_pos += len;
 }
 
 
 ReaderInner::ReaderInner(const ::std::string& filename):
+    m_filename(filename),
     m_backing(filename, ::std::ios_base::in|::std::ios_base::binary),
-    m_zstream(),
-    m_buffer(16*1024)
+    m_total_size(0),
+    m_cur_block(SIZE_MAX)
 {
     if( !m_backing.is_open() )
         throw ::std::runtime_error("Unable to open file");
 
-    m_zstream.zalloc = Z_NULL;
-    m_zstream.zfree = Z_NULL;
-    m_zstream.opaque = Z_NULL;
-
-    int ret = inflateInit(&m_zstream);
-    if(ret != Z_OK)
-        throw ::std::runtime_error("zlib init failure");
-
-    m_zstream.avail_in = 0;
+    char    magic[sizeof(FILE_MAGIC)];
+    m_backing.read(magic, sizeof(magic));
+    if( !m_backing || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 )
+        throw ::std::runtime_error("Bad file magic (not mrustc metadata, or from an incompatible version)");
+
+    uint8_t trailer[TRAILER_SIZE];
+    m_backing.seekg(-static_cast<::std::streamoff>(TRAILER_SIZE), ::std::ios_base::end);
+    m_backing.read(reinterpret_cast<char*>(trailer), sizeof(trailer));
+    if( !m_backing || memcmp(trailer+12, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 )
+        throw ::std::runtime_error("Bad trailer (truncated file?)");
+    auto index_ofs = get_u64(trailer+0);
+    auto n_blocks = get_u32(trailer+8);
+
+    ::std::vector<uint8_t>  index(n_blocks * 8);
+    m_backing.seekg(index_ofs);
+    m_backing.read(reinterpret_cast<char*>(index.data()), index.size());
+    if( !m_backing )
+        throw ::std::runtime_error("Unable to read block index");
+
+    uint64_t    file_ofs = sizeof(FILE_MAGIC);
+    m_blocks.reserve(n_blocks);
+    for(size_t i = 0; i < n_blocks; i ++)
+    {
+        Block   b;
+        b.file_ofs = file_ofs;
+        b.compressed_size = get_u32(index.data() + i*8 + 0);
+        b.size = get_u32(index.data() + i*8 + 4);
+        if( b.size != BLOCK_SIZE && i != n_blocks - 1 )
+            throw ::std::runtime_error("Malformed block index");
+        file_ofs += b.compressed_size;
+        m_total_size += b.size;
+        m_blocks.push_back(b);
+    }
+    if( file_ofs != index_ofs )
+        throw ::std::runtime_error("Malformed block index");
 }
 ReaderInner::~ReaderInner()
 {
-    inflateEnd(&m_zstream);
 }
-size_t ReaderInner::read(void* buf, size_t len)
+void ReaderInner::load_block(size_t idx)
 {
-    m_zstream.avail_out = len;
-    m_zstream.next_out = reinterpret_cast<unsigned char*>(buf);
-    do {
-        // Reset input buffer if empty
-        if( m_zstream.avail_in == 0 )
-        {
-            m_backing.read( reinterpret_cast<char*>(m_buffer.data()), m_buffer.size() );
-            m_zstream.avail_in = m_backing.gcount();
-            if( m_zstream.avail_in == 0 ) {
-                m_byte_out_count += len  - m_zstream.avail_out;
-                //::std::cerr << "Out of bytes, " << m_zstream.avail_out << " needed" << ::std::endl;
-                return len - m_zstream.avail_out;
-            }
-            m_zstream.next_in = const_cast<unsigned char*>(m_buffer.data());
-
-            m_byte_in_count += m_zstream.avail_in;
-        }
-
-        int ret = inflate(&m_zstream, Z_NO_FLUSH);
-        if(ret == Z_STREAM_ERROR)
-            throw ::std::runtime_error("zlib inflate stream error");
-        switch(ret)
-        {
-        case Z_NEED_DICT:
-            ret = Z_DATA_ERROR;
-        case Z_DATA_ERROR:
-        case Z_MEM_ERROR:
-            throw ::std::runtime_error("zlib inflate error");
-        default:
-            break;
-        }
-
-    } while( m_zstream.avail_out > 0 );
-    m_byte_out_count += len;
-
-    return len;
+    if( idx == m_cur_block )
+        return ;
+    const auto& b = m_blocks.at(idx);
+    if( !m_backing.is_open() )
+    {
+        m_backing.open(m_filename, ::std::ios_base::in|::std::ios_base::binary);
+        if( !m_backing.is_open() )
+            throw ::std::runtime_error("Unable to reopen file");
+    }
+    m_compressed.resize(b.compressed_size);
+    m_backing.clear();
+    m_backing.seekg(b.file_ofs);
+    m_backing.read(reinterpret_cast<char*>(m_compressed.data()), b.compressed_size);
+    if( !m_backing )
+        throw ::std::runtime_error("Unable to read block");
+
+    m_cur_data.resize(b.size);
+    uLongf  out_len = b.size;
+    int ret = uncompress(m_cur_data.data(), &out_len, m_compressed.data(), b.compressed_size);
+    if( ret != Z_OK || out_len != b.size )
+        throw ::std::runtime_error("zlib inflate error");
+    m_cur_block = idx;
+}
+size_t ReaderInner::read(size_t ofs, void* buf, size_t len)
+{
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+    auto* dst = reinterpret_cast<unsigned char*>(buf);
+    size_t  rv = 0;
+    while( len > 0 && ofs < m_total_size )
+    {
+        load_block(ofs / BLOCK_SIZE);
+        size_t  block_ofs = ofs % BLOCK_SIZE;
+        size_t  n = ::std::min(len, m_cur_data.size() - block_ofs);
+        memcpy(dst, m_cur_data.data() + block_ofs, n);
+        dst += n;
+        ofs += n;
+        len -= n;
+        rv += n;
+    }
+    return rv;
+}
+void ReaderInner::close_file()
+{
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+    if( m_backing.is_open() )
+        m_backing.close();
 }
 
 }   // namespace serialise
@@ -21,6 +21,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
 #include <stddef.h>
 #include <assert.h>
 #include <rc_string.hpp>
@@ -36,6 +37,11 @@ class Writer
     WriterInner*    m_inner;
     ::std::map<RcString, unsigned>  m_istring_cache;
     ::std::map<const char*, unsigned>  m_objname_cache;
+
+    // Active blob capture (see `open_blob`)
+    bool    m_in_blob;
+    ::std::vector<uint8_t>  m_blob_data;
+    ::std::map<const char*, unsigned>  m_blob_saved_objname_cache;
 public:
     Writer();
     Writer(const Writer&) = delete;
@@ -211,6 +217,11 @@ public:
     void close_object() {
         write_u8(0xFF);
     }
+
+    // Blobs: Self-contained length-prefixed sections that the reader can skip and decode later
+    // - Object names are cached per-blob, so the blob can be decoded independently of the outer stream
+    void open_blob();
+    void close_blob();
 };
 
 
@@ -223,24 +234,38 @@ public:
 
     size_t capacity() const { return m_backing.capacity(); }
     size_t read(void* dst, size_t len);
-    void populate(ReaderInner& is);
+    size_t populate(ReaderInner& is, size_t ofs);
+    void clear();
+};
+
+/// Reference to a blob (see `Writer::open_blob`) in an open file, for deferred decoding
+struct BlobRef
+{
+    ::std::shared_ptr<ReaderInner>  file;
+    ::std::shared_ptr< ::std::vector<RcString> >    strings;
+    size_t  ofs;
 };
 
 class Reader
 {
-    ReaderInner*    m_inner;
+    ::std::shared_ptr<ReaderInner>  m_inner;
     ReadBuffer  m_buffer;
     size_t  m_pos;
-    ::std::vector<RcString> m_strings;
+    // Offset in the uncompressed stream of the next `m_inner` read
+    size_t  m_inner_ofs;
+    ::std::shared_ptr< ::std::vector<RcString> >    m_strings;
 
     ::std::vector<std::string>  m_objname_cache;
 public:
     Reader(const ::std::string& path);
+    /// Open a reader positioned at the start of a blob's contents
+    Reader(const BlobRef& blob);
     Reader(const Writer&) = delete;
     Reader(Writer&&) = delete;
     ~Reader();
 
     size_t get_pos() const { return m_pos; }
+    void seek(size_t pos);
     void read(void* dst, size_t count);
 
     uint8_t read_u8() {
@@ -345,7 +370,7 @@ public:
     }
     RcString read_istring() {
         size_t idx = read_count();
-        return m_strings.at(idx);
+        return m_strings->at(idx);
     }
     ::std::string read_string() {
         size_t len = read_u8();
@@ -404,6 +429,13 @@ public:
         read( const_cast<char*>(rv.data()), len );
         return rv;
     }
+    /// Skip over a blob written by `Writer::open_blob`/`close_blob`, returning a reference for later decoding
+    BlobRef raw_skip_blob() {
+        auto len = raw_read_len();
+        BlobRef rv { m_inner, m_strings, m_pos };
+        seek(m_pos + len);
+        return rv;
+    }
 
 
     class CloseOnDrop {
@@ -8,6 +8,8 @@
 #include "type.hpp"
 #include <span.hpp>
 #include "expr.hpp" // Hack for cloning array types
+#include <mutex>
+#include <unordered_map>
 
 namespace HIR {
 
@@ -277,6 +279,9 @@ bool ::HIR::TypeRef::operator==(const ::HIR::TypeRef& x) const
     
     if( !m_ptr || !x.m_ptr )
         return false;
+    // Interned types are unique, so two different interned types can't be equal
+    if( m_ptr->m_interned && x.m_ptr->m_interned )
+        return false;
     if( data().tag() != x.data().tag() )
         return false;
 
@@ -365,10 +370,206 @@ bool ::HIR::TypeRef::operator==(const ::HIR::TypeRef& x) const
     )
     throw "";
 }
+namespace {
+    void hash_combine(size_t& h, size_t v) {
+        h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    void hash_params(size_t& h, const ::HIR::PathParams& pp) {
+        for(const auto& t : pp.m_types)
+            hash_combine(h, t.hash());
+    }
+    void hash_simplepath(size_t& h, const ::HIR::SimplePath& p) {
+        hash_combine(h, ::std::hash<RcString>()(p.m_crate_name));
+        for(const auto& c : p.m_components)
+            hash_combine(h, ::std::hash<RcString>()(c));
+    }
+}
+size_t HIR::TypeRef::hash() const
+{
+    if( m_ptr->m_interned )
+        return m_ptr->m_hash;
+    // NOTE: Only hashes fields that are checked by `operator==`, and skips some that are (e.g. lifetimes, array sizes)
+    size_t  rv = static_cast<size_t>(data().tag());
+    TU_MATCH_HDRA( (data()), {)
+    TU_ARMA(Infer, te) {
+        hash_combine(rv, te.index);
+        }
+    TU_ARMA(Diverge, te) {
+        }
+    TU_ARMA(Primitive, te) {
+        hash_combine(rv, static_cast<size_t>(te));
+        }
+    TU_ARMA(Path, te) {
+        TU_MATCH_HDRA( (te.path.m_data), {)
+        TU_ARMA(Generic, pe) {
+            hash_simplepath(rv, pe.m_path);
+            hash_params(rv, pe.m_params);
+            }
+        TU_ARMA(UfcsInherent, pe) {
+            hash_combine(rv, pe.type.hash());
+            hash_combine(rv, ::std::hash<RcString>()(pe.item));
+            }
+        TU_ARMA(UfcsKnown, pe) {
+            hash_combine(rv, pe.type.hash());
+            hash_simplepath(rv, pe.trait.m_path);
+            hash_combine(rv, ::std::hash<RcString>()(pe.item));
+            }
+        TU_ARMA(UfcsUnknown, pe) {
+            hash_combine(rv, pe.type.hash());
+            hash_combine(rv, ::std::hash<RcString>()(pe.item));
+            }
+        }
+        }
+    TU_ARMA(Generic, te) {
+        hash_combine(rv, te.binding);
+        }
+    TU_ARMA(TraitObject, te) {
+        hash_simplepath(rv, te.m_trait.m_path.m_path);
+        }
+    TU_ARMA(ErasedType, te) {
+        }
+    TU_ARMA(Array, te) {
+        hash_combine(rv, te.inner.hash());
+        }
+    TU_ARMA(Slice, te) {
+        hash_combine(rv, te.inner.hash());
+        }
+    TU_ARMA(Tuple, te) {
+        for(const auto& t : te)
+            hash_combine(rv, t.hash());
+        }
+    TU_ARMA(Borrow, te) {
+        hash_combine(rv, static_cast<size_t>(te.type));
+        hash_combine(rv, te.inner.hash());
+        }
+    TU_ARMA(Pointer, te) {
+        hash_combine(rv, static_cast<size_t>(te.type));
+        hash_combine(rv, te.inner.hash());
+        }
+    TU_ARMA(Function, te) {
+        for(const auto& t : te.m_arg_types)
+            hash_combine(rv, t.hash());
+        hash_combine(rv, te.m_rettype.hash());
+        }
+    TU_ARMA(Closure, te) {
+        hash_combine(rv, reinterpret_cast<::std::uintptr_t>(te.node));
+        }
+    TU_ARMA(Generator, te) {
+        hash_combine(rv, reinterpret_cast<::std::uintptr_t>(te.node));
+        }
+    }
+    return rv;
+}
+namespace {
+    // Set before any worker threads are started (from `-Z intern-types`)
+    bool    s_interning_enabled = false;
+    // Interned types, keyed by hash (entries are never freed)
+    ::std::mutex    s_intern_lock;
+    ::std::unordered_multimap<size_t, ::HIR::TypeRef>    s_intern_table;
+
+    bool intern_params(::HIR::PathParams& pp) {
+        for(auto& t : pp.m_types) {
+            t = t.intern();
+            if( !t.is_interned() )
+                return false;
+        }
+        return true;
+    }
+    bool intern_one(::HIR::TypeRef& t) {
+        t = t.intern();
+        return t.is_interned();
+    }
+    /// Replace all child types with their interned versions, returns false if any child can't be interned
+    bool intern_children(::HIR::TypeData& d)
+    {
+        TU_MATCH_HDRA( (d), {)
+        TU_ARMA(Infer, e)   return false;
+        TU_ARMA(Closure, e) return false;
+        TU_ARMA(Generator, e)   return false;
+        TU_ARMA(ErasedType, e)  return false;
+        TU_ARMA(TraitObject, e) return false;
+        TU_ARMA(Diverge, e) return true;
+        TU_ARMA(Primitive, e)   return true;
+        TU_ARMA(Generic, e) return true;
+        TU_ARMA(Path, e) {
+            if( e.binding.is_Unbound() )
+                return false;
+            TU_MATCH_HDRA( (e.path.m_data), {)
+            TU_ARMA(Generic, pe) {
+                return intern_params(pe.m_params);
+                }
+            TU_ARMA(UfcsInherent, pe) {
+                return intern_one(pe.type) && intern_params(pe.params) && intern_params(pe.impl_params);
+                }
+            TU_ARMA(UfcsKnown, pe) {
+                return intern_one(pe.type) && intern_params(pe.trait.m_params) && intern_params(pe.params);
+                }
+            TU_ARMA(UfcsUnknown, pe) {
+                return false;
+                }
+            }
+            }
+        TU_ARMA(Array, e) {
+            return e.size.is_Known() && intern_one(e.inner);
+            }
+        TU_ARMA(Slice, e) {
+            return intern_one(e.inner);
+            }
+        TU_ARMA(Tuple, e) {
+            for(auto& t : e)
+                if( !intern_one(t) )
+                    return false;
+            return true;
+            }
+        TU_ARMA(Borrow, e) {
+            return intern_one(e.inner);
+            }
+        TU_ARMA(Pointer, e) {
+            return intern_one(e.inner);
+            }
+        TU_ARMA(Function, e) {
+            for(auto& t : e.m_arg_types)
+                if( !intern_one(t) )
+                    return false;
+            return intern_one(e.m_rettype);
+            }
+        }
+        throw "";
+    }
+}
+void HIR::TypeRef::set_interning_enabled(bool enabled)
+{
+    s_interning_enabled = enabled;
+}
+::HIR::TypeRef HIR::TypeRef::intern() const
+{
+    if( m_ptr->m_interned || !s_interning_enabled )
+        return this->clone();
+
+    auto rv = this->clone_shallow();
+    if( !intern_children(rv.m_ptr->m_data) )
+        return this->clone();
+    auto h = rv.hash();
+
+    ::std::lock_guard<::std::mutex> lh { s_intern_lock };
+    auto range = s_intern_table.equal_range(h);
+    for(auto it = range.first; it != range.second; ++it)
+    {
+        if( it->second == rv )
+            return it->second.clone();
+    }
+    rv.m_ptr->m_interned = true;
+    rv.m_ptr->m_hash = h;
+    s_intern_table.insert(::std::make_pair(h, rv.clone()));
+    return rv;
+}
 Ordering HIR::TypeRef::ord(const ::HIR::TypeRef& x) const
 {
     Ordering    rv;
 
+    if( m_ptr == x.m_ptr )
+        return OrdEqual;
+
     ORD( static_cast<unsigned int>(data().tag()), static_cast<unsigned int>(x.data().tag()) );
 
     TU_MATCH(::HIR::TypeData, (data(), x.data()), (te, xe),
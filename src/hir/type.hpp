@@ -9,6 +9,7 @@
 #define _HIR_TYPE_HPP_
 #pragma once
 
+#include <atomic>
 #include <tagged_union.hpp>
 #include <hir/path.hpp>
 #include <hir/expr_ptr.hpp>
@@ -213,12 +214,17 @@ public:
     // Existing TypeRef
 
 private:
-    unsigned    m_refcount;
+    ::std::atomic<unsigned> m_refcount;
+    // Interned types are immutable, immortal (refcount is unused), and unique (so compare by pointer)
+    bool    m_interned;
+    size_t  m_hash; // Only valid if `m_interned`
 public:
     TypeData   m_data;
 private:
     TypeInner(TypeData d):
         m_refcount(1),
+        m_interned(false),
+        m_hash(0),
         m_data(mv$(d))
     {
     }
@@ -235,14 +241,14 @@ inline TypeRef::TypeRef(TypeData d):
 inline TypeRef::TypeRef(const TypeRef& x):
     m_ptr(x.m_ptr)
 {
-    x.m_ptr->m_refcount += 1;
+    if(!x.m_ptr->m_interned)
+        x.m_ptr->m_refcount.fetch_add(1, ::std::memory_order_relaxed);
 }
 inline TypeRef::~TypeRef()
 {
-    if(m_ptr)
+    if(m_ptr && !m_ptr->m_interned)
     {
-        m_ptr->m_refcount -= 1;
-        if(m_ptr->m_refcount == 0)
+        if(m_ptr->m_refcount.fetch_sub(1, ::std::memory_order_acq_rel) == 1)
         {
             delete m_ptr;
             m_ptr = nullptr;
@@ -250,8 +256,9 @@ inline TypeRef::~TypeRef()
     }
 }
 inline const TypeData& TypeRef::data() const { assert(m_ptr); return m_ptr->m_data; }
-inline TypeData& TypeRef::data_mut() { assert(m_ptr); return m_ptr->m_data; }
-inline TypeData& TypeRef::get_unique() { assert(m_ptr); if(m_ptr->m_refcount != 1) *this = this->clone_shallow(); return m_ptr->m_data; }
+inline TypeData& TypeRef::data_mut() { assert(m_ptr); if(m_ptr->m_interned) *this = this->clone_shallow(); return m_ptr->m_data; }
+inline TypeData& TypeRef::get_unique() { assert(m_ptr); if(m_ptr->m_interned || m_ptr->m_refcount != 1) *this = this->clone_shallow(); return m_ptr->m_data; }
+inline bool TypeRef::is_interned() const { return m_ptr && m_ptr->m_interned; }
 
 
 inline TypeRef::TypeRef(::HIR::CoreType ct):
@@ -109,6 +109,19 @@ public:
     bool operator!=(const ::HIR::TypeRef& x) const { return !(*this == x); }
     bool operator<(const ::HIR::TypeRef& x) const { return ord(x) == OrdLess; }
     Ordering ord(const ::HIR::TypeRef& x) const;
+    /// Structural hash, consistent with `operator==` (for use in hashed caches). Cached for interned types
+    size_t hash() const;
+    struct Hash {
+        size_t operator()(const TypeRef& t) const { return t.hash(); }
+    };
+
+    /// Get the canonical (hash-consed) instance of this type, interned types compare/hash in O(1)
+    /// - Types that aren't fully resolved (ivars, unbound paths, closures, ...) are returned as-is
+    /// - Only active once enabled with `set_interning_enabled` (`-Z intern-types`), otherwise this is `clone`
+    TypeRef intern() const;
+    /// Enable `intern` (interned types are never freed, so the table grows with the number of distinct types)
+    static void set_interning_enabled(bool enabled);
+    bool is_interned() const;
 
 
     //void match_generics(const Span& sp, const ::HIR::TypeRef& x_in, t_cb_resolve_type resolve_placeholder, MatchGenerics& callback) const;
@@ -973,4 +973,13 @@ void ConvertHIR_ResolveUFCS_SortImpls(::HIR::Crate& crate)
     for(const auto& ec : crate.m_ext_crates) {
         push_index_impls(crate, *ec.second.m_data);
     }
+    // - Index the merged un-named lists by type head (so lookups on e.g. `&str` don't scan every primitive/reference impl)
+    crate.m_all_type_impls.build_non_named_index();
+    for(auto& ig : crate.m_all_trait_impls) {
+        ig.second.build_non_named_index();
+    }
+    for(auto& ig : crate.m_all_marker_impls) {
+        ig.second.build_non_named_index();
+    }
+    DEBUG("Type impl index: " << crate.m_all_type_impls.non_named_index.size() << " head buckets for " << crate.m_all_type_impls.non_named.size() << " un-named impls");
 }
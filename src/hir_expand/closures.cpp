@@ -60,8 +60,7 @@ namespace {
     void OutState::push_new_impls(const Span& sp, ::HIR::Crate& crate)
     {
         auto push_trait_impl = [&](const ::HIR::SimplePath& p, std::unique_ptr<::HIR::TraitImpl> ptr) {
-            auto& trait_impl_list_r = crate.m_all_trait_impls[p].get_list_for_type_mut(ptr->m_type);
-            trait_impl_list_r.push_back(ptr.get());
+            crate.m_all_trait_impls[p].push_indexed(ptr.get());
             auto& trait_impl_list   = crate.m_trait_impls[p].get_list_for_type_mut(ptr->m_type);
             trait_impl_list.push_back(mv$(ptr));
             };
@@ -999,7 +998,7 @@ namespace {
                     {},
                     /*source module*/::HIR::SimplePath(m_resolve.m_crate.m_crate_name, {})
                     }));
-                const_cast<::HIR::Crate&>(m_resolve.m_crate).m_all_trait_impls[lang_Copy].get_list_for_type_mut(closure_type).push_back( v.back().get() );
+                const_cast<::HIR::Crate&>(m_resolve.m_crate).m_all_trait_impls[lang_Copy].push_indexed( v.back().get() );
             }
 
             // ---
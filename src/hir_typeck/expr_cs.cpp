@@ -1651,7 +1651,7 @@ void Context::dump() const {
         DEBUG(v);
     }
     for(const auto& v : to_visit) {
-        DEBUG(&*v << " " << FMT_CB(os, { ExprVisitor_Print ev(*this, os); v->visit(ev); }) << " -> " << this->m_ivars.fmt_type(v->m_res_type));
+        DEBUG("R" << v.rule_idx << " " << v.node << " " << FMT_CB(os, { ExprVisitor_Print ev(*this, os); v.node->visit(ev); }) << " -> " << this->m_ivars.fmt_type(v.node->m_res_type));
     }
     for(const auto& v : adv_revisits) {
         DEBUG(FMT_CB(ss, v->fmt(ss);));
@@ -3171,7 +3171,7 @@ void Context::equate_types_coerce(const Span& sp, const ::HIR::TypeRef& l, ::HIR
         l.clone(), &node_ptr
         }));
     DEBUG("++ " << *this->link_coerce.back());
-    this->m_ivars.mark_change();
+    this->m_ivars.mark_progress();
 }
 void Context::possible_equate_type_unknown(const Span& sp, const ::HIR::TypeRef& ty, Context::IvarUnknownType src)
 {
@@ -3243,10 +3243,58 @@ void Context::equate_types_assoc(const Span& sp, const ::HIR::TypeRef& l,  const
         is_op
         });
     DEBUG("++ " << this->link_assoc.back());
-    this->m_ivars.mark_change();
+    this->m_ivars.mark_progress();
+}
+void Context::rule_sleep(const Coercion& v)
+{
+    ::std::vector<unsigned> ivars;
+    m_ivars.get_unknown_ivars(v.left_ty, ivars);
+    m_ivars.get_unknown_ivars((*v.right_node_ptr)->m_res_type, ivars);
+    m_ivars.rule_sleep(v.rule_idx, ivars);
+}
+void Context::rule_sleep(const Associated& v)
+{
+    ::std::vector<unsigned> ivars;
+    if( v.name != "" )
+        m_ivars.get_unknown_ivars(v.left_ty, ivars);
+    m_ivars.get_unknown_ivars(v.impl_ty, ivars);
+    for(const auto& ty : v.params.m_types)
+        m_ivars.get_unknown_ivars(ty, ivars);
+    m_ivars.rule_sleep(v.rule_idx, ivars);
+}
+namespace {
+    /// Collects the ivars that a node revisit depends on: types used by the node itself, and the result types of its
+    /// direct children
+    class ExprVisitor_RevisitDeps:
+        public ::HIR::ExprVisitorDef
+    {
+        const HMTypeInferrence& m_ivars;
+    public:
+        ::std::vector<unsigned> ivars;
+
+        ExprVisitor_RevisitDeps(const HMTypeInferrence& ivars):
+            m_ivars(ivars)
+        {
+        }
+
+        void visit_node_ptr(::HIR::ExprNodeP& node_ptr) override {
+            // Don't recurse, only the child's result type matters
+            this->visit_type(node_ptr->m_res_type);
+        }
+        void visit_type(::HIR::TypeRef& ty) override {
+            m_ivars.get_unknown_ivars(ty, this->ivars);
+        }
+    };
+}
+void Context::rule_sleep(const NodeRevisit& v)
+{
+    ExprVisitor_RevisitDeps visitor { m_ivars };
+    v.node->visit(visitor);
+    visitor.visit_type(v.node->m_res_type);
+    m_ivars.rule_sleep(v.rule_idx, visitor.ivars);
 }
 void Context::add_revisit(::HIR::ExprNode& node) {
-    this->to_visit.push_back( &node );
+    this->to_visit.push_back(NodeRevisit { this->next_rule_idx ++, &node });
 }
 void Context::add_revisit_adv(::std::unique_ptr<Revisitor> ent_ptr) {
     this->adv_revisits.push_back( mv$(ent_ptr) );
@@ -5159,9 +5207,9 @@ namespace
         }
 
         // Handle methods
-        for(const auto* node_ptr_dyn : context.to_visit)
+        for(const auto& revisit : context.to_visit)
         {
-            if( const auto* node_ptr = dynamic_cast<const ::HIR::ExprNode_CallMethod*>(node_ptr_dyn) )
+            if( const auto* node_ptr = dynamic_cast<const ::HIR::ExprNode_CallMethod*>(revisit.node) )
             {
                 const auto& node = *node_ptr;
                 const auto& ty_tpl = context.get_type(node.m_value->m_res_type);
@@ -6597,100 +6645,147 @@ void Typecheck_Code_CS(const typeck::ModuleState& ms, t_args& args, const ::HIR:
         TRACE_FUNCTION_F("=== PASS " << count << " ===");
         context.dump();
 
-        // 1. Check coercions for ones that cannot coerce due to RHS type (e.g. `str` which doesn't coerce to anything)
-        // 2. (???) Locate coercions that cannot coerce (due to being the only way to know a type)
-        // - Keep a list in the ivar of what types that ivar could be equated to.
-        DEBUG("--- Coercion checking");
-        for(size_t i = 0; i < context.link_coerce.size(); )
-        {
-            auto ent = mv$(context.link_coerce[i]);
-            const auto& span = (*ent->right_node_ptr)->span();
-            auto& src_ty = (*ent->right_node_ptr)->m_res_type;
-            //src_ty = context.m_resolve.expand_associated_types( span, mv$(src_ty) );
-            ent->left_ty = context.m_resolve.expand_associated_types( span, mv$(ent->left_ty) );
-            if( check_coerce(context, *ent) )
-            {
-                DEBUG("- Consumed coercion R" << ent->rule_idx << " " << ent->left_ty << " := " << src_ty);
-
-                context.link_coerce.erase( context.link_coerce.begin() + i );
-            }
-            else
-            {
-                context.link_coerce[i] = mv$(ent);
-                ++ i;
-            }
-        }
-        // 3. Check associated type rules
-        DEBUG("--- Associated types");
-        unsigned int link_assoc_iter_limit = context.link_assoc.size() * 4;
-        for(unsigned int i = 0; i < context.link_assoc.size(); ) {
-            // - Move out (and back in later) to avoid holding a bad pointer if the list is updated
-            auto rule = mv$(context.link_assoc[i]);
+        // Check all rules, skipping coercion/associated rules that are asleep (they failed last time, and none of the
+        // ivars they mention have changed since).
+        // - Returns the number of skipped rules
+        auto check_rules = [&]()->size_t {
+            size_t  n_skipped = 0;
+            // 1. Check coercions for ones that cannot coerce due to RHS type (e.g. `str` which doesn't coerce to anything)
+            // 2. (???) Locate coercions that cannot coerce (due to being the only way to know a type)
+            // - Keep a list in the ivar of what types that ivar could be equated to.
+            DEBUG("--- Coercion checking");
+            for(size_t i = 0; i < context.link_coerce.size(); )
+            {
+                if( !context.m_ivars.rule_is_awake(context.link_coerce[i]->rule_idx) )
+                {
+                    n_skipped ++;
+                    ++ i;
+                    continue ;
+                }
+                auto ent = mv$(context.link_coerce[i]);
+                const auto& span = (*ent->right_node_ptr)->span();
+                auto& src_ty = (*ent->right_node_ptr)->m_res_type;
+                //src_ty = context.m_resolve.expand_associated_types( span, mv$(src_ty) );
+                ent->left_ty = context.m_resolve.expand_associated_types( span, mv$(ent->left_ty) );
+                auto change_count = context.m_ivars.change_count();
+                if( check_coerce(context, *ent) )
+                {
+                    DEBUG("- Consumed coercion R" << ent->rule_idx << " " << ent->left_ty << " := " << src_ty);
 
-            DEBUG("- " << rule);
-            for( auto& ty : rule.params.m_types ) {
-                ty = context.m_resolve.expand_associated_types(rule.span, mv$(ty));
-            }
-            if( rule.name != "" ) {
-                rule.left_ty = context.m_resolve.expand_associated_types(rule.span, mv$(rule.left_ty));
-                // HACK: If the left type is `!`, remove the type bound
-                //if( rule.left_ty.data().is_Diverge() ) {
-                //    rule.name = "";
-                //}
-            }
-            rule.impl_ty = context.m_resolve.expand_associated_types(rule.span, mv$(rule.impl_ty));
+                    context.link_coerce.erase( context.link_coerce.begin() + i );
+                }
+                else
+                {
+                    // Nothing changed, so this can't progress until one of its ivars is updated
+                    if( change_count == context.m_ivars.change_count() )
+                        context.rule_sleep(*ent);
+                    context.link_coerce[i] = mv$(ent);
+                    ++ i;
+                }
+            }
+            // 3. Check associated type rules
+            DEBUG("--- Associated types");
+            unsigned int link_assoc_iter_limit = context.link_assoc.size() * 4;
+            for(unsigned int i = 0; i < context.link_assoc.size(); ) {
+                if( !context.m_ivars.rule_is_awake(context.link_assoc[i].rule_idx) )
+                {
+                    n_skipped ++;
+                    i ++;
+                    continue ;
+                }
+                // - Move out (and back in later) to avoid holding a bad pointer if the list is updated
+                auto rule = mv$(context.link_assoc[i]);
+
+                DEBUG("- " << rule);
+                for( auto& ty : rule.params.m_types ) {
+                    ty = context.m_resolve.expand_associated_types(rule.span, mv$(ty));
+                }
+                if( rule.name != "" ) {
+                    rule.left_ty = context.m_resolve.expand_associated_types(rule.span, mv$(rule.left_ty));
+                    // HACK: If the left type is `!`, remove the type bound
+                    //if( rule.left_ty.data().is_Diverge() ) {
+                    //    rule.name = "";
+                    //}
+                }
+                rule.impl_ty = context.m_resolve.expand_associated_types(rule.span, mv$(rule.impl_ty));
+
+                auto change_count = context.m_ivars.change_count();
+                if( check_associated(context, rule) ) {
+                    DEBUG("- Consumed associated type rule " << i << "/" << context.link_assoc.size() << " - " << rule);
+                    if( i != context.link_assoc.size()-1 )
+                    {
+                        //assert( context.link_assoc[i] != context.link_assoc.back() );
+                        context.link_assoc[i] = mv$( context.link_assoc.back() );
+                    }
+                    context.link_assoc.pop_back();
+                }
+                else {
+                    if( change_count == context.m_ivars.change_count() )
+                        context.rule_sleep(rule);
+                    context.link_assoc[i] = mv$(rule);
+                    i ++;
+                }
 
-            if( check_associated(context, rule) ) {
-                DEBUG("- Consumed associated type rule " << i << "/" << context.link_assoc.size() << " - " << rule);
-                if( i != context.link_assoc.size()-1 )
+                if( link_assoc_iter_limit -- == 0 )
                 {
-                    //assert( context.link_assoc[i] != context.link_assoc.back() );
-                    context.link_assoc[i] = mv$( context.link_assoc.back() );
+                    DEBUG("link_assoc iteration limit exceeded");
+                    break;
                 }
-                context.link_assoc.pop_back();
-            }
-            else {
-                context.link_assoc[i] = mv$(rule);
-                i ++;
             }
-
-            if( link_assoc_iter_limit -- == 0 )
+            // 4. Revisit nodes that require revisiting
+            DEBUG("--- Node revisits");
+            for( auto it = context.to_visit.begin(); it != context.to_visit.end(); )
             {
-                DEBUG("link_assoc iteration limit exceeded");
-                break;
-            }
-        }
-        // 4. Revisit nodes that require revisiting
-        DEBUG("--- Node revisits");
-        for( auto it = context.to_visit.begin(); it != context.to_visit.end(); )
-        {
-            ::HIR::ExprNode& node = **it;
-            ExprVisitor_Revisit visitor { context };
-            DEBUG("> " << &node << " " << typeid(node).name() << " -> " << context.m_ivars.fmt_type(node.m_res_type));
-            node.visit( visitor );
-            //  - If the node is completed, remove it
-            if( visitor.node_completed() ) {
-                DEBUG("- Completed " << &node << " - " << typeid(node).name());
-                it = context.to_visit.erase(it);
-            }
-            else {
-                ++ it;
+                if( !context.m_ivars.rule_is_awake(it->rule_idx) )
+                {
+                    n_skipped ++;
+                    ++ it;
+                    continue ;
+                }
+                ::HIR::ExprNode& node = *it->node;
+                ExprVisitor_Revisit visitor { context };
+                DEBUG("> " << &node << " " << typeid(node).name() << " -> " << context.m_ivars.fmt_type(node.m_res_type));
+                auto change_count = context.m_ivars.change_count();
+                node.visit( visitor );
+                //  - If the node is completed, remove it
+                if( visitor.node_completed() ) {
+                    DEBUG("- Completed " << &node << " - " << typeid(node).name());
+                    it = context.to_visit.erase(it);
+                }
+                else {
+                    if( change_count == context.m_ivars.change_count() )
+                        context.rule_sleep(*it);
+                    ++ it;
+                }
             }
-        }
-        {
-            ::std::vector<bool> adv_revisit_remove_list;
-            size_t  len = context.adv_revisits.size();
-            for(size_t i = 0; i < len; i ++)
             {
-                auto& ent = *context.adv_revisits[i];
-                adv_revisit_remove_list.push_back( ent.revisit(context, /*is_fallback=*/false) );
+                ::std::vector<bool> adv_revisit_remove_list;
+                size_t  len = context.adv_revisits.size();
+                for(size_t i = 0; i < len; i ++)
+                {
+                    auto& ent = *context.adv_revisits[i];
+                    adv_revisit_remove_list.push_back( ent.revisit(context, /*is_fallback=*/false) );
+                }
+                for(size_t i = len; i --;)
+                {
+                    if( adv_revisit_remove_list[i] ) {
+                        context.adv_revisits.erase( context.adv_revisits.begin() + i );
+                    }
+                }
             }
-            for(size_t i = len; i --;)
+            return n_skipped;
+            };
+        if( check_rules() > 0 && !context.m_ivars.peek_changed() )
+        {
+            // Stalled with rules asleep: re-check everything, as the fallbacks below need the ivar possibilities that
+            // every rule records (and a rule could be waiting on a change that wasn't tracked)
+            DEBUG("--- Stalled, re-checking all rules");
+            for(auto& ivar_ent : context.possible_ivar_vals)
             {
-                if( adv_revisit_remove_list[i] ) {
-                    context.adv_revisits.erase( context.adv_revisits.begin() + i );
-                }
+                ivar_ent.reset();
             }
+            context.m_ivars.wake_all_rules();
+            check_rules();
         }
 
         // If nothing changed this pass, apply ivar possibilities
@@ -6777,7 +6872,7 @@ void Typecheck_Code_CS(const typeck::ModuleState& ms, t_args& args, const ::HIR:
             DEBUG("--- Node revisits (fallback)");
             for( auto it = context.to_visit.begin(); it != context.to_visit.end(); )
             {
-                ::HIR::ExprNode& node = **it;
+                ::HIR::ExprNode& node = *it->node;
                 ExprVisitor_Revisit visitor { context, true };
                 DEBUG("> " << &node << " " << typeid(node).name() << " -> " << context.m_ivars.fmt_type(node.m_res_type));
                 node.visit( visitor );
@@ -6912,8 +7007,9 @@ void Typecheck_Code_CS(const typeck::ModuleState& ms, t_args& args, const ::HIR:
             }
         }
         // TODO: Print revisit rules and advanced revisit rules.
-        for(const auto& node : context.to_visit)
+        for(const auto& revisit : context.to_visit)
         {
+            auto* node = revisit.node;
             const auto& sp = node->span();
             WARNING(sp, W0000, "Spare rule - " << FMT_CB(os, { ExprVisitor_Print ev(context, os); node->visit(ev); }) << " -> " << context.m_ivars.fmt_type(node->m_res_type));
         }
@@ -138,8 +138,14 @@ struct Context
     // NOTE: unique_ptr used to reduce copy costs of the list
     ::std::vector< ::std::unique_ptr<Coercion> > link_coerce;
     ::std::vector<Associated> link_assoc;
+    struct NodeRevisit
+    {
+        /// Index for rule wakeups (shared with coercion/associated rules)
+        unsigned    rule_idx;
+        ::HIR::ExprNode*    node;
+    };
     /// Nodes that need revisiting (e.g. method calls when the receiver isn't known)
-    ::std::vector< ::HIR::ExprNode*>    to_visit;
+    ::std::vector<NodeRevisit>  to_visit;
     /// Callback-based revisits (e.g. for slice patterns handling slices/arrays)
     ::std::vector< ::std::unique_ptr<Revisitor> >   adv_revisits;
 
@@ -252,6 +258,11 @@ struct Context
     void add_var(const Span& sp, unsigned int index, const RcString& name, ::HIR::TypeRef type);
     const ::HIR::TypeRef& get_var(const Span& sp, unsigned int idx) const;
 
+    // - Put a rule to sleep until one of the ivars it mentions changes (see `Typecheck_Code_CS`)
+    void rule_sleep(const Coercion& v);
+    void rule_sleep(const Associated& v);
+    void rule_sleep(const NodeRevisit& v);
+
     // - Add a revisit entry
     void add_revisit(::HIR::ExprNode& node);
     void add_revisit_adv(::std::unique_ptr<Revisitor> ent);
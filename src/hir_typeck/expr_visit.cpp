@@ -10,10 +10,13 @@
 #include <hir/visitor.hpp>
 #include "expr_visit.hpp"
 #include <hir/expr_state.hpp>
+#include <parallel.hpp>
 
 void Typecheck_Code(const typeck::ModuleState& ms, t_args& args, const ::HIR::TypeRef& result_type, ::HIR::ExprPtr& expr) {
     if( expr.m_state->stage < ::HIR::ExprState::Stage::Typecheck )
     {
+        // Nodes created by typecheck's rewrites go into the tree's arena
+        ::HIR::ExprArena::Scope arena_scope { expr.arena() };
         //Typecheck_Code_Simple(ms, args, result_type, expr);
         Typecheck_Code_CS(ms, args, result_type, expr);
     }
@@ -105,17 +108,42 @@ namespace typeck {
 
 namespace {
 
+    /// A body queued for parallel typechecking, with a snapshot of the module state at the point it was found
+    struct QueuedBody
+    {
+        ::typeck::ModuleState   ms;
+        t_args* args;   // If null, an empty list is used
+        ::HIR::TypeRef  result_type;
+        ::HIR::ExprPtr* expr;
+    };
 
     class OuterVisitor:
         public ::HIR::Visitor
     {
         ::typeck::ModuleState m_ms;
+        // If non-null, bodies are added to this list instead of being checked immediately
+        ::std::vector<QueuedBody>*  m_queue;
     public:
-        OuterVisitor(::HIR::Crate& crate):
-            m_ms(crate)
+        OuterVisitor(::HIR::Crate& crate, ::std::vector<QueuedBody>* queue=nullptr):
+            m_ms(crate),
+            m_queue(queue)
         {
         }
 
+    private:
+        void typecheck_code(t_args* args, const ::HIR::TypeRef& result_type, ::HIR::ExprPtr& expr)
+        {
+            if( m_queue )
+            {
+                m_queue->push_back(QueuedBody { m_ms, args, result_type.clone(), &expr });
+            }
+            else
+            {
+                t_args  tmp;
+                Typecheck_Code(m_ms, args ? *args : tmp, result_type, expr);
+            }
+        }
+
 
     public:
         void visit_module(::HIR::ItemPath p, ::HIR::Module& mod) override
@@ -175,9 +203,8 @@ namespace {
             {
                 this->visit_type( e->inner );
                 DEBUG("Array size " << ty);
-                t_args  tmp;
                 if( auto* se = e->size.opt_Unevaluated() ) {
-                    Typecheck_Code( m_ms, tmp, ::HIR::TypeRef(::HIR::CoreType::Usize), **se );
+                    this->typecheck_code( nullptr, ::HIR::TypeRef(::HIR::CoreType::Usize), **se );
                 }
             }
             else {
@@ -192,7 +219,7 @@ namespace {
             if( item.m_code )
             {
                 DEBUG("Function code " << p);
-                Typecheck_Code( m_ms, item.m_args, item.m_return, item.m_code );
+                this->typecheck_code( &item.m_args, item.m_return, item.m_code );
             }
             else
             {
@@ -204,8 +231,7 @@ namespace {
             if( item.m_value )
             {
                 DEBUG("Static value " << p);
-                t_args  tmp;
-                Typecheck_Code(m_ms, tmp, item.m_type, item.m_value);
+                this->typecheck_code(nullptr, item.m_type, item.m_value);
             }
         }
         void visit_constant(::HIR::ItemPath p, ::HIR::Constant& item) override {
@@ -213,8 +239,7 @@ namespace {
             if( item.m_value )
             {
                 DEBUG("Const value " << p);
-                t_args  tmp;
-                Typecheck_Code(m_ms, tmp, item.m_type, item.m_value);
+                this->typecheck_code(nullptr, item.m_type, item.m_value);
             }
         }
         void visit_enum(::HIR::ItemPath p, ::HIR::Enum& item) override {
@@ -229,8 +254,7 @@ namespace {
                     DEBUG("Enum value " << p << " - " << var.name);
                     if( var.expr )
                     {
-                        t_args  tmp;
-                        Typecheck_Code(m_ms, tmp, enum_type, var.expr);
+                        this->typecheck_code(nullptr, enum_type, var.expr);
                     }
                 }
             }
@@ -238,8 +262,27 @@ namespace {
     };
 }
 
-void Typecheck_Expressions(::HIR::Crate& crate)
+void Typecheck_Expressions(::HIR::Crate& crate, unsigned num_jobs/*=1*/)
 {
-    OuterVisitor    visitor { crate };
-    visitor.visit_crate( crate );
+    if( num_jobs <= 1 )
+    {
+        OuterVisitor    visitor { crate };
+        visitor.visit_crate( crate );
+        return ;
+    }
+
+    // Each body has its own inference state and only reads the crate, so they can be checked independently.
+    // - The shared state written from here is thread-safe: auto trait markings (`s_auto_impls_lock`), interned strings,
+    //   the span source map, and type refcounts. New nodes go into each body's own arena.
+    ::std::vector<QueuedBody>   queue;
+    {
+        OuterVisitor    visitor { crate, &queue };
+        visitor.visit_crate( crate );
+    }
+    DEBUG(queue.size() << " bodies over " << num_jobs << " jobs");
+    parallel_for_ordered(queue.size(), num_jobs, [&](unsigned , size_t idx) {
+        auto& b = queue[idx];
+        t_args  tmp;
+        Typecheck_Code(b.ms, b.args ? *b.args : tmp, b.result_type, *b.expr);
+        });
 }
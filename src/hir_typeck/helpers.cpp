@@ -6,6 +6,8 @@
  * - Typecheck helpers
  */
 #include "helpers.hpp"
+#include <algorithm>
+#include <mutex>
 
 // --------------------------------------------------------------------
 // HMTypeInferrence
@@ -448,7 +450,7 @@ void HMTypeInferrence::add_ivars(::HIR::TypeRef& type)
     TU_ARMA(Infer, e) {
         if( e.index == ~0u ) {
             type = this->new_ivar_tr(e.ty_class);
-            this->mark_change();
+            this->mark_progress();
             DEBUG("New ivar " << type);
         }
         }
@@ -574,7 +576,8 @@ const ::HIR::TypeRef& HMTypeInferrence::get_type(unsigned idx) const
 void HMTypeInferrence::set_ivar_to(unsigned int slot, ::HIR::TypeRef type)
 {
     auto sp = Span();
-    auto& root_ivar = this->get_pointed_ivar(slot);
+    auto root_slot = this->get_root_index(slot);
+    auto& root_ivar = m_ivars[root_slot];
     DEBUG("set_ivar_to(" << slot << " { " << *root_ivar.type << " }, " << type << ")");
 
     // If the left type was '_', alias the right to it
@@ -601,9 +604,11 @@ void HMTypeInferrence::set_ivar_to(unsigned int slot, ::HIR::TypeRef type)
         #if 1
         // Alias `l_e.index` to this slot
         DEBUG("Set IVar " << l_e->index << " = @" << slot);
-        auto& r_ivar = this->get_pointed_ivar(l_e->index);
+        auto r_slot = this->get_root_index(l_e->index);
+        auto& r_ivar = m_ivars[r_slot];
         r_ivar.alias = slot;
         r_ivar.type.reset();
+        this->wake_ivar(r_slot);
         #else
         DEBUG("Set IVar " << slot << " = @" << l_e->index);
         root_ivar.alias = l_e->index;
@@ -660,7 +665,7 @@ void HMTypeInferrence::set_ivar_to(unsigned int slot, ::HIR::TypeRef type)
         root_ivar.type = box$( type );
     }
 
-    this->mark_change();
+    this->mark_ivar_change(root_slot);
 }
 
 void HMTypeInferrence::ivar_unify(unsigned int left_slot, unsigned int right_slot)
@@ -668,10 +673,12 @@ void HMTypeInferrence::ivar_unify(unsigned int left_slot, unsigned int right_slo
     auto sp = Span();
     if( left_slot != right_slot )
     {
-        auto& left_ivar = this->get_pointed_ivar(left_slot);
+        auto left_root = this->get_root_index(left_slot);
+        auto& left_ivar = m_ivars[left_root];
 
         // TODO: Assert that setting this won't cause a loop.
-        auto& root_ivar = this->get_pointed_ivar(right_slot);
+        auto right_root = this->get_root_index(right_slot);
+        auto& root_ivar = m_ivars[right_root];
 
         if( const auto* re = root_ivar.type->data().opt_Infer() )
         {
@@ -720,10 +727,16 @@ void HMTypeInferrence::ivar_unify(unsigned int left_slot, unsigned int right_slo
         root_ivar.alias = left_slot;
         root_ivar.type.reset();
 
-        this->mark_change();
+        // NOTE: The left ivar's class may have changed
+        this->wake_ivar(left_root);
+        this->mark_ivar_change(right_root);
     }
 }
 HMTypeInferrence::IVar& HMTypeInferrence::get_pointed_ivar(unsigned int slot) const
+{
+    return const_cast<IVar&>(m_ivars.at(this->get_root_index(slot)));
+}
+unsigned HMTypeInferrence::get_root_index(unsigned int slot) const
 {
     auto index = slot;
     unsigned int count = 0;
@@ -737,7 +750,57 @@ HMTypeInferrence::IVar& HMTypeInferrence::get_pointed_ivar(unsigned int slot) co
         }
         count ++;
     }
-    return const_cast<IVar&>(m_ivars.at(index));
+    return index;
+}
+
+void HMTypeInferrence::rule_sleep(unsigned rule_idx, const ::std::vector<unsigned>& ivars)
+{
+    if( ivars.empty() )
+        return ;
+    if( rule_idx >= m_wakeups.sleep_gen.size() )
+        m_wakeups.sleep_gen.resize(rule_idx + 1, ~0u);
+    m_wakeups.sleep_gen[rule_idx] = m_wakeups.gen;
+    for(auto i : ivars)
+    {
+        if( i >= m_wakeups.ivar_waiters.size() )
+            m_wakeups.ivar_waiters.resize(i + 1);
+        m_wakeups.ivar_waiters[i].push_back(rule_idx);
+    }
+}
+void HMTypeInferrence::wake_ivar(unsigned slot)
+{
+    m_wakeups.change_count ++;
+    if( slot >= m_wakeups.ivar_waiters.size() )
+        return ;
+    for(auto r : m_wakeups.ivar_waiters[slot])
+        m_wakeups.sleep_gen[r] = ~0u;
+    m_wakeups.ivar_waiters[slot].clear();
+}
+void HMTypeInferrence::wake_all_rules()
+{
+    m_wakeups.change_count ++;
+    if( m_wakeups.ivar_waiters.empty() )
+        return ;
+    DEBUG("Wake all rules");
+    m_wakeups.gen ++;
+    m_wakeups.ivar_waiters.clear();
+}
+void HMTypeInferrence::get_unknown_ivars(const ::HIR::TypeRef& ty, ::std::vector<unsigned>& out) const
+{
+    visit_ty_with(ty, [&](const ::HIR::TypeRef& t)->bool {
+        if( t.data().is_Infer() ) {
+            const auto& rt = this->get_type(t);
+            if( const auto* re = rt.data().opt_Infer() ) {
+                if( ::std::find(out.begin(), out.end(), re->index) == out.end() )
+                    out.push_back(re->index);
+            }
+            else {
+                // Known, but may contain other unknown ivars
+                this->get_unknown_ivars(rt, out);
+            }
+        }
+        return false;
+        });
 }
 
 bool HMTypeInferrence::pathparams_contain_ivars(const ::HIR::PathParams& pps) const {
@@ -1634,6 +1697,10 @@ void TraitResolution::compact_ivars(HMTypeInferrence& m_ivars)
                 // TODO: cloning is expensive, BUT printing below is nice
                 auto nt = this->expand_associated_types(Span(), v.type->clone());
                 DEBUG("- " << i << " " << *v.type << " -> " << nt);
+                if( nt != *v.type ) {
+                    // Rules blocked on this ivar may now be able to progress (not counted as a change, as before)
+                    m_ivars.wake_ivar(i);
+                }
                 *v.type = mv$(nt);
             }
         }
@@ -2537,6 +2604,10 @@ bool TraitResolution::find_trait_impls_bound(const Span& sp, const ::HIR::Simple
         return false;
     });
 }
+namespace {
+    /// Protects `TraitMarkings::auto_impls` (a cache populated on demand, possibly from multiple typecheck threads)
+    ::std::mutex    s_auto_impls_lock;
+}
 bool TraitResolution::find_trait_impls_crate(const Span& sp,
         const ::HIR::SimplePath& trait, const ::HIR::PathParams* params_ptr,
         const ::HIR::TypeRef& type,
@@ -2552,7 +2623,7 @@ bool TraitResolution::find_trait_impls_crate(const Span& sp,
     if( m_crate.get_trait_by_path(sp, trait).m_is_marker )
     {
         // Detect recursion and return true if detected
-        static ::std::vector< ::std::tuple< const ::HIR::SimplePath*, const ::HIR::PathParams*, const ::HIR::TypeRef*> >    stack;
+        static thread_local ::std::vector< ::std::tuple< const ::HIR::SimplePath*, const ::HIR::PathParams*, const ::HIR::TypeRef*> >    stack;
         for(const auto& ent : stack ) {
             if( *::std::get<0>(ent) != trait )
                 continue ;
@@ -2588,13 +2659,25 @@ bool TraitResolution::find_trait_impls_crate(const Span& sp,
         // - Cache populated after destructure
         if( markings )
         {
-            auto it = markings->auto_impls.find( trait );
-            if( it != markings->auto_impls.end() )
+            bool found = false;
+            bool is_conditional = false;
+            bool is_impled = false;
+            {
+                ::std::lock_guard<::std::mutex> lh { s_auto_impls_lock };
+                auto it = markings->auto_impls.find( trait );
+                if( it != markings->auto_impls.end() )
+                {
+                    found = true;
+                    is_conditional = !it->second.conditions.empty();
+                    is_impled = it->second.is_impled;
+                }
+            }
+            if( found )
             {
-                if( ! it->second.conditions.empty() ) {
+                if( is_conditional ) {
                     TODO(sp, "Conditional auto trait impl");
                 }
-                else if( it->second.is_impled ) {
+                else if( is_impled ) {
                     return callback( ImplRef(&type, params_ptr, &null_assoc), ::HIR::Compare::Equal );
                 }
                 else {
@@ -2668,6 +2751,7 @@ bool TraitResolution::find_trait_impls_crate(const Span& sp,
         {
             if( markings ) {
                 ASSERT_BUG(sp, cmp == ::HIR::Compare::Equal, "Auto trait with no params returned a fuzzy match from destructure - " << trait << " for " << type);
+                ::std::lock_guard<::std::mutex> lh { s_auto_impls_lock };
                 markings->auto_impls.insert( ::std::make_pair(trait, ::HIR::TraitMarkings::AutoMarking { {}, true }) );
             }
             return callback( ImplRef(&type, params_ptr, &null_assoc), cmp );
@@ -2675,6 +2759,7 @@ bool TraitResolution::find_trait_impls_crate(const Span& sp,
         else
         {
             if( markings ) {
+                ::std::lock_guard<::std::mutex> lh { s_auto_impls_lock };
                 markings->auto_impls.insert( ::std::make_pair(trait, ::HIR::TraitMarkings::AutoMarking { {}, false }) );
             }
             return false;
@@ -71,6 +71,21 @@ public: // ?? - Needed once, anymore?
     ::std::vector< IVar>    m_ivars;
     bool    m_has_changed;
 
+private:
+    /// Inferrence rules (identified by index) that are blocked until one of a set of ivars changes
+    struct RuleWakeups
+    {
+        /// Rules waiting on each ivar (entries may be stale, waking a rule that is already awake is harmless)
+        ::std::vector< ::std::vector<unsigned> >   ivar_waiters;
+        /// Generation each rule was put to sleep in (~0 = awake)
+        ::std::vector<unsigned> sleep_gen;
+        /// Incremented when all rules are woken
+        unsigned    gen = 0;
+        /// Count of ivar changes (including untracked ones)
+        unsigned    change_count = 0;
+    };
+    RuleWakeups m_wakeups;
+
 public:
     HMTypeInferrence():
         m_has_changed(false)
@@ -84,13 +99,35 @@ public:
         m_has_changed = false;
         return rv;
     }
+    /// Record a change that can't be attributed to specific ivars (wakes all rules)
     void mark_change() {
+        this->wake_all_rules();
+        this->mark_progress();
+    }
+    /// Record progress that doesn't affect existing rules (e.g. a new rule or ivar)
+    void mark_progress() {
         if( !m_has_changed ) {
             DEBUG("- CHANGE");
             m_has_changed = true;
         }
     }
 
+    // Rule wakeups (see `Typecheck_Code_CS`)
+    bool rule_is_awake(unsigned rule_idx) const {
+        return rule_idx >= m_wakeups.sleep_gen.size() || m_wakeups.sleep_gen[rule_idx] != m_wakeups.gen;
+    }
+    /// Put a rule to sleep until one of the passed ivars changes (stays awake if the list is empty)
+    void rule_sleep(unsigned rule_idx, const ::std::vector<unsigned>& ivars);
+    /// Wake all rules waiting on an ivar (by root index)
+    void wake_ivar(unsigned slot);
+    void wake_all_rules();
+    /// Counter incremented by every change that would wake rules
+    unsigned change_count() const {
+        return m_wakeups.change_count;
+    }
+    /// Get the (root) indexes of all unknown ivars within a type
+    void get_unknown_ivars(const ::HIR::TypeRef& ty, ::std::vector<unsigned>& out) const;
+
     void compact_ivars();
     bool apply_defaults();
 
@@ -143,6 +180,12 @@ public:
     bool types_equal(const ::HIR::TypeRef& l, const ::HIR::TypeRef& r) const;
 private:
     IVar& get_pointed_ivar(unsigned int slot) const;
+    unsigned get_root_index(unsigned int slot) const;
+    /// Record a change to an ivar (by root index)
+    void mark_ivar_change(unsigned slot) {
+        this->wake_ivar(slot);
+        this->mark_progress();
+    }
 };
 
 class TraitResolution
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <hir/hir.hpp>
+#include <unordered_map>
 #include "common.hpp"
 #include "impl_ref.hpp"
 
@@ -55,9 +56,9 @@ public:
     ::HIR::SimplePath   m_lang_PhantomData;
 
 private:
-    mutable ::std::map< ::HIR::TypeRef, bool >  m_copy_cache;
-    mutable ::std::map< ::HIR::TypeRef, bool >  m_clone_cache;
-    mutable ::std::map< ::HIR::TypeRef, bool >  m_drop_cache;
+    mutable ::std::unordered_map< ::HIR::TypeRef, bool, ::HIR::TypeRef::Hash >  m_copy_cache;
+    mutable ::std::unordered_map< ::HIR::TypeRef, bool, ::HIR::TypeRef::Hash >  m_clone_cache;
+    mutable ::std::unordered_map< ::HIR::TypeRef, bool, ::HIR::TypeRef::Hash >  m_drop_cache;
     mutable ::std::map< ::HIR::Path, HIR::TypeRef>  m_aty_cache;
 
 public:
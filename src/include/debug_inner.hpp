@@ -2,14 +2,21 @@
  */
 #pragma once
 #include <ctime>
+#include <chrono>
+#include <cstdint>
 #include <initializer_list>
 
 extern void debug_init_phases(const char* env_var_name, std::initializer_list<const char*> il);
+/// Record per-phase timing/memory statistics to the given file (JSON, or CSV if the name ends with `.csv`)
+extern void debug_set_timings_output(const char* path);
 
 class DebugTimedPhase
 {
     const char* m_name;
     clock_t m_start;
+    ::std::chrono::steady_clock::time_point m_wall_start;
+    uint64_t    m_alloc_count_start;
+    uint64_t    m_alloc_bytes_start;
 public:
     DebugTimedPhase(const char* name);
     ~DebugTimedPhase();
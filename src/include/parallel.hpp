@@ -0,0 +1,137 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * include/parallel.hpp
+ * - Simple worker pool for running independent per-item passes
+ */
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+#include <span.hpp>
+#include <jobserver.h>	// tools/common/jobserver.h
+
+/// Run `fcn(worker_index, item_index)` for every item in `0 .. count`, using up to `num_jobs` threads.
+/// - With `num_jobs <= 1` (or a single item) this runs inline, in order
+/// - Items are handed out in order, and the first exception thrown by a worker is re-thrown on the caller
+/// - If there's a jobserver, each extra thread holds a token while it runs (taken before it claims any items)
+template<typename Fcn>
+void parallel_for(size_t count, unsigned num_jobs, Fcn fcn)
+{
+    if( num_jobs <= 1 || count <= 1 )
+    {
+        for(size_t i = 0; i < count; i ++)
+            fcn(0, i);
+        return ;
+    }
+    if( num_jobs > count )
+        num_jobs = static_cast<unsigned>(count);
+
+    ::std::atomic<size_t>   next_item(0);
+    ::std::atomic<bool> failed(false);
+    ::std::exception_ptr    error;
+    ::std::mutex    error_lock;
+    auto worker = [&](unsigned worker_idx) {
+        JobServer* js = (worker_idx > 0 ? JobServer::s_global : nullptr);
+        if( js && !js->acquire([&]{ return failed || next_item >= count; }) )
+            return ;
+        while( !failed )
+        {
+            size_t i = next_item.fetch_add(1);
+            if( i >= count )
+                break;
+            try
+            {
+                fcn(worker_idx, i);
+            }
+            catch(...)
+            {
+                ::std::lock_guard<::std::mutex> lh { error_lock };
+                if( !error )
+                    error = ::std::current_exception();
+                failed = true;
+            }
+        }
+        if( js )
+            js->release();
+    };
+
+    ::std::vector<::std::thread>    threads;
+    threads.reserve(num_jobs - 1);
+    for(unsigned w = 1; w < num_jobs; w ++)
+        threads.push_back(::std::thread(worker, w));
+    worker(0);
+    for(auto& t : threads)
+        t.join();
+
+    if( error )
+        ::std::rethrow_exception(error);
+}
+
+/// Variant of `parallel_for` that keeps diagnostics in item order
+/// - Warnings from each item are buffered and printed once all earlier items have completed
+/// - A fatal error waits for all earlier items to finish first, so the reported error is the same as a serial run
+/// - An exception from an item is re-thrown on the caller once the workers have stopped
+template<typename Fcn>
+void parallel_for_ordered(size_t count, unsigned num_jobs, Fcn fcn)
+{
+    if( num_jobs <= 1 || count <= 1 )
+    {
+        parallel_for(count, num_jobs, fcn);
+        return ;
+    }
+
+    ::std::mutex    lock;
+    ::std::condition_variable   cv;
+    ::std::vector<bool>  done(count);
+    ::std::vector<::std::string>    output(count);
+    size_t  n_flushed = 0;
+
+    parallel_for(count, num_jobs, [&](unsigned worker_idx, size_t i) {
+        DiagnosticBuffer    buf;
+        buf.on_fatal = [&](DiagnosticBuffer& b) {
+            ::std::unique_lock<::std::mutex>    lh { lock };
+            // Items are handed out in order, so every earlier item is either complete or running (and can't block on this one)
+            cv.wait(lh, [&]{ return n_flushed == i; });
+            ::std::cerr << b.messages << ::std::flush;
+            };
+        // An exception still marks the item as done (so later items aren't left waiting on it), and is then passed
+        // on to `parallel_for` to be re-thrown on the calling thread
+        ::std::exception_ptr    item_error;
+        {
+            struct Guard {
+                DiagnosticBuffer* prev;
+                ~Guard() { DiagnosticBuffer::set_current(prev); }
+            } _ { DiagnosticBuffer::set_current(&buf) };
+            try
+            {
+                fcn(worker_idx, i);
+            }
+            catch(...)
+            {
+                item_error = ::std::current_exception();
+            }
+        }
+
+        {
+            ::std::lock_guard<::std::mutex> lh { lock };
+            output[i] = ::std::move(buf.messages);
+            done[i] = true;
+            while( n_flushed < count && done[n_flushed] )
+            {
+                ::std::cerr << output[n_flushed];
+                output[n_flushed].clear();
+                n_flushed ++;
+            }
+            cv.notify_all();
+        }
+        if( item_error )
+            ::std::rethrow_exception(item_error);
+        });
+    ::std::cerr << ::std::flush;
+}
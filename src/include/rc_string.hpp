@@ -9,14 +9,15 @@
 
 #include <cstring>
 #include <ostream>
+#include <atomic>
 #include "../common.hpp"
 
 class RcString
 {
     struct Inner {
-        unsigned int    refcount;
+        ::std::atomic<unsigned int> refcount;
         unsigned int    size;
-        unsigned int    ordering;   // Populated only for interned strings, 0 otherwise
+        unsigned int    ordering;   // Non-zero for interned strings (set once, when the string is interned)
         unsigned int    data[1];    // Actually arbitary
     }*  m_ptr;
 public:
@@ -44,7 +45,7 @@ public:
     RcString(const RcString& x):
         m_ptr(x.m_ptr)
     {
-        if( m_ptr ) m_ptr->refcount += 1;
+        if( m_ptr ) m_ptr->refcount.fetch_add(1, ::std::memory_order_relaxed);
     }
     RcString(RcString&& x):
         m_ptr(x.m_ptr)
@@ -60,7 +61,7 @@ public:
         {
             this->~RcString();
             m_ptr = x.m_ptr;
-            if( m_ptr ) m_ptr->refcount += 1;
+            if( m_ptr ) m_ptr->refcount.fetch_add(1, ::std::memory_order_relaxed);
         }
         return *this;
     }
@@ -97,27 +98,26 @@ public:
     }
 
     Ordering ord(const char* s, size_t l) const;
-    Ordering ord_interned(const RcString& s) const;
 
     Ordering ord(const RcString& s) const {
         if( m_ptr == s.m_ptr )
             return OrdEqual;
         if( !m_ptr || !s.m_ptr)
             return m_ptr ? OrdGreater : OrdLess;
-        // If both are interned, then use stored sorting
-        if( is_interned() && s.is_interned() )
-            return ord_interned(s);
+        // NOTE: Always compares the bytes (even for interned strings), so the order doesn't depend on interning order
+        // and is safe to evaluate from multiple threads
         return ord(s.c_str(), s.size());
     }
     bool operator==(const RcString& s) const {
         if(s.size() != this->size())
             return false;
+        // Interned strings are unique, so two different interned strings can't be equal
+        if( m_ptr != s.m_ptr && is_interned() && s.is_interned() )
+            return false;
         return this->ord(s) == OrdEqual;
     }
     bool operator!=(const RcString& s) const {
-        if(s.size() != this->size())
-            return true;
-        return this->ord(s) != OrdEqual;
+        return !(*this == s);
     }
     bool operator<(const RcString& s) const { return this->ord(s) == OrdLess; }
     bool operator>(const RcString& s) const { return this->ord(s) == OrdGreater; }
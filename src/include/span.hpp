@@ -10,6 +10,7 @@
 #include <rc_string.hpp>
 #include <functional>
 #include <memory>
+#include <cstdint>
 
 enum ErrorType
 {
@@ -22,6 +23,7 @@ enum WarningType
 
 class Position;
 struct SpanInner;
+struct SpanInnerRef;
 
 struct ProtoSpan
 {
@@ -30,44 +32,25 @@ struct ProtoSpan
     unsigned int start_line;
     unsigned int start_ofs;
 };
+/// Handle to an entry in the global source map (see span.cpp)
+/// - Trivially copyable, the file/line information is looked up on demand (only needed for diagnostics)
 struct Span
 {
 private:
-    SpanInner*  m_ptr;
-    static SpanInner    s_empty_span;
+    /// Index into the source map's span table, zero is the empty span
+    uint32_t    m_idx;
 public:
     Span():
-        m_ptr(&s_empty_span)
+        m_idx(0)
     {}
-    Span(Span parent, RcString filename, unsigned int start_line, unsigned int start_ofs,  unsigned int end_line, unsigned int end_ofs);
+    Span(Span parent, const RcString& filename, unsigned int start_line, unsigned int start_ofs,  unsigned int end_line, unsigned int end_ofs);
     Span(Span parent, const Position& position);
-    ~Span();
 
-    Span(const Span& x);
-    Span(Span&& x):
-        m_ptr(x.m_ptr)
-    {
-        x.m_ptr = nullptr;
-    }
-
-    Span& operator=(const Span& x)
-    {
-        this->~Span();
-        new (this) Span(x);
-        return *this;
-    }
-    Span& operator=(Span&& x)
-    {
-        this->~Span();
-        new (this) Span(std::move(x));
-        return *this;
-    }
-
-    bool operator==(const Span& x) const { return m_ptr == x.m_ptr; }
+    bool operator==(const Span& x) const { return m_idx == x.m_idx; }
     bool operator!=(const Span& x) const { return !(*this == x); }
 
-    const SpanInner& operator*() const { return *m_ptr; }
-    const SpanInner* operator->() const { return m_ptr; }
+    SpanInner operator*() const;
+    SpanInnerRef operator->() const;
 
     void bug(::std::function<void(::std::ostream&)> msg) const;
     void error(ErrorType tag, ::std::function<void(::std::ostream&)> msg) const;
@@ -76,12 +59,9 @@ public:
 
     friend ::std::ostream& operator<<(::std::ostream& os, const Span& sp);
 };
+/// Expanded form of a `Span`, returned by value from the source map
 struct SpanInner
 {
-    friend struct Span;
-private:
-    size_t  reference_count;
-public:
     Span    parent_span;
     RcString    filename;
 
@@ -89,19 +69,27 @@ public:
     unsigned int start_ofs;
     unsigned int end_line;
     unsigned int end_ofs;
+};
+/// Holder allowing `sp->field` on a span
+struct SpanInnerRef
+{
+    SpanInner   inner;
+    const SpanInner* operator->() const { return &inner; }
+};
+inline SpanInnerRef Span::operator->() const {
+    return SpanInnerRef { **this };
+}
 
-private:
-    static SpanInner* alloc(Span parent, RcString filename, unsigned int start_line, unsigned int start_ofs,  unsigned int end_line, unsigned int end_ofs) {
-        auto* rv = new SpanInner();
-        rv->reference_count = 1;
-        rv->parent_span = parent;
-        rv->filename = ::std::move(filename);
-        rv->start_line = start_line;
-        rv->start_ofs = start_ofs;
-        rv->end_line = end_line;
-        rv->end_ofs = end_ofs;
-        return rv;
-    }
+/// Per-thread capture of diagnostics, used to keep output in a deterministic order when items are processed in parallel
+/// - While active, warnings/notes are appended to `messages` instead of being printed
+/// - On BUG/ERROR, the message is appended and `on_fatal` is called before the process exits (it prints `messages`)
+struct DiagnosticBuffer
+{
+    ::std::string   messages;
+    ::std::function<void(DiagnosticBuffer&)>    on_fatal;
+
+    /// Set the active buffer for the current thread, returns the previous one
+    static DiagnosticBuffer* set_current(DiagnosticBuffer* buf);
 };
 
 template<typename T>
@@ -698,6 +698,18 @@ namespace
         size_t position() const {
             return m_consume_count;
         }
+        /// Returns true if the next token was split off a larger token (so `position` doesn't fully describe the state)
+        bool has_faked_next() const {
+            return m_faked_next.type() != TOK_NULL;
+        }
+        /// Restore the state of another stream over the same tree
+        void restore(const TokenStreamRO& x) {
+            assert(&x.m_tt == &m_tt);
+            m_offsets = x.m_offsets;
+            m_active_offset = x.m_active_offset;
+            m_faked_next = x.m_faked_next;
+            m_consume_count = x.m_consume_count;
+        }
     };
 
     // Consume an entire TT
@@ -1810,6 +1822,140 @@ namespace
     }
 }
 
+namespace
+{
+    /// Results of `consume_from_frag` for a single macro invocation, keyed on the input position
+    /// - Arms often share a prefix, so the same fragment gets matched at the same position several times
+    class FragmentMatchCache
+    {
+        ::std::map< ::std::pair<size_t, MacroPatEnt::Type>, ::std::pair<bool, TokenStreamRO> >  m_ents;
+    public:
+        bool consume(TokenStreamRO& lex, MacroPatEnt::Type type)
+        {
+            // Split tokens (e.g. `>>`) aren't captured by the position
+            if( lex.has_faked_next() )
+                return consume_from_frag(lex, type);
+            auto key = ::std::make_pair(lex.position(), type);
+            auto it = m_ents.find(key);
+            if( it == m_ents.end() )
+            {
+                auto end = lex.clone();
+                bool rv = consume_from_frag(end, type);
+                it = m_ents.insert(::std::make_pair(key, ::std::make_pair(rv, mv$(end)))).first;
+            }
+            else
+            {
+                DEBUG("Cached " << type << " @" << key.first << " = " << it->second.first);
+            }
+            lex.restore(it->second.second);
+            return it->second.first;
+        }
+    };
+
+    /// Check if a token could be the start of the specified fragment (conservative, false only if it can't match)
+    bool fragment_can_start(MacroPatEnt::Type type, eTokenType tok)
+    {
+        switch(type)
+        {
+        case MacroPatEnt::PAT_IDENT:
+            return tok == TOK_IDENT || Token::type_is_rword(tok);
+        case MacroPatEnt::PAT_LIFETIME:
+            return tok == TOK_LIFETIME;
+        case MacroPatEnt::PAT_BLOCK:
+            return tok == TOK_BRACE_OPEN || tok == TOK_INTERPOLATED_BLOCK;
+        case MacroPatEnt::PAT_META:
+            return tok == TOK_IDENT || tok == TOK_INTERPOLATED_META;
+        case MacroPatEnt::PAT_LITERAL:
+            switch(tok)
+            {
+            case TOK_INTEGER:
+            case TOK_FLOAT:
+            case TOK_STRING:
+            case TOK_RWORD_TRUE:
+            case TOK_RWORD_FALSE:
+                return true;
+            default:
+                return false;
+            }
+        case MacroPatEnt::PAT_TT:
+            switch(tok)
+            {
+            case TOK_EOF:
+            case TOK_PAREN_CLOSE:
+            case TOK_BRACE_CLOSE:
+            case TOK_SQUARE_CLOSE:
+                return false;
+            default:
+                return true;
+            }
+        default:
+            // NOTE: `vis` can be empty, and the rest have complex grammars
+            return true;
+        }
+    }
+
+    const MacroRulesDispatch& get_dispatch(const MacroRules& rules)
+    {
+        if( !rules.m_dispatch )
+        {
+            auto d = ::std::make_unique<MacroRulesDispatch>();
+            d->arm_filters.reserve(rules.m_rules.size());
+            for(const auto& arm : rules.m_rules)
+            {
+                MacroRulesDispatch::ArmFilter   f;
+                // Only the first pattern entry is checked, anything that branches (loops/optional) is left as `Any`
+                // - An empty pattern is an implicit `End`
+                if( arm.m_pattern.empty() || arm.m_pattern.front().is_End() ) {
+                    f.kind = MacroRulesDispatch::ArmFilter::Exact;
+                    f.tok = Token(TOK_EOF);
+                }
+                else if( const auto* e = arm.m_pattern.front().opt_ExpectTok() ) {
+                    f.kind = MacroRulesDispatch::ArmFilter::Exact;
+                    f.tok = e->clone();
+                }
+                else if( const auto* e = arm.m_pattern.front().opt_ExpectPat() ) {
+                    f.kind = MacroRulesDispatch::ArmFilter::Frag;
+                    f.frag = e->type;
+                }
+                d->arm_filters.push_back(mv$(f));
+            }
+            rules.m_dispatch = mv$(d);
+        }
+        return *rules.m_dispatch;
+    }
+    /// Get the arms that could match input starting with `tok`
+    const ::std::vector<unsigned>& get_candidate_arms(const MacroRules& rules, const Token& tok)
+    {
+        get_dispatch(rules);
+        auto& d = *rules.m_dispatch;
+        auto it = d.by_token_type.find(tok.type());
+        if( it == d.by_token_type.end() )
+        {
+            ::std::vector<unsigned> arms;
+            for(unsigned i = 0; i < d.arm_filters.size(); i ++)
+            {
+                const auto& f = d.arm_filters[i];
+                switch(f.kind)
+                {
+                case MacroRulesDispatch::ArmFilter::Any:
+                    arms.push_back(i);
+                    break;
+                case MacroRulesDispatch::ArmFilter::Exact:
+                    if( f.tok.type() == tok.type() )
+                        arms.push_back(i);
+                    break;
+                case MacroRulesDispatch::ArmFilter::Frag:
+                    if( fragment_can_start(f.frag, tok.type()) )
+                        arms.push_back(i);
+                    break;
+                }
+            }
+            it = d.by_token_type.insert(::std::make_pair(tok.type(), mv$(arms))).first;
+        }
+        return it->second;
+    }
+}
+
 unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& rules, TokenTree input, const AST::Crate& crate, AST::Module& mod,  ParameterMappings& bound_tts)
 {
     TRACE_FUNCTION_F(rules.m_rules.size() << " options");
@@ -1817,8 +1963,17 @@ unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& ru
 
     ::std::vector< ::std::pair<size_t, ::std::vector<bool>> >    matches;
     ::std::vector< std::pair<size_t, eTokenType> >  fail_pos;
-    for(size_t i = 0; i < rules.m_rules.size(); i ++)
+    FragmentMatchCache  frag_cache;
+    const auto first_lex = TokenStreamRO(input);
+    const auto& first_tok = first_lex.next_tok();
+    const auto& candidates = get_candidate_arms(rules, first_tok);
+    DEBUG(candidates.size() << " candidate arms for " << first_tok);
+    for(size_t i : candidates)
     {
+        // Exact tokens (e.g. identifiers) are only filtered by type in the index
+        const auto& filter = rules.m_dispatch->arm_filters[i];
+        if( filter.kind == MacroRulesDispatch::ArmFilter::Exact && filter.tok != first_tok )
+            continue ;
         auto lex = TokenStreamRO(input);
         auto arm_stream = MacroPatternStream(rules.m_rules[i].m_pattern);
 
@@ -1842,7 +1997,7 @@ unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& ru
                 for(const auto& check : e->ents)
                 {
                     if( check.ty != MacroPatEnt::PAT_TOKEN ) {
-                        if( !consume_from_frag(lc, check.ty)  )
+                        if( !frag_cache.consume(lc, check.ty)  )
                         {
                             rv = false;
                             break;
@@ -1879,7 +2034,7 @@ unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& ru
             else if( const auto* e = pat.opt_ExpectPat() )
             {
                 DEBUG("Arm " << i << " @" << pos << " ExpectPat(" << e->type << " => $" << e->idx << ")");
-                if( !consume_from_frag(lex, e->type) )
+                if( !frag_cache.consume(lex, e->type) )
                 {
                     fail = true;
                     break;
@@ -1896,6 +2051,8 @@ unsigned int Macro_InvokeRules_MatchPattern(const Span& sp, const MacroRules& ru
         {
             matches.push_back( ::std::make_pair(i, arm_stream.take_history()) );
             DEBUG(i << " MATCHED");
+            // Only the first matching arm is used
+            break;
         }
         else
         {
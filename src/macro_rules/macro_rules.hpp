@@ -175,6 +175,26 @@ struct MacroRulesArm
     MacroRulesArm& operator=(MacroRulesArm&&) = default;
 };
 
+/// Index used to skip `macro_rules!` arms that can't match, based on the first token of the input
+/// - Built on the first invocation of a macro (see `macro_rules/eval.cpp`)
+struct MacroRulesDispatch
+{
+    /// What an arm's pattern requires of the first input token
+    struct ArmFilter
+    {
+        enum Kind {
+            Any,    // Not known, the arm must be tried
+            Exact,  // Must be exactly `tok`
+            Frag,   // Must be able to start a `frag` fragment
+        } kind = Any;
+        Token   tok;
+        MacroPatEnt::Type   frag = MacroPatEnt::PAT_TT;
+    };
+    ::std::vector<ArmFilter>    arm_filters;
+    /// Arms that could accept a token of the given type (populated on demand)
+    ::std::map<eTokenType, ::std::vector<unsigned>> by_token_type;
+};
+
 /// A sigle 'macro_rules!' block
 class MacroRules
 {
@@ -191,6 +211,9 @@ public:
     /// Expansion rules
     ::std::vector<MacroRulesArm>  m_rules;
 
+    /// Cached arm dispatch index (derived from `m_rules`)
+    mutable ::std::unique_ptr<MacroRulesDispatch>   m_dispatch;
+
     MacroRules()
     {
     }
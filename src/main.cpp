@@ -29,6 +29,7 @@
 
 #include "expand/cfg.hpp"
 #include <target_detect.h>	// tools/common/target_detect.h
+#include <jobserver.h>	// tools/common/jobserver.h
 #include <debug_inner.hpp>
 
 #ifdef _WIN32
@@ -57,6 +58,8 @@ struct ProgramParams
     ::std::string   target = DEFAULT_TARGET_NAME;
 
     ::std::string   emit_depfile;
+    /// File created once the crate metadata (`.hir`) is complete (used for pipelined builds)
+    ::std::string   emit_metadata_marker;
 
     AST::Edition      edition = AST::Edition::Rust2015;
     ::AST::Crate::Type  crate_type = ::AST::Crate::Type::Unknown;
@@ -79,6 +82,9 @@ struct ProgramParams
 
     ::std::set< ::std::string> features;
 
+    /// Number of worker threads used by per-function passes (typecheck and MIR) (1 = run serially)
+    unsigned num_threads = 1;
+
     struct {
         bool disable_mir_optimisations = false;
         bool full_validate = false;
@@ -92,8 +98,17 @@ struct ProgramParams
         ::std::string   codegen_type;
         ::std::string   emit_build_command;
         ::std::string   panic_type;
+        unsigned    codegen_units = 1;
+        unsigned    codegen_jobs = 0;
+        /// Export/import monomorphised functions across crates (`-Z share-generics`)
+        bool    share_generics = false;
+        /// Write `<output>.mir.bin` alongside the text MIR (`-C emit-mmir-binary`)
+        bool    emit_mmir_binary = false;
     } codegen;
 
+    /// Hash-cons fully-resolved types during monomorphisation (`-Z intern-types`)
+    bool intern_types = false;
+
     ProgramParams(int argc, char *argv[]);
 
     void show_help() const;
@@ -233,6 +248,11 @@ int main(int argc, char *argv[])
 {
     init_debug_list();
     ProgramParams   params(argc, argv);
+    // Share job slots with the parent build (make/minicargo) - parallel work past the first thread needs a token
+    // - This process's implicit slot is used by the main thread
+    auto jobserver = JobServer::from_env(/*implicit_available=*/false);
+    JobServer::s_global = jobserver.get();
+    ::HIR::TypeRef::set_interning_enabled(params.intern_types);
 
     // Set up cfg values
     CompilePhaseV("Setup", [&]() {
@@ -505,9 +525,10 @@ int main(int argc, char *argv[])
 
             of << params.outfile << ":";
             // - Iterate all loaded crates files
+            // NOTE: Uses the metadata file, as that's what is actually loaded (and it's complete before the library is)
             for(const auto& ec : crate.m_extern_crates)
             {
-                of << " " << ec.second.m_filename;
+                of << " " << ec.second.m_filename << ".hir";
             }
             // - Iterate all extra files (include! and friends)
         }
@@ -619,7 +640,7 @@ int main(int argc, char *argv[])
             });
         // Check the rest of the expressions (including function bodies)
         CompilePhaseV("Typecheck Expressions", [&]() {
-            Typecheck_Expressions(*hir_crate);
+            Typecheck_Expressions(*hir_crate, params.num_threads);
             });
         // === HIR Expansion ===
         // Annotate how each node's result is used
@@ -685,12 +706,12 @@ int main(int argc, char *argv[])
 
         // Validate the MIR
         CompilePhaseV("MIR Validate", [&]() {
-            MIR_CheckCrate(*hir_crate);
+            MIR_CheckCrate(*hir_crate, params.num_threads);
             });
 
         // - Expand constants in HIR and virtualise calls
         CompilePhaseV("MIR Cleanup", [&]() {
-            MIR_CleanupCrate(*hir_crate);
+            MIR_CleanupCrate(*hir_crate, params.num_threads);
             });
         if( params.debug.full_validate_early || getenv("MRUSTC_FULL_VALIDATE_PREOPT") )
         {
@@ -701,7 +722,7 @@ int main(int argc, char *argv[])
 
         // Optimise the MIR
         CompilePhaseV("MIR Optimise", [&]() {
-            MIR_OptimiseCrate(*hir_crate, params.debug.disable_mir_optimisations);
+            MIR_OptimiseCrate(*hir_crate, params.debug.disable_mir_optimisations, params.num_threads);
             });
 
         if( params.debug.dump_mir )
@@ -713,7 +734,7 @@ int main(int argc, char *argv[])
                 });
         }
         CompilePhaseV("MIR Validate PO", [&]() {
-            MIR_CheckCrate(*hir_crate);
+            MIR_CheckCrate(*hir_crate, params.num_threads);
             });
         // - Exhaustive MIR validation (follows every code path and checks variable validity)
         // > DEBUGGING ONLY
@@ -735,6 +756,9 @@ int main(int argc, char *argv[])
         trans_opt.mode = params.codegen.codegen_type == "" ? "c" : params.codegen.codegen_type;
         trans_opt.build_command_file = params.codegen.emit_build_command;
         trans_opt.opt_level = params.opt_level;
+        trans_opt.codegen_units = params.codegen.codegen_units;
+        trans_opt.codegen_jobs = params.codegen.codegen_jobs;
+        trans_opt.emit_mmir_binary = params.codegen.emit_mmir_binary;
         trans_opt.panic_crate = params.codegen.panic_type == "" ? "panic_abort" : "panic_"+params.codegen.panic_type;
         for(const char* libdir : params.lib_search_dirs ) {
             // Store these paths for use in final linking.
@@ -744,6 +768,10 @@ int main(int argc, char *argv[])
             hir_crate->m_ext_libs.push_back(::HIR::ExternLibrary { libname });
         }
         trans_opt.emit_debug_info = params.emit_debug_info;
+        // Shared instances rely on weak symbols, so are only supported with the C backend on GCC-like compilers
+        trans_opt.share_generics = params.codegen.share_generics
+            && trans_opt.mode == "c"
+            && Target_GetCurSpec().m_backend_c.m_codegen_mode == CodegenMode::Gnu11;
 
         // Generate code for non-generic public items (if requested)
         if( params.test_harness )
@@ -765,12 +793,12 @@ int main(int argc, char *argv[])
             case ::AST::Crate::Type::RustLib:
             case ::AST::Crate::Type::RustDylib:
             case ::AST::Crate::Type::CDylib:
-                return Trans_Enumerate_Public(*hir_crate);
+                return Trans_Enumerate_Public(*hir_crate, trans_opt.share_generics);
             case ::AST::Crate::Type::ProcMacro:
                 // TODO: proc macros enumerate twice, once as a library (why?) and again as an executable
                 return Trans_Enumerate_Public(*hir_crate);
             case ::AST::Crate::Type::Executable:
-                return Trans_Enumerate_Main(*hir_crate);
+                return Trans_Enumerate_Main(*hir_crate, trans_opt.share_generics);
             }
             throw ::std::runtime_error("Invalid crate_type value");
             });
@@ -794,13 +822,24 @@ int main(int argc, char *argv[])
             throw "";
         case ::AST::Crate::Type::RustLib:
             // Save a loadable HIR dump
-            CompilePhaseV("HIR Serialise", [&]() { HIR_Serialise(params.outfile + ".hir", *hir_crate); });
+            CompilePhaseV("HIR Serialise", [&]() {
+                if( trans_opt.share_generics )
+                    Trans_Enumerate_RecordShared(*hir_crate, items);
+                HIR_Serialise(params.outfile + ".hir", *hir_crate);
+                });
+            // - Metadata is now final, dependent crates can start compiling while codegen runs
+            if( params.emit_metadata_marker != "" )
+            {
+                ::std::ofstream(params.emit_metadata_marker) << params.outfile << ".hir" << ::std::endl;
+            }
             // Generate a loadable .o
             CompilePhaseV("Trans Codegen", [&]() { Trans_Codegen(params.outfile, CodegenOutput::StaticLibrary, trans_opt, *hir_crate, items, params.outfile + ".hir"); });
             break;
         case ::AST::Crate::Type::RustDylib:
             // Save a loadable HIR dump
             CompilePhaseV("HIR Serialise", [&]() {
+                if( trans_opt.share_generics )
+                    Trans_Enumerate_RecordShared(*hir_crate, items);
                 //auto saved_ext_crates = ::std::move(hir_crate->m_ext_crates);
                 HIR_Serialise(params.outfile + ".hir", *hir_crate);
                 //hir_crate->m_ext_crates = ::std::move(saved_ext_crates);
@@ -982,10 +1021,29 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                     get_optval();
                     this->emit_depfile = optval;
                 }
+                else if( optname == "emit-metadata-marker" ) {
+                    get_optval();
+                    this->emit_metadata_marker = optval;
+                }
                 else if( optname == "panic" ) {
                     get_optval();
                     this->codegen.panic_type = optval;
                 }
+                else if( optname == "codegen-units" ) {
+                    get_optval();
+                    this->codegen.codegen_units = ::std::strtoul(optval.c_str(), nullptr, 10);
+                    if( this->codegen.codegen_units == 0 ) {
+                        ::std::cerr << "Invalid value for -C codegen-units - '" << optval << "'" << ::std::endl;
+                        exit(1);
+                    }
+                }
+                else if( optname == "codegen-jobs" ) {
+                    get_optval();
+                    this->codegen.codegen_jobs = ::std::strtoul(optval.c_str(), nullptr, 10);
+                }
+                else if( optname == "emit-mmir-binary" ) {
+                    this->codegen.emit_mmir_binary = true;
+                }
                 else {
                     ::std::cerr << "Unknown codegen option: '" << optname << "'" << ::std::endl;
                     exit(1);
@@ -1063,10 +1121,26 @@ ProgramParams::ProgramParams(int argc, char *argv[])
                         exit(1);
                     }
                 }
+                else if( optname == "threads" ) {
+                    get_optval();
+                    this->num_threads = ::std::strtoul(optval.c_str(), nullptr, 10);
+                    if( this->num_threads == 0 ) {
+                        ::std::cerr << "Invalid value for -Z threads - '" << optval << "'" << ::std::endl;
+                        exit(1);
+                    }
+                }
                 else if( optname == "print-cfgs") {
                     no_optval();
                     this->print_cfgs = true;
                 }
+                else if( optname == "share-generics" ) {
+                    no_optval();
+                    this->codegen.share_generics = true;
+                }
+                else if( optname == "intern-types" ) {
+                    no_optval();
+                    this->intern_types = true;
+                }
                 else {
                     ::std::cerr << "Unknown debug option: '" << optname << "'" << ::std::endl;
                     exit(1);
@@ -1245,6 +1319,14 @@ ProgramParams::ProgramParams(int argc, char *argv[])
             else if( strcmp(arg, "--test") == 0 ) {
                 this->test_harness = true;
             }
+            // `--timings-out <file>`   - Write per-phase time/memory statistics (JSON, or CSV if the file ends in `.csv`)
+            else if( strcmp(arg, "--timings-out") == 0 ) {
+                if (i == argc - 1) {
+                    ::std::cerr << "Flag " << arg << " requires an argument" << ::std::endl;
+                    exit(1);
+                }
+                debug_set_timings_output(argv[++i]);
+            }
             else if( strcmp(arg, "--edition") == 0 ) {
                 if (i == argc - 1) {
                     ::std::cerr << "Flag " << arg << " requires an argument" << ::std::endl;
@@ -1327,6 +1409,8 @@ void ProgramParams::show_help() const
         "--cfg flag=\"val\"   : Set a string #[cfg]/cfg! flag\n"
         "--target <name>    : Compile code for the given target\n"
         "--test             : Generate a unit test executable\n"
+        "--timings-out <file>\n"
+        "                   : Write per-phase wall/CPU time, RSS and allocation counts (JSON, or CSV for `.csv`)\n"
         "-C <option>        : Code-generation options\n"
         "-Z <option>        : Debugging/experimental options\n"
         ;
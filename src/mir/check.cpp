@@ -1095,12 +1095,11 @@ void MIR_Validate(const StaticTraitResolve& resolve, const ::HIR::ItemPath& path
 
 // --------------------------------------------------------------------
 
-void MIR_CheckCrate(/*const*/ ::HIR::Crate& crate)
+void MIR_CheckCrate(/*const*/ ::HIR::Crate& crate, unsigned num_jobs/*=1*/)
 {
-    ::MIR::OuterVisitor    ov(crate, [](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
+    ::MIR::visit_crate_parallel(crate, num_jobs, [](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
         {
             MIR_Validate(res, p, *expr.m_mir, args, ty);
         }
         );
-    ov.visit_crate( crate );
 }
@@ -1363,12 +1363,11 @@ void MIR_Cleanup(const StaticTraitResolve& resolve, const ::HIR::ItemPath& path,
 
 }
 
-void MIR_CleanupCrate(::HIR::Crate& crate)
+void MIR_CleanupCrate(::HIR::Crate& crate, unsigned num_jobs/*=1*/)
 {
-    ::MIR::OuterVisitor    ov { crate, [&](const auto& res, const auto& p, ::HIR::ExprPtr& expr_ptr, const auto& args, const auto& ty){
+    ::MIR::visit_crate_parallel(crate, num_jobs, [&](const auto& res, const auto& p, ::HIR::ExprPtr& expr_ptr, const auto& args, const auto& ty){
             MIR_Cleanup(res, p, expr_ptr.get_mir_or_error_mut(Span()), args, ty);
             MIR_Validate(res, p, expr_ptr.get_mir_or_error_mut(Span()), args, ty);
-        } };
-    ov.visit_crate(crate);
+        });
 }
 
@@ -0,0 +1,37 @@
+/*
+ * MRustC - Rust Compiler
+ * - By John Hodge (Mutabah/thePowersGang)
+ *
+ * mir/inline_cost.hpp
+ * - Cost model for the post-enumeration inliner
+ */
+#pragma once
+
+namespace MIR {
+class Function;
+}
+
+/// Tunables for the post-enumeration inliner (see `InlinePolicy` in mir/optimise.cpp)
+///
+/// Can be overridden with `$MRUSTC_INLINE_COST`, a comma-separated list of `name=value` (e.g. `base=24,growth=200`)
+struct InlineCostModel
+{
+    /// Largest callee cost inlined without an `#[inline]` hint
+    unsigned    base_limit = 16;
+    /// Largest `#[inline]` callee cost
+    unsigned    hint_limit = 48;
+    /// Largest `#[inline(always)]` callee cost (these also ignore the growth budget)
+    unsigned    always_limit = 1000;
+    /// Extra allowance for each constant argument at the call site (the callee will likely const-propagate)
+    unsigned    const_arg_bonus = 8;
+    /// Cost of a call or asm statement in the callee (ordinary statements are 1)
+    unsigned    call_cost = 4;
+    /// Total callee cost that can be inlined into a caller is `growth_base + caller cost * growth_percent / 100`
+    unsigned    growth_base = 64;
+    unsigned    growth_percent = 100;
+
+    static InlineCostModel from_env();
+
+    /// Estimated size of a function's code
+    unsigned get_cost(const ::MIR::Function& fcn) const;
+};
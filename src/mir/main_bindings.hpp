@@ -13,11 +13,11 @@ class TransList;
 
 extern void HIR_GenerateMIR(::HIR::Crate& crate);
 extern void MIR_Dump(::std::ostream& sink, const ::HIR::Crate& crate);
-extern void MIR_CheckCrate(/*const*/ ::HIR::Crate& crate);
+extern void MIR_CheckCrate(/*const*/ ::HIR::Crate& crate, unsigned num_jobs=1);
 extern void MIR_CheckCrate_Full(/*const*/ ::HIR::Crate& crate);
 
-extern void MIR_CleanupCrate(::HIR::Crate& crate);
-extern void MIR_OptimiseCrate(::HIR::Crate& crate, bool minimal_optimisations);
+extern void MIR_CleanupCrate(::HIR::Crate& crate, unsigned num_jobs=1);
+extern void MIR_OptimiseCrate(::HIR::Crate& crate, bool minimal_optimisations, unsigned num_jobs=1);
 extern void MIR_OptimiseCrate_Inlining(const ::HIR::Crate& crate, TransList& list);
 
 extern void HIR_GenerateMIR_Expr(const ::HIR::Crate& crate, const ::HIR::ItemPath& path, ::HIR::ExprPtr& expr_ptr, const ::HIR::Function::args_t& args, const ::HIR::TypeRef& res_ty);
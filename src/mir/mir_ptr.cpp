@@ -7,13 +7,36 @@
  */
 #include "mir_ptr.hpp"
 #include "mir.hpp"
+#include <mutex>
 
+namespace {
+    // Lazy loads can be triggered from any thread that reads an extern crate's MIR
+    ::std::mutex    s_load_lock;
+}
 
 void ::MIR::FunctionPointer::reset()
 {
-    if( this->ptr ) {
-        delete this->ptr;
-        this->ptr = nullptr;
+    if( auto* p = this->ptr.exchange(nullptr, ::std::memory_order_acq_rel) ) {
+        delete p;
+    }
+    if( auto* l = this->loader.exchange(nullptr, ::std::memory_order_acq_rel) ) {
+        delete l;
     }
 }
 
+::MIR::Function* ::MIR::FunctionPointer::load() const
+{
+    ::std::lock_guard<::std::mutex> lh { s_load_lock };
+    if( auto* p = this->ptr.load(::std::memory_order_acquire) ) {
+        return p;
+    }
+    auto* l = this->loader.load(::std::memory_order_acquire);
+    if( !l ) {
+        throw "";
+    }
+    auto* p = l->load();
+    this->ptr.store(p, ::std::memory_order_release);
+    this->loader.store(nullptr, ::std::memory_order_release);
+    delete l;
+    return p;
+}
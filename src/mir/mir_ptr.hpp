@@ -7,36 +7,71 @@
  */
 #pragma once
 
+#include <atomic>
+
 namespace MIR {
 
 class Function;
 
+/// Deferred source of a MIR function (e.g. an undecoded body from extern crate metadata)
+class FunctionLoader
+{
+public:
+    virtual ~FunctionLoader() {}
+    virtual ::MIR::Function* load() = 0;
+};
+
 class FunctionPointer
 {
-    ::MIR::Function*    ptr;
+    // Both are atomic, as lazy loads can happen from any thread
+    // - `ptr` is published (release) before `loader` is cleared, so a null `loader` implies `ptr` is visible
+    mutable ::std::atomic<::MIR::Function*>   ptr;
+    // Populated for lazily-loaded bodies, cleared once `ptr` is filled
+    mutable ::std::atomic<::MIR::FunctionLoader*> loader;
 public:
-    FunctionPointer(): ptr(nullptr) {}
-    FunctionPointer(::MIR::Function* p): ptr(p) {}
-    FunctionPointer(FunctionPointer&& x): ptr(x.ptr) { x.ptr = nullptr; }
+    FunctionPointer(): ptr(nullptr), loader(nullptr) {}
+    FunctionPointer(::MIR::Function* p): ptr(p), loader(nullptr) {}
+    FunctionPointer(::MIR::FunctionLoader* l): ptr(nullptr), loader(l) {}
+    FunctionPointer(FunctionPointer&& x):
+        ptr(x.ptr.exchange(nullptr, ::std::memory_order_relaxed)),
+        loader(x.loader.exchange(nullptr, ::std::memory_order_relaxed))
+    {
+    }
 
     ~FunctionPointer() {
         reset();
     }
     FunctionPointer& operator=(FunctionPointer&& x) {
         reset();
-        ptr = x.ptr;
-        x.ptr = nullptr;
+        ptr.store(x.ptr.exchange(nullptr, ::std::memory_order_relaxed), ::std::memory_order_relaxed);
+        loader.store(x.loader.exchange(nullptr, ::std::memory_order_relaxed), ::std::memory_order_relaxed);
         return *this;
     }
 
     void reset();
 
-          ::MIR::Function* operator->()       { if(!ptr) throw ""; return ptr; }
-    const ::MIR::Function* operator->() const { if(!ptr) throw ""; return ptr; }
-          ::MIR::Function& operator*()       { if(!ptr) throw ""; return *ptr; }
-    const ::MIR::Function& operator*() const { if(!ptr) throw ""; return *ptr; }
+          ::MIR::Function* operator->()       { return &get(); }
+    const ::MIR::Function* operator->() const { return &get(); }
+          ::MIR::Function& operator*()       { return get(); }
+    const ::MIR::Function& operator*() const { return get(); }
+
+    operator bool() const {
+        // NOTE: `loader` is checked first, see the ordering note on the fields
+        return loader.load(::std::memory_order_acquire) != nullptr || ptr.load(::std::memory_order_acquire) != nullptr;
+    }
+    /// Returns true if the body has been materialised (i.e. isn't pending a lazy load)
+    bool is_loaded() const { return ptr.load(::std::memory_order_acquire) != nullptr; }
 
-    operator bool() const { return ptr != nullptr; }
+private:
+    ::MIR::Function& get() const {
+        auto* p = ptr.load(::std::memory_order_acquire);
+        if(!p) {
+            p = load();
+        }
+        return *p;
+    }
+    /// Slow path of `get`, checks (and fills) the pointer with the load lock held
+    ::MIR::Function* load() const;
 };
 
 }
@@ -11,11 +11,14 @@
 #include <hir/visitor.hpp>
 #include <hir_typeck/static.hpp>
 #include <mir/helpers.hpp>
+#include <mir/inline_cost.hpp>
 #include <mir/operations.hpp>
 #include <mir/visit_crate_mir.hpp>
 #include <algorithm>
 #include <cmath>
 #include <iomanip>
+#include <unordered_map>
+#include <unordered_set>
 #include <trans/target.hpp>
 #include <trans/trans_list.hpp> // Note: This is included for inlining after enumeration and monomorph
 
@@ -34,7 +37,8 @@
 // List of optimisations avaliable
 // ----
 bool MIR_Optimise_BlockSimplify(::MIR::TypeResolve& state, ::MIR::Function& fcn);
-bool MIR_Optimise_Inlining(::MIR::TypeResolve& state, ::MIR::Function& fcn, bool minimal, const TransList* list=nullptr);
+struct InlinePolicy;
+bool MIR_Optimise_Inlining(::MIR::TypeResolve& state, ::MIR::Function& fcn, bool minimal, const TransList* list=nullptr, InlinePolicy* policy=nullptr);
 bool MIR_Optimise_SplitAggregates(::MIR::TypeResolve& state, ::MIR::Function& fcn);
 bool MIR_Optimise_PropagateSingleAssignments(::MIR::TypeResolve& state, ::MIR::Function& fcn);
 bool MIR_Optimise_PropagateKnownValues(::MIR::TypeResolve& state, ::MIR::Function& fcn);
@@ -58,9 +62,9 @@ enum {
     CHECKMODE_PASS,
     CHECKMODE_ALL,
 };
-static int check_mode() {
-    static int mode = CHECKMODE_UNKNOWN;
-    if( mode == CHECKMODE_UNKNOWN ) {
+static int check_mode_inner() {
+    int mode = CHECKMODE_UNKNOWN;
+    {
         const auto* n = getenv("MRUSTC_MIR_CHECK");
         if(n)
         {
@@ -90,6 +94,14 @@ static int check_mode() {
     }
     return mode;
 }
+static int check_mode() {
+    // NOTE: Function-local static, so initialisation is safe when optimising on multiple threads
+    static int mode = check_mode_inner();
+    return mode;
+}
+/// Set while `MIR_OptimiseCrate` is running with multiple jobs: MIR bodies that may be concurrently modified
+static const ::std::unordered_set<const ::MIR::Function*>*  s_parallel_inflight_mir = nullptr;
+
 static bool check_after_all() {
     return check_mode() >= CHECKMODE_ALL;
 }
@@ -133,17 +145,325 @@ void MIR_OptimiseMin(const StaticTraitResolve& resolve, const ::HIR::ItemPath& p
 #endif
     return ;
 }
+
+InlineCostModel InlineCostModel::from_env()
+{
+    InlineCostModel rv;
+    const auto* n = getenv("MRUSTC_INLINE_COST");
+    if( !n )
+        return rv;
+    ::std::string   v = n;
+    for(size_t pos = 0; pos < v.size(); )
+    {
+        auto end = v.find(',', pos);
+        if( end == ::std::string::npos )
+            end = v.size();
+        auto item = v.substr(pos, end - pos);
+        pos = end + 1;
+
+        auto eq = item.find('=');
+        unsigned* dst = nullptr;
+        auto name = item.substr(0, eq);
+        if( name == "base" )    dst = &rv.base_limit;
+        else if( name == "hint" )   dst = &rv.hint_limit;
+        else if( name == "always" ) dst = &rv.always_limit;
+        else if( name == "const_arg" )  dst = &rv.const_arg_bonus;
+        else if( name == "call" )   dst = &rv.call_cost;
+        else if( name == "growth_base" )    dst = &rv.growth_base;
+        else if( name == "growth" ) dst = &rv.growth_percent;
+        if( !dst || eq == ::std::string::npos ) {
+            WARNING(Span(), W0000,
+                "Unknown entry in $MRUSTC_INLINE_COST - '" << item << "'"
+                << ": options are 'base','hint','always','const_arg','call','growth_base','growth'"
+                );
+            continue ;
+        }
+        *dst = static_cast<unsigned>( ::std::strtoul(item.c_str() + eq + 1, nullptr, 10) );
+    }
+    return rv;
+}
+unsigned InlineCostModel::get_cost(const ::MIR::Function& fcn) const
+{
+    unsigned rv = 0;
+    for(const auto& bb : fcn.blocks)
+    {
+        for(const auto& stmt : bb.statements)
+        {
+            TU_MATCH_HDRA( (stmt), {)
+            TU_ARMA(Assign, se) {
+                rv += 1;
+                }
+            TU_ARMA(Asm, se) {
+                rv += call_cost;
+                }
+            TU_ARMA(Drop, se) {
+                rv += 1;
+                }
+            TU_ARMA(SetDropFlag, se) {
+                }
+            TU_ARMA(ScopeEnd, se) {
+                }
+            }
+        }
+        TU_MATCH_HDRA( (bb.terminator), {)
+        default:
+            rv += 1;
+        TU_ARMA(Goto, te) {
+            }
+        TU_ARMA(Return, te) {
+            }
+        TU_ARMA(Diverge, te) {
+            }
+        TU_ARMA(Switch, te) {
+            rv += 1 + te.targets.size() / 4;
+            }
+        TU_ARMA(SwitchValue, te) {
+            rv += 1 + te.targets.size() / 4;
+            }
+        TU_ARMA(Call, te) {
+            rv += call_cost;
+            }
+        }
+    }
+    return rv;
+}
+
+/// Call graph over a `TransList`, used to inline bottom-up (callees are finalised before any of their callers)
+struct InlinePolicy
+{
+    struct Node {
+        TransList_Function* ent;
+        ::MIR::Function*    mir;
+        const ::HIR::Function::args_t*  args;
+        const ::HIR::TypeRef*   ret_ty;
+        ::std::vector<size_t>   callees;
+        /// Index of the strongly connected component containing this function
+        size_t  scc = SIZE_MAX;
+        /// Part of a cycle (never inlined)
+        bool    is_recursive = false;
+        /// Cached result of `InlineCostModel::get_cost` (only valid once the function's SCC has been processed)
+        unsigned    cost = ~0u;
+        /// Upstream function with saved MIR: can be inlined, but isn't optimised here
+        /// - Its callees are still edges, as inlining it adds calls to them (which must be processed first)
+        bool    is_leaf = false;
+    };
+
+    InlineCostModel model;
+    const TransList&    list;
+    ::std::vector<Node> nodes;
+    ::std::unordered_map<const TransList_Function*, size_t>   node_idx;
+    /// Nodes grouped by SCC, in bottom-up order
+    ::std::vector<::std::vector<size_t>>    sccs;
+
+    // State for the function currently being processed
+    size_t  cur_scc = SIZE_MAX;
+    unsigned    budget = 0;
+
+    InlinePolicy(TransList& list);
+
+    unsigned get_cost(size_t idx) {
+        auto& n = nodes[idx];
+        if( n.cost == ~0u )
+            n.cost = model.get_cost(*n.mir);
+        return n.cost;
+    }
+    /// Start processing a function (resets the growth budget)
+    void enter(size_t idx) {
+        cur_scc = nodes[idx].scc;
+        budget = model.growth_base + static_cast<unsigned>( static_cast<uint64_t>(get_cost(idx)) * model.growth_percent / 100 );
+    }
+    /// Decide if a call to `path` should be inlined (charging the budget if so)
+    /// - `folds_away` is set when the callee is known to reduce to a single arm with this call's arguments
+    bool should_inline(const ::MIR::TypeResolve& state, const ::HIR::Path& path, const ::std::vector<::MIR::Param>& args, bool folds_away);
+};
+
+InlinePolicy::InlinePolicy(TransList& list):
+    model(InlineCostModel::from_env()),
+    list(list)
+{
+    TRACE_FUNCTION;
+    for(auto& fcn_ent : list.m_functions)
+    {
+        auto& ent = *fcn_ent.second;
+        auto& hir_fcn = *const_cast<::HIR::Function*>(ent.ptr);
+        auto& mono_fcn = ent.monomorphised;
+        Node    n;
+        n.ent = &ent;
+        if( ent.is_upstream_shared )
+        {
+            // Emitted upstream, no code here
+            continue ;
+        }
+        else if( mono_fcn.code )
+        {
+            n.mir = &*mono_fcn.code;
+            n.args = &mono_fcn.arg_tys;
+            n.ret_ty = &mono_fcn.ret_ty;
+        }
+        else if( hir_fcn.m_code )
+        {
+            n.mir = &hir_fcn.m_code.get_mir_or_error_mut(Span());
+            n.args = &hir_fcn.m_args;
+            n.ret_ty = &hir_fcn.m_return;
+        }
+        else if( const auto* mir = hir_fcn.m_code.get_mir_opt() )
+        {
+            // Upstream non-generic function (only the MIR was saved), available for inlining
+            n.mir = const_cast<::MIR::Function*>(mir);
+            n.args = &hir_fcn.m_args;
+            n.ret_ty = &hir_fcn.m_return;
+            n.is_leaf = true;
+        }
+        else
+        {
+            // Extern, no optimisations
+            continue ;
+        }
+        node_idx.insert(::std::make_pair(&ent, nodes.size()));
+        nodes.push_back(mv$(n));
+    }
+    for(auto& n : nodes)
+    {
+        for(const auto& bb : n.mir->blocks)
+        {
+            if( const auto* te = bb.terminator.opt_Call() )
+            {
+                if( !te->fcn.is_Path() )
+                    continue ;
+                auto it = list.m_functions.find(te->fcn.as_Path());
+                if( it == list.m_functions.end() )
+                    continue ;
+                auto it2 = node_idx.find(it->second.get());
+                if( it2 == node_idx.end() )
+                    continue ;
+                if( it2->second == static_cast<size_t>(&n - nodes.data()) )
+                    n.is_recursive = true;
+                n.callees.push_back(it2->second);
+            }
+        }
+    }
+
+    // Tarjan's algorithm (iterative), which emits SCCs in reverse topological order - i.e. callees first
+    ::std::vector<size_t>   index(nodes.size(), SIZE_MAX);
+    ::std::vector<size_t>   lowlink(nodes.size());
+    ::std::vector<bool> on_stack(nodes.size());
+    ::std::vector<size_t>   stack;
+    ::std::vector<::std::pair<size_t,size_t>>   work;    // (node, next callee)
+    size_t  next_index = 0;
+    for(size_t root = 0; root < nodes.size(); root ++)
+    {
+        if( index[root] != SIZE_MAX )
+            continue ;
+        work.push_back(::std::make_pair(root, 0));
+        while( !work.empty() )
+        {
+            auto v = work.back().first;
+            auto& ci = work.back().second;
+            if( ci == 0 && index[v] == SIZE_MAX )
+            {
+                index[v] = lowlink[v] = next_index ++;
+                stack.push_back(v);
+                on_stack[v] = true;
+            }
+            if( ci < nodes[v].callees.size() )
+            {
+                auto w = nodes[v].callees[ci ++];
+                if( index[w] == SIZE_MAX ) {
+                    work.push_back(::std::make_pair(w, 0));
+                }
+                else if( on_stack[w] ) {
+                    lowlink[v] = ::std::min(lowlink[v], index[w]);
+                }
+                continue ;
+            }
+            work.pop_back();
+            if( !work.empty() )
+            {
+                auto p = work.back().first;
+                lowlink[p] = ::std::min(lowlink[p], lowlink[v]);
+            }
+            if( lowlink[v] == index[v] )
+            {
+                ::std::vector<size_t>   scc;
+                size_t  w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    nodes[w].scc = sccs.size();
+                    scc.push_back(w);
+                } while( w != v );
+                if( scc.size() > 1 ) {
+                    for(auto i : scc)
+                        nodes[i].is_recursive = true;
+                }
+                sccs.push_back(mv$(scc));
+            }
+        }
+    }
+    DEBUG(nodes.size() << " functions, " << sccs.size() << " SCCs");
+}
+
+bool InlinePolicy::should_inline(const ::MIR::TypeResolve& state, const ::HIR::Path& path, const ::std::vector<::MIR::Param>& args, bool folds_away)
+{
+    auto it = list.m_functions.find(path);
+    if( it == list.m_functions.end() )
+        return false;
+    auto it2 = node_idx.find(it->second.get());
+    if( it2 == node_idx.end() )
+        return false;
+    const auto& n = nodes[it2->second];
+
+    auto hint = n.ent->ptr->m_inline_hint;
+    if( hint == ::HIR::Function::InlineHint::Never ) {
+        DEBUG("Can't inline " << path << " - #[inline(never)]");
+        return false;
+    }
+    if( n.is_recursive || n.scc == cur_scc ) {
+        DEBUG("Can't inline " << path << " - recursive");
+        return false;
+    }
+    MIR_ASSERT(state, n.scc < cur_scc, "Inlining " << path << " before it has been processed");
+
+    unsigned cost = folds_away ? model.call_cost : get_cost(it2->second);
+    unsigned limit;
+    switch(hint)
+    {
+    case ::HIR::Function::InlineHint::Always:   limit = model.always_limit; break;
+    case ::HIR::Function::InlineHint::Hint: limit = model.hint_limit;   break;
+    default:    limit = model.base_limit;   break;
+    }
+    for(const auto& a : args)
+        if( a.is_Constant() )
+            limit += model.const_arg_bonus;
+
+    if( cost > limit ) {
+        DEBUG("Can't inline " << path << " - cost " << cost << " > " << limit);
+        return false;
+    }
+    if( hint != ::HIR::Function::InlineHint::Always )
+    {
+        if( cost > budget ) {
+            DEBUG("Can't inline " << path << " - cost " << cost << " over remaining budget " << budget);
+            return false;
+        }
+        budget -= cost;
+    }
+    return true;
+}
+
 /// Perfom inlining only, using a list of monomorphised functions, then cleans up the flow graph
 ///
 /// Returns true if any optimisation was performed
-bool MIR_OptimiseInline(const StaticTraitResolve& resolve, const ::HIR::ItemPath& path, ::MIR::Function& fcn, const ::HIR::Function::args_t& args, const ::HIR::TypeRef& ret_type, const TransList& list)
+bool MIR_OptimiseInline(const StaticTraitResolve& resolve, const ::HIR::ItemPath& path, ::MIR::Function& fcn, const ::HIR::Function::args_t& args, const ::HIR::TypeRef& ret_type, const TransList& list, InlinePolicy& policy)
 {
     static Span sp;
     bool rv = false;
     TRACE_FUNCTION_FR(path, rv);
     ::MIR::TypeResolve   state { sp, resolve, FMT_CB(ss, ss << path;), ret_type, args, fcn };
 
-    while( MIR_Optimise_Inlining(state, fcn, false, &list) )
+    // NOTE: Terminates, as each inlined function is charged against the growth budget
+    while( MIR_Optimise_Inlining(state, fcn, false, &list, &policy) )
     {
         MIR_Cleanup(resolve, path, fcn, args, ret_type);
         if( check_after_all() ) {
@@ -717,6 +1037,10 @@ namespace
             if( it->second->monomorphised.code ) {
                 return &*it->second->monomorphised.code;
             }
+            else if( it->second->is_upstream_shared ) {
+                // Emitted by an upstream crate, treat as external
+                return nullptr;
+            }
             else if( const auto* mir = hir_fcn.m_code.get_mir_opt() ) {
                 MIR_ASSERT(state, hir_fcn.m_params.m_types.empty(), "Enumeration failure - Function had params, but wasn't monomorphised - " << path);
                 // TODO: Check for trait methods too?
@@ -762,7 +1086,17 @@ namespace
             return nullptr;
             }
         TU_ARMA(Function, f) {
-            return f->m_code.get_mir_opt();
+            if( f->m_inline_hint == ::HIR::Function::InlineHint::Never ) {
+                DEBUG("Can't inline - " << path << " is #[inline(never)]");
+                return nullptr;
+            }
+            const auto* mir = f->m_code.get_mir_opt();
+            // When optimising in parallel, local functions may be mid-optimisation on another thread
+            if( mir && s_parallel_inflight_mir && s_parallel_inflight_mir->count(mir) ) {
+                DEBUG("Can't inline - " << path << " is being optimised concurrently");
+                return nullptr;
+            }
+            return mir;
             }
         }
         return nullptr;
@@ -1029,7 +1363,7 @@ bool MIR_Optimise_BlockSimplify(::MIR::TypeResolve& state, ::MIR::Function& fcn)
 // --------------------------------------------------------------------
 // If two temporaries don't overlap in lifetime (blocks in which they're valid), unify the two
 // --------------------------------------------------------------------
-bool MIR_Optimise_Inlining(::MIR::TypeResolve& state, ::MIR::Function& fcn, bool minimal, const TransList* list/*=nullptr*/)
+bool MIR_Optimise_Inlining(::MIR::TypeResolve& state, ::MIR::Function& fcn, bool minimal, const TransList* list/*=nullptr*/, InlinePolicy* policy/*=nullptr*/)
 {
     bool inline_happened = false;
     TRACE_FUNCTION_FR("", inline_happened);
@@ -1632,11 +1966,19 @@ bool MIR_Optimise_Inlining(::MIR::TypeResolve& state, ::MIR::Function& fcn, bool
                 continue ;
             }
 
+            if( policy )
+            {
+                // Post-enumeration: Use the cost model
+                bool folds_away = H::can_inline_Switch_wrapper(path, *called_mir, te->args)
+                    || H::can_inline_SwitchValue_wrapper(path, *called_mir, te->args);
+                if( !policy->should_inline(state, path, te->args, folds_away) )
+                    continue ;
+            }
             // Check the size of the target function.
             // Inline IF:
             // - First BB ends with a call and total count is 3
             // - Statement count smaller than 10
-            if( ! H::can_inline(path, *called_mir, te->args, minimal) )
+            else if( ! H::can_inline(path, *called_mir, te->args, minimal) )
             {
                 DEBUG("Can't inline " << path);
                 continue ;
@@ -5903,9 +6245,20 @@ void MIR_SortBlocks(const StaticTraitResolve& resolve, const ::HIR::ItemPath& pa
 }
 
 
-void MIR_OptimiseCrate(::HIR::Crate& crate, bool do_minimal_optimisation)
+void MIR_OptimiseCrate(::HIR::Crate& crate, bool do_minimal_optimisation, unsigned num_jobs/*=1*/)
 {
-    ::MIR::OuterVisitor ov { crate, [do_minimal_optimisation](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
+    // With multiple jobs, the bodies of this crate's functions can't be used for inlining (they're being mutated by other workers)
+    // - Enumeration-time inlining (`MIR_OptimiseCrate_Inlining`) still sees them
+    ::std::unordered_set<const ::MIR::Function*>    inflight_mir;
+    if( num_jobs > 1 )
+    {
+        ::MIR::OuterVisitor ov { crate, [&](const auto& , const auto& , auto& expr, const auto& , const auto& ) {
+            inflight_mir.insert( &expr.get_mir_or_error(Span()) );
+            } };
+        ov.visit_crate(crate);
+        s_parallel_inflight_mir = &inflight_mir;
+    }
+    ::MIR::visit_crate_parallel(crate, num_jobs, [do_minimal_optimisation](const auto& res, const auto& p, auto& expr, const auto& args, const auto& ty)
         {
             //if( ! dynamic_cast<::HIR::ExprNode_Block*>(expr.get()) ) {
             //    return ;
@@ -5918,56 +6271,38 @@ void MIR_OptimiseCrate(::HIR::Crate& crate, bool do_minimal_optimisation)
                 MIR_Optimise(res, p, mir, args, ty);
             }
         }
-        };
-    ov.visit_crate(crate);
+        );
+    s_parallel_inflight_mir = nullptr;
 }
 
 void MIR_OptimiseCrate_Inlining(const ::HIR::Crate& crate, TransList& list)
 {
     ::StaticTraitResolve    resolve { crate };
 
-    bool did_inline_on_pass;
-
-    size_t  MAX_ITERATIONS = 5; // TODO: Tune this.
-    size_t  num_iterations = 0;
-    do
+    // Visit functions bottom-up over the call graph, so every callee is final (and its cost known) when it's
+    // considered for inlining. A single pass is enough.
+    InlinePolicy    policy { list };
+    for(const auto& scc : policy.sccs)
     {
-        did_inline_on_pass = false;
-
-        for(auto& fcn_ent : list.m_functions)
+        for(auto idx : scc)
         {
-            const auto& path = fcn_ent.first;
-            //const auto& pp = fcn_ent.second->pp;
-            auto& hir_fcn = *const_cast<::HIR::Function*>(fcn_ent.second->ptr);
-            auto& mono_fcn = fcn_ent.second->monomorphised;
+            const auto& n = policy.nodes[idx];
+            if( n.is_leaf )
+                continue ;
+            const auto& path = *n.ent->path;
 
             ::std::string s = FMT(path);
             ::HIR::ItemPath ip(s);
 
-            if( mono_fcn.code )
-            {
-                did_inline_on_pass |= MIR_OptimiseInline(resolve, ip, *mono_fcn.code, mono_fcn.arg_tys, mono_fcn.ret_ty, list);
-
-                MIR_Cleanup(resolve, ip, *mono_fcn.code, mono_fcn.arg_tys, mono_fcn.ret_ty);
-            }
-            else if( hir_fcn.m_code )
-            {
-                auto& mir = hir_fcn.m_code.get_mir_or_error_mut(Span());
-                bool did_opt = MIR_OptimiseInline(resolve, ip, mir, hir_fcn.m_args, hir_fcn.m_return, list);
-                mir.trans_enum_state = ::MIR::EnumCachePtr();   // Clear MIR enum cache
-                did_inline_on_pass |= did_opt;
-
-                MIR_Cleanup(resolve, ip, mir, hir_fcn.m_args, hir_fcn.m_return);
-            }
-            else
-            {
-                // Extern, no optimisations
+            policy.enter(idx);
+            MIR_OptimiseInline(resolve, ip, *n.mir, *n.args, *n.ret_ty, list, policy);
+            MIR_Cleanup(resolve, ip, *n.mir, *n.args, *n.ret_ty);
+            if( !n.ent->monomorphised.code ) {
+                n.mir->trans_enum_state = ::MIR::EnumCachePtr();   // Clear MIR enum cache
             }
         }
-    } while( did_inline_on_pass && num_iterations < MAX_ITERATIONS );
-
-    if( did_inline_on_pass )
-    {
-        DEBUG("Ran inlining optimise pass to exhaustion (maximum of " << MAX_ITERATIONS << " hit");
+        // Costs are recalculated now the SCC is final
+        for(auto idx : scc)
+            policy.nodes[idx].cost = ~0u;
     }
 }
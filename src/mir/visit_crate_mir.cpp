@@ -7,6 +7,7 @@
  */
 #include "visit_crate_mir.hpp"
 #include <hir/expr.hpp>
+#include <parallel.hpp>
 
 // NOTE: This is left here to ensure that any expressions that aren't handled by higher code cause a failure
 void MIR::OuterVisitor::visit_expr(::HIR::ExprPtr& exp)
@@ -84,3 +85,58 @@ void MIR::OuterVisitor::visit_trait_impl(const ::HIR::SimplePath& trait_path, ::
     auto _ = this->m_resolve.set_impl_generics(impl.m_params);
     ::HIR::Visitor::visit_trait_impl(trait_path, impl);
 }
+
+namespace {
+    struct ParallelJob
+    {
+        ::std::string   path;
+        const ::HIR::GenericParams* impl_generics;
+        const ::HIR::GenericParams* item_generics;
+        ::HIR::ExprPtr* expr;
+        const ::HIR::Function::args_t*  args;
+        ::HIR::TypeRef  ret_type;
+    };
+}
+
+void MIR::visit_crate_parallel(::HIR::Crate& crate, unsigned num_jobs, OuterVisitor::cb_t cb)
+{
+    if( num_jobs <= 1 )
+    {
+        OuterVisitor    ov(crate, cb);
+        ov.visit_crate( crate );
+        return ;
+    }
+
+    // Collect the work list first (single-threaded), recording the generic scope for each item
+    static const ::HIR::Function::args_t  empty_args;
+    ::std::vector<ParallelJob>  jobs;
+    {
+        OuterVisitor    ov(crate, [&](const StaticTraitResolve& res, const ::HIR::ItemPath& ip, ::HIR::ExprPtr& expr, const ::HIR::Function::args_t& args, const ::HIR::TypeRef& ret_ty) {
+            // NOTE: Empty argument lists are often temporaries, so point at a static instead
+            jobs.push_back(ParallelJob { FMT(ip), res.m_impl_generics, res.m_item_generics, &expr, args.empty() ? &empty_args : &args, ret_ty.clone() });
+            });
+        ov.visit_crate( crate );
+    }
+    DEBUG(jobs.size() << " items over " << num_jobs << " jobs");
+
+    ::std::vector< ::std::unique_ptr<StaticTraitResolve> >  resolves;
+    for(unsigned i = 0; i < num_jobs; i ++)
+        resolves.push_back( ::std::unique_ptr<StaticTraitResolve>(new StaticTraitResolve(crate)) );
+
+    parallel_for_ordered(jobs.size(), num_jobs, [&](unsigned worker, size_t idx) {
+        auto& job = jobs[idx];
+        auto& res = *resolves[worker];
+        // Only switch generic scopes when they change, as doing so flushes the resolve's caches
+        if( res.m_impl_generics != job.impl_generics ) {
+            res.clear_impl_generics();
+            if( job.impl_generics )
+                res.set_impl_generics_raw(*job.impl_generics);
+        }
+        if( res.m_item_generics != job.item_generics ) {
+            res.clear_item_generics();
+            if( job.item_generics )
+                res.set_item_generics_raw(*job.item_generics);
+        }
+        cb(res, ::HIR::ItemPath(job.path), *job.expr, *job.args, job.ret_type);
+        });
+}
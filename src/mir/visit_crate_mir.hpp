@@ -43,5 +43,9 @@ public:
     void visit_trait_impl(const ::HIR::SimplePath& trait_path, ::HIR::TraitImpl& impl) override;
 };
 
+/// Visit all code-containing items in the crate, running `cb` on up to `num_jobs` threads
+/// - The callback must only mutate the passed expression (each worker gets its own resolve instance)
+/// - `num_jobs <= 1` is equivalent to running `OuterVisitor` directly
+extern void visit_crate_parallel(::HIR::Crate& crate, unsigned num_jobs, OuterVisitor::cb_t cb);
 
 }   // namespace MIR
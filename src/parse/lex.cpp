@@ -15,36 +15,76 @@
 #include <typeinfo>
 #include <algorithm>    // std::count
 #include <cctype>
+#include <cstring>  // memcmp
 //#define TRACE_CHARS
 //#define TRACE_RAW_TOKENS
 
+namespace {
+    enum {
+        CC_IDENT = 1,   // [A-Za-z0-9_]
+        CC_SPACE = 2,   // Horizontal whitespace (no newlines)
+        CC_OTHER = 4,   // Any other ASCII other than newlines (`\r` and `\n` need line tracking)
+    };
+    /// Classification of each byte for the lexer fast paths (non-ASCII bytes are zero, and go through UTF-8 decoding)
+    struct CharClassTable {
+        uint8_t v[256];
+        CharClassTable() {
+            for(unsigned i = 0; i < 256; i ++)
+            {
+                v[i] = 0;
+                if( i >= 128 || i == '\r' || i == '\n' )
+                    continue ;
+                if( ('0' <= i && i <= '9') || ('a' <= i && i <= 'z') || ('A' <= i && i <= 'Z') || i == '_' )
+                    v[i] = CC_IDENT;
+                else if( i == ' ' || i == '\t' || i == 0xC )
+                    v[i] = CC_SPACE;
+                else
+                    v[i] = CC_OTHER;
+            }
+        }
+    };
+    const CharClassTable    s_char_class;
+
+    Token Lex_FindReservedWord(const char* s, size_t s_len, AST::Edition edition);
+}
+
 Lexer::Lexer(const ::std::string& filename, ParseState ps):
     TokenStream(ps),
     m_path(filename.c_str()),
     m_line(1),
     m_line_ofs(0),
-    m_istream(filename.c_str()),
+    m_pos(0),
     m_last_char_valid(false),
     m_hygiene( Ident::Hygiene::new_scope() )
 {
-    if( !m_istream.is_open() )
+    // Read the whole file in one go, avoiding per-character stream overheads
     {
-        throw ::std::runtime_error("Unable to open file '" + filename + "'");
+        ::std::ifstream is(filename.c_str(), ::std::ios::binary);
+        if( !is.is_open() )
+        {
+            throw ::std::runtime_error("Unable to open file '" + filename + "'");
+        }
+        is.seekg(0, ::std::ios::end);
+        auto size = is.tellg();
+        is.seekg(0, ::std::ios::beg);
+        if( size > 0 )
+        {
+            m_data.resize(static_cast<size_t>(size));
+            is.read(&m_data[0], size);
+            m_data.resize(static_cast<size_t>(is.gcount()));
+        }
     }
     // Consume the BOM
-    if( this->getc_byte() == '\xef' )
+    if( m_data.compare(0, 3, "\xef\xbb\xbf") == 0 )
     {
-        if( this->getc_byte() != '\xbb' ) {
-            throw ::std::runtime_error("Incomplete BOM - missing \\xBB in second position");
-        }
-        if( this->getc_byte() != '\xbf' ) {
-            throw ::std::runtime_error("Incomplete BOM - missing \\xBF in second position");
-        }
-        m_line_ofs = 0;
+        m_pos = 3;
     }
-    else
+    else if( m_data.size() > 0 && m_data[0] == '\xef' )
     {
-        m_istream.unget();
+        if( m_data.size() < 2 || m_data[1] != '\xbb' ) {
+            throw ::std::runtime_error("Incomplete BOM - missing \\xBB in second position");
+        }
+        throw ::std::runtime_error("Incomplete BOM - missing \\xBF in second position");
     }
 }
 
@@ -367,6 +407,7 @@ Token Lexer::getTokenInt()
             return Token(TOK_NEWLINE);
         if( ch.isspace() )
         {
+            this->scan_ascii(CC_SPACE);
             while( (ch = this->getc()).isspace() && ch != '\n' )
                 ;
             this->ungetc();
@@ -650,6 +691,9 @@ Token Lexer::getTokenInt()
                 while(ch != '\n' && ch != '\r')
                 {
                     str += ch;
+                    auto start = m_pos;
+                    if( auto n = this->scan_ascii(CC_IDENT|CC_SPACE|CC_OTHER) )
+                        str.append(m_data, start, n);
                     ch = this->getc();
                 }
                 this->ungetc();
@@ -871,6 +915,33 @@ Token Lexer::getTokenInt_RawString(bool is_byte)
 }
 Token Lexer::getTokenInt_Identifier(Codepoint leader, Codepoint leader2, bool parse_reserved_word)
 {
+    // Fast path: An ASCII identifier with a single-byte leader that is still in the buffer, lex without copying
+    if( leader2 == '\0' && !m_last_char_valid && m_pos > 0 && leader.v < 128 && m_data[m_pos-1] == static_cast<char>(leader.v) )
+    {
+        auto start = m_pos - 1;
+        this->scan_ascii(CC_IDENT);
+        if( m_pos == m_data.size() || static_cast<uint8_t>(m_data[m_pos]) < 128 )
+        {
+            const char* s = m_data.data() + start;
+            size_t len = m_pos - start;
+            // Peek the terminator as the slow path does (for identical EOF handling and column numbers)
+            this->getc();
+            this->ungetc();
+            if(parse_reserved_word)
+            {
+                auto v = Lex_FindReservedWord(s, len, this->parse_state().get_edition());
+                if( v != TOK_NULL)
+                {
+                    return Token(v);
+                }
+            }
+            return Token(TOK_IDENT, Ident(this->get_hygiene(), RcString::new_interned(s, len)));
+        }
+        // Non-ASCII continuation, rewind and take the slow path
+        m_line_ofs -= m_pos - start - 1;
+        m_pos = start + 1;
+    }
+
     ::std::string   str;
     if( leader2 != '\0' )
         str += leader;
@@ -1006,18 +1077,15 @@ uint32_t Lexer::parseEscape(char enclosing)
 
 char Lexer::getc_byte()
 {
-    int rv = m_istream.get();
-    if( rv == EOF || m_istream.eof() )
+    if( m_pos >= m_data.size() )
         throw Lexer::EndOfFile();
+    char rv = m_data[m_pos++];
 
     if( rv == '\r' )
     {
-        if( m_istream.get() != '\n' )
-        {
-            m_istream.unget();
-        }
-        else
+        if( m_pos < m_data.size() && m_data[m_pos] == '\n' )
         {
+            m_pos ++;
             rv = '\n';
         }
     }
@@ -1040,7 +1108,17 @@ Codepoint Lexer::getc()
     }
     else
     {
-        m_last_char = this->getc_cp();
+        // Fast path: Plain ASCII (not a newline) needs no decoding or line tracking
+        uint8_t b = m_pos < m_data.size() ? static_cast<uint8_t>(m_data[m_pos]) : 0x80;
+        if( s_char_class.v[b] != 0 )
+        {
+            m_pos ++;
+            m_last_char = Codepoint(b);
+        }
+        else
+        {
+            m_last_char = this->getc_cp();
+        }
         m_line_ofs += 1;
 #ifdef TRACE_CHARS
         ::std::cout << "getc(): U+" << ::std::hex << m_last_char.v << ::std::endl;
@@ -1048,6 +1126,22 @@ Codepoint Lexer::getc()
     }
     return m_last_char;
 }
+/// Consume bytes directly from the buffer while they match `class_mask`, returning the number consumed
+///
+/// Only valid when there's no pending `ungetc` (so the buffer position is the logical position)
+size_t Lexer::scan_ascii(uint8_t class_mask)
+{
+    assert(!m_last_char_valid);
+    const auto* const start = reinterpret_cast<const uint8_t*>(m_data.data()) + m_pos;
+    const auto* const end = reinterpret_cast<const uint8_t*>(m_data.data()) + m_data.size();
+    const auto* p = start;
+    while( p != end && (s_char_class.v[*p] & class_mask) )
+        p ++;
+    size_t n = p - start;
+    m_pos += n;
+    m_line_ofs += n;
+    return n;
+}
 
 Codepoint Lexer::getc_num()
 {
@@ -1221,31 +1315,40 @@ Token Lex_FindOperator(const ::std::string& s)
     }
     return TOK_NULL;
 }
-Token Lex_FindReservedWord(const ::std::string& s, AST::Edition edition)
-{
-    size_t len = 0;
-    const sRWORD* RWORDS = nullptr;
-    switch(edition)
+namespace {
+    Token Lex_FindReservedWord(const char* s, size_t s_len, AST::Edition edition)
     {
-    case AST::Edition::Rust2015:
-        len = LEN(RWORDS_2015);
-        RWORDS = RWORDS_2015;
-        break;
-    case AST::Edition::Rust2018:
-        len = LEN(RWORDS_2018);
-        RWORDS = RWORDS_2018;
-        break;
-    }
-    for(size_t i = 0; i < len; i++)
-    {
-        const auto& e = RWORDS[i];
-        if( s < e.chars )
+        size_t len = 0;
+        const sRWORD* RWORDS = nullptr;
+        switch(edition)
+        {
+        case AST::Edition::Rust2015:
+            len = LEN(RWORDS_2015);
+            RWORDS = RWORDS_2015;
             break;
-        if( s == e.chars )
+        case AST::Edition::Rust2018:
+            len = LEN(RWORDS_2018);
+            RWORDS = RWORDS_2018;
+            break;
+        }
+        for(size_t i = 0; i < len; i++)
         {
-            assert(e.type > 0);
-            return static_cast<eTokenType>(e.type);
+            const auto& e = RWORDS[i];
+            int cmp = ::std::memcmp(s, e.chars, ::std::min<size_t>(s_len, e.len));
+            if( cmp == 0 )
+                cmp = (s_len < e.len ? -1 : (s_len > e.len ? 1 : 0));
+            if( cmp < 0 )
+                break;
+            if( cmp == 0 )
+            {
+                assert(e.type > 0);
+                return static_cast<eTokenType>(e.type);
+            }
         }
+        return TOK_NULL;
     }
-    return TOK_NULL;
+}
+Token Lex_FindReservedWord(const ::std::string& s, AST::Edition edition)
+{
+    return Lex_FindReservedWord(s.data(), s.size(), edition);
 }
@@ -39,7 +39,9 @@ class Lexer:
     unsigned int m_line;
     unsigned int m_line_ofs;
 
-    ::std::ifstream m_istream;
+    /// Entire source file (read up-front, the hot paths scan this directly)
+    ::std::string   m_data;
+    size_t  m_pos;
     bool    m_last_char_valid;
     Codepoint   m_last_char;
     ::std::vector<Token>    m_next_tokens;
@@ -70,6 +72,7 @@ private:
         m_hygiene = m_hygiene.get_parent();
     }
 
+    size_t scan_ascii(uint8_t class_mask);
     void ungetc();
     Codepoint getc_num();
     Codepoint getc();
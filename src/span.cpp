@@ -7,41 +7,156 @@
  */
 #include <functional>
 #include <iostream>
+#include <sstream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <span.hpp>
 #include <parse/lex.hpp>
 #include <common.hpp>
 
-SpanInner Span::s_empty_span;
+namespace {
+    /// Source file and parent (macro expansion) span, shared by all spans lexed in the same context
+    struct SourceContext
+    {
+        uint32_t    parent;
+        uint32_t    file;
+    };
+    struct SpanEntry
+    {
+        uint32_t    context;
+        uint32_t    start_line;
+        uint32_t    start_ofs;
+        uint32_t    end_line;
+        uint32_t    end_ofs;
+    };
 
-Span::Span(Span parent, RcString filename, unsigned int start_line, unsigned int start_ofs,  unsigned int end_line, unsigned int end_ofs):
-    m_ptr(SpanInner::alloc( parent, ::std::move(filename), start_line, start_ofs, end_line, end_ofs ))
-{}
-Span::Span(Span parent, const Position& pos):
-    m_ptr(SpanInner::alloc( parent, pos.filename, pos.line,pos.ofs, pos.line,pos.ofs ))
+    /// Global source map: append-only tables of files, contexts, and span ranges
+    /// - Spans are allocated lock-free (into lazily allocated fixed-size chunks, so entries never move)
+    /// - Files and contexts are interned under a lock, with a per-thread cache of the last context used
+    class SourceMap
+    {
+        static const unsigned CHUNK_BITS = 18;
+        static const size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+        static const size_t MAX_CHUNKS = (size_t(1) << 32) >> CHUNK_BITS;
+
+        ::std::atomic<SpanEntry*>   m_chunks[MAX_CHUNKS];
+        ::std::atomic<uint64_t> m_next_span;
+
+        mutable ::std::mutex    m_lock;
+        ::std::vector<RcString> m_files;
+        ::std::unordered_map<RcString, uint32_t>    m_file_lookup;
+        ::std::vector<SourceContext>    m_contexts;
+        ::std::map<::std::pair<uint32_t,uint32_t>, uint32_t>    m_context_lookup;
+
+    public:
+        SourceMap():
+            m_next_span(1)  // Index zero is the empty span
+        {
+            for(auto& c : m_chunks)
+                c.store(nullptr, ::std::memory_order_relaxed);
+        }
+
+        uint32_t get_context(uint32_t parent, const RcString& filename)
+        {
+            struct Cache {
+                bool    valid;
+                uint32_t    parent;
+                RcString    filename;   // Holds the string alive, so pointer equality is a valid check
+                uint32_t    context;
+            };
+            static thread_local Cache   tl_cache { false, 0, RcString(), 0 };
+            if( tl_cache.valid && tl_cache.parent == parent && tl_cache.filename.c_str() == filename.c_str() )
+                return tl_cache.context;
+
+            ::std::lock_guard<::std::mutex>  lh(m_lock);
+            auto file_it = m_file_lookup.find(filename);
+            if( file_it == m_file_lookup.end() )
+            {
+                file_it = m_file_lookup.insert(::std::make_pair(filename, static_cast<uint32_t>(m_files.size()))).first;
+                m_files.push_back(filename);
+            }
+            auto key = ::std::make_pair(parent, file_it->second);
+            auto ctx_it = m_context_lookup.find(key);
+            if( ctx_it == m_context_lookup.end() )
+            {
+                ctx_it = m_context_lookup.insert(::std::make_pair(key, static_cast<uint32_t>(m_contexts.size()))).first;
+                m_contexts.push_back(SourceContext { parent, file_it->second });
+            }
+            tl_cache = Cache { true, parent, filename, ctx_it->second };
+            return ctx_it->second;
+        }
+
+        uint32_t add_span(uint32_t context, unsigned int start_line, unsigned int start_ofs,  unsigned int end_line, unsigned int end_ofs)
+        {
+            auto idx = m_next_span.fetch_add(1, ::std::memory_order_relaxed);
+            if( idx > UINT32_MAX ) {
+                ::std::cerr << "Source map is full (more than 2^32 spans)" << ::std::endl;
+                abort();
+            }
+            auto& chunk = m_chunks[idx >> CHUNK_BITS];
+            auto* entries = chunk.load(::std::memory_order_acquire);
+            if( !entries )
+            {
+                ::std::lock_guard<::std::mutex>  lh(m_lock);
+                entries = chunk.load(::std::memory_order_acquire);
+                if( !entries )
+                {
+                    entries = new SpanEntry[CHUNK_SIZE];
+                    chunk.store(entries, ::std::memory_order_release);
+                }
+            }
+            entries[idx & (CHUNK_SIZE-1)] = SpanEntry { context, start_line, start_ofs, end_line, end_ofs };
+            return static_cast<uint32_t>(idx);
+        }
+
+        /// Look up the full information for a span, including the parent and the filename
+        void get(uint32_t idx, uint32_t& out_parent, RcString& out_filename, SpanEntry& out_entry) const
+        {
+            out_entry = m_chunks[idx >> CHUNK_BITS].load(::std::memory_order_acquire)[idx & (CHUNK_SIZE-1)];
+            ::std::lock_guard<::std::mutex>  lh(m_lock);
+            const auto& ctx = m_contexts[out_entry.context];
+            out_parent = ctx.parent;
+            out_filename = m_files[ctx.file];
+        }
+    };
+    SourceMap& source_map() {
+        static SourceMap    s_source_map;
+        return s_source_map;
+    }
+}
+
+Span::Span(Span parent, const RcString& filename, unsigned int start_line, unsigned int start_ofs,  unsigned int end_line, unsigned int end_ofs)
 {
+    auto& sm = source_map();
+    m_idx = sm.add_span( sm.get_context(parent.m_idx, filename), start_line, start_ofs, end_line, end_ofs );
 }
-Span::Span(const Span& x):
-    m_ptr(x.m_ptr)
+Span::Span(Span parent, const Position& pos):
+    Span(parent, pos.filename, pos.line,pos.ofs, pos.line,pos.ofs)
 {
-    m_ptr->reference_count += 1;
 }
-Span::~Span()
+SpanInner Span::operator*() const
 {
-    if(m_ptr && m_ptr != &s_empty_span)
+    SpanInner   rv { Span(), RcString(), 0,0, 0,0 };
+    if( m_idx != 0 )
     {
-        m_ptr->reference_count --;
-        if( m_ptr->reference_count == 0 )
-        {
-            delete m_ptr;
-        }
-        m_ptr = nullptr;
+        SpanEntry   ent;
+        source_map().get(m_idx, rv.parent_span.m_idx, rv.filename, ent);
+        rv.start_line = ent.start_line;
+        rv.start_ofs  = ent.start_ofs;
+        rv.end_line   = ent.end_line;
+        rv.end_ofs    = ent.end_ofs;
     }
+    return rv;
 }
 
 namespace {
+    thread_local DiagnosticBuffer*  tl_diagnostic_buffer = nullptr;
+
     void print_span_message(const Span& sp, ::std::function<void(::std::ostream&)> tag, ::std::function<void(::std::ostream&)> msg)
     {
-        auto& sink = ::std::cerr;
+        ::std::ostringstream    sink;
         sink << sp->filename << ":" << sp->start_line << ": ";
         tag(sink);
         sink << ":";
@@ -52,11 +167,39 @@ namespace {
         {
             sink << parent->filename << ":" << parent->start_line << ": note: From here" << ::std::endl;
         }
+
+        if( tl_diagnostic_buffer ) {
+            tl_diagnostic_buffer->messages += sink.str();
+        }
+        else {
+            ::std::cerr << sink.str() << ::std::flush;
+        }
     }
+    void handle_fatal()
+    {
+        if( auto* buf = tl_diagnostic_buffer )
+        {
+            tl_diagnostic_buffer = nullptr;
+            if( buf->on_fatal ) {
+                buf->on_fatal(*buf);
+            }
+            else {
+                ::std::cerr << buf->messages << ::std::flush;
+            }
+        }
+    }
+}
+DiagnosticBuffer* DiagnosticBuffer::set_current(DiagnosticBuffer* buf)
+{
+    auto* rv = tl_diagnostic_buffer;
+    tl_diagnostic_buffer = buf;
+    return rv;
 }
+
 void Span::bug(::std::function<void(::std::ostream&)> msg) const
 {
     print_span_message(*this, [](auto& os){os << "BUG";}, msg);
+    handle_fatal();
 #ifndef _WIN32
     abort();
 #else
@@ -66,6 +209,7 @@ void Span::bug(::std::function<void(::std::ostream&)> msg) const
 
 void Span::error(ErrorType tag, ::std::function<void(::std::ostream&)> msg) const {
     print_span_message(*this, [&](auto& os){os << "error:" << tag;}, msg);
+    handle_fatal();
 #ifndef _WIN32
     abort();
 #else
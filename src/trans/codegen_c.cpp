@@ -18,6 +18,9 @@
 #include "target.hpp"
 #include "allocator.hpp"
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <jobserver.h>	// tools/common/jobserver.h
 
 namespace {
     struct FmtShell
@@ -154,6 +157,109 @@ namespace {
         return rv;
     }
 
+    /// Build a shell command from an argument list, with arguments from `arg_file_start` onwards placed in `command_file`
+    ::std::string make_command(const StringList& args, size_t arg_file_start, const ::std::string& command_file, bool is_windows)
+    {
+        ::std::stringstream cmd_ss;
+        if (is_windows)
+        {
+            cmd_ss << "echo \"\" & ";
+        }
+        std::ofstream   command_file_stream;
+        bool use_arg_file = arg_file_start > 0;
+        if(use_arg_file) {
+            command_file_stream.open(command_file);
+        }
+        size_t i = -1;
+        for(const auto& arg : args.get_vec())
+        {
+            i ++;
+            auto& out_ss = (use_arg_file && i >= arg_file_start ? static_cast<::std::ostream&>(command_file_stream) : cmd_ss);
+            if(strcmp(arg, "&") == 0 && is_windows) {
+                out_ss << "&";
+            }
+            else {
+                if( is_windows && strchr(arg, ' ') == nullptr ) {
+                    out_ss << arg << " ";
+                }
+                else {
+                    out_ss << "\"" << FmtShell(arg, is_windows) << "\" ";
+                }
+            }
+        }
+        if(use_arg_file) {
+            cmd_ss << "@\"" << FmtShell(command_file, is_windows) << "\"";
+            command_file_stream.close();
+        }
+        return cmd_ss.str();
+    }
+
+    /// Run C compiler commands, with up to `max_jobs` running at once (0 = one per CPU)
+    /// - Exits the process if any command fails
+    /// - With a jobserver, commands past the first need a token (so the parent's `-j` limit is respected)
+    void run_commands(const ::std::vector< ::std::string>& commands, unsigned max_jobs)
+    {
+        if( max_jobs == 0 )
+        {
+            max_jobs = ::std::max(1u, ::std::thread::hardware_concurrency());
+        }
+        max_jobs = ::std::min(max_jobs, static_cast<unsigned>(commands.size()));
+
+        ::std::vector<int>  exit_codes(commands.size());
+        ::std::atomic<size_t>   next_command { 0 };
+        auto worker = [&](JobServer* js) {
+            for(;;)
+            {
+                if( js && !js->acquire([&]{ return next_command >= commands.size(); }) )
+                    break;
+                size_t i = next_command++;
+                if( i < commands.size() )
+                {
+                    exit_codes[i] = system(commands[i].c_str());
+                }
+                if( js )
+                    js->release();
+                if( i >= commands.size() )
+                    break;
+            }
+            };
+        ::std::vector< ::std::thread>   workers;
+        for(unsigned i = 1; i < max_jobs; i ++)
+        {
+            workers.push_back(::std::thread(worker, JobServer::s_global));
+        }
+        worker(nullptr);
+        for(auto& t : workers)
+        {
+            t.join();
+        }
+
+        bool failed = false;
+        for(size_t i = 0; i < commands.size(); i ++)
+        {
+            int ec = exit_codes[i];
+            if( ec == -1 )
+            {
+                ::std::cerr << "C Compiler failed to execute (system returned -1)" << ::std::endl;
+                perror("system");
+                failed = true;
+            }
+            else if( ec != 0 )
+            {
+                ::std::cerr << "C Compiler failed to execute - error code " << ec << ::std::endl;
+                if( commands.size() > 1 )
+                {
+                    ::std::cerr << "- " << commands[i] << ::std::endl;
+                }
+                failed = true;
+            }
+        }
+        if( failed )
+        {
+            exit(1);
+        }
+    }
+
     enum class AtomicOp
     {
         Add,
@@ -185,7 +291,18 @@ namespace {
         ::std::string   m_outfile_path;
         ::std::string   m_outfile_path_c;
 
-        ::std::ofstream m_of;
+        /// A separately-compiled C file holding a share of the function bodies (only used with `codegen_units > 1`)
+        struct CodegenUnit {
+            ::std::string   path_c;
+            ::std::filebuf  buf;
+            /// Number of bytes emitted so far, used to balance the units
+            size_t  size = 0;
+        };
+        /// Output for `m_outfile_path_c`, which holds everything except function bodies when there are multiple units
+        ::std::filebuf  m_of_main;
+        ::std::vector< ::std::unique_ptr<CodegenUnit> > m_units;
+        /// Current output stream, the buffer is switched to the active codegen unit
+        ::std::ostream  m_of;
         const ::MIR::TypeResolve* m_mir_res;
 
         Compiler    m_compiler = Compiler::Gcc;
@@ -198,12 +315,12 @@ namespace {
         ::std::set< ::HIR::TypeRef> m_emitted_fn_types;
         ::std::set< const TypeRepr*>    m_embedded_tags;
     public:
-        CodeGenerator_C(const ::HIR::Crate& crate, const ::std::string& outfile):
+        CodeGenerator_C(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt):
             m_crate(crate),
             m_resolve(crate),
             m_outfile_path(outfile),
             m_outfile_path_c(outfile + ".c"),
-            m_of(m_outfile_path_c)
+            m_of(nullptr)
         {
             m_options.emulated_i128 = Target_GetCurSpec().m_backend_c.m_emulated_i128;
             switch(Target_GetCurSpec().m_backend_c.m_codegen_mode)
@@ -226,6 +343,37 @@ namespace {
                 break;
             }
 
+            if( opt.codegen_units > 1 )
+            {
+                // Function bodies are spread over the units, which requires cross-unit (weak) linkage for functions
+                // that would otherwise be `static`
+                if( m_compiler == Compiler::Msvc )
+                {
+                    WARNING(Span(), W0000, "Multiple codegen units are not supported with MSVC, using one");
+                }
+                else
+                {
+                    // The shared types/prototypes are written to a header included by each unit
+                    m_outfile_path_c = outfile + ".h";
+                    auto header_name = m_outfile_path_c.substr(m_outfile_path_c.find_last_of("/\\") + 1);
+                    for(unsigned i = 0; i < opt.codegen_units; i ++)
+                    {
+                        auto unit = ::std::make_unique<CodegenUnit>();
+                        unit->path_c = FMT(outfile << "." << i << ".c");
+                        if( !unit->buf.open(unit->path_c, ::std::ios::out|::std::ios::trunc) ) {
+                            ERROR(Span(), E0000, "Unable to open " << unit->path_c << " for writing");
+                        }
+                        m_of.rdbuf(&unit->buf);
+                        m_of << "#include \"" << header_name << "\"\n";
+                        m_units.push_back(::std::move(unit));
+                    }
+                }
+            }
+            if( !m_of_main.open(m_outfile_path_c, ::std::ios::out|::std::ios::trunc) ) {
+                ERROR(Span(), E0000, "Unable to open " << m_outfile_path_c << " for writing");
+            }
+            m_of.rdbuf(&m_of_main);
+
             m_of
                 << "/*\n"
                 << " * AUTOGENERATED by mrustc\n"
@@ -745,6 +893,12 @@ namespace {
         {
             const bool create_shims = (out_ty == CodegenOutput::Executable);
 
+            // Entrypoint and shims go in the first unit (the header is included by every unit)
+            if( !m_units.empty() )
+            {
+                m_of.rdbuf(&m_units.front()->buf);
+            }
+
             // TODO: Support dynamic libraries too
             // - No main, but has the rest.
             // - Well... for cdylibs that's the case, for rdylibs it's not
@@ -877,7 +1031,11 @@ namespace {
             }
 
             m_of.flush();
-            m_of.close();
+            m_of_main.close();
+            for(auto& unit : m_units)
+            {
+                unit->buf.close();
+            }
 
             class LinkList: private StringList
             {
@@ -1101,6 +1259,8 @@ namespace {
 
             // Execute $CC with the required libraries
             StringList  args;
+            // Commands to compile each codegen unit, run (in parallel) before `args`
+            ::std::vector< ::std::string>   unit_commands;
 #ifdef _WIN32
             bool is_windows = true;
 #else
@@ -1152,6 +1312,19 @@ namespace {
                     args.push_back("-g");
                 }
                 args.push_back("-fPIC");
+                for(const auto& unit : m_units)
+                {
+                    StringList  unit_args;
+                    for(const char* a : args)
+                    {
+                        unit_args.push_back(::std::string(a));
+                    }
+                    unit_args.push_back("-c");
+                    unit_args.push_back("-o");
+                    unit_args.push_back(unit->path_c + ".o");
+                    unit_args.push_back(unit->path_c.c_str());
+                    unit_commands.push_back( make_command(unit_args, arg_file_start, unit->path_c + "_cmd.txt", is_windows) );
+                }
                 args.push_back("-o");
                 switch(out_ty)
                 {
@@ -1164,7 +1337,17 @@ namespace {
                     args.push_back(m_outfile_path+".o");
                     break;
                 }
-                args.push_back(m_outfile_path_c.c_str());
+                if( m_units.empty() )
+                {
+                    args.push_back(m_outfile_path_c.c_str());
+                }
+                else
+                {
+                    for(const auto& unit : m_units)
+                    {
+                        args.push_back(unit->path_c + ".o");
+                    }
+                }
                 switch(out_ty)
                 {
                 case CodegenOutput::DynamicLibrary:
@@ -1209,7 +1392,16 @@ namespace {
                     break;
                 case CodegenOutput::StaticLibrary:
                 case CodegenOutput::Object:
-                    args.push_back("-c");
+                    if( m_units.empty() )
+                    {
+                        args.push_back("-c");
+                    }
+                    else
+                    {
+                        // Combine the unit objects into a single relocatable object
+                        args.push_back("-r");
+                        args.push_back("-nostdlib");
+                    }
                     break;
                 }
                 break;
@@ -1303,59 +1495,31 @@ namespace {
                 break;
             }
 
-            ::std::stringstream cmd_ss;
-            if (is_windows)
+            auto cmd = make_command(args, arg_file_start, m_outfile_path + "_cmd.txt", is_windows);
+            //DEBUG("- " << cmd);
+            for(const auto& unit_cmd : unit_commands)
             {
-                cmd_ss << "echo \"\" & ";
+                ::std::cout << "Running command - " << unit_cmd << ::std::endl;
             }
-            std::string command_file = m_outfile_path + "_cmd.txt";
-            std::ofstream   command_file_stream;
-            bool use_arg_file = arg_file_start > 0;
-            if(use_arg_file) {
-                command_file_stream.open(command_file);
-            }
-            size_t i = -1;
-            for(const auto& arg : args.get_vec())
-            {
-                i ++;
-                auto& out_ss = (use_arg_file && i >= arg_file_start ? static_cast<::std::ostream&>(command_file_stream) : cmd_ss);
-                if(strcmp(arg, "&") == 0 && is_windows) {
-                    out_ss << "&";
-                }
-                else {
-                    if( is_windows && strchr(arg, ' ') == nullptr ) {
-                        out_ss << arg << " ";
-                    }
-                    else {
-                        out_ss << "\"" << FmtShell(arg, is_windows) << "\" ";
-                    }
-                }
-            }
-            if(use_arg_file) {
-                cmd_ss << "@\"" << FmtShell(command_file, is_windows) << "\"";
-                command_file_stream.close();
-            }
-            //DEBUG("- " << cmd_ss.str());
-            ::std::cout << "Running command - " << cmd_ss.str() << ::std::endl;
+            ::std::cout << "Running command - " << cmd << ::std::endl;
             if( opt.build_command_file != "" )
             {
-                ::std::cerr << "INVOKE CC: " << cmd_ss.str() << ::std::endl;
-                ::std::ofstream(opt.build_command_file) << cmd_ss.str() << ::std::endl;
+                ::std::ofstream cmd_file(opt.build_command_file);
+                for(const auto& unit_cmd : unit_commands)
+                {
+                    ::std::cerr << "INVOKE CC: " << unit_cmd << ::std::endl;
+                    cmd_file << unit_cmd << ::std::endl;
+                }
+                ::std::cerr << "INVOKE CC: " << cmd << ::std::endl;
+                cmd_file << cmd << ::std::endl;
             }
             else
             {
-                int ec = system(cmd_ss.str().c_str());
-                if( ec == -1 )
+                if( !unit_commands.empty() )
                 {
-                    ::std::cerr << "C Compiler failed to execute (system returned -1)" << ::std::endl;
-                    perror("system");
-                    exit(1);
-                }
-                else if( ec != 0 )
-                {
-                    ::std::cerr << "C Compiler failed to execute - error code " << ec << ::std::endl;
-                    exit(1);
+                    run_commands(unit_commands, opt.codegen_jobs);
                 }
+                run_commands({ cmd }, 1);
             }
 
             // HACK! Static libraries aren't implemented properly yet, just touch the output file
@@ -2158,24 +2322,12 @@ namespace {
 
             TRACE_FUNCTION_F(p);
             auto type = params.monomorph(m_resolve, item.m_type);
-            switch(item.m_linkage.type)
+            // With multiple units, the definition is emitted by `emit_static_local` into the first unit
+            if( !m_units.empty() )
             {
-            case HIR::Linkage::Type::External:
-                break;
-            case HIR::Linkage::Type::Auto:
-                break;
-            case HIR::Linkage::Type::Weak:
-                switch(m_compiler)
-                {
-                case Compiler::Gcc:
-                    m_of << "__attribute__((weak)) ";
-                    break;
-                case Compiler::Msvc:
-                    m_of << "__declspec(selectany) ";
-                    break;
-                }
-                break;
+                m_of << "extern ";
             }
+            emit_static_linkage(item);
             emit_static_ty(type, p, /*is_proto=*/true);
             m_of << ";";
             m_of << "\t// static " << p << " : " << type;
@@ -2191,9 +2343,17 @@ namespace {
 
             TRACE_FUNCTION_F(p);
 
+            if( !m_units.empty() )
+            {
+                m_of.rdbuf(&m_units.front()->buf);
+            }
+
             auto type = params.monomorph(m_resolve, item.m_type);
             // statics that are zero do not require initializers, since they will be initialized to zero on program startup.
             if( !is_zero_literal(type, item.m_value_res, params)) {
+                if( !m_units.empty() ) {
+                    emit_static_linkage(item);
+                }
                 bool is_packed = emit_static_ty(type, p, /*is_proto=*/false);
                 m_of << " = ";
 
@@ -2258,9 +2418,61 @@ namespace {
                 m_of << "\t// static " << p << " : " << type << " = " << item.m_value_res;
                 m_of << "\n";
             }
+            else if( !m_units.empty() ) {
+                // The header only has an `extern` declaration, so the (zeroed) definition is needed here
+                emit_static_linkage(item);
+                emit_static_ty(type, p, /*is_proto=*/false);
+                m_of << ";\n";
+            }
+
+            if( !m_units.empty() )
+            {
+                m_units.front()->size = m_of.tellp();
+                m_of.rdbuf(&m_of_main);
+            }
 
             m_mir_res = nullptr;
         }
+        void emit_static_linkage(const ::HIR::Static& item)
+        {
+            switch(item.m_linkage.type)
+            {
+            case HIR::Linkage::Type::External:
+                break;
+            case HIR::Linkage::Type::Auto:
+                break;
+            case HIR::Linkage::Type::Weak:
+                switch(m_compiler)
+                {
+                case Compiler::Gcc:
+                    m_of << "__attribute__((weak)) ";
+                    break;
+                case Compiler::Msvc:
+                    m_of << "__declspec(selectany) ";
+                    break;
+                }
+                break;
+            }
+        }
+        /// Linkage for functions only visible to this crate (e.g. monomorphised generics from other crates)
+        /// - `is_shared` is set for functions exported for downstream crates (`HIR::Crate::m_shared_generics`), which
+        ///   are weak as sibling crates can emit the same instance
+        void emit_local_linkage(bool is_shared=false)
+        {
+            if( is_shared )
+            {
+                m_of << "__attribute__((weak)) ";
+            }
+            else if( m_units.empty() )
+            {
+                m_of << "static ";
+            }
+            else
+            {
+                // Needs to be visible to the other units, but must not conflict with copies in other crates
+                m_of << "__attribute__((weak,visibility(\"hidden\"))) ";
+            }
+        }
         void emit_float(double v) {
             if( ::std::isnan(v) ) {
                 m_of << "NAN";
@@ -2466,7 +2678,7 @@ namespace {
             }
             if( is_extern_def )
             {
-                m_of << "static ";
+                emit_local_linkage(m_crate.m_shared_generics.count(p) > 0);
             }
             switch(item.m_linkage.type)
             {
@@ -2505,9 +2717,17 @@ namespace {
             ::MIR::TypeResolve  mir_res { sp, m_resolve, FMT_CB(ss, ss << p;), ret_type, arg_types, *code };
             m_mir_res = &mir_res;
 
+            // Place the body in the unit with the least code so far
+            CodegenUnit* unit = nullptr;
+            if( !m_units.empty() )
+            {
+                unit = ::std::min_element(m_units.begin(), m_units.end(), [](const auto& a, const auto& b){ return a->size < b->size; })->get();
+                m_of.rdbuf(&unit->buf);
+            }
+
             m_of << "// " << p << "\n";
             if( is_extern_def ) {
-                m_of << "static ";
+                emit_local_linkage(m_crate.m_shared_generics.count(p) > 0);
             }
             emit_function_header(p, item, params);
             m_of << "\n";
@@ -2795,6 +3015,11 @@ namespace {
             }
             m_of << "}\n";
             m_of.flush();
+            if( unit )
+            {
+                unit->size = m_of.tellp();
+                m_of.rdbuf(&m_of_main);
+            }
             m_mir_res = nullptr;
         }
 
@@ -6778,7 +7003,7 @@ namespace {
     Span CodeGenerator_C::sp;
 }
 
-::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGeneratorC(const ::HIR::Crate& crate, const ::std::string& outfile)
+::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGeneratorC(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt)
 {
-    return ::std::unique_ptr<CodeGenerator>(new CodeGenerator_C(crate, outfile));
+    return ::std::unique_ptr<CodeGenerator>(new CodeGenerator_C(crate, outfile, opt));
 }
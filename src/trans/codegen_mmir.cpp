@@ -15,6 +15,9 @@
 
 #include <iomanip>
 #include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <mmir_binary.h>	// tools/common/mmir_binary.h
 
 namespace
 {
@@ -239,555 +242,105 @@ namespace
         return os;
     }
 
-    class CodeGenerator_MonoMir:
-        public CodeGenerator
-    {
-        enum class MetadataType {
-            None,
-            Slice,
-            TraitObject,
-        };
-
-        static Span sp;
-
-        const ::HIR::Crate& m_crate;
-        ::StaticTraitResolve    m_resolve;
 
+    /// Output format for the monomorphised MIR
+    /// - The generator builds each record once, and passes it to every enabled sink
+    class MmirSink
+    {
+    public:
+        virtual ~MmirSink() {}
+
+        /// Reference to an upstream crate's output (loaded before the rest of this file)
+        virtual void crate(const ::std::string& path) = 0;
+        /// Layout of a struct/union/enum/tuple, `item` is set for enums (for the variant list)
+        virtual void datatype(const ::std::string& name, const TypeRepr& repr, const ::HIR::TypeRef* dst_meta, const ::HIR::Path* drop_glue, const ::HIR::Enum* item) = 0;
+        virtual void static_value(const ::std::string& name, const ::HIR::TypeRef& ty, const EncodedLiteral& value) = 0;
+        /// Function definition, `code` is null for external functions
+        virtual void function(const ::std::string& name, const ::std::vector<::HIR::TypeRef>& args, const ::HIR::TypeRef& ret, const ::std::string& link_name, const ::std::string& abi, const ::MIR::Function* code) = 0;
+        /// Called after the last record
+        virtual void finish() = 0;
+    };
 
-        ::std::string   m_outfile_path;
+    /// Text form (`.mir`), parsed by standalone_miri's `Parser`
+    class MmirTextSink:
+        public MmirSink
+    {
         ::std::ofstream m_of;
-        const ::MIR::TypeResolve* m_mir_res;
-
     public:
-        CodeGenerator_MonoMir(const ::HIR::Crate& crate, const ::std::string& outfile):
-            m_crate(crate),
-            m_resolve(crate),
-            m_outfile_path(outfile),
-            m_of(m_outfile_path + ".mir")
-        {
-            for( const auto& crate : m_crate.m_ext_crates )
-            {
-                m_of << "crate \"" << FmtEscaped(crate.second.m_path) << ".mir\";\n";
-            }
-        }
-
-        void finalise(const TransOptions& opt, CodegenOutput out_ty, const ::std::string& hir_file) override
+        MmirTextSink(const ::std::string& path):
+            m_of(path)
         {
-            if( out_ty == CodegenOutput::Executable )
-            {
-                m_of << "fn main#(isize, *const *const i8): isize {\n";
-                auto c_start_path = m_resolve.m_crate.get_lang_item_path_opt("mrustc-start");
-                if( c_start_path == ::HIR::SimplePath() )
-                {
-                    m_of << "\tlet m: fn();\n";
-                    m_of << "\t0: {\n";
-                    m_of << "\t\tASSIGN m = ADDROF " << fmt(::HIR::GenericPath(m_resolve.m_crate.get_lang_item_path(Span(), "mrustc-main"))) << ";\n";
-                    m_of << "\t\tCALL RETURN = " << fmt(::HIR::GenericPath(m_resolve.m_crate.get_lang_item_path(Span(), "start"))) << "(m, arg0, arg1) goto 1 else 1\n";
-                }
-                else
-                {
-                    m_of << "\t0: {\n";
-                    m_of << "\t\tCALL RETURN = " << fmt(::HIR::GenericPath(c_start_path)) << "(arg0, arg1) goto 1 else 1;\n";
-                }
-                m_of << "\t}\n";
-                m_of << "\t1: {\n";
-                m_of << "\t\tRETURN\n";
-                m_of << "\t}\n";
-                m_of << "}\n";
-
-                if(TARGETVER_LEAST_1_29)
-                {
-                    // Bind `panic_impl` lang item to the item tagged with `panic_implementation`
-                    const auto& panic_impl_path = m_crate.get_lang_item_path(Span(), "mrustc-panic_implementation");
-                    m_of << "fn panic_impl#(usize): u32 = \"panic_impl\":\"Rust\" {\n";
-                    m_of << "\t0: {\n";
-                    m_of << "\t\tCALL RETURN = " << fmt(panic_impl_path) << "(arg0) goto 1 else 2\n";
-                    m_of << "\t}\n";
-                    m_of << "\t1: { RETURN }\n";
-                    m_of << "\t2: { DIVERGE }\n";
-                    m_of << "}\n";
-
-                    // TODO: OOM impl?
-                }
-            }
-
-            m_of.flush();
-            m_of.close();
-
-            // HACK! Create the output file, but keep it empty
-            {
-                ::std::ofstream of( m_outfile_path );
-                if( !of.good() )
-                {
-                    // TODO: Error?
-                }
-            }
         }
 
-
-        void emit_type(const ::HIR::TypeRef& ty) override
+        void crate(const ::std::string& path) override
         {
-            TRACE_FUNCTION_F(ty);
-            ::MIR::Function empty_fcn;
-            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "type " << ty;), ::HIR::TypeRef(), {}, empty_fcn };
-            m_mir_res = &top_mir_res;
-
-            if( const auto* te = ty.data().opt_Tuple() )
-            {
-                if( te->size() > 0 )
-                {
-                    const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
-                    MIR_ASSERT(*m_mir_res, repr, "No repr for tuple " << ty);
-
-                    bool has_drop_glue =  m_resolve.type_needs_drop_glue(sp, ty);
-                    auto drop_glue_path = ::HIR::Path(ty.clone(), "#drop_glue");
-
-                    m_of << "type " << fmt(ty) << " {\n";
-                    m_of << "\tSIZE " << repr->size << ", ALIGN " << repr->align << ";\n";
-                    if( has_drop_glue )
-                    {
-                        m_of << "\tDROP " << fmt(drop_glue_path) << ";\n";
-                    }
-                    for(const auto& e : repr->fields)
-                    {
-                        m_of << "\t" << e.offset << " = " << fmt(e.ty) << ";\n";
-                    }
-                    m_of << "}\n";
-                }
-            }
-            else {
-            }
-
-            m_mir_res = nullptr;
+            m_of << "crate \"" << FmtEscaped(path) << "\";\n";
         }
-
-        // TODO: Move this to a more common location
-        MetadataType metadata_type(const ::HIR::TypeRef& ty) const
+        void datatype(const ::std::string& name, const TypeRepr& repr, const ::HIR::TypeRef* dst_meta, const ::HIR::Path* drop_glue, const ::HIR::Enum* item) override
         {
-            if( ty == ::HIR::CoreType::Str || ty.data().is_Slice() ) {
-                return MetadataType::Slice;
-            }
-            else if( ty.data().is_TraitObject() ) {
-                return MetadataType::TraitObject;
-            }
-            else if( ty.data().is_Path() )
+            m_of << "type " << name << " {\n";
+            m_of << "\tSIZE " << repr.size << ", ALIGN " << repr.align << ";\n";
+            if( drop_glue )
             {
-                const auto& te = ty.data().as_Path();
-                switch( te.binding.tag() )
-                {
-                TU_ARM(te.binding, Struct, tpb) {
-                    switch( tpb->m_struct_markings.dst_type )
-                    {
-                    case ::HIR::StructMarkings::DstType::None:
-                        return MetadataType::None;
-                    case ::HIR::StructMarkings::DstType::Possible: {
-                        // TODO: How to figure out? Lazy way is to check the monomorpised type of the last field (structs only)
-                        const auto& path = ty.data().as_Path().path.m_data.as_Generic();
-                        const auto& str = *ty.data().as_Path().binding.as_Struct();
-                        auto monomorph = [&](const auto& tpl) {
-                            return m_resolve.monomorph_expand(sp, tpl, MonomorphStatePtr(nullptr, &path.m_params, nullptr));
-                        };
-                        TU_MATCHA( (str.m_data), (se),
-                        (Unit,  MIR_BUG(*m_mir_res, "Unit-like struct with DstType::Possible"); ),
-                        (Tuple, return metadata_type( monomorph(se.back().ent) ); ),
-                        (Named, return metadata_type( monomorph(se.back().second.ent) ); )
-                        )
-                        //MIR_TODO(*m_mir_res, "Determine DST type when ::Possible - " << ty);
-                        return MetadataType::None;
-                    }
-                    case ::HIR::StructMarkings::DstType::Slice:
-                        return MetadataType::Slice;
-                    case ::HIR::StructMarkings::DstType::TraitObject:
-                        return MetadataType::TraitObject;
-                    }
-                    throw "";
-                    } break;
-                TU_ARM(te.binding, Union, tpb)
-                    return MetadataType::None;
-                TU_ARM(te.binding, Enum, tpb)
-                    return MetadataType::None;
-                default:
-                    MIR_BUG(*m_mir_res, "Unbound/opaque path in trans - " << ty);
-                }
-                throw "";
-            }
-            else {
-                return MetadataType::None;
+                m_of << "\tDROP " << fmt(*drop_glue) << ";\n";
             }
-        }
-
-        void emit_struct(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Struct& item) override
-        {
-            ::MIR::Function empty_fcn;
-            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "struct " << p;), ::HIR::TypeRef(), {}, empty_fcn };
-            m_mir_res = &top_mir_res;
-
-            auto drop_glue_path = ::HIR::Path(::HIR::TypeRef::new_path(p.clone(), &item), "#drop_glue");
-
-            TRACE_FUNCTION_F(p);
-            ::HIR::TypeRef  ty = ::HIR::TypeRef::new_path(p.clone(), &item);
-
-            struct H {
-                static ::HIR::TypeRef get_metadata_type(const Span& sp, const ::StaticTraitResolve& resolve, const TypeRepr& r)
-                {
-                    ASSERT_BUG(sp, r.fields.size() > 0, "");
-                    auto& t = r.fields.back().ty;
-                    if( t == ::HIR::CoreType::Str ) {
-                        return ::HIR::CoreType::Usize;
-                    }
-                    else if( t.data().is_Slice() ) {
-                        return ::HIR::CoreType::Usize;
-                    }
-                    else if( t.data().is_TraitObject() ) {
-                        const auto& te = t.data().as_TraitObject();
-                        //auto vtp = t.m_data.as_TraitObject().m_trait.m_path;
-
-                        const auto& trait = resolve.m_crate.get_trait_by_path(sp, te.m_trait.m_path.m_path);
-                        auto vtable_ty = trait.get_vtable_type(sp, resolve.m_crate, te);
-                        return ::HIR::TypeRef::new_pointer(::HIR::BorrowType::Shared, std::move(vtable_ty));
-                    }
-                    else if( t.data().is_Path() ) {
-                        auto* repr = Target_GetTypeRepr(sp, resolve, t);
-                        ASSERT_BUG(sp, repr, "No repr for " << t);
-                        return get_metadata_type(sp, resolve, *repr);
-                    }
-                    else {
-                        BUG(sp, "Unexpected type in get_metadata_type - " << t);
-                    }
-                }
-            };
-
-
-            // Generate the drop glue (and determine if there is any)
-            bool has_drop_glue = m_resolve.type_needs_drop_glue(sp, ty);
-
-            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
-            MIR_ASSERT(*m_mir_res, repr, "No repr for struct " << ty);
-            m_of << "type " << Trans_Mangle(p) << " {\n";
-            m_of << "\tSIZE " << repr->size << ", ALIGN " << repr->align << ";\n";
-            if( repr->size == SIZE_MAX )
+            if( dst_meta )
             {
-                m_of << "\tDSTMETA " << H::get_metadata_type(sp, m_resolve, *repr) << ";\n";
+                m_of << "\tDSTMETA " << fmt(*dst_meta) << ";\n";
             }
-            if( has_drop_glue )
+            for(const auto& e : repr.fields)
             {
-                m_of << "\tDROP " << fmt(drop_glue_path) << ";\n";
+                m_of << "\t" << e.offset << " = " << fmt(e.ty) << ";\n";
             }
-            for(const auto& e : repr->fields)
+            if( item )
             {
-                m_of << "\t" << e.offset << " = " << fmt(e.ty) << ";\n";
+                emit_variants(*item, repr);
             }
             m_of << "}\n";
-
-            m_mir_res = nullptr;
         }
-        void emit_constructor_enum(const Span& sp, const ::HIR::GenericPath& var_path, const ::HIR::Enum& item, size_t var_idx) override
+        void static_value(const ::std::string& name, const ::HIR::TypeRef& ty, const EncodedLiteral& encoded) override
         {
-            TRACE_FUNCTION_F(var_path);
-
-            ::HIR::TypeRef  tmp;
-            MonomorphStatePtr   ms(nullptr, &var_path.m_params, nullptr);
-            auto monomorph = [&](const auto& x)->const auto& { return m_resolve.monomorph_expand_opt(sp, tmp, x, ms); };
-
-            auto enum_path = var_path.clone();
-            enum_path.m_path.m_components.pop_back();
-
-            // Create constructor function
-            const auto& var_ty = item.m_data.as_Data().at(var_idx).type;
-            const auto& e = var_ty.data().as_Path().binding.as_Struct()->m_data.as_Tuple();
-            m_of << "fn " << fmt(var_path) << "(";
-            for(unsigned int i = 0; i < e.size(); i ++)
-            {
-                if(i != 0)
-                    m_of << ", ";
-                m_of << fmt(monomorph(e[i].ent));
-            }
-            m_of << "): " << fmt(enum_path) << " {\n";
-            m_of << "\t0: {\n";
-            m_of << "\t\tASSIGN RETURN = ENUM " << fmt(enum_path) << " " << var_idx << " { ";
-            for(unsigned int i = 0; i < e.size(); i ++)
+            m_of << "static " << name << ": " << fmt(ty) << " = \"";
+            for(auto b : encoded.bytes)
+                emit_str_byte(b);
+            m_of << "\"";
+            m_of << "{";
+            for(const auto& r : encoded.relocations)
             {
-                if(i != 0)
-                    m_of << ", ";
-                m_of << "arg" << i;
+                m_of << "@" << r.ofs << "+" << r.len << " = ";
+                if( r.p )
+                    m_of << fmt(*r.p);
+                else
+                    m_of << "\"" << FmtEscaped(r.bytes) << "\"";
+                m_of << ",";
             }
-            m_of << " };\n";
-            m_of << "\t\tRETURN\n";
-            m_of << "\t}\n";
             m_of << "}";
+            m_of << ";\n";
         }
-        void emit_constructor_struct(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Struct& item) override
+        void function(const ::std::string& name, const ::std::vector<::HIR::TypeRef>& args, const ::HIR::TypeRef& ret, const ::std::string& link_name, const ::std::string& abi, const ::MIR::Function* code) override
         {
-            TRACE_FUNCTION_F(p);
-            ::HIR::TypeRef  tmp;
-            MonomorphStatePtr   ms(nullptr, &p.m_params, nullptr);
-            auto monomorph = [&](const auto& x)->const auto& { return m_resolve.monomorph_expand_opt(sp, tmp, x, ms); };
-            // Create constructor function
-            const auto& e = item.m_data.as_Tuple();
-            m_of << "fn " << fmt(p) << "(";
-            for(unsigned int i = 0; i < e.size(); i ++)
+            // - Signature
+            m_of << "fn " << name << "(";
+            for(unsigned int i = 0; i < args.size(); i ++)
             {
-                if(i != 0)
-                    m_of << ", ";
-                m_of << fmt(monomorph(e[i].ent));
+                if( i != 0 )    m_of << ", ";
+                m_of << fmt(args[i]);
             }
-            m_of << "): " << fmt(p) << " {\n";
-            m_of << "\t0: {\n";
-            m_of << "\t\tASSIGN RETURN = { ";
-            for(unsigned int i = 0; i < e.size(); i ++)
+            m_of << "): " << fmt(ret);
+            if( link_name != "" )
             {
-                if(i != 0)
-                    m_of << ", ";
-                m_of << "arg" << i;
+                m_of << " = \"" << link_name << "\":\"" << abi << "\"";
             }
-            m_of << " }: " << fmt(p) << ";\n";
-            m_of << "\t\tRETURN\n";
-            m_of << "\t}\n";
-            m_of << "}\n";
-        }
-        void emit_union(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Union& item) override
-        {
-            ::MIR::Function empty_fcn;
-            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "union " << p;), ::HIR::TypeRef(), {}, empty_fcn };
-            m_mir_res = &top_mir_res;
-
-            TRACE_FUNCTION_F(p);
-            ::HIR::TypeRef  ty = ::HIR::TypeRef::new_path(p.clone(), &item);
-
-            bool has_drop_glue = m_resolve.type_needs_drop_glue(sp, ty);
-            auto drop_glue_path = ::HIR::Path(ty.clone(), "#drop_glue");
-
-            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
-            MIR_ASSERT(*m_mir_res, repr, "No repr for union " << ty);
-            m_of << "type " << fmt(p) << " {\n";
-            m_of << "\tSIZE " << repr->size << ", ALIGN " << repr->align << ";\n";
-            if( has_drop_glue )
+            if( !code )
             {
-                m_of << "\tDROP " << fmt(drop_glue_path) << ";\n";
+                m_of << ";\n";
+                return ;
             }
-            for(const auto& e : repr->fields)
-            {
-                m_of << "\t" << e.offset << " = " << fmt(e.ty) << ";\n";
-            }
-            m_of << "}\n";
-        }
-
-        void emit_enum(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Enum& item) override
-        {
-            ::MIR::Function empty_fcn;
-            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "enum " << p;), ::HIR::TypeRef(), {}, empty_fcn };
-            m_mir_res = &top_mir_res;
-
-
-            TRACE_FUNCTION_F(p);
-            ::HIR::TypeRef  ty = ::HIR::TypeRef::new_path(p.clone(), &item);
-
-            // Generate the drop glue (and determine if there is any)
-            bool has_drop_glue = m_resolve.type_needs_drop_glue(sp, ty);
-            auto drop_glue_path = ::HIR::Path(ty.clone(), "#drop_glue");
-
-            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
-            MIR_ASSERT(*m_mir_res, repr, "No repr for enum " << ty);
-            m_of << "type " << fmt(p) << " {\n";
-            m_of << "\tSIZE " << repr->size << ", ALIGN " << repr->align << ";\n";
-            if( has_drop_glue )
-            {
-                m_of << "\tDROP " << fmt(drop_glue_path) << ";\n";
-            }
-            for(const auto& e : repr->fields)
-            {
-                m_of << "\t" << e.offset << " = " << fmt(e.ty) << ";\n";
-            }
-
-            auto emit_value = [&](const TypeRepr::FieldPath& path, uint64_t v) {
-                m_of << "\"";
-                for(size_t i = 0; i < path.size; i ++)
-                {
-                    int val = (v >> (i*8)) & 0xFF;
-                    if(val < 16)
-                        m_of << ::std::hex << "\\x0" << val << ::std::dec;
-                    else
-                        m_of << ::std::hex << "\\x" << val << ::std::dec;
-                }
-                m_of << "\"";
-                };
-
-            switch(repr->variants.tag())
-            {
-            case TypeRepr::VariantMode::TAGDEAD:    throw "";
-            TU_ARM(repr->variants, None, _e) {
-                }
-            TU_ARM(repr->variants, Linear, e) {
-                m_of << "\t@[" << e.field.index << ", " << e.field.sub_fields << "] = {\n";
-                for(size_t i = 0; i < e.num_variants; i ++ )
-                {
-                    m_of << "\t\t";
-
-                    if( e.is_niche(i) ) {
-                        m_of << "*";
-                    }
-                    else {
-                        emit_value(e.field, e.offset + i);
-                    }
-                    // - Data field number (optional)
-                    if( !item.is_value() )
-                    {
-                        m_of << " =" << i;
-                    }
-                    m_of << ",\n";
-                }
-                m_of << "\t\t}\n";
-                }
-            TU_ARM(repr->variants, Values, e) {
-                m_of << "\t@[" << e.field.index << ", " << e.field.sub_fields << "] = {\n";
-                for(size_t idx = 0; idx < e.values.size(); idx ++)
-                {
-                    m_of << "\t\t";
-                    // - Tag value
-                    emit_value(e.field, e.values[idx]);
-                    // - Data field number (optional)
-                    if( !item.is_value() )
-                    {
-                        m_of << " =" << idx;
-                    }
-                    m_of << ",\n";
-                }
-                m_of << "\t}\n";
-                }
-            TU_ARM(repr->variants, NonZero, e) {
-                m_of << "\t@[" << e.field.index << ", " << e.field.sub_fields << "] = { ";
-                for(int i = 0; i < 2; i ++)
-                {
-                    if( i == 1 ) {
-                        m_of << ", ";
-                    }
-
-                    if( e.zero_variant == i ) {
-                        m_of << "\"";
-                        for(size_t i = 0; i < e.field.size; i ++)
-                        {
-                            m_of << "\\0";
-                        }
-                        m_of << "\"";
-                    }
-                    else {
-                        m_of << "* =" << i;
-                    }
-                }
-                m_of << " }\n";
-                }
-            }
-            m_of << "}\n";
-
-            m_mir_res = nullptr;
-        }
-
-        void emit_str_byte(uint8_t b) {
-            if( b == 0 ) {
-                m_of << "\\0";
-            }
-            else if( b == '\\' ) {
-                m_of << "\\\\";
-            }
-            else if( b == '"' ) {
-                m_of << "\\\"";
-            }
-            else if( ' ' <= b && b <= 'z' && b != '\\' ) {
-                m_of << b;
-            }
-            else if( b < 16 ) {
-                m_of << "\\x0" << ::std::hex << int(b) << ::std::dec;
-            }
-            else {
-                m_of << "\\x" << ::std::hex << int(b) << ::std::dec;
-            }
-        }
-        void emit_static_local(const ::HIR::Path& p, const ::HIR::Static& item, const Trans_Params& params) override
-        {
-            ::MIR::Function empty_fcn;
-            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "static " << p;), ::HIR::TypeRef(), {}, empty_fcn };
-            m_mir_res = &top_mir_res;
-
-            TRACE_FUNCTION_F(p);
-
-            auto type = params.monomorph(m_resolve, item.m_type);
-            const auto& encoded = item.m_value_res;
-
-            m_of << "static " << fmt(p) << ": " << fmt(type) << " = \"";
-            for(auto b : encoded.bytes)
-                emit_str_byte(b);
-            m_of << "\"";
-            m_of << "{";
-            for(const auto& r : encoded.relocations)
-            {
-                m_of << "@" << r.ofs << "+" << r.len << " = ";
-                if( r.p )
-                    m_of << fmt(*r.p);
-                else
-                    m_of << "\"" << FmtEscaped(r.bytes) << "\"";
-                m_of << ",";
-            }
-            m_of << "}";
-            m_of << ";\n";
-
-            m_mir_res = nullptr;
-        }
-
-        void emit_function_ext(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params) override
-        {
-            ::MIR::Function empty_fcn;
-            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "extern fn " << p;), ::HIR::TypeRef(), {}, empty_fcn };
-            m_mir_res = &top_mir_res;
-            TRACE_FUNCTION_F(p);
-
-            // If the function is a C external, emit as such
-            if( item.m_linkage.name != "" )
-            {
-                ::HIR::TypeRef  ret_type_tmp;
-                const auto& ret_type = monomorphise_fcn_return(ret_type_tmp, item, params);
-
-                m_of << "fn " << fmt(p) << "(";
-                for(unsigned int i = 0; i < item.m_args.size(); i ++)
-                {
-                    if( i != 0 )    m_of << ", ";
-                    m_of << fmt(params.monomorph(m_resolve, item.m_args[i].second));
-                }
-                m_of << "): " << fmt(ret_type) << " = \"" << item.m_linkage.name << "\":\"" << item.m_abi << "\";\n";
-            }
-
-            m_mir_res = nullptr;
-        }
-        void emit_function_code(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def, const ::MIR::FunctionPointer& code) override
-        {
-            TRACE_FUNCTION_F(p);
-
-            ::MIR::TypeResolve::args_t  arg_types;
-            for(const auto& ent : item.m_args)
-                arg_types.push_back(::std::make_pair( ::HIR::Pattern{}, params.monomorph(m_resolve, ent.second) ));
-
-            ::HIR::TypeRef  ret_type_tmp;
-            const auto& ret_type = monomorphise_fcn_return(ret_type_tmp, item, params);
-
-            ::MIR::TypeResolve  mir_res { sp, m_resolve, FMT_CB(ss, ss << p;), ret_type, arg_types, *code };
-            m_mir_res = &mir_res;
-
-            // - Signature
-            m_of << "fn " << fmt(p) << "(";
-            for(unsigned int i = 0; i < item.m_args.size(); i ++)
-            {
-                if( i != 0 )    m_of << ", ";
-                m_of << fmt(params.monomorph(m_resolve, item.m_args[i].second));
-            }
-            m_of << "): " << fmt(ret_type);
-            if( item.m_linkage.name != "" )
-            {
-                m_of << " = \"" << item.m_linkage.name << "\":\"" << item.m_abi << "\"";
-            }
-            m_of << " {\n";
-            // - Locals
-            for(unsigned int i = 0; i < code->locals.size(); i ++) {
-                DEBUG("var" << i << " : " << code->locals[i]);
-                m_of << "\tlet var" << i << ": " << fmt(code->locals[i]) << ";\n";
+            m_of << " {\n";
+            // - Locals
+            for(unsigned int i = 0; i < code->locals.size(); i ++) {
+                DEBUG("var" << i << " : " << code->locals[i]);
+                m_of << "\tlet var" << i << ": " << fmt(code->locals[i]) << ";\n";
             }
             for(unsigned int i = 0; i < code->drop_flags.size(); i ++) {
                 m_of << "\tlet df" << i << " = " << code->drop_flags[i] << ";\n";
@@ -796,14 +349,13 @@ namespace
 
             for(unsigned int i = 0; i < code->blocks.size(); i ++)
             {
-                TRACE_FUNCTION_F(p << " bb" << i);
+                TRACE_FUNCTION_F(name << " bb" << i);
 
                 m_of << "\t" << i << ": {\n";
 
                 for(const auto& stmt : code->blocks[i].statements)
                 {
                     m_of << "\t\t";
-                    mir_res.set_cur_stmt(i, (&stmt - &code->blocks[i].statements.front()));
                     DEBUG(stmt);
                     switch(stmt.tag())
                     {
@@ -966,105 +518,1281 @@ namespace
                         }
                         } break;
                     }
-                    m_of << ";\n";
+                    m_of << ";\n";
+                }
+
+                const auto& term = code->blocks[i].terminator;
+                DEBUG("- " << term);
+                m_of << "\t\t";
+                switch(term.tag())
+                {
+                case ::MIR::Terminator::TAGDEAD: throw "";
+                TU_ARM(term, Incomplete, _e) (void)_e;
+                    m_of << "INCOMPLETE\n";
+                    break;
+                TU_ARM(term, Return, _e) (void)_e;
+                    m_of << "RETURN\n";
+                    break;
+                TU_ARM(term, Diverge, _e) (void)_e;
+                    m_of << "DIVERGE\n";
+                    break;
+                TU_ARM(term, Goto, e)
+                    m_of << "GOTO " << e << "\n";
+                    break;
+                TU_ARM(term, Panic, e)
+                    m_of << "PANIC " << e.dst << "\n";
+                    break;
+                TU_ARM(term, If, e)
+                    m_of << "IF " << fmt(e.cond) << " goto " << e.bb0 << " else " << e.bb1 << "\n";
+                    break;
+                TU_ARM(term, Switch, e) {
+                    m_of << "SWITCH " << fmt(e.val) << " { ";
+                    m_of << e.targets;
+                    m_of << " }\n";
+                    } break;
+                TU_ARM(term, SwitchValue, e) {
+                    m_of << "SWITCHVALUE " << fmt(e.val) << " { ";
+                    switch(e.values.tag())
+                    {
+                    case ::MIR::SwitchValues::TAGDEAD:  throw "";
+                    TU_ARM(e.values, String, ve)
+                        for(size_t i = 0; i < ve.size(); i++)
+                        {
+                            m_of << "\"" << FmtEscaped(ve[i]) << "\" = " << e.targets[i] << ",";
+                        }
+                        break;
+                    TU_ARM(e.values, Unsigned, ve)
+                        for(size_t i = 0; i < ve.size(); i++)
+                        {
+                            m_of << ve[i] << " = " << e.targets[i] << ",";
+                        }
+                        break;
+                    TU_ARM(e.values, Signed, ve)
+                        for(size_t i = 0; i < ve.size(); i++)
+                        {
+                            m_of << (ve[i] < 0 ? "" : "+") << ve[i] << " = " << e.targets[i] << ",";
+                        }
+                        break;
+                    }
+                    // TODO: Values.
+                    //if( e.values.size() > 0 )
+                    //{
+                    //    m_of << ", ";
+                    //}
+                    m_of << "_ = " << e.def_target;
+                    m_of << " }\n";
+                    } break;
+                TU_ARM(term, Call, e) {
+                    m_of << "CALL " << fmt(e.ret_val) << " = ";
+                    switch(e.fcn.tag())
+                    {
+                    case ::MIR::CallTarget::TAGDEAD: throw "";
+                    TU_ARM(e.fcn, Intrinsic, f) {
+                        m_of << "\"" << f.name << "\"";
+                        if( f.params.m_types.size() > 0 ) {
+                            m_of << "<";
+                            for(const auto& t : f.params.m_types)
+                                m_of << fmt(t) << ",";
+                            m_of << ">";
+                        }
+                        } break;
+                    TU_ARM(e.fcn, Value, f)     m_of << "(" << fmt(f) << ")";  break;
+                    TU_ARM(e.fcn, Path, f)      m_of << fmt(f);  break;
+                    }
+                    m_of << "(";
+                    for(const auto& a : e.args)
+                    {
+                        m_of << fmt(a) << ", ";
+                    }
+                    m_of << ") goto " << e.ret_block << " else " << e.panic_block << "\n";
+                    } break;
+                }
+                m_of << "\t}\n";
+            }
+
+            m_of << "}\n";
+        }
+        void finish() override
+        {
+            m_of.flush();
+            m_of.close();
+        }
+
+    private:
+        /// Write the variant list of an enum (`@[field path] = { tag values }`)
+        void emit_variants(const ::HIR::Enum& item, const TypeRepr& repr)
+        {
+            auto emit_value = [&](const TypeRepr::FieldPath& path, uint64_t v) {
+                m_of << "\"";
+                for(size_t i = 0; i < path.size; i ++)
+                {
+                    int val = (v >> (i*8)) & 0xFF;
+                    if(val < 16)
+                        m_of << ::std::hex << "\\x0" << val << ::std::dec;
+                    else
+                        m_of << ::std::hex << "\\x" << val << ::std::dec;
+                }
+                m_of << "\"";
+                };
+
+            switch(repr.variants.tag())
+            {
+            case TypeRepr::VariantMode::TAGDEAD:    throw "";
+            TU_ARM(repr.variants, None, _e) {
+                }
+            TU_ARM(repr.variants, Linear, e) {
+                m_of << "\t@[" << e.field.index << ", " << e.field.sub_fields << "] = {\n";
+                for(size_t i = 0; i < e.num_variants; i ++ )
+                {
+                    m_of << "\t\t";
+
+                    if( e.is_niche(i) ) {
+                        m_of << "*";
+                    }
+                    else {
+                        emit_value(e.field, e.offset + i);
+                    }
+                    // - Data field number (optional)
+                    if( !item.is_value() )
+                    {
+                        m_of << " =" << i;
+                    }
+                    m_of << ",\n";
+                }
+                m_of << "\t\t}\n";
+                }
+            TU_ARM(repr.variants, Values, e) {
+                m_of << "\t@[" << e.field.index << ", " << e.field.sub_fields << "] = {\n";
+                for(size_t idx = 0; idx < e.values.size(); idx ++)
+                {
+                    m_of << "\t\t";
+                    // - Tag value
+                    emit_value(e.field, e.values[idx]);
+                    // - Data field number (optional)
+                    if( !item.is_value() )
+                    {
+                        m_of << " =" << idx;
+                    }
+                    m_of << ",\n";
+                }
+                m_of << "\t}\n";
+                }
+            TU_ARM(repr.variants, NonZero, e) {
+                m_of << "\t@[" << e.field.index << ", " << e.field.sub_fields << "] = { ";
+                for(int i = 0; i < 2; i ++)
+                {
+                    if( i == 1 ) {
+                        m_of << ", ";
+                    }
+
+                    if( e.zero_variant == i ) {
+                        m_of << "\"";
+                        for(size_t i = 0; i < e.field.size; i ++)
+                        {
+                            m_of << "\\0";
+                        }
+                        m_of << "\"";
+                    }
+                    else {
+                        m_of << "* =" << i;
+                    }
+                }
+                m_of << " }\n";
+                }
+            }
+        }
+        void emit_str_byte(uint8_t b) {
+            if( b == 0 ) {
+                m_of << "\\0";
+            }
+            else if( b == '\\' ) {
+                m_of << "\\\\";
+            }
+            else if( b == '"' ) {
+                m_of << "\\\"";
+            }
+            else if( ' ' <= b && b <= 'z' && b != '\\' ) {
+                m_of << b;
+            }
+            else if( b < 16 ) {
+                m_of << "\\x0" << ::std::hex << int(b) << ::std::dec;
+            }
+            else {
+                m_of << "\\x" << ::std::hex << int(b) << ::std::dec;
+            }
+        }
+    };
+
+    /// Binary form (`.mir.bin`, see tools/common/mmir_binary.h), loaded in preference to the text form by standalone_miri
+    class MmirBinarySink:
+        public MmirSink
+    {
+        ::std::ofstream m_of_bin;
+        /// Record currently being written
+        ::mmir_binary::Writer   m_bin;
+        /// Strings/types first used by the current record, written out before it
+        ::mmir_binary::Writer   m_bin_defs;
+        ::std::unordered_map<::std::string, unsigned>   m_bin_strings;
+        ::std::map<::HIR::TypeRef, unsigned>    m_bin_types;
+    public:
+        MmirBinarySink(const ::std::string& path):
+            m_of_bin(path, ::std::ios::binary)
+        {
+            m_of_bin.write(::mmir_binary::MAGIC, sizeof(::mmir_binary::MAGIC));
+        }
+
+        void crate(const ::std::string& path) override
+        {
+            m_bin.write_tag(::mmir_binary::Record::Crate);
+            m_bin.write_uv(bin_string(path));
+            bin_flush();
+        }
+        void datatype(const ::std::string& name, const TypeRepr& repr, const ::HIR::TypeRef* dst_meta, const ::HIR::Path* drop_glue, const ::HIR::Enum* item) override
+        {
+            bin_datatype(name, repr, dst_meta, drop_glue);
+            if( item )
+                bin_variants(*item, repr);
+            else
+                m_bin.write_u8(0);
+            bin_flush();
+        }
+        void static_value(const ::std::string& name, const ::HIR::TypeRef& ty, const EncodedLiteral& encoded) override
+        {
+            auto ty_idx = bin_type(ty);
+            m_bin.write_tag(::mmir_binary::Record::Static);
+            m_bin.write_uv(bin_string(name));
+            m_bin.write_uv(ty_idx);
+            m_bin.write_bytes(encoded.bytes.data(), encoded.bytes.size());
+            m_bin.write_uv(encoded.relocations.size());
+            for(const auto& r : encoded.relocations)
+            {
+                m_bin.write_uv(r.ofs);
+                m_bin.write_uv(r.len);
+                if( r.p ) {
+                    m_bin.write_u8(0);
+                    m_bin.write_uv(bin_string_fmt(*r.p));
+                }
+                else {
+                    m_bin.write_u8(1);
+                    m_bin.write_bytes(r.bytes.data(), r.bytes.size());
+                }
+            }
+            bin_flush();
+        }
+        void function(const ::std::string& name, const ::std::vector<::HIR::TypeRef>& args, const ::HIR::TypeRef& ret, const ::std::string& link_name, const ::std::string& abi, const ::MIR::Function* code) override
+        {
+            bin_function(name, args, ret, link_name, abi, code);
+        }
+        void finish() override
+        {
+            m_of_bin.put(static_cast<char>(::mmir_binary::Record::End));
+            m_of_bin.close();
+        }
+
+    private:
+
+        /// Write the current record (preceded by any new string/type definitions) to the binary output
+        void bin_flush()
+        {
+            m_of_bin.write(m_bin_defs.data().data(), m_bin_defs.data().size());
+            m_of_bin.write(m_bin.data().data(), m_bin.data().size());
+            m_bin_defs.clear();
+            m_bin.clear();
+        }
+        unsigned bin_string(const ::std::string& s)
+        {
+            auto it = m_bin_strings.find(s);
+            if( it != m_bin_strings.end() )
+                return it->second;
+            unsigned idx = static_cast<unsigned>(m_bin_strings.size());
+            m_bin_defs.write_tag(::mmir_binary::Record::String);
+            m_bin_defs.write_bytes(s.data(), s.size());
+            m_bin_strings.insert(::std::make_pair(s, idx));
+            return idx;
+        }
+        template<typename T>
+        unsigned bin_string_fmt(const T& v)
+        {
+            return bin_string(FMT(fmt(v)));
+        }
+        static ::mmir_binary::BorrowKind bin_borrow(::HIR::BorrowType bt)
+        {
+            switch(bt)
+            {
+            case ::HIR::BorrowType::Shared: return ::mmir_binary::BorrowKind::Shared;
+            case ::HIR::BorrowType::Unique: return ::mmir_binary::BorrowKind::Unique;
+            case ::HIR::BorrowType::Owned:  return ::mmir_binary::BorrowKind::Move;
+            }
+            throw "";
+        }
+        unsigned bin_type(const ::HIR::TypeRef& ty)
+        {
+            auto it = m_bin_types.find(ty);
+            if( it != m_bin_types.end() )
+                return it->second;
+
+            // Inner types (and strings) are defined first, so the loader can resolve them immediately
+            ::mmir_binary::Writer   w;
+            TU_MATCH_HDRA( (ty.data()), {)
+            TU_ARMA(Infer, te)  BUG(Span(), "" << ty);
+            TU_ARMA(Generic, te)  BUG(Span(), "" << ty);
+            TU_ARMA(ErasedType, te)  BUG(Span(), "" << ty);
+            TU_ARMA(Closure, te)  BUG(Span(), "Unexpected type in trans: " << ty);
+            TU_ARMA(Generator, te)  BUG(Span(), "Unexpected type in trans: " << ty);
+            TU_ARMA(Diverge, te) {
+                w.write_tag(::mmir_binary::TypeKind::Diverge);
+                }
+            TU_ARMA(Primitive, te) {
+                w.write_tag(::mmir_binary::TypeKind::Primitive);
+                w.write_u8(static_cast<uint8_t>(te));
+                }
+            TU_ARMA(Path, te) {
+                w.write_tag(::mmir_binary::TypeKind::Composite);
+                w.write_uv(bin_string(FMT(Trans_Mangle(te.path))));
+                }
+            TU_ARMA(TraitObject, te) {
+                w.write_tag(::mmir_binary::TypeKind::TraitObject);
+                w.write_uv(bin_string(FMT(Trans_Mangle(te.m_trait.m_path))));
+                }
+            TU_ARMA(Array, te) {
+                auto inner = bin_type(te.inner);
+                w.write_tag(::mmir_binary::TypeKind::Array);
+                w.write_uv(te.size.as_Known());
+                w.write_uv(inner);
+                }
+            TU_ARMA(Slice, te) {
+                auto inner = bin_type(te.inner);
+                w.write_tag(::mmir_binary::TypeKind::Slice);
+                w.write_uv(inner);
+                }
+            TU_ARMA(Tuple, te) {
+                if( te.empty() ) {
+                    w.write_tag(::mmir_binary::TypeKind::Unit);
+                }
+                else {
+                    w.write_tag(::mmir_binary::TypeKind::Composite);
+                    w.write_uv(bin_string(FMT(Trans_Mangle(ty))));
+                }
+                }
+            TU_ARMA(Borrow, te) {
+                auto inner = bin_type(te.inner);
+                w.write_tag(::mmir_binary::TypeKind::Borrow);
+                w.write_tag(bin_borrow(te.type));
+                w.write_uv(inner);
+                }
+            TU_ARMA(Pointer, te) {
+                auto inner = bin_type(te.inner);
+                w.write_tag(::mmir_binary::TypeKind::Pointer);
+                w.write_tag(bin_borrow(te.type));
+                w.write_uv(inner);
+                }
+            TU_ARMA(Function, te) {
+                ::std::vector<unsigned> args;
+                for(const auto& t : te.m_arg_types)
+                    args.push_back(bin_type(t));
+                auto ret = bin_type(te.m_rettype);
+                w.write_tag(::mmir_binary::TypeKind::Function);
+                w.write_u8(te.is_unsafe);
+                w.write_uv(bin_string(te.m_abi == "" ? "Rust" : te.m_abi));
+                w.write_uv(args.size());
+                for(auto a : args)
+                    w.write_uv(a);
+                w.write_uv(ret);
+                }
+            }
+
+            unsigned idx = static_cast<unsigned>(m_bin_types.size());
+            m_bin_defs.write_tag(::mmir_binary::Record::Type);
+            m_bin_defs.write_raw(w.data());
+            m_bin_types.insert(::std::make_pair(ty.clone(), idx));
+            return idx;
+        }
+        void bin_lvalue(const ::MIR::LValue& lv)
+        {
+            TU_MATCHA( (lv.m_root), (e),
+            (Return,
+                m_bin.write_tag(::mmir_binary::LValueRoot::Return);
+                ),
+            (Argument,
+                m_bin.write_tag(::mmir_binary::LValueRoot::Argument);
+                m_bin.write_uv(e);
+                ),
+            (Local,
+                m_bin.write_tag(::mmir_binary::LValueRoot::Local);
+                m_bin.write_uv(e);
+                ),
+            (Static,
+                m_bin.write_tag(::mmir_binary::LValueRoot::Static);
+                m_bin.write_uv(bin_string_fmt(e));
+                )
+            )
+            m_bin.write_uv(lv.m_wrappers.size());
+            for(const auto& w : lv.m_wrappers)
+            {
+                switch(w.tag())
+                {
+                case ::MIR::LValue::Wrapper::TAGDEAD:   throw "";
+                TU_ARM(w, Deref, e)
+                    m_bin.write_tag(::mmir_binary::LValueWrapper::Deref);
+                    break;
+                TU_ARM(w, Field, e) {
+                    m_bin.write_tag(::mmir_binary::LValueWrapper::Field);
+                    m_bin.write_uv(e);
+                    } break;
+                TU_ARM(w, Downcast, e) {
+                    m_bin.write_tag(::mmir_binary::LValueWrapper::Downcast);
+                    m_bin.write_uv(e);
+                    } break;
+                TU_ARM(w, Index, e) {
+                    m_bin.write_tag(::mmir_binary::LValueWrapper::Index);
+                    m_bin.write_uv(e);
+                    } break;
+                }
+            }
+        }
+        void bin_constant(const ::MIR::Constant& c)
+        {
+            switch(c.tag())
+            {
+            case ::MIR::Constant::TAGDEAD:  throw "";
+            TU_ARM(c, Int, v) {
+                m_bin.write_tag(::mmir_binary::Constant::Int);
+                m_bin.write_sv(v.v);
+                m_bin.write_u8(static_cast<uint8_t>(v.t));
+                } break;
+            TU_ARM(c, Uint, v) {
+                m_bin.write_tag(::mmir_binary::Constant::Uint);
+                m_bin.write_uv(v.v);
+                m_bin.write_u8(static_cast<uint8_t>(v.t));
+                } break;
+            TU_ARM(c, Float, v) {
+                uint64_t    bits;
+                ::std::memcpy(&bits, &v.v, sizeof(double));
+                m_bin.write_tag(::mmir_binary::Constant::Float);
+                m_bin.write_raw64(bits);
+                m_bin.write_u8(static_cast<uint8_t>(v.t));
+                } break;
+            TU_ARM(c, Bool, v) {
+                m_bin.write_tag(::mmir_binary::Constant::Bool);
+                m_bin.write_u8(v.v);
+                } break;
+            TU_ARM(c, Bytes, v) {
+                m_bin.write_tag(::mmir_binary::Constant::Bytes);
+                m_bin.write_bytes(v.data(), v.size());
+                } break;
+            TU_ARM(c, StaticString, v) {
+                m_bin.write_tag(::mmir_binary::Constant::StaticString);
+                m_bin.write_bytes(v.data(), v.size());
+                } break;
+            TU_ARM(c, ItemAddr, v) {
+                m_bin.write_tag(::mmir_binary::Constant::ItemAddr);
+                m_bin.write_uv(bin_string_fmt(*v));
+                } break;
+            TU_ARM(c, Const, v) {
+                BUG(Span(), "Stray named constant in MIR after cleanup - " << c);
+                } break;
+            TU_ARM(c, Generic, v) {
+                BUG(Span(), "Generic constant in MIR after monomorphisation - " << c);
+                } break;
+            }
+        }
+        void bin_param(const ::MIR::Param& p)
+        {
+            switch(p.tag())
+            {
+            case ::MIR::Param::TAGDEAD: throw "";
+            TU_ARM(p, LValue, e) {
+                m_bin.write_tag(::mmir_binary::Param::LValue);
+                bin_lvalue(e);
+                } break;
+            TU_ARM(p, Borrow, e) {
+                m_bin.write_tag(::mmir_binary::Param::Borrow);
+                m_bin.write_tag(bin_borrow(e.type));
+                bin_lvalue(e.val);
+                } break;
+            TU_ARM(p, Constant, e) {
+                m_bin.write_tag(::mmir_binary::Param::Constant);
+                bin_constant(e);
+                } break;
+            }
+        }
+        void bin_params(const ::std::vector<::MIR::Param>& vals)
+        {
+            m_bin.write_uv(vals.size());
+            for(const auto& v : vals)
+                bin_param(v);
+        }
+        void bin_rvalue(const ::MIR::RValue& rv)
+        {
+            switch(rv.tag())
+            {
+            case ::MIR::RValue::TAGDEAD:    throw "";
+            TU_ARM(rv, Use, e) {
+                m_bin.write_tag(::mmir_binary::RValue::Use);
+                bin_lvalue(e);
+                } break;
+            TU_ARM(rv, Constant, e) {
+                m_bin.write_tag(::mmir_binary::RValue::Constant);
+                bin_constant(e);
+                } break;
+            TU_ARM(rv, SizedArray, e) {
+                m_bin.write_tag(::mmir_binary::RValue::SizedArray);
+                bin_param(e.val);
+                m_bin.write_uv(e.count);
+                } break;
+            TU_ARM(rv, Borrow, e) {
+                m_bin.write_tag(::mmir_binary::RValue::Borrow);
+                m_bin.write_tag(bin_borrow(e.type));
+                bin_lvalue(e.val);
+                } break;
+            TU_ARM(rv, Cast, e) {
+                auto ty = bin_type(e.type);
+                m_bin.write_tag(::mmir_binary::RValue::Cast);
+                bin_lvalue(e.val);
+                m_bin.write_uv(ty);
+                } break;
+            TU_ARM(rv, BinOp, e) {
+                m_bin.write_tag(::mmir_binary::RValue::BinOp);
+                bin_param(e.val_l);
+                m_bin.write_u8(static_cast<uint8_t>(e.op));
+                bin_param(e.val_r);
+                } break;
+            TU_ARM(rv, UniOp, e) {
+                m_bin.write_tag(::mmir_binary::RValue::UniOp);
+                bin_lvalue(e.val);
+                m_bin.write_u8(static_cast<uint8_t>(e.op));
+                } break;
+            TU_ARM(rv, DstMeta, e) {
+                m_bin.write_tag(::mmir_binary::RValue::DstMeta);
+                bin_lvalue(e.val);
+                } break;
+            TU_ARM(rv, DstPtr, e) {
+                m_bin.write_tag(::mmir_binary::RValue::DstPtr);
+                bin_lvalue(e.val);
+                } break;
+            TU_ARM(rv, MakeDst, e) {
+                m_bin.write_tag(::mmir_binary::RValue::MakeDst);
+                bin_param(e.ptr_val);
+                bin_param(e.meta_val);
+                } break;
+            TU_ARM(rv, Tuple, e) {
+                m_bin.write_tag(::mmir_binary::RValue::Tuple);
+                bin_params(e.vals);
+                } break;
+            TU_ARM(rv, Array, e) {
+                m_bin.write_tag(::mmir_binary::RValue::Array);
+                bin_params(e.vals);
+                } break;
+            TU_ARM(rv, UnionVariant, e) {
+                m_bin.write_tag(::mmir_binary::RValue::UnionVariant);
+                m_bin.write_uv(bin_string_fmt(e.path));
+                m_bin.write_uv(e.index);
+                bin_param(e.val);
+                } break;
+            TU_ARM(rv, EnumVariant, e) {
+                m_bin.write_tag(::mmir_binary::RValue::EnumVariant);
+                m_bin.write_uv(bin_string_fmt(e.path));
+                m_bin.write_uv(e.index);
+                bin_params(e.vals);
+                } break;
+            TU_ARM(rv, Struct, e) {
+                m_bin.write_tag(::mmir_binary::RValue::Struct);
+                m_bin.write_uv(bin_string_fmt(e.path));
+                bin_params(e.vals);
+                } break;
+            }
+        }
+        void bin_strings(const ::std::vector<::std::string>& vals)
+        {
+            m_bin.write_uv(vals.size());
+            for(const auto& v : vals)
+                m_bin.write_uv(bin_string(v));
+        }
+        void bin_statement(const ::MIR::Statement& stmt)
+        {
+            switch(stmt.tag())
+            {
+            case ::MIR::Statement::TAGDEAD: throw "";
+            TU_ARM(stmt, Assign, se) {
+                m_bin.write_tag(::mmir_binary::Statement::Assign);
+                bin_lvalue(se.dst);
+                bin_rvalue(se.src);
+                } break;
+            TU_ARM(stmt, SetDropFlag, se) {
+                m_bin.write_tag(::mmir_binary::Statement::SetDropFlag);
+                m_bin.write_uv(se.idx);
+                m_bin.write_u8(se.new_val);
+                m_bin.write_uv(se.other + 1u);
+                } break;
+            TU_ARM(stmt, Drop, se) {
+                m_bin.write_tag(::mmir_binary::Statement::Drop);
+                m_bin.write_u8(static_cast<uint8_t>(se.kind));
+                bin_lvalue(se.slot);
+                m_bin.write_uv(se.flag_idx + 1u);
+                } break;
+            TU_ARM(stmt, Asm, se) {
+                m_bin.write_tag(::mmir_binary::Statement::Asm);
+                m_bin.write_uv(bin_string(se.tpl));
+                for(const auto* list : { &se.outputs, &se.inputs })
+                {
+                    m_bin.write_uv(list->size());
+                    for(const auto& v : *list)
+                    {
+                        m_bin.write_uv(bin_string(v.first));
+                        bin_lvalue(v.second);
+                    }
+                }
+                bin_strings(se.clobbers);
+                bin_strings(se.flags);
+                } break;
+            TU_ARM(stmt, ScopeEnd, se) {
+                (void)se;
+                BUG(Span(), "ScopeEnd should have been skipped");
+                } break;
+            }
+        }
+        void bin_terminator(const ::MIR::Terminator& term)
+        {
+            switch(term.tag())
+            {
+            case ::MIR::Terminator::TAGDEAD: throw "";
+            TU_ARM(term, Incomplete, _e) (void)_e;
+                m_bin.write_tag(::mmir_binary::Terminator::Incomplete);
+                break;
+            TU_ARM(term, Return, _e) (void)_e;
+                m_bin.write_tag(::mmir_binary::Terminator::Return);
+                break;
+            TU_ARM(term, Diverge, _e) (void)_e;
+                m_bin.write_tag(::mmir_binary::Terminator::Diverge);
+                break;
+            TU_ARM(term, Goto, e) {
+                m_bin.write_tag(::mmir_binary::Terminator::Goto);
+                m_bin.write_uv(e);
+                } break;
+            TU_ARM(term, Panic, e) {
+                m_bin.write_tag(::mmir_binary::Terminator::Panic);
+                m_bin.write_uv(e.dst);
+                } break;
+            TU_ARM(term, If, e) {
+                m_bin.write_tag(::mmir_binary::Terminator::If);
+                bin_lvalue(e.cond);
+                m_bin.write_uv(e.bb0);
+                m_bin.write_uv(e.bb1);
+                } break;
+            TU_ARM(term, Switch, e) {
+                m_bin.write_tag(::mmir_binary::Terminator::Switch);
+                bin_lvalue(e.val);
+                m_bin.write_uv(e.targets.size());
+                for(auto t : e.targets)
+                    m_bin.write_uv(t);
+                } break;
+            TU_ARM(term, SwitchValue, e) {
+                m_bin.write_tag(::mmir_binary::Terminator::SwitchValue);
+                bin_lvalue(e.val);
+                m_bin.write_u8(static_cast<uint8_t>(e.values.tag()) - static_cast<uint8_t>(::MIR::SwitchValues::TAG_Unsigned));
+                m_bin.write_uv(e.targets.size());
+                for(size_t i = 0; i < e.targets.size(); i ++)
+                {
+                    switch(e.values.tag())
+                    {
+                    case ::MIR::SwitchValues::TAGDEAD:  throw "";
+                    TU_ARM(e.values, Unsigned, ve)
+                        m_bin.write_uv(ve[i]);
+                        break;
+                    TU_ARM(e.values, Signed, ve)
+                        m_bin.write_sv(ve[i]);
+                        break;
+                    TU_ARM(e.values, String, ve)
+                        m_bin.write_bytes(ve[i].data(), ve[i].size());
+                        break;
+                    }
+                    m_bin.write_uv(e.targets[i]);
+                }
+                m_bin.write_uv(e.def_target);
+                } break;
+            TU_ARM(term, Call, e) {
+                ::std::vector<unsigned> param_tys;
+                if( const auto* f = e.fcn.opt_Intrinsic() )
+                {
+                    for(const auto& t : f->params.m_types)
+                        param_tys.push_back(bin_type(t));
+                }
+                m_bin.write_tag(::mmir_binary::Terminator::Call);
+                switch(e.fcn.tag())
+                {
+                case ::MIR::CallTarget::TAGDEAD: throw "";
+                TU_ARM(e.fcn, Value, f) {
+                    m_bin.write_u8(0);
+                    bin_lvalue(f);
+                    } break;
+                TU_ARM(e.fcn, Path, f) {
+                    m_bin.write_u8(1);
+                    m_bin.write_uv(bin_string_fmt(f));
+                    } break;
+                TU_ARM(e.fcn, Intrinsic, f) {
+                    m_bin.write_u8(2);
+                    m_bin.write_uv(bin_string(f.name.c_str()));
+                    m_bin.write_uv(param_tys.size());
+                    for(auto t : param_tys)
+                        m_bin.write_uv(t);
+                    } break;
+                }
+                bin_params(e.args);
+                m_bin.write_uv(e.ret_block);
+                m_bin.write_uv(e.panic_block);
+                bin_lvalue(e.ret_val);
+                } break;
+            }
+        }
+        /// Emit a function record, `code` is null for external functions
+        void bin_function(const ::std::string& name, const ::std::vector<::HIR::TypeRef>& args, const ::HIR::TypeRef& ret, const ::std::string& link_name, const ::std::string& abi, const ::MIR::Function* code)
+        {
+            ::std::vector<unsigned> arg_tys;
+            for(const auto& t : args)
+                arg_tys.push_back(bin_type(t));
+            auto ret_ty = bin_type(ret);
+            ::std::vector<unsigned> local_tys;
+            if( code )
+            {
+                for(const auto& t : code->locals)
+                    local_tys.push_back(bin_type(t));
+            }
+
+            m_bin.write_tag(::mmir_binary::Record::Function);
+            m_bin.write_uv(bin_string(name));
+            m_bin.write_uv(arg_tys.size());
+            for(auto t : arg_tys)
+                m_bin.write_uv(t);
+            m_bin.write_uv(ret_ty);
+            m_bin.write_uv(bin_string(link_name));
+            m_bin.write_uv(bin_string(abi));
+            m_bin.write_u8(code != nullptr);
+            if( code )
+            {
+                m_bin.write_uv(local_tys.size());
+                for(auto t : local_tys)
+                    m_bin.write_uv(t);
+                m_bin.write_uv(code->drop_flags.size());
+                for(bool v : code->drop_flags)
+                    m_bin.write_u8(v);
+                m_bin.write_uv(code->blocks.size());
+                for(const auto& bb : code->blocks)
+                {
+                    m_bin.write_uv(::std::count_if(bb.statements.begin(), bb.statements.end(), [](const ::MIR::Statement& s){ return !s.is_ScopeEnd(); }));
+                    for(const auto& stmt : bb.statements)
+                    {
+                        if( !stmt.is_ScopeEnd() )
+                            bin_statement(stmt);
+                    }
+                    bin_terminator(bb.terminator);
+                }
+            }
+            bin_flush();
+        }
+        /// Emit a type record for a struct/union/enum/tuple
+        void bin_datatype(const ::std::string& name, const TypeRepr& repr, const ::HIR::TypeRef* dst_meta, const ::HIR::Path* drop_glue)
+        {
+            auto dst_meta_ty = dst_meta ? bin_type(*dst_meta) : 0;
+            ::std::vector<unsigned> field_tys;
+            for(const auto& e : repr.fields)
+                field_tys.push_back(bin_type(e.ty));
+
+            m_bin.write_tag(::mmir_binary::Record::DataType);
+            m_bin.write_uv(bin_string(name));
+            m_bin.write_uv(repr.size);
+            m_bin.write_uv(repr.align);
+            m_bin.write_u8( (drop_glue ? 1 : 0) | (dst_meta ? 2 : 0) );
+            if( drop_glue )
+                m_bin.write_uv(bin_string_fmt(*drop_glue));
+            if( dst_meta )
+                m_bin.write_uv(dst_meta_ty);
+            m_bin.write_uv(repr.fields.size());
+            for(size_t i = 0; i < repr.fields.size(); i ++)
+            {
+                m_bin.write_uv(repr.fields[i].offset);
+                m_bin.write_uv(field_tys[i]);
+            }
+        }
+        /// Write the variant list of an enum (same content as the text `@[...] = { ... }` block)
+        void bin_variants(const ::HIR::Enum& item, const TypeRepr& repr)
+        {
+            auto write_path = [&](const TypeRepr::FieldPath& path) {
+                m_bin.write_u8(1);
+                m_bin.write_uv(path.index);
+                m_bin.write_uv(path.sub_fields.size());
+                for(auto i : path.sub_fields)
+                    m_bin.write_uv(i);
+                };
+            auto write_variant = [&](const TypeRepr::FieldPath* path, uint64_t v, size_t data_field) {
+                if( path ) {
+                    char    buf[sizeof(uint64_t)];
+                    for(size_t i = 0; i < path->size; i ++)
+                        buf[i] = static_cast<char>(v >> (i*8));
+                    m_bin.write_u8(1);
+                    m_bin.write_bytes(buf, path->size);
+                }
+                else {
+                    m_bin.write_u8(0);
+                }
+                m_bin.write_uv(data_field + 1);
+                };
+            switch(repr.variants.tag())
+            {
+            case TypeRepr::VariantMode::TAGDEAD:    throw "";
+            TU_ARM(repr.variants, None, _e) {
+                m_bin.write_u8(0);
+                }
+            TU_ARM(repr.variants, Linear, e) {
+                write_path(e.field);
+                m_bin.write_uv(e.num_variants);
+                for(size_t i = 0; i < e.num_variants; i ++)
+                {
+                    write_variant(e.is_niche(i) ? nullptr : &e.field, e.offset + i, item.is_value() ? SIZE_MAX : i);
+                }
+                }
+            TU_ARM(repr.variants, Values, e) {
+                write_path(e.field);
+                m_bin.write_uv(e.values.size());
+                for(size_t idx = 0; idx < e.values.size(); idx ++)
+                {
+                    write_variant(&e.field, e.values[idx], item.is_value() ? SIZE_MAX : idx);
+                }
+                }
+            TU_ARM(repr.variants, NonZero, e) {
+                write_path(e.field);
+                m_bin.write_uv(2);
+                for(unsigned i = 0; i < 2; i ++)
+                {
+                    if( e.zero_variant == i )
+                        write_variant(&e.field, 0, SIZE_MAX);
+                    else
+                        write_variant(nullptr, 0, i);
+                }
+                }
+            }
+        }
+    };
+
+    class CodeGenerator_MonoMir:
+        public CodeGenerator
+    {
+        enum class MetadataType {
+            None,
+            Slice,
+            TraitObject,
+        };
+
+        static Span sp;
+
+        const ::HIR::Crate& m_crate;
+        ::StaticTraitResolve    m_resolve;
+
+
+        ::std::string   m_outfile_path;
+        const ::MIR::TypeResolve* m_mir_res;
+
+        /// Output formats, each record is passed to all of these
+        ::std::vector<::std::unique_ptr<MmirSink>>  m_sinks;
+
+    public:
+        CodeGenerator_MonoMir(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt):
+            m_crate(crate),
+            m_resolve(crate),
+            m_outfile_path(outfile)
+        {
+            m_sinks.push_back(::std::make_unique<MmirTextSink>(m_outfile_path + ".mir"));
+            if( opt.emit_mmir_binary )
+            {
+                m_sinks.push_back(::std::make_unique<MmirBinarySink>(m_outfile_path + ".mir.bin"));
+            }
+            else
+            {
+                // Remove any binary form from an earlier build, standalone_miri would load it instead of the new text
+                ::std::remove((m_outfile_path + ".mir.bin").c_str());
+            }
+            for( const auto& crate : m_crate.m_ext_crates )
+            {
+                auto path = FMT(crate.second.m_path << ".mir");
+                for(auto& s : m_sinks)
+                    s->crate(path);
+            }
+        }
+
+        void finalise(const TransOptions& opt, CodegenOutput out_ty, const ::std::string& hir_file) override
+        {
+            if( out_ty == CodegenOutput::Executable )
+            {
+                {
+                    auto c_start_path = m_resolve.m_crate.get_lang_item_path_opt("mrustc-start");
+                    ::MIR::Function code;
+                    ::std::vector<::MIR::Param> args;
+                    ::HIR::Path start_path = ::HIR::GenericPath(c_start_path);
+                    if( c_start_path == ::HIR::SimplePath() )
+                    {
+                        ::HIR::TypeData::Data_Function  ft;
+                        ft.is_unsafe = false;
+                        ft.m_rettype = ::HIR::TypeRef::new_unit();
+                        code.locals.push_back(::HIR::TypeRef(mv$(ft)));
+                        auto main_path = ::HIR::Path(::HIR::GenericPath(m_resolve.m_crate.get_lang_item_path(Span(), "mrustc-main")));
+                        code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Incomplete({}) });
+                        code.blocks[0].statements.push_back(::MIR::Statement::make_Assign({
+                            ::MIR::LValue::new_Local(0), ::MIR::Constant::make_ItemAddr(box$(main_path))
+                            }));
+                        args.push_back(::MIR::LValue::new_Local(0));
+                        start_path = ::HIR::GenericPath(m_resolve.m_crate.get_lang_item_path(Span(), "start"));
+                    }
+                    else
+                    {
+                        code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Incomplete({}) });
+                    }
+                    args.push_back(::MIR::LValue::new_Argument(0));
+                    args.push_back(::MIR::LValue::new_Argument(1));
+                    code.blocks[0].terminator = ::MIR::Terminator::make_Call({ 1, 1, ::MIR::LValue::new_Return(), mv$(start_path), mv$(args) });
+                    code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Return({}) });
+
+                    ::std::vector<::HIR::TypeRef>   arg_tys;
+                    arg_tys.push_back(::HIR::CoreType::Isize);
+                    arg_tys.push_back(::HIR::TypeRef::new_pointer(::HIR::BorrowType::Shared, ::HIR::TypeRef::new_pointer(::HIR::BorrowType::Shared, ::HIR::CoreType::I8)));
+                    for(auto& s : m_sinks)
+                        s->function("main#", arg_tys, ::HIR::CoreType::Isize, "", "", &code);
+                }
+
+                if(TARGETVER_LEAST_1_29)
+                {
+                    // Bind `panic_impl` lang item to the item tagged with `panic_implementation`
+                    const auto& panic_impl_path = m_crate.get_lang_item_path(Span(), "mrustc-panic_implementation");
+                    ::MIR::Function code;
+                    ::std::vector<::MIR::Param> args;
+                    args.push_back(::MIR::LValue::new_Argument(0));
+                    code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Call({ 1, 2, ::MIR::LValue::new_Return(), ::HIR::Path(::HIR::GenericPath(panic_impl_path)), mv$(args) }) });
+                    code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Return({}) });
+                    code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Diverge({}) });
+                    ::std::vector<::HIR::TypeRef>   arg_tys;
+                    arg_tys.push_back(::HIR::CoreType::Usize);
+                    for(auto& s : m_sinks)
+                        s->function("panic_impl#", arg_tys, ::HIR::CoreType::U32, "panic_impl", "Rust", &code);
+
+                    // TODO: OOM impl?
+                }
+            }
+
+            for(auto& s : m_sinks)
+                s->finish();
+
+            // HACK! Create the output file, but keep it empty
+            {
+                ::std::ofstream of( m_outfile_path );
+                if( !of.good() )
+                {
+                    // TODO: Error?
+                }
+            }
+        }
+
+
+        void emit_type(const ::HIR::TypeRef& ty) override
+        {
+            TRACE_FUNCTION_F(ty);
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "type " << ty;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+
+            if( const auto* te = ty.data().opt_Tuple() )
+            {
+                if( te->size() > 0 )
+                {
+                    const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
+                    MIR_ASSERT(*m_mir_res, repr, "No repr for tuple " << ty);
+
+                    bool has_drop_glue =  m_resolve.type_needs_drop_glue(sp, ty);
+                    auto drop_glue_path = ::HIR::Path(ty.clone(), "#drop_glue");
+
+                    auto name = FMT(fmt(ty));
+                    for(auto& s : m_sinks)
+                        s->datatype(name, *repr, nullptr, has_drop_glue ? &drop_glue_path : nullptr, nullptr);
+                }
+            }
+            else {
+            }
+
+            m_mir_res = nullptr;
+        }
+
+        // TODO: Move this to a more common location
+        MetadataType metadata_type(const ::HIR::TypeRef& ty) const
+        {
+            if( ty == ::HIR::CoreType::Str || ty.data().is_Slice() ) {
+                return MetadataType::Slice;
+            }
+            else if( ty.data().is_TraitObject() ) {
+                return MetadataType::TraitObject;
+            }
+            else if( ty.data().is_Path() )
+            {
+                const auto& te = ty.data().as_Path();
+                switch( te.binding.tag() )
+                {
+                TU_ARM(te.binding, Struct, tpb) {
+                    switch( tpb->m_struct_markings.dst_type )
+                    {
+                    case ::HIR::StructMarkings::DstType::None:
+                        return MetadataType::None;
+                    case ::HIR::StructMarkings::DstType::Possible: {
+                        // TODO: How to figure out? Lazy way is to check the monomorpised type of the last field (structs only)
+                        const auto& path = ty.data().as_Path().path.m_data.as_Generic();
+                        const auto& str = *ty.data().as_Path().binding.as_Struct();
+                        auto monomorph = [&](const auto& tpl) {
+                            return m_resolve.monomorph_expand(sp, tpl, MonomorphStatePtr(nullptr, &path.m_params, nullptr));
+                        };
+                        TU_MATCHA( (str.m_data), (se),
+                        (Unit,  MIR_BUG(*m_mir_res, "Unit-like struct with DstType::Possible"); ),
+                        (Tuple, return metadata_type( monomorph(se.back().ent) ); ),
+                        (Named, return metadata_type( monomorph(se.back().second.ent) ); )
+                        )
+                        //MIR_TODO(*m_mir_res, "Determine DST type when ::Possible - " << ty);
+                        return MetadataType::None;
+                    }
+                    case ::HIR::StructMarkings::DstType::Slice:
+                        return MetadataType::Slice;
+                    case ::HIR::StructMarkings::DstType::TraitObject:
+                        return MetadataType::TraitObject;
+                    }
+                    throw "";
+                    } break;
+                TU_ARM(te.binding, Union, tpb)
+                    return MetadataType::None;
+                TU_ARM(te.binding, Enum, tpb)
+                    return MetadataType::None;
+                default:
+                    MIR_BUG(*m_mir_res, "Unbound/opaque path in trans - " << ty);
                 }
+                throw "";
+            }
+            else {
+                return MetadataType::None;
+            }
+        }
 
-                mir_res.set_cur_stmt_term(i);
-                const auto& term = code->blocks[i].terminator;
-                DEBUG("- " << term);
-                m_of << "\t\t";
-                switch(term.tag())
+        void emit_struct(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Struct& item) override
+        {
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "struct " << p;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+
+            auto drop_glue_path = ::HIR::Path(::HIR::TypeRef::new_path(p.clone(), &item), "#drop_glue");
+
+            TRACE_FUNCTION_F(p);
+            ::HIR::TypeRef  ty = ::HIR::TypeRef::new_path(p.clone(), &item);
+
+            struct H {
+                static ::HIR::TypeRef get_metadata_type(const Span& sp, const ::StaticTraitResolve& resolve, const TypeRepr& r)
                 {
-                case ::MIR::Terminator::TAGDEAD: throw "";
-                TU_ARM(term, Incomplete, _e) (void)_e;
-                    m_of << "INCOMPLETE\n";
-                    break;
-                TU_ARM(term, Return, _e) (void)_e;
-                    m_of << "RETURN\n";
-                    break;
-                TU_ARM(term, Diverge, _e) (void)_e;
-                    m_of << "DIVERGE\n";
-                    break;
-                TU_ARM(term, Goto, e)
-                    m_of << "GOTO " << e << "\n";
-                    break;
-                TU_ARM(term, Panic, e)
-                    m_of << "PANIC " << e.dst << "\n";
-                    break;
-                TU_ARM(term, If, e)
-                    m_of << "IF " << fmt(e.cond) << " goto " << e.bb0 << " else " << e.bb1 << "\n";
-                    break;
-                TU_ARM(term, Switch, e) {
-                    m_of << "SWITCH " << fmt(e.val) << " { ";
-                    m_of << e.targets;
-                    m_of << " }\n";
-                    } break;
-                TU_ARM(term, SwitchValue, e) {
-                    m_of << "SWITCHVALUE " << fmt(e.val) << " { ";
-                    switch(e.values.tag())
-                    {
-                    case ::MIR::SwitchValues::TAGDEAD:  throw "";
-                    TU_ARM(e.values, String, ve)
-                        for(size_t i = 0; i < ve.size(); i++)
-                        {
-                            m_of << "\"" << FmtEscaped(ve[i]) << "\" = " << e.targets[i] << ",";
-                        }
-                        break;
-                    TU_ARM(e.values, Unsigned, ve)
-                        for(size_t i = 0; i < ve.size(); i++)
-                        {
-                            m_of << ve[i] << " = " << e.targets[i] << ",";
-                        }
-                        break;
-                    TU_ARM(e.values, Signed, ve)
-                        for(size_t i = 0; i < ve.size(); i++)
-                        {
-                            m_of << (ve[i] < 0 ? "" : "+") << ve[i] << " = " << e.targets[i] << ",";
-                        }
-                        break;
+                    ASSERT_BUG(sp, r.fields.size() > 0, "");
+                    auto& t = r.fields.back().ty;
+                    if( t == ::HIR::CoreType::Str ) {
+                        return ::HIR::CoreType::Usize;
                     }
-                    // TODO: Values.
-                    //if( e.values.size() > 0 )
-                    //{
-                    //    m_of << ", ";
-                    //}
-                    m_of << "_ = " << e.def_target;
-                    m_of << " }\n";
-                    } break;
-                TU_ARM(term, Call, e) {
-                    m_of << "CALL " << fmt(e.ret_val) << " = ";
-                    switch(e.fcn.tag())
-                    {
-                    case ::MIR::CallTarget::TAGDEAD: throw "";
-                    TU_ARM(e.fcn, Intrinsic, f) {
-                        m_of << "\"" << f.name << "\"";
-                        if( f.params.m_types.size() > 0 ) {
-                            m_of << "<";
-                            for(const auto& t : f.params.m_types)
-                                m_of << fmt(t) << ",";
-                            m_of << ">";
-                        }
-                        } break;
-                    TU_ARM(e.fcn, Value, f)     m_of << "(" << fmt(f) << ")";  break;
-                    TU_ARM(e.fcn, Path, f)      m_of << fmt(f);  break;
+                    else if( t.data().is_Slice() ) {
+                        return ::HIR::CoreType::Usize;
                     }
-                    m_of << "(";
-                    for(const auto& a : e.args)
-                    {
-                        m_of << fmt(a) << ", ";
+                    else if( t.data().is_TraitObject() ) {
+                        const auto& te = t.data().as_TraitObject();
+                        //auto vtp = t.m_data.as_TraitObject().m_trait.m_path;
+
+                        const auto& trait = resolve.m_crate.get_trait_by_path(sp, te.m_trait.m_path.m_path);
+                        auto vtable_ty = trait.get_vtable_type(sp, resolve.m_crate, te);
+                        return ::HIR::TypeRef::new_pointer(::HIR::BorrowType::Shared, std::move(vtable_ty));
+                    }
+                    else if( t.data().is_Path() ) {
+                        auto* repr = Target_GetTypeRepr(sp, resolve, t);
+                        ASSERT_BUG(sp, repr, "No repr for " << t);
+                        return get_metadata_type(sp, resolve, *repr);
+                    }
+                    else {
+                        BUG(sp, "Unexpected type in get_metadata_type - " << t);
                     }
-                    m_of << ") goto " << e.ret_block << " else " << e.panic_block << "\n";
-                    } break;
                 }
-                m_of << "\t}\n";
+            };
+
+
+            // Generate the drop glue (and determine if there is any)
+            bool has_drop_glue = m_resolve.type_needs_drop_glue(sp, ty);
+
+            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
+            MIR_ASSERT(*m_mir_res, repr, "No repr for struct " << ty);
+            ::HIR::TypeRef  dst_meta;
+            if( repr->size == SIZE_MAX )
+            {
+                dst_meta = H::get_metadata_type(sp, m_resolve, *repr);
             }
 
-            m_of << "}\n";
+            auto name = FMT(Trans_Mangle(p));
+            for(auto& s : m_sinks)
+                s->datatype(name, *repr, repr->size == SIZE_MAX ? &dst_meta : nullptr, has_drop_glue ? &drop_glue_path : nullptr, nullptr);
+
+            m_mir_res = nullptr;
+        }
+        void emit_constructor_enum(const Span& sp, const ::HIR::GenericPath& var_path, const ::HIR::Enum& item, size_t var_idx) override
+        {
+            TRACE_FUNCTION_F(var_path);
+
+            ::HIR::TypeRef  tmp;
+            MonomorphStatePtr   ms(nullptr, &var_path.m_params, nullptr);
+            auto monomorph = [&](const auto& x)->const auto& { return m_resolve.monomorph_expand_opt(sp, tmp, x, ms); };
+
+            auto enum_path = var_path.clone();
+            enum_path.m_path.m_components.pop_back();
+
+            // Create constructor function
+            const auto& var_ty = item.m_data.as_Data().at(var_idx).type;
+            const auto& e = var_ty.data().as_Path().binding.as_Struct()->m_data.as_Tuple();
+
+            ::std::vector<::HIR::TypeRef>   arg_tys;
+            ::std::vector<::MIR::Param> vals;
+            for(unsigned int i = 0; i < e.size(); i ++)
+            {
+                arg_tys.push_back(monomorph(e[i].ent).clone());
+                vals.push_back(::MIR::LValue::new_Argument(i));
+            }
+            ::MIR::Function code;
+            code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Return({}) });
+            code.blocks[0].statements.push_back(::MIR::Statement::make_Assign({
+                ::MIR::LValue::new_Return(), ::MIR::RValue::make_EnumVariant({ enum_path.clone(), static_cast<unsigned>(var_idx), mv$(vals) })
+                }));
+            auto ret_ty = ::HIR::TypeRef::new_path(mv$(enum_path), &item);
+            auto name = FMT(fmt(var_path));
+            for(auto& s : m_sinks)
+                s->function(name, arg_tys, ret_ty, "", "", &code);
+        }
+        void emit_constructor_struct(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Struct& item) override
+        {
+            TRACE_FUNCTION_F(p);
+            ::HIR::TypeRef  tmp;
+            MonomorphStatePtr   ms(nullptr, &p.m_params, nullptr);
+            auto monomorph = [&](const auto& x)->const auto& { return m_resolve.monomorph_expand_opt(sp, tmp, x, ms); };
+            // Create constructor function
+            const auto& e = item.m_data.as_Tuple();
+
+            ::std::vector<::HIR::TypeRef>   arg_tys;
+            ::std::vector<::MIR::Param> vals;
+            for(unsigned int i = 0; i < e.size(); i ++)
+            {
+                arg_tys.push_back(monomorph(e[i].ent).clone());
+                vals.push_back(::MIR::LValue::new_Argument(i));
+            }
+            ::MIR::Function code;
+            code.blocks.push_back(::MIR::BasicBlock { {}, ::MIR::Terminator::make_Return({}) });
+            code.blocks[0].statements.push_back(::MIR::Statement::make_Assign({
+                ::MIR::LValue::new_Return(), ::MIR::RValue::make_Struct({ p.clone(), mv$(vals) })
+                }));
+            auto ret_ty = ::HIR::TypeRef::new_path(p.clone(), &item);
+            auto name = FMT(fmt(p));
+            for(auto& s : m_sinks)
+                s->function(name, arg_tys, ret_ty, "", "", &code);
+        }
+        void emit_union(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Union& item) override
+        {
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "union " << p;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+
+            TRACE_FUNCTION_F(p);
+            ::HIR::TypeRef  ty = ::HIR::TypeRef::new_path(p.clone(), &item);
+
+            bool has_drop_glue = m_resolve.type_needs_drop_glue(sp, ty);
+            auto drop_glue_path = ::HIR::Path(ty.clone(), "#drop_glue");
+
+            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
+            MIR_ASSERT(*m_mir_res, repr, "No repr for union " << ty);
 
+            auto name = FMT(fmt(p));
+            for(auto& s : m_sinks)
+                s->datatype(name, *repr, nullptr, has_drop_glue ? &drop_glue_path : nullptr, nullptr);
 
             m_mir_res = nullptr;
         }
 
+        void emit_enum(const Span& sp, const ::HIR::GenericPath& p, const ::HIR::Enum& item) override
+        {
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "enum " << p;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+
+
+            TRACE_FUNCTION_F(p);
+            ::HIR::TypeRef  ty = ::HIR::TypeRef::new_path(p.clone(), &item);
+
+            // Generate the drop glue (and determine if there is any)
+            bool has_drop_glue = m_resolve.type_needs_drop_glue(sp, ty);
+            auto drop_glue_path = ::HIR::Path(ty.clone(), "#drop_glue");
+
+            const auto* repr = Target_GetTypeRepr(sp, m_resolve, ty);
+            MIR_ASSERT(*m_mir_res, repr, "No repr for enum " << ty);
+
+            auto name = FMT(fmt(p));
+            for(auto& s : m_sinks)
+                s->datatype(name, *repr, nullptr, has_drop_glue ? &drop_glue_path : nullptr, &item);
+
+            m_mir_res = nullptr;
+        }
+
+        void emit_static_local(const ::HIR::Path& p, const ::HIR::Static& item, const Trans_Params& params) override
+        {
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "static " << p;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+
+            TRACE_FUNCTION_F(p);
+
+            auto type = params.monomorph(m_resolve, item.m_type);
+
+            auto name = FMT(fmt(p));
+            for(auto& s : m_sinks)
+                s->static_value(name, type, item.m_value_res);
+
+            m_mir_res = nullptr;
+        }
+
+        void emit_function_ext(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params) override
+        {
+            ::MIR::Function empty_fcn;
+            ::MIR::TypeResolve  top_mir_res { sp, m_resolve, FMT_CB(ss, ss << "extern fn " << p;), ::HIR::TypeRef(), {}, empty_fcn };
+            m_mir_res = &top_mir_res;
+            TRACE_FUNCTION_F(p);
+
+            // If the function is a C external, emit as such
+            if( item.m_linkage.name != "" )
+            {
+                ::HIR::TypeRef  ret_type_tmp;
+                const auto& ret_type = monomorphise_fcn_return(ret_type_tmp, item, params);
+
+                ::std::vector<::HIR::TypeRef>   arg_tys;
+                for(const auto& a : item.m_args)
+                    arg_tys.push_back(params.monomorph(m_resolve, a.second));
+                auto name = FMT(fmt(p));
+                for(auto& s : m_sinks)
+                    s->function(name, arg_tys, ret_type, item.m_linkage.name, item.m_abi, nullptr);
+            }
+
+            m_mir_res = nullptr;
+        }
+        void emit_function_code(const ::HIR::Path& p, const ::HIR::Function& item, const Trans_Params& params, bool is_extern_def, const ::MIR::FunctionPointer& code) override
+        {
+            TRACE_FUNCTION_F(p);
+
+            ::std::vector<::HIR::TypeRef>   arg_tys;
+            for(const auto& ent : item.m_args)
+                arg_tys.push_back(params.monomorph(m_resolve, ent.second));
+
+            ::HIR::TypeRef  ret_type_tmp;
+            const auto& ret_type = monomorphise_fcn_return(ret_type_tmp, item, params);
+
+            auto name = FMT(fmt(p));
+            auto abi = item.m_linkage.name != "" ? item.m_abi : ::std::string();
+            for(auto& s : m_sinks)
+                s->function(name, arg_tys, ret_type, item.m_linkage.name, abi, &*code);
+        }
+
 
     private:
         const ::HIR::TypeRef& monomorphise_fcn_return(::HIR::TypeRef& tmp, const ::HIR::Function& item, const Trans_Params& params)
@@ -1097,7 +1825,7 @@ namespace
     Span CodeGenerator_MonoMir::sp;
 }
 
-::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGenerator_MonoMir(const ::HIR::Crate& crate, const ::std::string& outfile)
+::std::unique_ptr<CodeGenerator> Trans_Codegen_GetGenerator_MonoMir(const ::HIR::Crate& crate, const ::std::string& outfile, const TransOptions& opt)
 {
-    return ::std::unique_ptr<CodeGenerator>(new CodeGenerator_MonoMir(crate, outfile));
-}
+    return ::std::unique_ptr<CodeGenerator>(new CodeGenerator_MonoMir(crate, outfile, opt));
+}
\ No newline at end of file
@@ -12,12 +12,14 @@
 #include <hir/hir.hpp>
 #include <mir/mir.hpp>
 #include <mir/helpers.hpp>
+#include <mir/inline_cost.hpp>
 #include <hir_typeck/common.hpp>    // monomorph
 #include <hir_typeck/static.hpp>    // StaticTraitResolve
 #include <hir/item_path.hpp>
 #include <deque>
 #include <algorithm>
 #include "target.hpp"
+#include "mangling.hpp"
 
 namespace {
     struct EnumState
@@ -29,9 +31,35 @@ namespace {
         ::std::deque<TransList_Function*>  fcn_queue;
         ::std::vector<TransList_Function*> fcns_to_type_visit;
 
-        EnumState(const ::HIR::Crate& crate):
+        struct PathPtrLess {
+            bool operator()(const ::HIR::Path* a, const ::HIR::Path* b) const { return *a < *b; }
+        };
+        /// Functions emitted by upstream crates (`m_shared_generics` of every loaded crate), with their symbol names
+        ::std::map<const ::HIR::Path*, const ::std::string*, PathPtrLess>    upstream_shared;
+
+        EnumState(const ::HIR::Crate& crate, bool share_generics=false):
             crate(crate)
-        {}
+        {
+            if( share_generics )
+            {
+                for(const auto& ext_crate : crate.m_ext_crates)
+                {
+                    for(const auto& ent : ext_crate.second.m_data->m_shared_generics)
+                        upstream_shared.insert(::std::make_pair(&ent.first, &ent.second));
+                }
+                DEBUG(upstream_shared.size() << " functions shared by upstream crates");
+            }
+        }
+
+        /// Check if an upstream crate has already emitted this function (with the same symbol)
+        bool is_upstream_shared(const ::HIR::Path& p) const
+        {
+            auto it = upstream_shared.find(&p);
+            if( it == upstream_shared.end() )
+                return false;
+            // If the mangling scheme has changed, this crate's references wouldn't match the upstream definition
+            return *it->second == FMT(Trans_Mangle(p));
+        }
 
         void enum_fcn(::HIR::Path p, const ::HIR::Function& fcn, Trans_Params pp)
         {
@@ -40,7 +68,17 @@ namespace {
                 fcns_to_type_visit.push_back(e);
                 e->ptr = &fcn;
                 e->pp = mv$(pp);
-                fcn_queue.push_back(e);
+                if( !upstream_shared.empty() && is_upstream_shared(*e->path) )
+                {
+                    // Only the signature is needed, so the body (and everything it uses) isn't enumerated
+                    DEBUG("Upstream shared " << *e->path);
+                    e->force_prototype = true;
+                    e->is_upstream_shared = true;
+                }
+                else
+                {
+                    fcn_queue.push_back(e);
+                }
             }
         }
     };
@@ -101,11 +139,11 @@ namespace MIR {
 }
 
 /// Enumerate trans items starting from `::main` (binary crate)
-TransList Trans_Enumerate_Main(const ::HIR::Crate& crate)
+TransList Trans_Enumerate_Main(const ::HIR::Crate& crate, bool share_generics/*=false*/)
 {
     static Span sp;
 
-    EnumState   state { crate };
+    EnumState   state { crate, share_generics };
 
     auto c_start_path = crate.get_lang_item_path_opt("mrustc-start");
     if( c_start_path == ::HIR::SimplePath() )
@@ -280,10 +318,10 @@ namespace {
 }
 
 /// Enumerate trans items for all public non-generic items (library crate)
-TransList Trans_Enumerate_Public(::HIR::Crate& crate)
+TransList Trans_Enumerate_Public(::HIR::Crate& crate, bool share_generics/*=false*/)
 {
     static Span sp;
-    EnumState   state { crate };
+    EnumState   state { crate, share_generics };
 
     Trans_Enumerate_Public_Mod(state, crate.m_root_module,  ::HIR::SimplePath(crate.m_crate_name,{}), true);
 
@@ -490,6 +528,40 @@ void Trans_Enumerate_Cleanup(const ::HIR::Crate& crate, TransList& list)
 #endif
 }
 
+void Trans_Enumerate_RecordShared(::HIR::Crate& crate, const TransList& list)
+{
+    crate.m_shared_generics.clear();
+    const auto cost_model = InlineCostModel::from_env();
+    for(const auto& ent : list.m_functions)
+    {
+        const auto& fcn_ent = *ent.second;
+        if( !fcn_ent.monomorphised.code || fcn_ent.force_prototype )
+            continue ;
+        // Leave out `#[inline]` functions, and those small enough for the post-enumeration inliner to take without a
+        // hint (see `InlinePolicy::should_inline` in mir/optimise.cpp), they're cheap to re-instantiate and a prototype
+        // would prevent inlining them downstream.
+        // - Switch wrappers are also left out, as they can fold away to a single arm at a call site.
+        // - `#[inline(never)]` functions are always shared, they'd never be inlined anyway.
+        switch(fcn_ent.ptr->m_inline_hint)
+        {
+        case ::HIR::Function::InlineHint::Hint:
+        case ::HIR::Function::InlineHint::Always:
+            continue ;
+        case ::HIR::Function::InlineHint::Never:
+            break;
+        case ::HIR::Function::InlineHint::None: {
+            const auto& code = *fcn_ent.monomorphised.code;
+            if( cost_model.get_cost(code) <= cost_model.base_limit )
+                continue ;
+            if( code.blocks[0].terminator.is_Switch() || code.blocks[0].terminator.is_SwitchValue() )
+                continue ;
+            } break;
+        }
+        crate.m_shared_generics.insert(::std::make_pair( ent.first.clone(), FMT(Trans_Mangle(ent.first)) ));
+    }
+    DEBUG(crate.m_shared_generics.size() << " shared functions");
+}
+
 /// Common post-processing
 void Trans_Enumerate_CommonPost_Run(EnumState& state)
 {
@@ -19,6 +19,14 @@ struct TransOptions
     unsigned int opt_level = 0;
     bool emit_debug_info = false;
     ::std::string   build_command_file;
+    /// Number of C files to split function bodies across (compiled in parallel)
+    unsigned int codegen_units = 1;
+    /// Maximum number of concurrent C compiler invocations (0 = number of CPUs)
+    unsigned int codegen_jobs = 0;
+    /// Export monomorphised functions for use by downstream crates, and use those exported by upstream crates
+    bool share_generics = false;
+    /// Also write the binary form of the monomorphised MIR (`<output>.mir.bin`, `monomir` mode only)
+    bool emit_mmir_binary = false;
 
     ::std::string   panic_crate;
 
@@ -33,9 +41,11 @@ enum class CodegenOutput {
     Executable, // no suffix, includes main stub (TODO: Can't that just be added earlier?)
 };
 
-extern TransList Trans_Enumerate_Main(const ::HIR::Crate& crate);
+extern TransList Trans_Enumerate_Main(const ::HIR::Crate& crate, bool share_generics=false);
 // NOTE: This also sets the saveout flags
-extern TransList Trans_Enumerate_Public(::HIR::Crate& crate);
+extern TransList Trans_Enumerate_Public(::HIR::Crate& crate, bool share_generics=false);
+/// Record the monomorphised functions this crate emits in `HIR::Crate::m_shared_generics` (for `share_generics`)
+extern void Trans_Enumerate_RecordShared(::HIR::Crate& crate, const TransList& list);
 
 /// Re-run enumeration on monomorphised functions, removing now-unused items
 extern void Trans_Enumerate_Cleanup(const ::HIR::Crate& crate, TransList& list);
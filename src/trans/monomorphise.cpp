@@ -117,7 +117,8 @@ namespace {
     for(const auto& var : tpl->locals)
     {
         DEBUG("- _" << output.locals.size());
-        output.locals.push_back( params.monomorph(resolve, var) );
+        // Interned (if enabled with `-Z intern-types`), as monomorphised locals are heavily duplicated and are used as keys in type caches
+        output.locals.push_back( params.monomorph(resolve, var).intern() );
     }
     output.drop_flags = tpl->drop_flags;
 
@@ -366,6 +367,8 @@ void Trans_Monomorphise_List(const ::HIR::Crate& crate, TransList& list)
 
     for(auto& fcn_ent : list.m_functions)
     {
+        if( fcn_ent.second->is_upstream_shared )
+            continue ;
         const auto& fcn = *fcn_ent.second->ptr;
         // Trait methods (which are the only case where `Self` can exist in the argument list at this stage) always need to be monomorphised.
         bool is_method = ( fcn.m_args.size() > 0 && visit_ty_with(fcn.m_args[0].second, [&](const auto& x){return x == ::HIR::TypeRef("Self",0xFFFF);}) );
@@ -10,6 +10,8 @@
 #include "../expand/cfg.hpp"
 #include <fstream>
 #include <map>
+#include <unordered_map>
+#include <mutex>
 #include <hir/hir.hpp>
 #include <hir_typeck/helpers.hpp>
 #include <hir_conv/main_bindings.hpp>   // ConvertHIR_ConstantEvaluate_Enum
@@ -54,6 +56,87 @@ bool Target_GetSizeAndAlignOf(const Span& sp, const StaticTraitResolve& resolve,
 
 namespace
 {
+    /// Cache of type layouts (representation and size/alignment), sharded by type hash so that it can be queried
+    /// from multiple threads with little contention.
+    /// - Locks are only held for lookup/insert, computation happens unlocked (and may recurse into the cache)
+    class TypeLayoutCache
+    {
+        struct SizeAlign {
+            bool    is_known;
+            size_t  size;
+            size_t  align;
+        };
+        /// Entries are keyed by the type's hash, so lookups compare against the caller's type without cloning it
+        /// (the type is only cloned on insert)
+        template<typename V>
+        using Map = ::std::unordered_multimap<size_t, ::std::pair<::HIR::TypeRef, V>>;
+        struct Shard {
+            ::std::mutex    lock;
+            Map<::std::unique_ptr<TypeRepr>>    reprs;
+            Map<SizeAlign>  size_align;
+        };
+        static const size_t N_SHARDS = 16;
+        Shard   m_shards[N_SHARDS];
+
+        Shard& shard(size_t hash) {
+            return m_shards[(hash ^ (hash >> 16)) % N_SHARDS];
+        }
+        template<typename V>
+        static V* find(Map<V>& map, size_t hash, const ::HIR::TypeRef& ty) {
+            auto range = map.equal_range(hash);
+            for(auto it = range.first; it != range.second; ++it)
+            {
+                if( it->second.first == ty )
+                    return &it->second.second;
+            }
+            return nullptr;
+        }
+    public:
+        /// Look up a repr, returns false if not yet in the cache
+        bool get_repr(size_t hash, const ::HIR::TypeRef& ty, const TypeRepr*& out_repr) {
+            auto& s = shard(hash);
+            ::std::lock_guard<::std::mutex> lh { s.lock };
+            auto* e = find(s.reprs, hash, ty);
+            if( !e )
+                return false;
+            out_repr = e->get();
+            return true;
+        }
+        /// Insert a repr, returns the cached value (existing value if another caller got there first) and if the insert happened
+        /// - `repr` is only moved from if the insert happens
+        ::std::pair<const TypeRepr*, bool> set_repr(size_t hash, const ::HIR::TypeRef& ty, ::std::unique_ptr<TypeRepr>&& repr) {
+            auto& s = shard(hash);
+            ::std::lock_guard<::std::mutex> lh { s.lock };
+            if( auto* e = find(s.reprs, hash, ty) )
+                return ::std::make_pair(e->get(), false);
+            auto it = s.reprs.insert(::std::make_pair( hash, ::std::make_pair(ty.clone(), mv$(repr)) ));
+            return ::std::make_pair(it->second.second.get(), true);
+        }
+
+        bool get_size_align(size_t hash, const ::HIR::TypeRef& ty, bool& out_known, size_t& out_size, size_t& out_align) {
+            auto& s = shard(hash);
+            ::std::lock_guard<::std::mutex> lh { s.lock };
+            auto* e = find(s.size_align, hash, ty);
+            if( !e )
+                return false;
+            out_known = e->is_known;
+            if( out_known ) {
+                out_size = e->size;
+                out_align = e->align;
+            }
+            return true;
+        }
+        void set_size_align(size_t hash, const ::HIR::TypeRef& ty, bool is_known, size_t size, size_t align) {
+            auto& s = shard(hash);
+            ::std::lock_guard<::std::mutex> lh { s.lock };
+            if( find(s.size_align, hash, ty) )
+                return ;
+            s.size_align.insert(::std::make_pair( hash, ::std::make_pair(ty.clone(), SizeAlign { is_known, size, align }) ));
+        }
+    };
+    TypeLayoutCache s_layout_cache;
+
+
     TargetSpec load_spec_from_file(const ::std::string& filename)
     {
         TargetSpec  rv;
@@ -605,7 +688,8 @@ void Target_SetCfg(const ::std::string& target_name)
         });
 }
 
-bool Target_GetSizeAndAlignOf(const Span& sp, const StaticTraitResolve& resolve, const ::HIR::TypeRef& ty, size_t& out_size, size_t& out_align)
+namespace {
+bool Target_GetSizeAndAlignOf_Uncached(const Span& sp, const StaticTraitResolve& resolve, const ::HIR::TypeRef& ty, size_t& out_size, size_t& out_align)
 {
     //TRACE_FUNCTION_FR(ty, "size=" << out_size << ", align=" << out_align);
     TU_MATCH_HDRA( (ty.data()), {)
@@ -798,6 +882,21 @@ bool Target_GetSizeAndAlignOf(const Span& sp, const StaticTraitResolve& resolve,
     }
     return false;
 }
+}
+bool Target_GetSizeAndAlignOf(const Span& sp, const StaticTraitResolve& resolve, const ::HIR::TypeRef& ty, size_t& out_size, size_t& out_align)
+{
+    // Primitives are cheaper to calculate than to look up
+    if( ty.data().is_Primitive() )
+        return Target_GetSizeAndAlignOf_Uncached(sp, resolve, ty, out_size, out_align);
+
+    auto hash = ty.hash();
+    bool is_known;
+    if( s_layout_cache.get_size_align(hash, ty, is_known, out_size, out_align) )
+        return is_known;
+    is_known = Target_GetSizeAndAlignOf_Uncached(sp, resolve, ty, out_size, out_align);
+    s_layout_cache.set_size_align(hash, ty, is_known, is_known ? out_size : 0, is_known ? out_align : 0);
+    return is_known;
+}
 bool Target_GetSizeOf(const Span& sp, const StaticTraitResolve& resolve, const ::HIR::TypeRef& ty, size_t& out_size)
 {
     size_t  ignore_align;
@@ -1824,30 +1923,72 @@ namespace {
         return rv;
     }
 
-    // TODO: Thread safety on this cache?
-    static ::std::map<::HIR::TypeRef, ::std::unique_ptr<TypeRepr>>  s_cache;
+    bool operator==(const TypeRepr::FieldPath& a, const TypeRepr::FieldPath& b)
+    {
+        return a.index == b.index && a.size == b.size && a.sub_fields == b.sub_fields;
+    }
+    bool type_repr_equal(const TypeRepr& a, const TypeRepr& b)
+    {
+        if( a.size != b.size || a.align != b.align )
+            return false;
+        if( a.fields.size() != b.fields.size() )
+            return false;
+        for(size_t i = 0; i < a.fields.size(); i ++)
+        {
+            if( a.fields[i].offset != b.fields[i].offset || a.fields[i].ty != b.fields[i].ty )
+                return false;
+        }
+        if( a.variants.tag() != b.variants.tag() )
+            return false;
+        TU_MATCH_HDRA( (a.variants), {)
+        TU_ARMA(None, ae) {
+            }
+        TU_ARMA(Linear, ae) {
+            const auto& be = b.variants.as_Linear();
+            return ae.field == be.field && ae.offset == be.offset && ae.num_variants == be.num_variants;
+            }
+        TU_ARMA(Values, ae) {
+            const auto& be = b.variants.as_Values();
+            return ae.field == be.field && ae.values == be.values;
+            }
+        TU_ARMA(NonZero, ae) {
+            const auto& be = b.variants.as_NonZero();
+            return ae.field == be.field && ae.zero_variant == be.zero_variant;
+            }
+        }
+        return true;
+    }
 
     void set_type_repr(const Span& sp, const ::HIR::TypeRef& ty, ::std::unique_ptr<TypeRepr> repr)
     {
-        auto ires = s_cache.insert(::std::make_pair( ty.clone(), mv$(repr) ));
-        ASSERT_BUG(sp, ires.second, "set_type_repr called for type that already has a repr: " << ty);
-        DEBUG("Set repr for " << ires.first->first);
+        // NOTE: Another thread may have computed (and set) the same layout first, in which case its value is kept
+        // - Layout is deterministic, so the existing value must match
+        auto ires = s_layout_cache.set_repr(ty.hash(), ty, mv$(repr));
+        if( ires.second ) {
+            DEBUG("Set repr for " << ty);
+        }
+        else {
+            ASSERT_BUG(sp, ires.first && repr && type_repr_equal(*ires.first, *repr),
+                "set_type_repr called with a different repr for a type that already has one: " << ty);
+            DEBUG("Repr for " << ty << " already set");
+        }
     }
 }
 const TypeRepr* Target_GetTypeRepr(const Span& sp, const StaticTraitResolve& resolve, const ::HIR::TypeRef& ty)
 {
-    auto it = s_cache.find(ty);
-    if( it != s_cache.end() )
+    auto hash = ty.hash();
+    const TypeRepr* rv;
+    if( s_layout_cache.get_repr(hash, ty, rv) )
     {
-        return it->second.get();
+        return rv;
     }
 
-    auto ires = s_cache.insert(::std::make_pair( ty.clone(), make_type_repr(sp, resolve, ty) ));
+    auto ires = s_layout_cache.set_repr(hash, ty, make_type_repr(sp, resolve, ty));
     if(ires.second)
     {
-        DEBUG("Created repr for " << ires.first->first);
+        DEBUG("Created repr for " << ty);
     }
-    return ires.first->second.get();
+    return ires.first;
 }
 const ::HIR::TypeRef& Target_GetInnerType(const Span& sp, const StaticTraitResolve& resolve, const TypeRepr& repr, size_t idx, const ::std::vector<size_t>& sub_fields, size_t ofs)
 {
@@ -83,11 +83,15 @@ struct TransList_Function
     CachedFunction  monomorphised;
     /// Forces the function to not be emited as code (just emit the signature)
     bool    force_prototype;
+    /// Code was emitted by an upstream crate (see `HIR::Crate::m_shared_generics`), implies `force_prototype`
+    /// - Not monomorphised, so can't be inlined either
+    bool    is_upstream_shared;
 
     TransList_Function(const ::HIR::Path& path):
         path(&path),
         ptr(nullptr),
-        force_prototype(false)
+        force_prototype(false),
+        is_upstream_shared(false)
     {}
 };
 struct TransList_Static
@@ -5,6 +5,8 @@ make all
 make -C tools/standalone_miri || exit 1
 make -f minicargo.mk MMIR=1 LIBS V= || exit 1
 echo "--- mrustc -o output-mmir/hello"
-time ./bin/mrustc rustc-1.19.0-src/src/test/run-pass/hello.rs -O -C codegen-type=monomir -o output-mmir/hello -L output-mmir/ > output-mmir/hello_dbg.txt || exit 1
+time ./bin/mrustc rustc-1.19.0-src/src/test/run-pass/hello.rs -O -C codegen-type=monomir -C emit-mmir-binary -o output-mmir/hello -L output-mmir/ > output-mmir/hello_dbg.txt || exit 1
+echo "--- standalone_miri --check-binary output-mmir/hello.mir"
+./bin/standalone_miri --check-binary output-mmir/hello.mir --logfile smiri_check.log || exit 1
 echo "--- standalone_miri output-mmir/hello.mir"
 time ./bin/standalone_miri output-mmir/hello.mir --logfile smiri_hello.log
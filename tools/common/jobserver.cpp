@@ -0,0 +1,267 @@
+/*
+ * mrustc common code
+ * - by John Hodge (Mutabah)
+ *
+ * tools/common/jobserver.cpp
+ * - GNU make jobserver client/server
+ *
+ * See https://www.gnu.org/software/make/manual/html_node/Job-Slots.html
+ */
+#include "jobserver.h"
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>   // sscanf
+#include <iostream>
+#if _WIN32
+# include <Windows.h>
+#else
+# include <unistd.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <errno.h>
+#endif
+
+JobServer* JobServer::s_global = nullptr;
+
+namespace {
+    /// Get the value of the last `--jobserver-auth=` (or the older `--jobserver-fds=`) in MAKEFLAGS
+    ::std::string get_jobserver_auth()
+    {
+        const char* makeflags = getenv("MAKEFLAGS");
+        if( !makeflags )
+            return "";
+        ::std::string   flags = makeflags;
+        size_t  best_pos = ::std::string::npos;
+        size_t  best_len = 0;
+        for(const char* key : { "--jobserver-auth=", "--jobserver-fds=" })
+        {
+            auto pos = flags.rfind(key);
+            if( pos != ::std::string::npos && (best_pos == ::std::string::npos || pos > best_pos) ) {
+                best_pos = pos;
+                best_len = ::std::strlen(key);
+            }
+        }
+        if( best_pos == ::std::string::npos )
+            return "";
+        auto start = best_pos + best_len;
+        auto end = flags.find(' ', start);
+        return flags.substr(start, end == ::std::string::npos ? ::std::string::npos : end - start);
+    }
+    /// Append the jobserver to `MAKEFLAGS` (the last entry is the one used by clients)
+    void export_jobserver(unsigned count, const ::std::string& auth)
+    {
+        const char* makeflags = getenv("MAKEFLAGS");
+        ::std::string   v = makeflags ? makeflags : "";
+        v += " -j" + ::std::to_string(count) + " --jobserver-auth=" + auth;
+#if _WIN32
+        _putenv_s("MAKEFLAGS", v.c_str());
+#else
+        setenv("MAKEFLAGS", v.c_str(), 1);
+#endif
+    }
+}
+
+JobServer::JobServer():
+#if _WIN32
+    m_semaphore(nullptr),
+#else
+    m_read_fd(-1),
+    m_write_fd(-1),
+    m_close_read_fd(false),
+    m_close_write_fd(false),
+#endif
+    m_implicit_free(false)
+{
+}
+JobServer::~JobServer()
+{
+#if _WIN32
+    if( m_semaphore )
+        CloseHandle(m_semaphore);
+#else
+    if( m_close_read_fd )
+        close(m_read_fd);
+    if( m_close_write_fd && m_write_fd != m_read_fd )
+        close(m_write_fd);
+#endif
+}
+
+::std::unique_ptr<JobServer> JobServer::from_env(bool implicit_available)
+{
+    auto auth = get_jobserver_auth();
+    if( auth == "" )
+        return nullptr;
+
+    ::std::unique_ptr<JobServer>    rv { new JobServer() };
+    rv->m_implicit_free = implicit_available;
+#if _WIN32
+    rv->m_semaphore = OpenSemaphoreA(SYNCHRONIZE|SEMAPHORE_MODIFY_STATE, FALSE, auth.c_str());
+    if( !rv->m_semaphore ) {
+        ::std::cerr << "warning: Unable to open jobserver semaphore '" << auth << "'" << ::std::endl;
+        return nullptr;
+    }
+#else
+    if( auth.compare(0, 5, "fifo:") == 0 )
+    {
+        // GNU make 4.4+ named pipe (this open is private to the process, so can be non-blocking)
+        int fd = open(auth.c_str() + 5, O_RDWR|O_CLOEXEC|O_NONBLOCK);
+        if( fd < 0 ) {
+            ::std::cerr << "warning: Unable to open jobserver fifo '" << auth.c_str() + 5 << "'" << ::std::endl;
+            return nullptr;
+        }
+        rv->m_read_fd = fd;
+        rv->m_write_fd = fd;
+        rv->m_close_read_fd = true;
+        rv->m_close_write_fd = true;
+    }
+    else
+    {
+        int r, w;
+        if( sscanf(auth.c_str(), "%d,%d", &r, &w) != 2 ) {
+            ::std::cerr << "warning: Unknown jobserver format '" << auth << "'" << ::std::endl;
+            return nullptr;
+        }
+        // make only passes the descriptors to recipes it knows are recursive (`$(MAKE)` or a `+` prefix)
+        if( r < 0 || w < 0 || fcntl(r, F_GETFD) == -1 || fcntl(w, F_GETFD) == -1 ) {
+            return nullptr;
+        }
+        // Reads need to be non-blocking, prefer re-opening the pipe (giving a private file description) so the inherited
+        // descriptor's flags are left alone. Otherwise set the flag on the shared one (make's own reads are non-blocking).
+        auto reopen_path = "/proc/self/fd/" + ::std::to_string(r);
+        int fd = open(reopen_path.c_str(), O_RDONLY|O_CLOEXEC|O_NONBLOCK);
+        if( fd >= 0 ) {
+            rv->m_read_fd = fd;
+            rv->m_close_read_fd = true;
+        }
+        else {
+            int flags = fcntl(r, F_GETFL);
+            if( flags == -1 || fcntl(r, F_SETFL, flags|O_NONBLOCK) == -1 ) {
+                perror("jobserver fcntl");
+                return nullptr;
+            }
+            rv->m_read_fd = r;
+        }
+        rv->m_write_fd = w;
+    }
+#endif
+    return rv;
+}
+
+::std::unique_ptr<JobServer> JobServer::create(unsigned count)
+{
+    ::std::unique_ptr<JobServer>    rv { new JobServer() };
+    rv->m_implicit_free = true;
+#if _WIN32
+    auto name = "mrustc_jobserver_" + ::std::to_string(GetCurrentProcessId());
+    rv->m_semaphore = CreateSemaphoreA(NULL, count - 1, count > 1 ? count - 1 : 1, name.c_str());
+    if( !rv->m_semaphore ) {
+        ::std::cerr << "warning: Unable to create jobserver semaphore" << ::std::endl;
+        return nullptr;
+    }
+    export_jobserver(count, name);
+#else
+    int fds[2];
+    if( pipe(fds) != 0 ) {
+        perror("jobserver pipe");
+        return nullptr;
+    }
+    rv->m_read_fd = fds[0];
+    rv->m_write_fd = fds[1];
+    rv->m_close_read_fd = true;
+    rv->m_close_write_fd = true;
+    // Reads are non-blocking (see `acquire`)
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL)|O_NONBLOCK);
+    for(unsigned i = 1; i < count; i ++)
+    {
+        if( write(rv->m_write_fd, "+", 1) != 1 ) {
+            perror("jobserver write");
+            return nullptr;
+        }
+    }
+    export_jobserver(count, ::std::to_string(fds[0]) + "," + ::std::to_string(fds[1]));
+#endif
+    return rv;
+}
+
+bool JobServer::acquire(const ::std::function<bool()>& give_up)
+{
+    for(;;)
+    {
+        {
+            ::std::lock_guard<::std::mutex> lh { m_lock };
+            if( m_implicit_free ) {
+                m_implicit_free = false;
+                return true;
+            }
+        }
+        if( give_up && give_up() )
+            return false;
+
+        // Wait with a timeout, so `give_up` and the implicit slot are re-checked
+#if _WIN32
+        switch( WaitForSingleObject(m_semaphore, 50) )
+        {
+        case WAIT_OBJECT_0: {
+            ::std::lock_guard<::std::mutex> lh { m_lock };
+            m_held.push_back('+');
+            return true; }
+        case WAIT_TIMEOUT:
+            break;
+        default:
+            ::std::cerr << "warning: Jobserver wait failed" << ::std::endl;
+            return false;
+        }
+#else
+        struct pollfd   pfd;
+        pfd.fd = m_read_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int prv = poll(&pfd, 1, 50);
+        if( prv < 0 ) {
+            if( errno == EINTR )
+                continue ;
+            perror("jobserver poll");
+            return false;
+        }
+        if( prv == 0 )
+            continue ;
+        // NOTE: Another client can take the token between the poll and the read, the read is non-blocking so that just
+        // returns EAGAIN and goes back to polling.
+        char    tok;
+        auto n = read(m_read_fd, &tok, 1);
+        if( n == 1 ) {
+            ::std::lock_guard<::std::mutex> lh { m_lock };
+            m_held.push_back(tok);
+            return true;
+        }
+        if( n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) )
+            continue ;
+        if( n < 0 )
+            perror("jobserver read");
+        return false;
+#endif
+    }
+}
+
+void JobServer::release()
+{
+    char    tok;
+    {
+        ::std::lock_guard<::std::mutex> lh { m_lock };
+        // Hand back a real token first, the implicit slot is kept as long as any work is running
+        if( m_held.empty() ) {
+            m_implicit_free = true;
+            return ;
+        }
+        tok = m_held.back();
+        m_held.pop_back();
+    }
+#if _WIN32
+    (void)tok;
+    ReleaseSemaphore(m_semaphore, 1, NULL);
+#else
+    while( write(m_write_fd, &tok, 1) < 0 && errno == EINTR )
+        ;
+#endif
+}
@@ -0,0 +1,57 @@
+/*
+ * mrustc common code
+ * - by John Hodge (Mutabah)
+ *
+ * tools/common/jobserver.h
+ * - GNU make jobserver client/server (HEADER)
+ */
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+
+/// A pool of job slots shared between processes, using GNU make's jobserver protocol
+///
+/// Every process implicitly owns one slot (the one its parent used to start it), extra parallel work needs a token
+/// read from the jobserver, which is written back once the work completes. The jobserver is advertised to child
+/// processes through `MAKEFLAGS` (`--jobserver-auth=`).
+class JobServer
+{
+#ifdef _WIN32
+    void*   m_semaphore;
+#else
+    /// Non-blocking (another client can take the token between `poll` and `read`)
+    int m_read_fd;
+    int m_write_fd;
+    /// File descriptors were opened by this object (instead of being inherited)
+    bool    m_close_read_fd;
+    bool    m_close_write_fd;
+#endif
+    /// Tokens obtained from the jobserver (written back verbatim on release)
+    ::std::vector<char> m_held;
+    ::std::mutex    m_lock;
+    /// The implicit slot can be handed out by `acquire` (i.e. the calling thread isn't doing work itself)
+    bool    m_implicit_free;
+
+    JobServer();
+public:
+    JobServer(const JobServer&) = delete;
+    ~JobServer();
+
+    /// Join the jobserver advertised in `MAKEFLAGS` (returns nullptr if there isn't a usable one)
+    /// - `implicit_available` should be set if this process's own slot is free for `acquire` to hand out
+    static ::std::unique_ptr<JobServer> from_env(bool implicit_available);
+    /// Create a new jobserver with `count` slots (including the implicit one), and export it in `MAKEFLAGS`
+    static ::std::unique_ptr<JobServer> create(unsigned count);
+
+    /// Acquire a slot, blocking until one is available
+    /// - Returns false (without a slot) if `give_up` returns true while waiting
+    bool acquire(const ::std::function<bool()>& give_up = {});
+    /// Release a slot obtained from `acquire`
+    void release();
+
+    /// Process-wide jobserver (null if not in use), set by the program's `main`
+    static JobServer* s_global;
+};
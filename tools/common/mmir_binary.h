@@ -0,0 +1,241 @@
+/*
+ * mrustc common code
+ * - by John Hodge (Mutabah)
+ *
+ * tools/common/mmir_binary.h
+ * - Binary encoding of monomorphised MIR (written by mrustc, loaded by standalone_miri)
+ *
+ * Layout: `MAGIC` followed by a sequence of records, each starting with a `Record` byte and ending with `Record::End`.
+ * - Strings and types are defined (by `Record::String`/`Record::Type`) before the first record that uses them, and are
+ *   then referenced by index (in definition order).
+ * - Integers are LEB128 (unsigned, or zig-zag for signed), floats are the raw IEEE bits (8 bytes, little endian).
+ * - Locals and drop flags are referenced by index, arguments by index, statics/functions by their (mangled) path string.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+namespace mmir_binary {
+
+/// File header, last byte is the format version
+static const char MAGIC[8] = { 'M','M','I','R','B','I','N', 1 };
+
+enum class Record: uint8_t {
+    End,
+    String,     // <len> <bytes>
+    Type,       // TypeKind ...
+    Crate,      // <string: .mir path>
+    Function,   // <string: name> <count> <type>* <type: ret> <string: link name> <string: abi> <u8 has_body>
+                //  [<count> <type: local>* <count> <u8: drop flag>* <count> (<count> <statement>* <terminator>)*]
+    Static,     // <string: name> <type> <len> <bytes> <count> (<offset> <len> <u8 kind> (0: <string: path> | 1: <len> <bytes>))*
+    DataType,   // <string: name> <size> <align> <u8 flags: 1=drop,2=dstmeta> [<string: drop glue>] [<type: meta>] <count> (<offset> <type>)*
+                //  <u8 has_variants> [<base field> <count> <index>* <count> (<u8 has_tag> [<len> <bytes>] <data field+1 (0 for none)>)*]
+};
+enum class TypeKind: uint8_t {
+    Unit,
+    Diverge,
+    Primitive,  // Primitive
+    Composite,  // <string: name>
+    Array,      // <count> <type>
+    Slice,      // <type>
+    Borrow,     // BorrowKind <type>
+    Pointer,    // BorrowKind <type>
+    Function,   // <u8 unsafe> <string: abi> <count> <type>* <type: ret>
+    TraitObject,// <string: vtable type name>
+};
+/// NOTE: Matches the order of mrustc's `HIR::CoreType`
+enum class Primitive: uint8_t {
+    Usize, Isize,
+    U8, I8,
+    U16, I16,
+    U32, I32,
+    U64, I64,
+    U128, I128,
+    F32, F64,
+    Bool,
+    Char, Str,
+};
+enum class BorrowKind: uint8_t {
+    Shared,
+    Unique,
+    Move,
+};
+
+enum class LValueRoot: uint8_t {
+    Return,
+    Argument,   // <index>
+    Local,      // <index>
+    Static,     // <string: path>
+};
+enum class LValueWrapper: uint8_t {
+    Deref,
+    Field,      // <index>
+    Downcast,   // <index>
+    Index,      // <local index>
+};
+enum class Constant: uint8_t {
+    Int,        // <svalue> Primitive
+    Uint,       // <uvalue> Primitive
+    Float,      // <raw 8 bytes> Primitive
+    Bool,       // <u8>
+    Bytes,      // <len> <bytes>
+    StaticString,   // <len> <bytes>
+    ItemAddr,   // <string: path>
+};
+enum class Param: uint8_t {
+    LValue,
+    Borrow,     // BorrowKind <lvalue>
+    Constant,
+};
+// NOTE: `MIR::eBinOp`, `MIR::eUniOp`, and `MIR::eDropKind` are shared between mrustc and miri, so are encoded as their values
+enum class RValue: uint8_t {
+    Use,        // <lvalue>
+    Constant,   // <constant>
+    SizedArray, // <param> <count>
+    Borrow,     // BorrowKind <lvalue>
+    Cast,       // <lvalue> <type>
+    BinOp,      // <param> <op> <param>
+    UniOp,      // <lvalue> <op>
+    DstMeta,    // <lvalue>
+    DstPtr,     // <lvalue>
+    MakeDst,    // <param> <param>
+    Tuple,      // <count> <param>*
+    Array,      // <count> <param>*
+    UnionVariant,   // <string: path> <index> <param>
+    EnumVariant,    // <string: path> <index> <count> <param>*
+    Struct,     // <string: path> <count> <param>*
+};
+enum class Statement: uint8_t {
+    Assign,     // <lvalue> <rvalue>
+    SetDropFlag,// <index> <u8 value> <other+1 (0 for none)>
+    Drop,       // <kind> <lvalue> <flag+1 (0 for none)>
+    Asm,        // <string tpl> <count> (<string> <lvalue>)* <count> (<string> <lvalue>)* <count> <string>* <count> <string>*
+};
+enum class Terminator: uint8_t {
+    Incomplete,
+    Return,
+    Diverge,
+    Goto,       // <bb>
+    Panic,      // <bb>
+    If,         // <lvalue> <bb> <bb>
+    Switch,     // <lvalue> <count> <bb>*
+    SwitchValue,// <lvalue> <u8 kind: 0=unsigned,1=signed,2=string> <count> (<value> <bb>)* <bb: default>
+    Call,       // <u8 kind> (0: <lvalue> | 1: <string: path> | 2: <string: name> <count> <type>*) <count> <param>* <bb: ret> <bb: panic> <lvalue: dst>
+};
+
+/// Append-only byte buffer with the primitive encodings
+class Writer
+{
+    ::std::string   m_data;
+public:
+    const ::std::string& data() const { return m_data; }
+    void clear() { m_data.clear(); }
+
+    void write_u8(uint8_t v) {
+        m_data.push_back(static_cast<char>(v));
+    }
+    template<typename E>
+    void write_tag(E v) {
+        write_u8(static_cast<uint8_t>(v));
+    }
+    void write_uv(uint64_t v) {
+        while( v >= 0x80 ) {
+            write_u8(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        write_u8(static_cast<uint8_t>(v));
+    }
+    void write_sv(int64_t v) {
+        write_uv( (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63) );
+    }
+    void write_raw64(uint64_t v) {
+        for(int i = 0; i < 8; i ++)
+            write_u8(static_cast<uint8_t>(v >> (i*8)));
+    }
+    void write_bytes(const void* data, size_t len) {
+        write_uv(len);
+        m_data.append(static_cast<const char*>(data), len);
+    }
+    void write_raw(const ::std::string& d) {
+        m_data.append(d);
+    }
+};
+
+/// Cursor over a borrowed buffer (no copies are made, returned pointers refer to the buffer)
+class Reader
+{
+    const uint8_t*  m_cur;
+    const uint8_t*  m_end;
+
+    void need(size_t n) const {
+        if( static_cast<size_t>(m_end - m_cur) < n )
+            throw ::std::runtime_error("Truncated MMIR binary");
+    }
+public:
+    Reader(const void* data, size_t len):
+        m_cur(static_cast<const uint8_t*>(data)),
+        m_end(static_cast<const uint8_t*>(data) + len)
+    {
+    }
+
+    bool at_end() const { return m_cur == m_end; }
+
+    uint8_t read_u8() {
+        need(1);
+        return *m_cur++;
+    }
+    template<typename E>
+    E read_tag() {
+        return static_cast<E>(read_u8());
+    }
+    uint64_t read_uv() {
+        uint64_t    rv = 0;
+        for(unsigned shift = 0; ; shift += 7)
+        {
+            if( shift >= 64 )
+                throw ::std::runtime_error("Oversized integer in MMIR binary");
+            uint8_t b = read_u8();
+            rv |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if( !(b & 0x80) )
+                break;
+        }
+        return rv;
+    }
+    int64_t read_sv() {
+        uint64_t v = read_uv();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+    uint64_t read_raw64() {
+        need(8);
+        uint64_t    rv = 0;
+        for(int i = 0; i < 8; i ++)
+            rv |= static_cast<uint64_t>(m_cur[i]) << (i*8);
+        m_cur += 8;
+        return rv;
+    }
+    /// Returns a pointer into the buffer, with the length in `len`
+    const char* read_bytes(size_t& len) {
+        len = static_cast<size_t>(read_uv());
+        need(len);
+        const char* rv = reinterpret_cast<const char*>(m_cur);
+        m_cur += len;
+        return rv;
+    }
+    ::std::string read_string() {
+        size_t  len;
+        const char* p = read_bytes(len);
+        return ::std::string(p, len);
+    }
+    /// Check for (and consume) the file header
+    bool read_magic() {
+        if( static_cast<size_t>(m_end - m_cur) < sizeof(MAGIC) || ::std::memcmp(m_cur, MAGIC, sizeof(MAGIC)) != 0 )
+            return false;
+        m_cur += sizeof(MAGIC);
+        return true;
+    }
+};
+
+}
@@ -20,6 +20,8 @@ extern int _putenv_s(const char*, const char*);
 #include "manifest.h"
 #include "cfg.hpp"
 #include "build.h"
+#include "cache.h"
+#include <jobserver.h>
 #include "debug.h"
 #include "stringlist.h"
 #include <vector>
@@ -35,6 +37,11 @@ extern int _putenv_s(const char*, const char*);
 #include <fstream>
 #include <climits>
 #include <cassert>
+#include <cstring>  // strcmp
+#include <chrono>
+#include <map>
+#include <memory>  // unique_ptr
+#include <iomanip>    // setprecision
 #ifdef _WIN32
 # include <Windows.h>
 #else
@@ -62,6 +69,56 @@ extern int _putenv_s(const char*, const char*);
 #include <target_detect.h>	// tools/common/target_detect.h
 #define HOST_TARGET	DEFAULT_TARGET_NAME
 
+/// Historical build times (in seconds) for each output file, used to prioritise the build queue
+/// - Stored in `<output_dir>/build_times.txt` as `<seconds> <output path>` lines
+/// - Keyed by the full output path, as host and target builds of a crate share a filename
+class BuildTimings
+{
+    ::helpers::path m_path;
+    ::std::map<::std::string, double>   m_times;
+    bool    m_dirty = false;
+#ifndef DISABLE_MULTITHREAD
+    mutable ::std::mutex    m_lock;
+#endif
+public:
+    BuildTimings(::helpers::path path);
+    ~BuildTimings();
+
+    /// Returns a negative value if there's no record of this file
+    double get(const ::std::string& key) const;
+    void set(const ::std::string& key, double seconds);
+    void save();
+};
+
+/// Per-phase compiler statistics (from `mrustc --timings-out`), totalled over every crate built
+/// - Written to `<output_dir>/phase_timings.csv`, with phases in the order they were first seen
+class PhaseTotals
+{
+    struct Entry
+    {
+        ::std::string   name;
+        unsigned    count = 0;
+        double  wall_s = 0;
+        double  cpu_s = 0;
+        uint64_t    peak_rss_kb = 0;
+        uint64_t    allocs = 0;
+        uint64_t    alloc_bytes = 0;
+    };
+    ::helpers::path m_path;
+    ::std::vector<Entry>    m_entries;
+    bool    m_dirty = false;
+#ifndef DISABLE_MULTITHREAD
+    mutable ::std::mutex    m_lock;
+#endif
+public:
+    PhaseTotals(::helpers::path path);
+    ~PhaseTotals();
+
+    /// Add the contents of a CSV file written by `--timings-out`
+    void add_file(const ::helpers::path& csv_path);
+    void save();
+};
+
 /// Class abstracting access to the compiler
 class Builder
 {
@@ -69,17 +126,26 @@ class Builder
     ::helpers::path m_compiler_path;
     size_t m_total_targets;
     mutable size_t m_targets_built;
+    mutable BuildTimings    m_timings;
+    /// Only populated if `BuildOptions::phase_timings` is set
+    ::std::unique_ptr<PhaseTotals>  m_phase_totals;
+    ArtifactCache   m_cache;
+    /// Hash of the compiler executable (only populated if the cache is enabled)
+    ::std::string   m_compiler_hash;
 
 public:
     Builder(const BuildOptions& opts, size_t total_targets);
 
-    bool build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index) const;
-    bool build_library(const PackageManifest& manifest, bool is_for_host, size_t index) const;
+    /// Time taken to compile this package's library the last time it was built (negative if unknown)
+    double get_build_time(const PackageManifest& manifest, bool is_for_host) const;
+
+    bool build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index, ::std::function<void()> on_metadata={}) const;
+    bool build_library(const PackageManifest& manifest, bool is_for_host, size_t index, ::std::function<void()> on_metadata={}) const;
     ::helpers::path build_build_script(const PackageManifest& manifest, bool is_for_host, bool* out_is_rebuilt) const;
 
 private:
     ::helpers::path get_crate_path(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, const char** crate_type, ::std::string* out_crate_suffix) const;
-    bool spawn_process_mrustc(const StringList& args, StringListKV env, const ::helpers::path& logfile) const;
+    bool spawn_process_mrustc(const StringList& args, StringListKV env, const ::helpers::path& logfile, const ::helpers::path& marker_file={}, ::std::function<void()> on_marker={}) const;
 
     ::helpers::path build_and_run_script(const PackageManifest& manifest, bool is_for_host) const;
 
@@ -244,40 +310,95 @@ BuildList::BuildList(const PackageManifest& manifest, const BuildOptions& opts):
 
     // Move the contents of the above list to this class's list
     m_list.reserve(b.m_list.size());
+    ::std::map<const PackageManifest*, unsigned>    package_indexes;
     for(const auto& e : b.m_list)
     {
-        m_list.push_back({ e.package, e.native, {} });
+        package_indexes.insert(::std::make_pair( e.package, static_cast<unsigned>(m_list.size()) ));
+        m_list.push_back({ e.package, e.native, {}, {}, 0 });
     }
+
     // Fill in all of the dependents (i.e. packages that will be closer to being buildable when the package is built)
-    for(size_t i = 0; i < m_list.size(); i++)
+    // - With pipelining, a library only needs the metadata of the rlibs it depends on. Anything that links (proc macros,
+    //   dylibs, build scripts) needs the full build of every crate it (transitively) pulls in.
+    struct H {
+        static bool library_is_rlib(const PackageManifest& p) {
+            if( !p.has_library() )
+                return false;
+            const auto& t = p.get_library();
+            if( t.m_crate_types.empty() )
+                return !t.m_is_proc_macro;
+            switch(t.m_crate_types.front())
+            {
+            case PackageTarget::CrateType::rlib:
+                return true;
+            case PackageTarget::CrateType::dylib:
+                // See `Builder::get_crate_path`, dylibs are only emitted as dylibs if requested
+                return getenv("MINICARGO_DYLIB") == nullptr;
+            default:
+                return false;
+            }
+        }
+    };
+    bool include_build = !opts.build_script_overrides.is_valid();
+    for(size_t j = 0; j < m_list.size(); j ++)
     {
-        const auto* cur = m_list[i].package;
-        for(size_t j = i+1; j < m_list.size(); j ++)
+        const auto& p = *m_list[j].package;
+        bool needs_full = !opts.pipeline || !H::library_is_rlib(p);
+        // Map of prerequisite index to `true` if the full build is needed (instead of just metadata)
+        ::std::map<unsigned, bool>  prereqs;
+        ::std::function<void(const PackageManifest&, bool)>    add_prereq;
+        add_prereq = [&](const PackageManifest& dep, bool full) {
+            auto it = package_indexes.find(&dep);
+            if( it == package_indexes.end() )
+                return ;
+            auto r = prereqs.insert(::std::make_pair(it->second, full));
+            if( !r.second ) {
+                if( !full || r.first->second )
+                    return ;
+                r.first->second = true;
+            }
+            // The full build of a pipelined library doesn't imply its dependencies are fully built
+            if( full && opts.pipeline ) {
+                for(const auto& d : dep.dependencies()) {
+                    if( !d.is_disabled() ) {
+                        add_prereq(d.get_package(), true);
+                    }
+                }
+            }
+            };
+        for( const auto& dep : p.dependencies() )
         {
-            const auto& p = *m_list[j].package;
-            for( const auto& dep : p.dependencies() )
+            if( !dep.is_disabled() )
             {
-                if( !dep.is_disabled() && &dep.get_package() == cur )
-                {
-                    m_list[i].dependents.push_back(static_cast<unsigned>(j));
-                }
+                const auto& dp = dep.get_package();
+                add_prereq(dp, needs_full || !H::library_is_rlib(dp));
             }
-            if( p.build_script() != "" && !opts.build_script_overrides.is_valid() )
+        }
+        if( p.build_script() != "" && include_build )
+        {
+            for(const auto& dep : p.build_dependencies())
             {
-                for(const auto& dep : p.build_dependencies())
+                if( !dep.is_disabled() )
                 {
-                    if( !dep.is_disabled() && &dep.get_package() == cur )
-                    {
-                        m_list[i].dependents.push_back(static_cast<unsigned>(j));
-                    }
+                    add_prereq(dep.get_package(), true);
                 }
             }
         }
+
+        for(const auto& e : prereqs)
+        {
+            if( e.second ) {
+                m_list[e.first].dependents.push_back(static_cast<unsigned>(j));
+            }
+            else {
+                m_list[e.first].meta_dependents.push_back(static_cast<unsigned>(j));
+            }
+        }
+        m_list[j].num_deps = static_cast<unsigned>(prereqs.size());
     }
 }
 bool BuildList::build(BuildOptions opts, unsigned num_jobs)
 {
-    bool include_build = !opts.build_script_overrides.is_valid();
     Builder builder { opts, m_list.size() };
 
     // Pre-count how many dependencies are remaining for each package
@@ -285,13 +406,31 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
     {
         ::std::vector<unsigned> num_deps_remaining;
         ::std::vector<unsigned> build_queue;
+        ::std::vector<bool> metadata_ready;
+        /// Estimated time (seconds) from starting this package until everything depending on it is built
+        ::std::vector<double>   priority;
 
+        /// Metadata for a package is ready (dependents that just need the `.hir` can start)
+        int complete_metadata(unsigned index, const ::std::vector<Entry>& list)
+        {
+            if( this->metadata_ready[index] )
+                return 0;
+            this->metadata_ready[index] = true;
+            DEBUG("Metadata ready " << list[index].package->name() << " (" << list[index].meta_dependents.size() << " dependents)");
+            return release(list, list[index].meta_dependents);
+        }
         int complete_package(unsigned index, const ::std::vector<Entry>& list)
         {
-            int rv = 0;
+            int rv = complete_metadata(index, list);
             DEBUG("Completed " << list[index].package->name() << " (" << list[index].dependents.size() << " dependents)");
-
-            for(auto d : list[index].dependents)
+            rv += release(list, list[index].dependents);
+            return rv;
+        }
+    private:
+        int release(const ::std::vector<Entry>& list, const ::std::vector<unsigned>& dependents)
+        {
+            int rv = 0;
+            for(auto d : dependents)
             {
                 assert(this->num_deps_remaining[d] > 0);
                 this->num_deps_remaining[d] --;
@@ -302,51 +441,84 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
                     this->build_queue.push_back(d);
                 }
             }
-
             return rv;
         }
+    public:
 
+        /// Pick the queued package with the longest remaining dependency chain (most recently queued wins ties)
         unsigned get_next()
         {
             assert(!this->build_queue.empty());
-            unsigned rv = this->build_queue.back();
-            this->build_queue.pop_back();
+            auto best = this->build_queue.begin();
+            for(auto it = this->build_queue.begin(); it != this->build_queue.end(); ++it)
+            {
+                if( this->priority[*it] >= this->priority[*best] )
+                    best = it;
+            }
+            unsigned rv = *best;
+            this->build_queue.erase(best);
+            DEBUG("Next: " << rv << " (priority " << this->priority[rv] << ")");
             return rv;
         }
     };
     BuildState  state;
     state.num_deps_remaining.reserve(m_list.size());
-    for(const auto& e : m_list)
+    state.metadata_ready.resize(m_list.size());
+
+    // Critical path weighting: each package costs its last recorded build time (or the average of known times if
+    // it's not been built before), and its priority is that plus the most expensive chain of dependents.
     {
-        auto idx = static_cast<unsigned>(state.num_deps_remaining.size());
-        const auto& p = *e.package;
-        unsigned n_deps = 0;
-        for (const auto& dep : p.dependencies())
+        ::std::vector<double>   cost;
+        cost.reserve(m_list.size());
+        double  known_total = 0;
+        unsigned    known_count = 0;
+        for(const auto& e : m_list)
         {
-            if( dep.is_disabled() )
-            {
-                continue ;
+            auto t = builder.get_build_time(*e.package, e.is_host);
+            if( t >= 0 ) {
+                known_total += t;
+                known_count += 1;
             }
-            n_deps ++;
+            cost.push_back(t);
         }
-
-        if( p.build_script() != "" && include_build )
+        double default_cost = known_count > 0 ? known_total / known_count : 1.0;
+        for(auto& c : cost)
         {
-            for(const auto& dep : p.build_dependencies())
+            if( c < 0 )
+                c = default_cost;
+        }
+
+        state.priority.resize(m_list.size(), -1.0);
+        ::std::function<double(unsigned)>   get_priority;
+        get_priority = [&](unsigned idx)->double {
+            auto& rv = state.priority[idx];
+            if( rv < 0 )
             {
-                if( dep.is_disabled() )
-                {
-                    continue ;
-                }
-                n_deps ++;
+                double max_dep = 0;
+                for(auto d : m_list[idx].dependents)
+                    max_dep = ::std::max(max_dep, get_priority(d));
+                for(auto d : m_list[idx].meta_dependents)
+                    max_dep = ::std::max(max_dep, get_priority(d));
+                rv = cost[idx] + max_dep;
             }
+            return rv;
+            };
+        for(unsigned i = 0; i < m_list.size(); i ++)
+        {
+            DEBUG("Package '" << m_list[i].package->name() << "' cost=" << cost[i] << " priority=" << get_priority(i));
         }
+    }
+    for(const auto& e : m_list)
+    {
+        auto idx = static_cast<unsigned>(state.num_deps_remaining.size());
+        const auto& p = *e.package;
+        unsigned n_deps = e.num_deps;
         // If there's no dependencies for this package, add it to the build queue
         if( n_deps == 0 )
         {
             state.build_queue.push_back(idx);
         }
-        DEBUG("Package '" << p.name() << "' has " << n_deps << " dependencies and " << m_list[idx].dependents.size() << " dependents");
+        DEBUG("Package '" << p.name() << "' has " << n_deps << " dependencies and " << (e.dependents.size() + e.meta_dependents.size()) << " dependents");
         state.num_deps_remaining.push_back( n_deps );
     }
 
@@ -423,6 +595,9 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
                         break;
                     }
 
+                    // Take a job slot before picking the package (so the highest priority one is picked once it can start)
+                    bool have_slot = JobServer::s_global && JobServer::s_global->acquire();
+
                     unsigned cur;
                     {
                         ::std::lock_guard<::std::mutex> sl { queue.mutex };
@@ -431,7 +606,20 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
                     }
 
                     DEBUG("Thread " << my_idx << ": Starting " << cur << " - " << list[cur].package->name());
-                    if( ! builder->build_library(*list[cur].package, list[cur].is_host, cur) )
+                    auto on_metadata = [&queue,&list,cur]() {
+                        ::std::lock_guard<::std::mutex> sl { queue.mutex };
+                        int v = queue.state.complete_metadata(cur, list);
+                        while(v--)
+                        {
+                            queue.avaliable_tasks.notify();
+                        }
+                        };
+                    bool ok = builder->build_library(*list[cur].package, list[cur].is_host, cur, on_metadata);
+                    if( have_slot )
+                    {
+                        JobServer::s_global->release();
+                    }
+                    if( !ok )
                     {
                         queue.failure = true;
                         queue.signal_all();
@@ -568,12 +756,158 @@ bool BuildList::build(BuildOptions opts, unsigned num_jobs)
 }
 
 
+BuildTimings::BuildTimings(::helpers::path path):
+    m_path(::std::move(path))
+{
+    ::std::ifstream is { m_path.str() };
+    double  secs;
+    ::std::string   key;
+    // The path is the rest of the line (it may contain spaces)
+    while( is >> secs && is.get() == ' ' && ::std::getline(is, key) )
+    {
+        m_times[key] = secs;
+    }
+}
+BuildTimings::~BuildTimings()
+{
+    this->save();
+}
+double BuildTimings::get(const ::std::string& key) const
+{
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+#endif
+    auto it = m_times.find(key);
+    return it != m_times.end() ? it->second : -1.0;
+}
+void BuildTimings::set(const ::std::string& key, double seconds)
+{
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+#endif
+    m_times[key] = seconds;
+    m_dirty = true;
+}
+void BuildTimings::save()
+{
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+#endif
+    if( !m_dirty )
+        return ;
+    ::std::ofstream os { m_path.str() };
+    for(const auto& e : m_times)
+    {
+        os << e.second << " " << e.first << "\n";
+    }
+    m_dirty = false;
+}
+
+PhaseTotals::PhaseTotals(::helpers::path path):
+    m_path(::std::move(path))
+{
+}
+PhaseTotals::~PhaseTotals()
+{
+    this->save();
+}
+void PhaseTotals::add_file(const ::helpers::path& csv_path)
+{
+    ::std::ifstream is { csv_path.str() };
+    ::std::string   line;
+    // Skip the header
+    if( !::std::getline(is, line) )
+        return ;
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+#endif
+    while( ::std::getline(is, line) )
+    {
+        // `"<phase>",wall_s,cpu_s,rss_kb,peak_rss_kb,allocs,alloc_bytes`
+        if( line.size() < 2 || line[0] != '"' )
+            continue ;
+        auto name_end = line.find('"', 1);
+        if( name_end == ::std::string::npos || name_end + 1 >= line.size() || line[name_end+1] != ',' )
+            continue ;
+        ::std::string   name = line.substr(1, name_end - 1);
+        ::std::istringstream    ss { line.substr(name_end + 2) };
+        double  wall_s, cpu_s;
+        uint64_t    rss_kb, peak_rss_kb, allocs, alloc_bytes;
+        char c1, c2, c3, c4, c5;
+        if( !(ss >> wall_s >> c1 >> cpu_s >> c2 >> rss_kb >> c3 >> peak_rss_kb >> c4 >> allocs >> c5 >> alloc_bytes) )
+            continue ;
+
+        auto it = ::std::find_if(m_entries.begin(), m_entries.end(), [&](const Entry& e){ return e.name == name; });
+        if( it == m_entries.end() )
+        {
+            m_entries.push_back(Entry());
+            m_entries.back().name = name;
+            it = m_entries.end() - 1;
+        }
+        it->count += 1;
+        it->wall_s += wall_s;
+        it->cpu_s += cpu_s;
+        it->peak_rss_kb = ::std::max(it->peak_rss_kb, peak_rss_kb);
+        it->allocs += allocs;
+        it->alloc_bytes += alloc_bytes;
+        m_dirty = true;
+    }
+}
+void PhaseTotals::save()
+{
+#ifndef DISABLE_MULTITHREAD
+    ::std::lock_guard<::std::mutex> lh { m_lock };
+#endif
+    if( !m_dirty )
+        return ;
+    ::std::ofstream os { m_path.str() };
+    os << ::std::fixed << ::std::setprecision(6);
+    os << "phase,crates,wall_s,cpu_s,max_peak_rss_kb,allocs,alloc_bytes\n";
+    for(const auto& e : m_entries)
+    {
+        os << "\"" << e.name << "\"," << e.count << "," << e.wall_s << "," << e.cpu_s << "," << e.peak_rss_kb
+            << "," << e.allocs << "," << e.alloc_bytes << "\n";
+    }
+    m_dirty = false;
+}
+
 Builder::Builder(const BuildOptions& opts, size_t total_targets):
     m_opts(opts),
     m_total_targets(total_targets),
-    m_targets_built(0)
+    m_targets_built(0),
+    m_timings(opts.output_dir / "build_times.txt")
 {
     m_compiler_path = get_mrustc_path();
+    if( opts.phase_timings )
+    {
+        m_phase_totals.reset(new PhaseTotals(opts.output_dir / "phase_timings.csv"));
+    }
+    if( opts.cache_dir.is_valid() )
+    {
+        m_cache = ArtifactCache(opts.cache_dir, opts.output_dir);
+        m_compiler_hash = Hasher::for_file(m_compiler_path);
+    }
+}
+
+double Builder::get_build_time(const PackageManifest& manifest, bool is_for_host) const
+{
+    if( !manifest.has_library() )
+        return -1.0;
+    const auto& lib = manifest.get_library();
+    // `get_crate_path` doesn't handle crate types mrustc can't emit, these have no recorded time
+    if( !lib.m_crate_types.empty() )
+    {
+        switch(lib.m_crate_types.front())
+        {
+        case PackageTarget::CrateType::staticlib:
+        case PackageTarget::CrateType::cdylib:
+            return -1.0;
+        default:
+            break;
+        }
+    }
+    auto outfile = this->get_crate_path(manifest, lib, is_for_host, nullptr, nullptr);
+    return m_timings.get(outfile.str());
 }
 
 ::helpers::path Builder::get_crate_path(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, const char** crate_type, ::std::string* out_crate_suffix) const
@@ -803,7 +1137,7 @@ namespace {
     }
 }
 
-bool Builder::build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index) const
+bool Builder::build_target(const PackageManifest& manifest, const PackageTarget& target, bool is_for_host, size_t index, ::std::function<void()> on_metadata/*={}*/) const
 {
     const bool is_rustc = (m_compiler_path.basename() == "rustc" || m_compiler_path.basename() == "rustc.exe");
 
@@ -866,7 +1200,7 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
         TODO("Run command `" << cmd << "` from build script override");
     }
 
-    {
+    auto print_status = [&](const char* action) {
 #ifndef DISABLE_MULTITHREAD
         ::std::lock_guard<::std::mutex> lh { s_cout_mutex };
 #endif
@@ -875,14 +1209,14 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
             //::std::cout << "(" << index << "/" << m_total_targets << ") ";
             ::std::cout << "(" << this_target_idx << "/" << m_total_targets << ") ";
         }
-        ::std::cout << "BUILDING ";
+        ::std::cout << action << " ";
         if(target.m_name != manifest.name())
             ::std::cout << target.m_name << " from ";
         ::std::cout << manifest.name() << " v" << manifest.version();
         if( !manifest.active_features().empty() )
             ::std::cout << " with features [" << manifest.active_features() << "]";
         ::std::cout << ::std::endl;
-    }
+        };
     StringList  args;
     args.push_back(::helpers::path(manifest.manifest_path()).parent() / ::helpers::path(target.m_path));
     args.push_back("-o"); args.push_back(outfile);
@@ -926,6 +1260,18 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
     {
         args.push_back("-C"); args.push_back("codegen-type=monomir");
     }
+    if( m_opts.share_generics )
+    {
+        args.push_back("-Z"); args.push_back("share-generics");
+    }
+    // Pipelining: mrustc touches the marker once the `.hir` metadata is written, dependents can start then
+    ::helpers::path marker_file;
+    if( m_opts.pipeline && on_metadata && !is_rustc && ::std::strcmp(crate_type, "rlib") == 0 )
+    {
+        marker_file = outfile + ".meta_ready";
+        remove(marker_file.str().c_str());
+        args.push_back("-C"); args.push_back(format("emit-metadata-marker=",marker_file));
+    }
 
     for(const auto& d : m_opts.lib_search_dirs)
     {
@@ -1012,10 +1358,67 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
     env.push_back("OUT_DIR", out_dir.str());
     push_env_common(env, manifest);
 
+    // Artifact cache: keyed on the compiler, arguments, and environment. Input files (sources and loaded crates) are
+    // checked against the depfile recorded with each entry.
+    // - The output directory is normalised out of the key (it's in `-o`, `-L`, `--extern` and `OUT_DIR`), so builds
+    //   in different output directories can share entries.
+    // - The main output is restored last, so it's newer than the depfile and metadata.
+    // - The depfile and command file list paths, so are stored normalised (they're the first two outputs)
+    ::std::string   cache_key;
+    ::std::vector<::helpers::path>  cache_outputs { depfile, outfile + ".sh", outfile + ".hir", outfile };
+    const size_t    cache_n_text = 2;
+    if( m_cache.is_enabled() && !is_rustc )
+    {
+        Hasher  h;
+        h.update(m_compiler_hash);
+        for(const auto& a : args.get_vec())
+            h.update(m_cache.normalise(a));
+        for(const auto& kv : env)
+        {
+            h.update(kv.first);
+            h.update(m_cache.normalise(kv.second));
+        }
+        cache_key = h.finish();
+        if( m_cache.restore(cache_key, cache_outputs, cache_n_text) )
+        {
+            print_status("RESTORED");
+            return true;
+        }
+    }
+
+    print_status("BUILDING");
     // TODO: If emitting command files (i.e. cross-compiling), concatenate the contents of `outfile + ".sh"` onto a
     // master file.
     // - Will probably want to do this as a final stage after building everything.
-    return this->spawn_process_mrustc(args, ::std::move(env), outfile + "_dbg.txt");
+    // Added after the cache key is calculated, so collecting timings doesn't change it
+    auto phase_timings_file = outfile + "_timings.csv";
+    if( m_phase_totals )
+    {
+        args.push_back("--timings-out");
+        args.push_back(phase_timings_file.str());
+    }
+    auto start_time = ::std::chrono::steady_clock::now();
+    if( !this->spawn_process_mrustc(args, ::std::move(env), outfile + "_dbg.txt", marker_file, marker_file.is_valid() ? on_metadata : ::std::function<void()>()) )
+    {
+        return false;
+    }
+    ::std::chrono::duration<double> elapsed = ::std::chrono::steady_clock::now() - start_time;
+    m_timings.set(outfile.str(), elapsed.count());
+    if( m_phase_totals )
+    {
+        m_phase_totals->add_file(phase_timings_file);
+    }
+
+    if( cache_key != "" )
+    {
+        auto depfile_ents = load_depfile(depfile);
+        auto it = depfile_ents.find(outfile);
+        if( it != depfile_ents.end() )
+        {
+            m_cache.store(cache_key, it->second, cache_outputs, cache_n_text);
+        }
+    }
+    return true;
 }
 ::helpers::path Builder::build_build_script(const PackageManifest& manifest, bool is_for_host, bool* out_is_rebuilt) const
 {
@@ -1071,6 +1474,10 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
     {
         args.push_back("-C"); args.push_back("codegen-type=monomir");
     }
+    if( m_opts.share_generics )
+    {
+        args.push_back("-Z"); args.push_back("share-generics");
+    }
     switch(manifest.edition())
     {
     case Edition::Unspec:
@@ -1195,7 +1602,7 @@ bool Builder::build_target(const PackageManifest& manifest, const PackageTarget&
 
     return out_file;
 }
-bool Builder::build_library(const PackageManifest& manifest, bool is_for_host, size_t index) const
+bool Builder::build_library(const PackageManifest& manifest, bool is_for_host, size_t index, ::std::function<void()> on_metadata/*={}*/) const
 {
     if( manifest.build_script() != "" )
     {
@@ -1221,12 +1628,12 @@ bool Builder::build_library(const PackageManifest& manifest, bool is_for_host, s
         }
     }
 
-    return this->build_target(manifest, manifest.get_library(), is_for_host, index);
+    return this->build_target(manifest, manifest.get_library(), is_for_host, index, ::std::move(on_metadata));
 }
-bool Builder::spawn_process_mrustc(const StringList& args, StringListKV env, const ::helpers::path& logfile) const
+bool Builder::spawn_process_mrustc(const StringList& args, StringListKV env, const ::helpers::path& logfile, const ::helpers::path& marker_file/*={}*/, ::std::function<void()> on_marker/*={}*/) const
 {
     //env.push_back("MRUSTC_DEBUG", "");
-    return spawn_process(m_compiler_path.str().c_str(), args, env, logfile);
+    return spawn_process(m_compiler_path.str().c_str(), args, env, logfile, {}, marker_file, ::std::move(on_marker));
 }
 
 const helpers::path& get_mrustc_path()
@@ -1289,8 +1696,19 @@ const helpers::path& get_mrustc_path()
     return s_compiler_path;
 }
 
-bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory/*={}*/)
+bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory/*={}*/,
+    const ::helpers::path& marker_file/*={}*/, ::std::function<void()> on_marker/*={}*/)
 {
+    // Poll for the marker file (if requested) while waiting for the child to exit
+    bool marker_seen = !on_marker;
+    auto check_marker = [&]() {
+        if( !marker_seen && !(Timestamp::for_file(marker_file) == Timestamp::infinite_past()) ) {
+            DEBUG("Marker " << marker_file << " present");
+            marker_seen = true;
+            on_marker();
+        }
+        };
+
 #ifdef _WIN32
     ::std::stringstream cmdline;
     cmdline << exe_name;
@@ -1353,7 +1771,14 @@ bool spawn_process(const char* exe_name, const StringList& args, const StringLis
     PROCESS_INFORMATION pi = { 0 };
     CreateProcessA(exe_name, (LPSTR)cmdline_str.c_str(), NULL, NULL, TRUE, 0, NULL, (working_directory != ::helpers::path() ? working_directory.str().c_str() : NULL), &si, &pi);
     CloseHandle(si.hStdOutput);
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    if( on_marker ) {
+        while( WaitForSingleObject(pi.hProcess, 50) == WAIT_TIMEOUT ) {
+            check_marker();
+        }
+    }
+    else {
+        WaitForSingleObject(pi.hProcess, INFINITE);
+    }
     DWORD status = 1;
     GetExitCodeProcess(pi.hProcess, &status);
     if (status != 0)
@@ -1436,7 +1861,16 @@ bool spawn_process(const char* exe_name, const StringList& args, const StringLis
     }
     posix_spawn_file_actions_destroy(&fa);
     int status = -1;
-    waitpid(pid, &status, 0);
+    if( on_marker ) {
+        pid_t rv;
+        while( (rv = waitpid(pid, &status, WNOHANG)) == 0 || (rv < 0 && errno == EINTR) ) {
+            check_marker();
+            usleep(50*1000);
+        }
+    }
+    else {
+        waitpid(pid, &status, 0);
+    }
     if( status != 0 )
     {
         if( WIFEXITED(status) )
@@ -9,6 +9,7 @@
 
 #include "manifest.h"
 #include <path.h>
+#include <functional>
 
 class StringList;
 class StringListKV;
@@ -20,6 +21,14 @@ struct BuildOptions
     ::helpers::path build_script_overrides;
     ::std::vector<::helpers::path>  lib_search_dirs;
     bool emit_mmir = false;
+    /// Pass `-Z share-generics` to mrustc (dependents use the generic instances emitted by their dependencies)
+    bool share_generics = false;
+    /// Start dependent libraries as soon as a library's metadata is written (while its C code is still compiling)
+    bool pipeline = true;
+    /// Pass `--timings-out` to mrustc, and total the per-phase results into `<output_dir>/phase_timings.csv`
+    bool phase_timings = false;
+    /// Directory for the content-addressed cache of build outputs (disabled if not set)
+    ::helpers::path cache_dir;
     const char* target_name = nullptr;  // if null, host is used
     enum class Mode {
         /// Build the binary/library
@@ -37,7 +46,9 @@ class BuildList
     {
         const PackageManifest*  package;
         bool    is_host;
-        ::std::vector<unsigned> dependents;   // Indexes into the list
+        ::std::vector<unsigned> dependents;   // Indexes into the list, released once this package is fully built
+        ::std::vector<unsigned> meta_dependents;  // Indexes into the list, released once this package's metadata is ready
+        unsigned    num_deps;   // Number of entries that list this one in `dependents` or `meta_dependents`
     };
     const PackageManifest&  m_root_manifest;
     // List is sorted by build order
@@ -48,4 +59,7 @@ public:
 };
 
 extern const helpers::path& get_mrustc_path();
-extern bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory={});
+/// Run a process (blocking until it exits)
+/// - If `on_marker` is set, it's called (from the calling thread) once `marker_file` is created by the process
+extern bool spawn_process(const char* exe_name, const StringList& args, const StringListKV& env, const ::helpers::path& logfile, const ::helpers::path& working_directory={},
+    const ::helpers::path& marker_file={}, ::std::function<void()> on_marker={});
@@ -0,0 +1,415 @@
+/*
+ * minicargo - MRustC-specific clone of `cargo`
+ * - By John Hodge (Mutabah)
+ *
+ * cache.cpp
+ * - Content-addressed cache of build outputs
+ */
+#include "cache.h"
+#include "debug.h"
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <cstdio>   // rename/remove
+#include <cstring>
+#if _WIN32
+# include <Windows.h>
+#else
+# include <dirent.h>
+# include <unistd.h>    // getpid
+# include <sys/stat.h>
+#endif
+
+namespace {
+    const uint32_t SHA256_K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    inline uint32_t rotr(uint32_t v, unsigned n) {
+        return (v >> n) | (v << (32 - n));
+    }
+
+    void make_dir(const ::helpers::path& p)
+    {
+#if _WIN32
+        CreateDirectory(p.str().c_str(), NULL);
+#else
+        mkdir(p.str().c_str(), 0755);
+#endif
+    }
+    ::std::vector<::std::string> list_dir(const ::helpers::path& p)
+    {
+        ::std::vector<::std::string>    rv;
+#if _WIN32
+        WIN32_FIND_DATA find_data;
+        HANDLE find_handle = FindFirstFile( (p / "*").str().c_str(), &find_data );
+        if( find_handle == INVALID_HANDLE_VALUE )
+            return rv;
+        do
+        {
+            rv.push_back(find_data.cFileName);
+        } while( FindNextFile(find_handle, &find_data) );
+        FindClose(find_handle);
+#else
+        auto* dp = opendir(p.str().c_str());
+        if( dp == nullptr )
+            return rv;
+        while( const auto* dent = readdir(dp) )
+        {
+            rv.push_back(dent->d_name);
+        }
+        closedir(dp);
+#endif
+        return rv;
+    }
+    /// Copy a file, going via a temporary so the destination is never seen half-written
+    bool copy_file(const ::helpers::path& src, const ::helpers::path& dst)
+    {
+        auto tmp = dst + ".cache_tmp";
+        {
+            ::std::ifstream is { src.str(), ::std::ios::binary };
+            if( !is.good() )
+                return false;
+            ::std::ofstream os { tmp.str(), ::std::ios::binary };
+            // NOTE: Inserting an empty streambuf sets failbit, so check for EOF first
+            if( is.peek() != ::std::ifstream::traits_type::eof() )
+                os << is.rdbuf();
+            if( !os.good() )
+                return false;
+        }
+#if _WIN32
+        remove(dst.str().c_str());
+#endif
+        return rename(tmp.str().c_str(), dst.str().c_str()) == 0;
+    }
+    /// Copy a text file, passing its contents through `fcn`
+    template<typename Fcn>
+    bool copy_text_file(const ::helpers::path& src, const ::helpers::path& dst, Fcn fcn)
+    {
+        ::std::stringstream ss;
+        {
+            ::std::ifstream is { src.str(), ::std::ios::binary };
+            if( !is.good() )
+                return false;
+            if( is.peek() != ::std::ifstream::traits_type::eof() )
+                ss << is.rdbuf();
+        }
+        auto tmp = dst + ".cache_tmp";
+        {
+            ::std::ofstream os { tmp.str(), ::std::ios::binary };
+            os << fcn(ss.str());
+            if( !os.good() )
+                return false;
+        }
+#if _WIN32
+        remove(dst.str().c_str());
+#endif
+        return rename(tmp.str().c_str(), dst.str().c_str()) == 0;
+    }
+}
+
+Hasher::Hasher():
+    m_state { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 },
+    m_length(0),
+    m_block_len(0)
+{
+}
+void Hasher::process_block(const uint8_t* block)
+{
+    uint32_t    w[64];
+    for(int i = 0; i < 16; i ++)
+        w[i] = (uint32_t(block[i*4]) << 24) | (uint32_t(block[i*4+1]) << 16) | (uint32_t(block[i*4+2]) << 8) | uint32_t(block[i*4+3]);
+    for(int i = 16; i < 64; i ++)
+    {
+        uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+    for(int i = 0; i < 64; i ++)
+    {
+        uint32_t S1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + S1 + ch + SHA256_K[i] + w[i];
+        uint32_t S0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = S0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+    m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+}
+void Hasher::update(const void* data, size_t len)
+{
+    const auto* p = static_cast<const uint8_t*>(data);
+    m_length += len;
+    while( len > 0 )
+    {
+        size_t n = ::std::min(len, sizeof(m_block) - m_block_len);
+        ::std::memcpy(m_block + m_block_len, p, n);
+        m_block_len += n;
+        p += n;
+        len -= n;
+        if( m_block_len == sizeof(m_block) )
+        {
+            process_block(m_block);
+            m_block_len = 0;
+        }
+    }
+}
+bool Hasher::update_file(const ::helpers::path& path)
+{
+    ::std::ifstream is { path.str(), ::std::ios::binary };
+    if( !is.good() )
+        return false;
+    char    buf[1 << 14];
+    while( is.read(buf, sizeof(buf)) || is.gcount() > 0 )
+    {
+        update(buf, static_cast<size_t>(is.gcount()));
+    }
+    return true;
+}
+::std::string Hasher::finish()
+{
+    uint64_t bit_len = m_length * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+    pad = 0;
+    while( m_block_len != 56 )
+        update(&pad, 1);
+    uint8_t len_bytes[8];
+    for(int i = 0; i < 8; i ++)
+        len_bytes[i] = static_cast<uint8_t>(bit_len >> (56 - i*8));
+    update(len_bytes, 8);
+
+    static const char HEX[] = "0123456789abcdef";
+    ::std::string   rv;
+    for(auto v : m_state)
+    {
+        for(int i = 28; i >= 0; i -= 4)
+            rv += HEX[(v >> i) & 0xF];
+    }
+    return rv;
+}
+::std::string Hasher::for_file(const ::helpers::path& p)
+{
+    Hasher  h;
+    if( !h.update_file(p) )
+        return "";
+    return h.finish();
+}
+
+namespace {
+    const char* const OUTPUT_DIR_PLACEHOLDER = "${OUTPUT_DIR}";
+
+    bool is_path_sep(char c) {
+        return c == '/' || c == '\\';
+    }
+}
+
+ArtifactCache::ArtifactCache(::helpers::path dir, const ::helpers::path& output_dir):
+    m_dir(::std::move(dir)),
+    m_output_dir(output_dir.str())
+{
+    make_dir(m_dir);
+    for(const auto& d : { output_dir.str(), output_dir.to_absolute().str() })
+    {
+        if( d != "" && ::std::find(m_output_dirs.begin(), m_output_dirs.end(), d) == m_output_dirs.end() )
+            m_output_dirs.push_back(d);
+    }
+    // Longest first, in case one spelling is a suffix of the other
+    ::std::sort(m_output_dirs.begin(), m_output_dirs.end(), [](const ::std::string& a, const ::std::string& b){ return a.size() > b.size(); });
+}
+
+::std::string ArtifactCache::normalise(const ::std::string& s) const
+{
+    ::std::string   rv = s;
+    for(const auto& d : m_output_dirs)
+    {
+        size_t  pos = 0;
+        while( (pos = rv.find(d, pos)) != ::std::string::npos )
+        {
+            // Only replace whole paths: at the start of the string (or of an `a=b` value, or a word in a depfile/script)
+            // and followed by a separator or the end of the word
+            auto end = pos + d.size();
+            bool start_ok = (pos == 0 || ::std::strchr("= \t\n\"'", rv[pos-1]) != nullptr);
+            bool end_ok = (end == rv.size() || is_path_sep(rv[end]) || ::std::strchr(": \t\n\"'", rv[end]) != nullptr);
+            if( start_ok && end_ok ) {
+                rv.replace(pos, d.size(), OUTPUT_DIR_PLACEHOLDER);
+                pos += ::std::strlen(OUTPUT_DIR_PLACEHOLDER);
+            }
+            else {
+                pos = end;
+            }
+        }
+    }
+    return rv;
+}
+::std::string ArtifactCache::expand(const ::std::string& s) const
+{
+    ::std::string   rv = s;
+    auto ph_len = ::std::strlen(OUTPUT_DIR_PLACEHOLDER);
+    size_t  pos = 0;
+    while( (pos = rv.find(OUTPUT_DIR_PLACEHOLDER, pos)) != ::std::string::npos )
+    {
+        rv.replace(pos, ph_len, m_output_dir);
+        pos += m_output_dir.size();
+    }
+    return rv;
+}
+
+bool ArtifactCache::restore(const ::std::string& key, const ::std::vector<::helpers::path>& outputs, size_t n_text) const
+{
+    auto key_dir = m_dir / key.substr(0, 2).c_str() / key.c_str();
+    // Cache of input hashes (multiple entries will usually list the same files)
+    ::std::map<::std::string, ::std::string>    input_hashes;
+    for(const auto& ent_name : list_dir(key_dir))
+    {
+        if( ent_name == "." || ent_name == ".." || ent_name.compare(0, 4, "tmp.") == 0 )
+            continue ;
+        auto ent_dir = key_dir / ent_name.c_str();
+        ::std::ifstream is { (ent_dir / "entry.txt").str() };
+        if( !is.good() )
+            continue ;
+
+        bool matches = true;
+        ::std::vector<unsigned> present_outputs;
+        ::std::string   line;
+        while( matches && ::std::getline(is, line) )
+        {
+            if( line.compare(0, 3, "in ") == 0 )
+            {
+                auto sep = line.find(' ', 3);
+                if( sep == ::std::string::npos ) {
+                    matches = false;
+                    break;
+                }
+                auto hash = line.substr(3, sep - 3);
+                auto path = line.substr(sep + 1);
+                // Paths in the output directory are stored with a placeholder, expand to this build's directory
+                path = expand(path);
+                auto it = input_hashes.find(path);
+                if( it == input_hashes.end() )
+                    it = input_hashes.insert(::std::make_pair(path, Hasher::for_file(path))).first;
+                if( it->second != hash ) {
+                    DEBUG("Cache entry " << ent_name << ": " << path << " changed");
+                    matches = false;
+                }
+            }
+            else if( line.compare(0, 4, "out ") == 0 )
+            {
+                auto idx = ::std::strtoul(line.c_str() + 4, nullptr, 10);
+                if( idx >= outputs.size() ) {
+                    matches = false;
+                    break;
+                }
+                present_outputs.push_back(idx);
+            }
+        }
+        if( !matches )
+            continue ;
+
+        DEBUG("Cache hit " << key << "/" << ent_name);
+        for(auto idx : present_outputs)
+        {
+            // Output directory might not exist yet (e.g. after a clean)
+            make_dir(outputs[idx].parent());
+            auto src = ent_dir / ::format("out", idx).c_str();
+            bool ok = idx < n_text
+                ? copy_text_file(src, outputs[idx], [&](const ::std::string& c){ return expand(c); })
+                : copy_file(src, outputs[idx]);
+            if( !ok ) {
+                DEBUG("Unable to restore " << outputs[idx] << " from cache");
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+void ArtifactCache::store(const ::std::string& key, const ::std::vector<::helpers::path>& inputs, const ::std::vector<::helpers::path>& outputs, size_t n_text) const
+{
+    // Entry contents (input hashes + which outputs exist), the entry is named by its hash
+    ::std::stringstream entry;
+    for(const auto& p : inputs)
+    {
+        auto h = Hasher::for_file(p);
+        if( h == "" ) {
+            DEBUG("Not caching " << key << " - Can't read input " << p);
+            return ;
+        }
+        entry << "in " << h << " " << normalise(p.str()) << "\n";
+    }
+    for(size_t i = 0; i < outputs.size(); i ++)
+    {
+        if( ::std::ifstream(outputs[i].str()).good() )
+            entry << "out " << i << "\n";
+    }
+    auto entry_str = entry.str();
+    Hasher  eh;
+    eh.update(entry_str);
+    auto entry_name = eh.finish();
+
+    auto key_dir = m_dir / key.substr(0, 2).c_str() / key.c_str();
+    make_dir(key_dir.parent());
+    make_dir(key_dir);
+    auto ent_dir = key_dir / entry_name.c_str();
+    if( ::std::ifstream((ent_dir / "entry.txt").str()).good() ) {
+        DEBUG("Already cached " << key << "/" << entry_name);
+        return ;
+    }
+
+    // Populate a temporary directory, then rename into place (so concurrent readers never see a partial entry)
+#if _WIN32
+    auto pid = GetCurrentProcessId();
+#else
+    auto pid = getpid();
+#endif
+    auto tmp_name = ::format("tmp.", entry_name, ".", pid);
+    auto tmp_dir = key_dir / tmp_name.c_str();
+    make_dir(tmp_dir);
+    ::std::vector<::helpers::path>  tmp_files;
+    bool ok = true;
+    for(size_t i = 0; ok && i < outputs.size(); i ++)
+    {
+        if( !::std::ifstream(outputs[i].str()).good() )
+            continue ;
+        auto dst = tmp_dir / ::format("out", i).c_str();
+        tmp_files.push_back(dst);
+        ok = i < n_text
+            ? copy_text_file(outputs[i], dst, [&](const ::std::string& c){ return normalise(c); })
+            : copy_file(outputs[i], dst);
+    }
+    if( ok )
+    {
+        auto dst = tmp_dir / "entry.txt";
+        tmp_files.push_back(dst);
+        ::std::ofstream os { dst.str() };
+        os << entry_str;
+        ok = os.good();
+    }
+    if( ok && rename(tmp_dir.str().c_str(), ent_dir.str().c_str()) == 0 )
+    {
+        DEBUG("Cached " << key << "/" << entry_name);
+        return ;
+    }
+    // Failed (or another process stored the same entry first), clean up
+    for(const auto& f : tmp_files)
+        remove(f.str().c_str());
+#if _WIN32
+    RemoveDirectory(tmp_dir.str().c_str());
+#else
+    rmdir(tmp_dir.str().c_str());
+#endif
+}
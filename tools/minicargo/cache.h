@@ -0,0 +1,78 @@
+/*
+ * minicargo - MRustC-specific clone of `cargo`
+ * - By John Hodge (Mutabah)
+ *
+ * cache.h
+ * - Content-addressed cache of build outputs
+ */
+#pragma once
+
+#include <path.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// SHA-256 hasher, producing a hex string
+class Hasher
+{
+    uint32_t    m_state[8];
+    uint64_t    m_length;
+    uint8_t     m_block[64];
+    size_t      m_block_len;
+public:
+    Hasher();
+
+    void update(const void* data, size_t len);
+    /// Hash a string (including a terminator, so adjacent strings can't alias)
+    void update(const ::std::string& s) {
+        update(s.data(), s.size());
+        update("", 1);
+    }
+    /// Hash the contents of a file, returns false if it can't be read
+    bool update_file(const ::helpers::path& p);
+
+    ::std::string finish();
+
+    /// Hash of a file's contents (empty string if it can't be read)
+    static ::std::string for_file(const ::helpers::path& p);
+private:
+    void process_block(const uint8_t* block);
+};
+
+/// On-disk cache of build outputs
+///
+/// Entries are looked up in two stages:
+/// - The key (a hash of the compiler, arguments and environment) selects a directory
+/// - Each entry in that directory lists the input files (from the depfile) and their hashes, the first entry with all
+///   inputs matching is used.
+/// - Paths under the output directory are stored relative to it (see `normalise`)
+class ArtifactCache
+{
+    ::helpers::path m_dir;
+    /// Spellings of the build's output directory (as given, and absolute), longest first
+    ::std::vector<::std::string>    m_output_dirs;
+    /// Output directory used when expanding the placeholder
+    ::std::string   m_output_dir;
+public:
+    ArtifactCache() {}
+    /// - `output_dir` is replaced by a placeholder in keys and recorded input paths, so entries can be shared between
+    ///   output directories
+    ArtifactCache(::helpers::path dir, const ::helpers::path& output_dir);
+
+    bool is_enabled() const { return m_dir.is_valid(); }
+
+    /// Replace references to the output directory in `s` (an argument, environment value, path, or text file) with a
+    /// placeholder
+    ::std::string normalise(const ::std::string& s) const;
+
+    /// Copy cached outputs (in the same order as passed to `store`) to `outputs`, returns false on a miss
+    /// - The first `n_text` outputs are text (e.g. the depfile) and have the output directory placeholder expanded
+    bool restore(const ::std::string& key, const ::std::vector<::helpers::path>& outputs, size_t n_text) const;
+    /// Save the outputs of a successful build
+    /// - Outputs that don't exist are skipped (and won't be restored)
+    /// - The first `n_text` outputs are text, and are stored normalised
+    void store(const ::std::string& key, const ::std::vector<::helpers::path>& inputs, const ::std::vector<::helpers::path>& outputs, size_t n_text) const;
+private:
+    /// Reverse of `normalise`, for this build's output directory
+    ::std::string expand(const ::std::string& s) const;
+};
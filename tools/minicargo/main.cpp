@@ -17,6 +17,7 @@
 #include <toml.h>   // TomlFile (workspace)
 #include <fstream>  // for workspace enumeration
 #include "cfg.hpp"
+#include <jobserver.h>
 
 struct ProgramOptions
 {
@@ -35,8 +36,13 @@ struct ProgramOptions
     // Output/build directory
     const char* output_directory = nullptr;
 
+    /// Shared cache of build outputs (can also be set with `MINICARGO_CACHE_DIR`)
+    const char* cache_directory = nullptr;
+
     // Emit Monomorphised MIR instead of C
     bool emit_mmir = false;
+    /// Re-use generic instances emitted by dependencies (`-Z share-generics`)
+    bool share_generics = false;
 
     // Target name (if null, defaults to host)
     const char* target = nullptr;
@@ -46,6 +52,10 @@ struct ProgramOptions
 
     // Number of build jobs to run at a time
     unsigned build_jobs = 1;
+    /// Start dependent library builds once metadata is emitted (instead of waiting for codegen)
+    bool pipeline = true;
+    /// Collect per-phase compiler timings (`--timings-out`) for the whole build
+    bool phase_timings = false;
 
     // Pause for user input before quitting (useful for MSVC debugging)
     bool pause_before_quit = false;
@@ -220,6 +230,15 @@ int main(int argc, const char* argv[])
         build_opts.output_dir = opts.output_directory ? ::helpers::path(opts.output_directory) : ::helpers::path("output");
         build_opts.lib_search_dirs.reserve(opts.lib_search_dirs.size());
         build_opts.emit_mmir = opts.emit_mmir;
+        build_opts.share_generics = opts.share_generics;
+        build_opts.pipeline = opts.pipeline;
+        build_opts.phase_timings = opts.phase_timings;
+        if( opts.cache_directory ) {
+            build_opts.cache_dir = ::helpers::path(opts.cache_directory);
+        }
+        else if( const char* e = getenv("MINICARGO_CACHE_DIR") ) {
+            build_opts.cache_dir = ::helpers::path(e);
+        }
         build_opts.target_name = opts.target;
         for(const auto* d : opts.lib_search_dirs)
             build_opts.lib_search_dirs.push_back( ::helpers::path(d) );
@@ -230,6 +249,15 @@ int main(int argc, const char* argv[])
             ;
         Debug_SetPhase("Enumerate Build");
         auto build_list = BuildList(m, build_opts);
+        // Job slots: join the parent make's jobserver, or host one so that mrustc (and the C compiler) share the `-j` limit
+        ::std::unique_ptr<JobServer>    jobserver;
+        if( opts.build_jobs > 0 )
+        {
+            jobserver = JobServer::from_env(/*implicit_available=*/true);
+            if( !jobserver && opts.build_jobs > 1 )
+                jobserver = JobServer::create(opts.build_jobs);
+            JobServer::s_global = jobserver.get();
+        }
         Debug_SetPhase("Run Build");
         if( !build_list.build(::std::move(build_opts), opts.build_jobs) )
         {
@@ -313,6 +341,9 @@ int ProgramOptions::parse(int argc, const char* argv[])
                 if( ::std::strcmp(arg, "emit-mmir") == 0 ) {
                     this->emit_mmir = true;
                 }
+                else if( ::std::strcmp(arg, "share-generics") == 0 ) {
+                    this->share_generics = true;
+                }
                 else {
                     ::std::cerr << "Unknown debug option -Z " << arg << ::std::endl;
                     return 1;
@@ -368,6 +399,13 @@ int ProgramOptions::parse(int argc, const char* argv[])
                 }
                 this->output_directory = argv[++i];
             }
+            else if( ::std::strcmp(arg, "--cache-dir") == 0 ) {
+                if(i+1 == argc) {
+                    ::std::cerr << "Flag " << arg << " takes an argument" << ::std::endl;
+                    return 1;
+                }
+                this->cache_directory = argv[++i];
+            }
             else if( ::std::strcmp(arg, "--target") == 0 ) {
                 if(i+1 == argc) {
                     ::std::cerr << "Flag " << arg << " takes an argument" << ::std::endl;
@@ -394,6 +432,12 @@ int ProgramOptions::parse(int argc, const char* argv[])
             else if( ::std::strcmp(arg, "--test") == 0 ) {
                 this->test = true;
             }
+            else if( ::std::strcmp(arg, "--no-pipeline") == 0 ) {
+                this->pipeline = false;
+            }
+            else if( ::std::strcmp(arg, "--phase-timings") == 0 ) {
+                this->phase_timings = true;
+            }
             else {
                 ::std::cerr << "Unknown flag " << arg << ::std::endl;
                 return 1;
@@ -428,8 +472,11 @@ void ProgramOptions::help() const
         << "--script-overrides <dir> : Directory containing <package>.txt files containing the build script output\n"
         << "--vendor-dir <dir>       : Directory containing vendored packages (from `cargo vendor`)\n"
         << "--output-dir,-o <dir>    : Specify the compiler output directory\n"
+        << "--cache-dir <dir>        : Restore/save build outputs in this content-addressed cache (or set MINICARGO_CACHE_DIR)\n"
         << "-L <dir>                 : Search for pre-built crates (e.g. libstd) in the specified directory\n"
         << "-j <count>               : Run at most <count> build tasks at once (default is to run only one)\n"
         << "-n                       : Don't build any packages, just list the packages that would be built\n"
+        << "--no-pipeline            : Wait for dependencies to fully build (instead of just their metadata)\n"
+        << "--phase-timings          : Total the compiler's per-phase time/memory over the build, in <output dir>/phase_timings.csv\n"
         ;
 }
@@ -10,6 +10,8 @@
 #include "value.hpp"
 #include <algorithm>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
 #include "debug.hpp"
 #include "miri.hpp"
 #include "../../src/common.hpp"
@@ -26,11 +28,105 @@ struct ProgramOptions
     ::std::string   logfile;
     // Arguments for the program
     ::std::vector<const char*>  args;
+    // Compare the binary and text forms of the input instead of running it
+    bool check_binary = false;
 
     int parse(int argc, const char* argv[]);
     void show_help(const char* prog) const;
 };
 
+/// Print everything loaded into a tree, in a stable order (for comparing the results of two loads)
+static void dump_tree(::std::ostream& os, const ModuleTree& tree)
+{
+    // Byte strings are printed as hex (they can contain NULs)
+    auto hex = [&](const uint8_t* p, size_t len) {
+        os << ::std::hex;
+        for(size_t i = 0; i < len; i ++)
+            os << " " << int(p[i]);
+        os << ::std::dec;
+        };
+    auto hex_str = [&](const ::std::string& s) { hex(reinterpret_cast<const uint8_t*>(s.data()), s.size()); };
+    tree.iterate_composites([&](RcString name, const DataType& dt) {
+        os << "type " << name << " populated=" << dt.populated << " SIZE " << dt.size << " ALIGN " << dt.alignment
+            << " DROP " << dt.drop_glue << " DSTMETA " << dt.dst_meta << "\n";
+        for(const auto& f : dt.fields)
+            os << "\t" << f.first << " = " << f.second << "\n";
+        os << "\t@" << dt.tag_path.base_field;
+        for(auto i : dt.tag_path.other_indexes)
+            os << "," << i;
+        os << "\n";
+        for(const auto& v : dt.variants)
+        {
+            os << "\t";
+            hex_str(v.tag_data);
+            os << " =" << v.data_field << "\n";
+        }
+        });
+    tree.iterate_statics([&](RcString name, const Static& s) {
+        os << "static " << name << ": " << s.ty << " =";
+        hex(s.init.bytes.data(), s.init.bytes.size());
+        os << "\n";
+        for(const auto& r : s.init.relocs)
+        {
+            os << "\t@" << r.ofs << "+" << r.len << " = " << r.fcn_path << " /";
+            hex_str(r.string);
+            os << "\n";
+        }
+        });
+    tree.iterate_functions([&](RcString name, const Function& f) {
+        os << "fn " << name << "(";
+        for(const auto& t : f.args)
+            os << t << ", ";
+        os << "): " << f.ret_ty << " = \"" << f.external.link_name << "\":\"" << f.external.link_abi << "\"\n";
+        for(const auto& t : f.m_mir.locals)
+            os << "\tlet " << t << "\n";
+        for(bool v : f.m_mir.drop_flags)
+            os << "\tlet df = " << v << "\n";
+        for(size_t i = 0; i < f.m_mir.blocks.size(); i ++)
+        {
+            os << "\t" << i << ":\n";
+            for(const auto& stmt : f.m_mir.blocks[i].statements)
+                os << "\t\t" << stmt << "\n";
+            os << "\t\t" << f.m_mir.blocks[i].terminator << "\n";
+        }
+        });
+}
+
+/// Load the input from both its binary and text forms, and check that they produce the same tree
+static int check_binary(const ProgramOptions& opts)
+{
+    if( !::std::ifstream(opts.infile + ".bin") )
+    {
+        ::std::cerr << "No binary form (" << opts.infile << ".bin) to check" << ::std::endl;
+        return 1;
+    }
+    ::std::stringstream dumps[2];
+    for(int i = 0; i < 2; i ++)
+    {
+        auto tree = ModuleTree { /*prefer_binary=*/i == 0 };
+        tree.load_file(opts.infile);
+        dump_tree(dumps[i], tree);
+    }
+
+    ::std::string   lines[2];
+    for(size_t line = 1; ; line ++)
+    {
+        bool ok0 = !!::std::getline(dumps[0], lines[0]);
+        bool ok1 = !!::std::getline(dumps[1], lines[1]);
+        if( !ok0 && !ok1 )
+            break;
+        if( ok0 != ok1 || lines[0] != lines[1] )
+        {
+            ::std::cerr << "Binary and text forms of " << opts.infile << " differ at line " << line << " of the dump" << ::std::endl;
+            ::std::cerr << "- binary: " << (ok0 ? lines[0] : "<end>") << ::std::endl;
+            ::std::cerr << "- text:   " << (ok1 ? lines[1] : "<end>") << ::std::endl;
+            return 1;
+        }
+    }
+    ::std::cout << "Binary and text forms of " << opts.infile << " match" << ::std::endl;
+    return 0;
+}
+
 int main(int argc, const char* argv[])
 {
     ProgramOptions  opts;
@@ -46,6 +142,19 @@ int main(int argc, const char* argv[])
         DebugSink::set_output_file(opts.logfile);
     }
 
+    if( opts.check_binary )
+    {
+        try
+        {
+            return check_binary(opts);
+        }
+        catch(const DebugExceptionError& /*e*/)
+        {
+            ::std::cerr << "Error encountered" << ::std::endl;
+            return 1;
+        }
+    }
+
     // Load HIR tree
     auto tree = ModuleTree {};
     try
@@ -76,11 +185,11 @@ int main(int argc, const char* argv[])
     // Create argc/argv based on input arguments
     auto argv_alloc = Allocation::new_alloc((1 + opts.args.size()) * POINTER_SIZE, "argv");
     argv_alloc->write_usize(0 * POINTER_SIZE, Allocation::PTR_BASE);
-    argv_alloc->relocations.push_back({ 0 * POINTER_SIZE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv0", opts.infile.c_str(), opts.infile.size() + 1)) });
+    argv_alloc->set_reloc(0 * POINTER_SIZE, POINTER_SIZE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv0", opts.infile.c_str(), opts.infile.size() + 1)));
     for(size_t i = 0; i < opts.args.size(); i ++)
     {
         argv_alloc->write_usize((1 + i) * POINTER_SIZE, Allocation::PTR_BASE);
-        argv_alloc->relocations.push_back({ (1 + i) * POINTER_SIZE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv", opts.args[i], ::std::strlen(opts.args[i]) + 1)) });
+        argv_alloc->set_reloc((1 + i) * POINTER_SIZE, POINTER_SIZE, RelocationPtr::new_ffi(FFIPointer::new_const_bytes("argv", opts.args[i], ::std::strlen(opts.args[i]) + 1)));
     }
     LOG_DEBUG("argv_alloc = " << *argv_alloc);
 
@@ -182,6 +291,9 @@ int ProgramOptions::parse(int argc, const char* argv[])
                 const char* opt = argv[++argidx];
                 this->logfile = opt;
             }
+            else if( ::std::strcmp(arg, "--check-binary") == 0 ) {
+                this->check_binary = true;
+            }
             //else if( ::std::strcmp(arg, "--api") == 0 ) {
             //}
             else {
@@ -200,4 +312,6 @@ int ProgramOptions::parse(int argc, const char* argv[])
 void ProgramOptions::show_help(const char* prog) const
 {
     ::std::cout << "USAGE: " << prog << " <infile> <... args>" << ::std::endl;
+    ::std::cout << "       " << prog << " --check-binary <infile>" << ::std::endl;
+    ::std::cout << "  Check that <infile>.bin loads to the same result as <infile> (and any crates it references)" << ::std::endl;
 }
@@ -292,98 +292,315 @@ struct MirHelpers
     {
     }
 
-    ValueRef get_value_and_type_root(const ::MIR::LValue::Storage& lv_root, ::HIR::TypeRef& ty)
+    // ----------------------------------------------------------------
+    // Block compilation
+    // ----------------------------------------------------------------
+    CompiledFunction::LValue compile_lvalue(const ::MIR::LValue& lv)
     {
-        switch(lv_root.tag())
+        CompiledFunction::LValue    rv;
+        auto& ty = rv.ty;
+        rv.root = lv.m_root.tag();
+        switch(lv.m_root.tag())
         {
         case ::MIR::LValue::Storage::TAGDEAD:    throw "";
         // --> Slots
-        TU_ARM(lv_root, Return, _e) {
+        TU_ARM(lv.m_root, Return, _e) {
             ty = this->frame.fcn->ret_ty;
-            return ValueRef(this->frame.ret);
             } break;
-        TU_ARM(lv_root, Local, e) {
+        TU_ARM(lv.m_root, Local, e) {
+            rv.root_idx = e;
             ty = this->frame.fcn->m_mir.locals.at(e);
-            return ValueRef(this->frame.locals.at(e));
             } break;
-        TU_ARM(lv_root, Argument, e) {
+        TU_ARM(lv.m_root, Argument, e) {
+            rv.root_idx = e;
             ty = this->frame.fcn->args.at(e);
-            return ValueRef(this->frame.args.at(e));
             } break;
-        TU_ARM(lv_root, Static, e) {
+        TU_ARM(lv.m_root, Static, e) {
             /*const*/ auto& s = this->thread.m_global.m_modtree.get_static(e);
             ty = s.ty;
-            return ValueRef( this->thread.m_global.m_statics.at(&s) );
+            rv.root_static = &this->thread.m_global.m_statics.at(&s);
             } break;
         }
-        throw "";
-    }
-    ValueRef get_value_and_type(const ::MIR::LValue& lv, ::HIR::TypeRef& ty)
-    {
-        auto vr = get_value_and_type_root(lv.m_root, ty);
         for(const auto& w : lv.m_wrappers)
         {
+            CompiledFunction::LValue::Step  step;
             switch(w.tag())
             {
             case ::MIR::LValue::Wrapper::TAGDEAD:    throw "";
             // --> Modifiers
             TU_ARM(w, Index, idx_var) {
-                auto idx = this->frame.locals.at(idx_var).read_usize(0);
+                step.ty = CompiledFunction::LValue::Step::Ty::Index;
+                step.idx_local = idx_var;
                 const auto* wrapper = ty.get_wrapper();
-                if( !wrapper )
-                {
-                    LOG_ERROR("Indexing non-array/slice - " << ty);
-                    throw "ERROR";
-                }
-                else if( wrapper->type == TypeWrapper::Ty::Array )
-                {
-                    ty = ty.get_inner();
-                    vr.m_offset += ty.get_size() * idx;
-                }
-                else if( wrapper->type == TypeWrapper::Ty::Slice )
-                {
-                    ty = ty.get_inner();
-                    LOG_ASSERT(vr.m_metadata, "No slice metadata");
-                    auto len = vr.m_metadata->read_usize(0);
-                    LOG_ASSERT(idx < len, "Slice index out of range");
-                    vr.m_offset += ty.get_size() * idx;
-                    vr.m_metadata.reset();
-                }
-                else
+                if( !wrapper || (wrapper->type != TypeWrapper::Ty::Array && wrapper->type != TypeWrapper::Ty::Slice) )
                 {
                     LOG_ERROR("Indexing non-array/slice - " << ty);
                     throw "ERROR";
                 }
+                step.is_slice = (wrapper->type == TypeWrapper::Ty::Slice);
+                ty = ty.get_inner();
+                step.ofs = ty.get_size();
                 } break;
             TU_ARM(w, Field, fld_idx) {
                 // TODO: if there's metadata present in the base, but the inner doesn't have metadata, clear the metadata
-                size_t inner_ofs;
-                auto inner_ty = ty.get_field(fld_idx, inner_ofs);
-                LOG_DEBUG("Field - " << ty << "#" << fld_idx << " = @" << inner_ofs << " " << inner_ty);
-                vr.m_offset += inner_ofs;
+                step.ty = CompiledFunction::LValue::Step::Ty::Offset;
+                auto inner_ty = ty.get_field(fld_idx, step.ofs);
+                LOG_DEBUG("Field - " << ty << "#" << fld_idx << " = @" << step.ofs << " " << inner_ty);
                 if( inner_ty.get_meta_type() == HIR::TypeRef(RawType::Unreachable) )
                 {
-                    LOG_ASSERT(vr.m_size >= inner_ty.get_size(), "Field didn't fit in the value - " << inner_ty.get_size() << " required, but " << vr.m_size << " available");
-                    vr.m_size = inner_ty.get_size();
+                    step.size = inner_ty.get_size();
                 }
                 ty = ::std::move(inner_ty);
                 }
             TU_ARM(w, Downcast, variant_index) {
+                step.ty = CompiledFunction::LValue::Step::Ty::Offset;
                 auto composite_ty = ::std::move(ty);
                 LOG_DEBUG("Downcast - " << composite_ty);
-
-                size_t inner_ofs;
-                ty = composite_ty.get_field(variant_index, inner_ofs);
-                vr.m_offset += inner_ofs;
+                ty = composite_ty.get_field(variant_index, step.ofs);
                 }
             TU_ARM(w, Deref, _) {
-                auto ptr_ty = ::std::move(ty);
-                ty = ptr_ty.get_inner();
-                LOG_DEBUG("Deref - " << vr << " into " << ty);
+                step.ty = CompiledFunction::LValue::Step::Ty::Deref;
+                ty = ty.get_inner();
+                const auto meta_ty = ty.get_meta_type();
+                if( meta_ty != RawType::Unreachable )
+                {
+                    step.meta_size = meta_ty.get_size();
+                    size_t  slice_inner_size;
+                    if( ty.has_slice_meta(slice_inner_size) ) {
+                        // Slice metadata, the size is the base size (if it's a struct) plus the slice
+                        // - `get_wrapper` will return non-null for `[T]`, special-case `str`
+                        step.slice_inner_size = slice_inner_size;
+                        step.size = (ty != RawType::Str && ty.get_wrapper() == nullptr ? ty.get_size() : 0);
+                    }
+                }
+                else
+                {
+                    step.size = ty.get_size();
+                }
+                } break;
+            }
+            step.ty_after = ty;
+            rv.steps.push_back(::std::move(step));
+        }
+        return rv;
+    }
+    CompiledFunction::Param compile_param(const ::MIR::Param& p)
+    {
+        CompiledFunction::Param rv;
+        switch(p.tag())
+        {
+        case ::MIR::Param::TAGDEAD: throw "";
+        TU_ARM(p, Constant, pe) {
+            rv.ty = CompiledFunction::Param::Ty::Constant;
+            rv.constant = const_to_value(pe, rv.lv.ty);
+            } break;
+        TU_ARM(p, Borrow, pe) {
+            rv.ty = CompiledFunction::Param::Ty::Borrow;
+            rv.bt = pe.type;
+            rv.lv = compile_lvalue(pe.val);
+            } break;
+        TU_ARM(p, LValue, pe) {
+            rv.ty = CompiledFunction::Param::Ty::LValue;
+            rv.lv = compile_lvalue(pe);
+            } break;
+        }
+        return rv;
+    }
+    CompiledFunction::Param compile_param(const ::MIR::LValue& lv)
+    {
+        CompiledFunction::Param rv;
+        rv.ty = CompiledFunction::Param::Ty::LValue;
+        rv.lv = compile_lvalue(lv);
+        return rv;
+    }
+    void compile_block(CompiledFunction::Block& blk, const ::MIR::BasicBlock& bb)
+    {
+        TRACE_FUNCTION_R(this->frame.fcn->my_path << " BB" << (&bb - &this->frame.fcn->m_mir.blocks.front()), "");
+        typedef CompiledFunction::Instr::Op Op;
+        blk.stmts.reserve(bb.statements.size());
+        for(const auto& stmt : bb.statements)
+        {
+            CompiledFunction::Instr instr;
+            instr.stmt = &stmt;
+            switch(stmt.tag())
+            {
+            case ::MIR::Statement::TAGDEAD: throw "";
+            TU_ARM(stmt, Assign, se) {
+                instr.dst = compile_lvalue(se.dst);
+                instr.op = Op::RValue;
+                switch(se.src.tag())
+                {
+                case ::MIR::RValue::TAGDEAD: throw "";
+                TU_ARM(se.src, Use, re) {
+                    instr.op = Op::Copy;
+                    instr.srcs.push_back(compile_param(re));
+                    } break;
+                TU_ARM(se.src, Constant, re) {
+                    instr.op = Op::Const;
+                    instr.constant = const_to_value(re);
+                    } break;
+                TU_ARM(se.src, Borrow, re) {
+                    instr.op = Op::Borrow;
+                    instr.srcs.push_back(compile_param(re.val));
+                    instr.srcs.back().ty = CompiledFunction::Param::Ty::Borrow;
+                    instr.srcs.back().bt = re.type;
+                    } break;
+                TU_ARM(se.src, Cast, re)
+                    instr.srcs.push_back(compile_param(re.val));
+                TU_ARM(se.src, BinOp, re) {
+                    instr.srcs.push_back(compile_param(re.val_l));
+                    instr.srcs.push_back(compile_param(re.val_r));
+                    }
+                TU_ARM(se.src, UniOp, re)
+                    instr.srcs.push_back(compile_param(re.val));
+                TU_ARM(se.src, DstMeta, re)
+                    instr.srcs.push_back(compile_param(re.val));
+                TU_ARM(se.src, DstPtr, re)
+                    instr.srcs.push_back(compile_param(re.val));
+                TU_ARM(se.src, MakeDst, re) {
+                    instr.srcs.push_back(compile_param(re.ptr_val));
+                    instr.srcs.push_back(compile_param(re.meta_val));
+                    }
+                TU_ARM(se.src, Tuple, re) {
+                    for(const auto& v : re.vals)
+                        instr.srcs.push_back(compile_param(v));
+                    }
+                TU_ARM(se.src, Array, re) {
+                    for(const auto& v : re.vals)
+                        instr.srcs.push_back(compile_param(v));
+                    }
+                TU_ARM(se.src, SizedArray, re)
+                    instr.srcs.push_back(compile_param(re.val));
+                TU_ARM(se.src, UnionVariant, re)
+                    instr.srcs.push_back(compile_param(re.val));
+                TU_ARM(se.src, EnumVariant, re) {
+                    for(const auto& v : re.vals)
+                        instr.srcs.push_back(compile_param(v));
+                    }
+                TU_ARM(se.src, Struct, re) {
+                    for(const auto& v : re.vals)
+                        instr.srcs.push_back(compile_param(v));
+                    }
+                }
+                } break;
+            TU_ARM(stmt, Drop, se) {
+                instr.op = Op::Drop;
+                instr.srcs.push_back(compile_param(se.slot));
+                } break;
+            TU_ARM(stmt, SetDropFlag, se) {
+                instr.op = Op::SetDropFlag;
+                } break;
+            case ::MIR::Statement::TAG_Asm:
+            case ::MIR::Statement::TAG_ScopeEnd:
+                instr.op = Op::Unsupported;
+                break;
+            }
+            blk.stmts.push_back(::std::move(instr));
+        }
+
+        auto& term = blk.term;
+        switch(bb.terminator.tag())
+        {
+        case ::MIR::Terminator::TAGDEAD:    throw "";
+        case ::MIR::Terminator::TAG_Incomplete:
+        case ::MIR::Terminator::TAG_Diverge:
+        case ::MIR::Terminator::TAG_Panic:
+        case ::MIR::Terminator::TAG_Goto:
+        case ::MIR::Terminator::TAG_Return:
+            break;
+        TU_ARM(bb.terminator, If, te) {
+            term.srcs.push_back(compile_param(te.cond));
+            } break;
+        TU_ARM(bb.terminator, Switch, te) {
+            term.srcs.push_back(compile_param(te.val));
+            const auto& ty = term.srcs.back().lv.ty;
+            LOG_ASSERT(ty.get_wrapper() == nullptr, "Matching on wrapped value - " << ty);
+            LOG_ASSERT(ty.inner_type == RawType::Composite, "Matching on non-coposite - " << ty);
+            const auto& dt = ty.composite_type();
 
+            // Get offset, and index the variant tags
+            auto& tbl = blk.variants;
+            ::HIR::TypeRef  tag_ty;
+            tbl.tag_ofs = ty.get_field_ofs(dt.tag_path.base_field, dt.tag_path.other_indexes, tag_ty);
+            tbl.tag_size = tag_ty.get_size();
+            for(size_t i = 0; i < dt.variants.size(); i ++)
+            {
+                const auto& var = dt.variants[i];
+                if( var.tag_data.size() == 0 )
+                {
+                    // Save as the default, error for multiple defaults
+                    if( tbl.default_variant != SIZE_MAX )
+                    {
+                        LOG_FATAL("Two variants with no tag in Switch - " << ty);
+                    }
+                    tbl.default_variant = i;
+                }
+                else
+                {
+                    LOG_ASSERT(var.tag_data.size() == tbl.tag_size, "Mismatch in tag data size");
+                    // Keep the first variant with a given tag
+                    tbl.variants.insert(::std::make_pair(var.tag_data, i));
+                }
+            }
+            } break;
+        TU_ARM(bb.terminator, SwitchValue, te) {
+            term.srcs.push_back(compile_param(te.val));
+            } break;
+        TU_ARM(bb.terminator, Call, te) {
+            term.dst = compile_lvalue(te.ret_val);
+            for(const auto& a : te.args)
+                term.srcs.push_back(compile_param(a));
+            if( te.fcn.is_Value() )
+                term.srcs.push_back(compile_param(te.fcn.as_Value()));
+            } break;
+        }
+        blk.is_compiled = true;
+    }
+
+    // ----------------------------------------------------------------
+    // Evaluation of compiled lvalues/operands
+    // ----------------------------------------------------------------
+    ValueRef get_value_ref_root(const CompiledFunction::LValue& lv)
+    {
+        switch(lv.root)
+        {
+        case ::MIR::LValue::Storage::TAGDEAD:    throw "";
+        case ::MIR::LValue::Storage::TAG_Return:    return ValueRef(this->frame.ret);
+        case ::MIR::LValue::Storage::TAG_Local:     return ValueRef(this->frame.locals[lv.root_idx]);
+        case ::MIR::LValue::Storage::TAG_Argument:  return ValueRef(this->frame.args.at(lv.root_idx));
+        case ::MIR::LValue::Storage::TAG_Static:    return ValueRef(*lv.root_static);
+        }
+        throw "";
+    }
+    ValueRef get_value_ref(const CompiledFunction::LValue& lv)
+    {
+        auto vr = get_value_ref_root(lv);
+        for(const auto& step : lv.steps)
+        {
+            switch(step.ty)
+            {
+            case CompiledFunction::LValue::Step::Ty::Offset:
+                vr.m_offset += step.ofs;
+                if( step.size != SIZE_MAX )
+                {
+                    LOG_ASSERT(vr.m_size >= step.size, "Field didn't fit in the value - " << step.size << " required, but " << vr.m_size << " available");
+                    vr.m_size = step.size;
+                }
+                break;
+            case CompiledFunction::LValue::Step::Ty::Index: {
+                auto idx = this->frame.locals.at(step.idx_local).read_usize(0);
+                if( step.is_slice )
+                {
+                    LOG_ASSERT(vr.m_metadata, "No slice metadata");
+                    auto len = vr.m_metadata->read_usize(0);
+                    LOG_ASSERT(idx < len, "Slice index out of range");
+                    vr.m_metadata.reset();
+                }
+                vr.m_offset += step.ofs * idx;
+                } break;
+            case CompiledFunction::LValue::Step::Ty::Deref: {
+                LOG_DEBUG("Deref - " << vr << " into " << step.ty_after);
                 LOG_ASSERT(vr.m_size >= POINTER_SIZE, "Deref pointer isn't large enough to be a pointer");
-                // TODO: Move the metadata machinery into `deref` (or at least the logic needed to get the value size)
-                //auto inner_val = vr.deref(0, ty);
                 size_t ofs = vr.read_usize(0);
                 LOG_ASSERT(ofs != 0, "Dereferencing NULL pointer");
                 auto alloc = vr.get_relocation(0);
@@ -393,42 +610,17 @@ struct MirHelpers
                     LOG_ASSERT(ofs >= Allocation::PTR_BASE, "Dereferencing invalid pointer - " << ofs << " into " << alloc);
                     ofs -= Allocation::PTR_BASE;
                 }
-                else
-                {
-                }
 
-                // There MUST be a relocation at this point with a valid allocation.
-                LOG_TRACE("Interpret " << alloc << " + " << ofs << " as value of type " << ty);
-                // NOTE: No alloc can happen when dereferencing a zero-sized pointer
-                if( alloc.is_alloc() )
-                {
-                    //LOG_DEBUG("Deref - lvr=" << ::MIR::LValue::CRef(lv, &w - &lv.m_wrappers.front()) << " alloc=" << alloc.alloc());
-                }
-                else
-                {
-                    LOG_ASSERT(ty.get_meta_type() != RawType::Unreachable || ty.get_size() >= 0, "Dereference (giving a non-ZST) with no allocation");
-                }
                 size_t size;
-
-                const auto meta_ty = ty.get_meta_type();
                 ::std::shared_ptr<Value>    meta_val;
                 // If the type has metadata, store it.
-                if( meta_ty != RawType::Unreachable )
+                if( step.meta_size > 0 )
                 {
-                    auto meta_size = meta_ty.get_size();
-                    LOG_ASSERT(vr.m_size == POINTER_SIZE + meta_size, "Deref of " << ty << ", but pointer isn't correct size");
-                    meta_val = ::std::make_shared<Value>( vr.read_value(POINTER_SIZE, meta_size) );
-
-                    size_t    slice_inner_size;
-                    if( ty.has_slice_meta(slice_inner_size) ) {
-                        // Slice metadata, add the base size (if it's a struct) to the variable size
-                        // - `get_wrapper` will return non-null for `[T]`, special-case `str`
-                        size = (ty != RawType::Str && ty.get_wrapper() == nullptr ? ty.get_size() : 0) + meta_val->read_usize(0) * slice_inner_size;
+                    LOG_ASSERT(vr.m_size == POINTER_SIZE + step.meta_size, "Deref of " << step.ty_after << ", but pointer isn't correct size");
+                    meta_val = ::std::make_shared<Value>( vr.read_value(POINTER_SIZE, step.meta_size) );
+                    if( step.slice_inner_size != SIZE_MAX ) {
+                        size = step.size + meta_val->read_usize(0) * step.slice_inner_size;
                     }
-                    //else if( ty == RawType::TraitObject) {
-                    //    // NOTE: Getting the size from the allocation is semi-valid, as you can't sub-slice trait objects
-                    //    size = alloc.get_size() - ofs;
-                    //}
                     else {
                         LOG_DEBUG("> Meta " << *meta_val << ", size = " << alloc.get_size() << " - " << ofs);
                         // TODO: if the inner type is a trait object, then check that it has an allocation.
@@ -437,9 +629,8 @@ struct MirHelpers
                 }
                 else
                 {
-                    LOG_DEBUG("sizeof(" << ty << ") = " << ty.get_size());
-                    LOG_ASSERT(vr.m_size == POINTER_SIZE, "Deref of a value that isn't a pointer-sized value (size=" << vr << ") - " << vr << ": " << ptr_ty);
-                    size = ty.get_size();
+                    LOG_ASSERT(vr.m_size == POINTER_SIZE, "Deref of a value that isn't a pointer-sized value (size=" << vr << ") - " << vr << " to " << step.ty_after);
+                    size = step.size;
                     if( !alloc && size > 0 ) {
                         LOG_ERROR("Deref of a non-ZST pointer with no relocation - " << vr);
                     }
@@ -453,36 +644,15 @@ struct MirHelpers
         }
         return vr;
     }
-    ValueRef get_value_ref(const ::MIR::LValue& lv)
-    {
-        ::HIR::TypeRef  tmp;
-        return get_value_and_type(lv, tmp);
-    }
 
-    ::HIR::TypeRef get_lvalue_ty(const ::MIR::LValue& lv)
+    Value read_lvalue(const CompiledFunction::LValue& lv)
     {
-        ::HIR::TypeRef  ty;
-        get_value_and_type(lv, ty);
-        return ty;
+        return get_value_ref(lv).read_value(0, lv.ty.get_size());
     }
-
-    Value read_lvalue_with_ty(const ::MIR::LValue& lv, ::HIR::TypeRef& ty)
-    {
-        auto base_value = get_value_and_type(lv, ty);
-
-        return base_value.read_value(0, ty.get_size());
-    }
-    Value read_lvalue(const ::MIR::LValue& lv)
-    {
-        ::HIR::TypeRef  ty;
-        return read_lvalue_with_ty(lv, ty);
-    }
-    void write_lvalue(const ::MIR::LValue& lv, Value val)
+    void write_lvalue(const CompiledFunction::LValue& lv, Value val)
     {
         // TODO: Ensure that target is writable? Or should write_value do that?
-        //LOG_DEBUG(lv << " = " << val);
-        ::HIR::TypeRef  ty;
-        auto base_value = get_value_and_type(lv, ty);
+        auto base_value = get_value_ref(lv);
 
         if( val.size() > 0 )
         {
@@ -495,10 +665,9 @@ struct MirHelpers
         }
     }
 
-    Value borrow_value(const ::MIR::LValue& lv, ::HIR::BorrowType bt, ::HIR::TypeRef& dst_ty)
+    Value borrow_value(const CompiledFunction::LValue& lv, ::HIR::BorrowType bt)
     {
-        ::HIR::TypeRef  src_ty;
-        ValueRef src_base_value = this->get_value_and_type(lv, src_ty);
+        ValueRef src_base_value = this->get_value_ref(lv);
         auto alloc = src_base_value.m_alloc;
         // If the source doesn't yet have a relocation, give it a backing allocation so we can borrow
         if( !alloc && src_base_value.m_value )
@@ -511,12 +680,11 @@ struct MirHelpers
         else
             LOG_DEBUG("Borrow - alloc=" << alloc);
         size_t ofs = src_base_value.m_offset;
-        const auto meta = src_ty.get_meta_type();
-        dst_ty = src_ty.wrapped(TypeWrapper::Ty::Borrow, static_cast<size_t>(bt));
+        const auto meta = lv.ty.get_meta_type();
         LOG_DEBUG("Borrow - ofs=" << ofs << ", meta_ty=" << meta);
 
         // Create the pointer (can this just store into the target?)
-        auto new_val = Value(dst_ty);
+        auto new_val = Value(lv.ty.wrapped(TypeWrapper::Ty::Borrow, static_cast<size_t>(bt)));
         new_val.write_ptr(0, Allocation::PTR_BASE + ofs, ::std::move(alloc));
         // - Add metadata if required
         if( meta != RawType::Unreachable )
@@ -552,7 +720,8 @@ struct MirHelpers
             return val;
             } break;
         TU_ARM(c, Bool, ce) {
-            Value val = Value(::HIR::TypeRef { RawType::Bool });
+            ty = ::HIR::TypeRef(RawType::Bool);
+            Value val = Value(ty);
             val.write_bytes(0, &ce.v, 1);
             return val;
             } break;
@@ -616,38 +785,31 @@ struct MirHelpers
         ::HIR::TypeRef  ty;
         return const_to_value(c, ty);
     }
-    Value param_to_value(const ::MIR::Param& p, ::HIR::TypeRef& ty)
+    Value param_to_value(const CompiledFunction::Param& p)
     {
-        switch(p.tag())
+        switch(p.ty)
         {
-        case ::MIR::Param::TAGDEAD: throw "";
-        TU_ARM(p, Constant, pe)
-            return const_to_value(pe, ty);
-        TU_ARM(p, Borrow, pe)
-            return borrow_value(pe.val, pe.type, ty);
-        TU_ARM(p, LValue, pe)
-            return read_lvalue_with_ty(pe, ty);
+        case CompiledFunction::Param::Ty::Constant:
+            return Value(p.constant);
+        case CompiledFunction::Param::Ty::Borrow:
+            return borrow_value(p.lv, p.bt);
+        case CompiledFunction::Param::Ty::LValue:
+            return read_lvalue(p.lv);
         }
         throw "";
     }
-    Value param_to_value(const ::MIR::Param& p)
-    {
-        ::HIR::TypeRef  ty;
-        return param_to_value(p, ty);
-    }
 
-    ValueRef get_value_ref_param(const ::MIR::Param& p, Value& tmp, ::HIR::TypeRef& ty)
+    ValueRef get_value_ref_param(const CompiledFunction::Param& p, Value& tmp)
     {
-        switch(p.tag())
+        switch(p.ty)
         {
-        case ::MIR::Param::TAGDEAD: throw "";
-        TU_ARM(p, Constant, pe)
-            tmp = const_to_value(pe, ty);
-            return ValueRef(tmp, 0, ty.get_size());
-        TU_ARM(p, Borrow, pe)
+        case CompiledFunction::Param::Ty::Constant:
+            tmp = Value(p.constant);
+            return ValueRef(tmp, 0, p.lv.ty.get_size());
+        case CompiledFunction::Param::Ty::Borrow:
             LOG_TODO("");
-        TU_ARM(p, LValue, pe)
-            return get_value_and_type(pe, ty);
+        case CompiledFunction::Param::Ty::LValue:
+            return get_value_ref(p.lv);
         }
         throw "";
     }
@@ -744,6 +906,83 @@ GlobalState::GlobalState(const ModuleTree& modtree):
     m_fcn_overrides.insert(::std::make_pair( make_simplepath("std"      , {"sys", "imp", "stack_overflow", "imp", "init"}), cb_nop));
     m_fcn_overrides.insert(::std::make_pair( make_simplepath("std#0_0_0", {"sys", "imp", "stack_overflow", "imp", "init"}), cb_nop));
 }
+GlobalState::~GlobalState()
+{
+}
+CompiledFunction& GlobalState::get_compiled(const Function& fcn)
+{
+    auto it = m_compiled_functions.find(&fcn);
+    if( it == m_compiled_functions.end() )
+    {
+        it = m_compiled_functions.insert(::std::make_pair( &fcn, ::std::unique_ptr<CompiledFunction>(new CompiledFunction(fcn)) )).first;
+    }
+    return *it->second;
+}
+
+// ====================================================================
+// Pre-computed terminator data
+// ====================================================================
+CompiledFunction::CompiledFunction(const Function& fcn):
+    blocks( fcn.m_mir.blocks.size() )
+{
+    for(size_t i = 0; i < fcn.m_mir.blocks.size(); i ++)
+    {
+        const auto& term = fcn.m_mir.blocks[i].terminator;
+        if( const auto* te = term.opt_SwitchValue() )
+        {
+            ::std::vector<uint64_t> keys;
+            TU_MATCH_HDRA( (te->values), {)
+            TU_ARMA(Unsigned, vals) {
+                keys = vals;
+                }
+            TU_ARMA(Signed, vals) {
+                // Flip the sign bit so the keys are ordered (keeps negative ranges dense)
+                for(auto v : vals)
+                    keys.push_back( static_cast<uint64_t>(v) ^ (1ull << 63) );
+                }
+            TU_ARMA(String, vals) {
+                // Rare, left as a linear search
+                }
+            }
+            blocks[i].values.build(::std::move(keys));
+        }
+    }
+}
+void CompiledFunction::ValueTable::build(::std::vector<uint64_t> keys)
+{
+    if( keys.empty() )
+        return ;
+    auto minmax = ::std::minmax_element(keys.begin(), keys.end());
+    uint64_t range = *minmax.second - *minmax.first;
+    if( range < keys.size() * 2 + 8 )
+    {
+        this->base = *minmax.first;
+        this->dense.resize(range + 1, SIZE_MAX);
+        // Iterate in reverse so the first arm for a duplicated value wins
+        for(size_t i = keys.size(); i --; )
+            this->dense[keys[i] - this->base] = i;
+    }
+    else
+    {
+        for(size_t i = 0; i < keys.size(); i ++)
+            this->sorted.push_back(::std::make_pair(keys[i], i));
+        // Stable, so the first arm for a duplicated value wins
+        ::std::stable_sort(this->sorted.begin(), this->sorted.end(), [](const ::std::pair<uint64_t,size_t>& a, const ::std::pair<uint64_t,size_t>& b){ return a.first < b.first; });
+    }
+}
+size_t CompiledFunction::ValueTable::lookup(uint64_t key) const
+{
+    if( !this->dense.empty() )
+    {
+        if( key < this->base || key - this->base >= this->dense.size() )
+            return SIZE_MAX;
+        return this->dense[key - this->base];
+    }
+    auto it = ::std::lower_bound(this->sorted.begin(), this->sorted.end(), key, [](const ::std::pair<uint64_t,size_t>& e, uint64_t k){ return e.first < k; });
+    if( it != this->sorted.end() && it->first == key )
+        return it->second;
+    return SIZE_MAX;
+}
 
 // ====================================================================
 //
@@ -795,33 +1034,48 @@ bool InterpreterThread::step_one(Value& out_thread_result)
 
     MirHelpers  state { *this, cur_frame };
 
+    if( !cur_frame.compiled )
+    {
+        cur_frame.compiled = &m_global.get_compiled(*cur_frame.fcn);
+    }
+    auto& bb_info = cur_frame.compiled->blocks[cur_frame.bb_idx];
+    if( !bb_info.is_compiled )
+    {
+        state.compile_block(bb_info, bb);
+    }
+
     if( cur_frame.stmt_idx < bb.statements.size() )
     {
-        const auto& stmt = bb.statements[cur_frame.stmt_idx];
+        typedef CompiledFunction::Instr::Op Op;
+        const auto& instr = bb_info.stmts[cur_frame.stmt_idx];
+        const auto& stmt = *instr.stmt;
         LOG_DEBUG("=== F" << cur_frame.frame_index << " BB" << cur_frame.bb_idx << "/" << cur_frame.stmt_idx << ": " << stmt);
-        switch(stmt.tag())
+        Value   new_val;
+        switch(instr.op)
         {
-        case ::MIR::Statement::TAGDEAD: throw "";
-        TU_ARM(stmt, Assign, se) {
-            Value   new_val;
+        case Op::Copy:
+            new_val = state.read_lvalue(instr.srcs[0].lv);
+            break;
+        case Op::Const:
+            new_val = Value(instr.constant);
+            break;
+        case Op::Borrow:
+            new_val = state.borrow_value(instr.srcs[0].lv, instr.srcs[0].bt);
+            break;
+        case Op::RValue: {
+            const auto& se = stmt.as_Assign();
             switch(se.src.tag())
             {
             case ::MIR::RValue::TAGDEAD: throw "";
-            TU_ARM(se.src, Use, re) {
-                new_val = state.read_lvalue(re);
-                } break;
-            TU_ARM(se.src, Constant, re) {
-                new_val = state.const_to_value(re);
-                } break;
-            TU_ARM(se.src, Borrow, re) {
-                HIR::TypeRef    dst_ty;
-                new_val = state.borrow_value(re.val, re.type, dst_ty);
-                } break;
+            case ::MIR::RValue::TAG_Use:
+            case ::MIR::RValue::TAG_Constant:
+            case ::MIR::RValue::TAG_Borrow:
+                LOG_BUG("Rvalue should have been lowered - " << stmt);
             TU_ARM(se.src, Cast, re) {
                 // Determine the type of cast, is it a reinterpret or is it a value transform?
                 // - Float <-> integer is a transform, anything else should be a reinterpret.
-                ::HIR::TypeRef  src_ty;
-                auto src_value = state.get_value_and_type(re.val, src_ty);
+                const auto& src_ty = instr.srcs[0].lv.ty;
+                auto src_value = state.get_value_ref(instr.srcs[0].lv);
 
                 new_val = Value(re.type);
                 if( re.type == src_ty )
@@ -1169,10 +1423,11 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 }
                 } break;
             TU_ARM(se.src, BinOp, re) {
-                ::HIR::TypeRef  ty_l, ty_r;
+                const auto& ty_l = instr.srcs[0].lv.ty;
+                const auto& ty_r = instr.srcs[1].lv.ty;
                 Value   tmp_l, tmp_r;
-                auto v_l = state.get_value_ref_param(re.val_l, tmp_l, ty_l);
-                auto v_r = state.get_value_ref_param(re.val_r, tmp_r, ty_r);
+                auto v_l = state.get_value_ref_param(instr.srcs[0], tmp_l);
+                auto v_r = state.get_value_ref_param(instr.srcs[1], tmp_r);
                 LOG_DEBUG(v_l << " (" << ty_l <<") ? " << v_r << " (" << ty_r <<")");
 
                 switch(re.op)
@@ -1440,8 +1695,8 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 }
                 } break;
             TU_ARM(se.src, UniOp, re) {
-                ::HIR::TypeRef  ty;
-                auto v = state.get_value_and_type(re.val, ty);
+                const auto& ty = instr.srcs[0].lv.ty;
+                auto v = state.get_value_ref(instr.srcs[0].lv);
                 LOG_ASSERT(ty.get_wrapper() == nullptr, "UniOp on wrapped type - " << ty);
                 new_val = Value(ty);
                 switch(re.op)
@@ -1506,33 +1761,27 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 }
                 } break;
             TU_ARM(se.src, DstMeta, re) {
-                auto ptr = state.get_value_ref(re.val);
-
-                ::HIR::TypeRef  dst_ty;
-                state.get_value_and_type(se.dst, dst_ty);
-                new_val = ptr.read_value(POINTER_SIZE, dst_ty.get_size());
+                auto ptr = state.get_value_ref(instr.srcs[0].lv);
+                new_val = ptr.read_value(POINTER_SIZE, instr.dst.ty.get_size());
                 } break;
             TU_ARM(se.src, DstPtr, re) {
-                auto ptr = state.get_value_ref(re.val);
-
+                auto ptr = state.get_value_ref(instr.srcs[0].lv);
                 new_val = ptr.read_value(0, POINTER_SIZE);
                 } break;
             TU_ARM(se.src, MakeDst, re) {
                 // - Get target type, just for some assertions
-                ::HIR::TypeRef  dst_ty;
-                state.get_value_and_type(se.dst, dst_ty);
+                const auto& dst_ty = instr.dst.ty;
                 new_val = Value(dst_ty);
 
-                auto ptr  = state.param_to_value(re.ptr_val );
-                auto meta = state.param_to_value(re.meta_val);
+                auto ptr  = state.param_to_value(instr.srcs[0]);
+                auto meta = state.param_to_value(instr.srcs[1]);
                 LOG_DEBUG("ty=" << dst_ty << ", ptr=" << ptr << ", meta=" << meta);
 
                 new_val.write_value(0, ::std::move(ptr));
                 new_val.write_value(POINTER_SIZE, ::std::move(meta));
                 } break;
             TU_ARM(se.src, Tuple, re) {
-                ::HIR::TypeRef  dst_ty;
-                state.get_value_and_type(se.dst, dst_ty);
+                const auto& dst_ty = instr.dst.ty;
                 new_val = Value(dst_ty);
 
                 if( dst_ty.inner_type == RawType::Unit )
@@ -1545,28 +1794,26 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                     for(size_t i = 0; i < re.vals.size(); i++)
                     {
                         auto fld_ofs = dst_ty.composite_type().fields.at(i).first;
-                        new_val.write_value(fld_ofs, state.param_to_value(re.vals[i]));
+                        new_val.write_value(fld_ofs, state.param_to_value(instr.srcs[i]));
                     }
                 }
                 } break;
             TU_ARM(se.src, Array, re) {
-                ::HIR::TypeRef  dst_ty;
-                state.get_value_and_type(se.dst, dst_ty);
+                const auto& dst_ty = instr.dst.ty;
                 new_val = Value(dst_ty);
                 // TODO: Assert that type is an array
                 auto inner_ty = dst_ty.get_inner();
                 size_t stride = inner_ty.get_size();
 
                 size_t ofs = 0;
-                for(const auto& v : re.vals)
+                for(const auto& v : instr.srcs)
                 {
                     new_val.write_value(ofs, state.param_to_value(v));
                     ofs += stride;
                 }
                 } break;
             TU_ARM(se.src, SizedArray, re) {
-                ::HIR::TypeRef  dst_ty;
-                state.get_value_and_type(se.dst, dst_ty);
+                const auto& dst_ty = instr.dst.ty;
                 new_val = Value(dst_ty);
                 // TODO: Assert that type is an array
                 auto inner_ty = dst_ty.get_inner();
@@ -1575,7 +1822,7 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 size_t ofs = 0;
                 for(size_t i = 0; i < re.count; i++)
                 {
-                    new_val.write_value(ofs, state.param_to_value(re.val));
+                    new_val.write_value(ofs, state.param_to_value(instr.srcs[0]));
                     ofs += stride;
                 }
                 } break;
@@ -1589,7 +1836,7 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 // Union, no tag
                 const auto& fld = data_ty.fields.at(re.index);
 
-                new_val.write_value(fld.first, state.param_to_value(re.val));
+                new_val.write_value(fld.first, state.param_to_value(instr.srcs[0]));
                 LOG_DEBUG("UnionVariant " << new_val);
                 }
             TU_ARM(se.src, EnumVariant, re) {
@@ -1610,7 +1857,7 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                     for(size_t i = 0; i < re.vals.size(); i++)
                     {
                         auto fld_ofs = fld.first + fld.second.composite_type().fields.at(i).first;
-                        auto v = state.param_to_value(re.vals[i]);
+                        auto v = state.param_to_value(instr.srcs[i]);
                         LOG_DEBUG("EnumVariant - @" << fld_ofs << " = " << v);
                         new_val.write_value(fld_ofs, ::std::move(v));
                     }
@@ -1628,8 +1875,7 @@ bool InterpreterThread::step_one(Value& out_thread_result)
             TU_ARM(se.src, Struct, re) {
                 const auto& data_ty = m_global.m_modtree.get_composite(re.path.n);
 
-                ::HIR::TypeRef  dst_ty;
-                state.get_value_and_type(se.dst, dst_ty);
+                const auto& dst_ty = instr.dst.ty;
                 new_val = Value(dst_ty);
                 LOG_ASSERT(dst_ty.inner_type == RawType::Composite, dst_ty);
                 LOG_ASSERT(dst_ty.ptr.composite_type == &data_ty, "Destination type of RValue::Struct isn't the same as the input");
@@ -1637,23 +1883,19 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 for(size_t i = 0; i < re.vals.size(); i++)
                 {
                     auto fld_ofs = data_ty.fields.at(i).first;
-                    auto v = state.param_to_value(re.vals[i]);
+                    auto v = state.param_to_value(instr.srcs[i]);
                     LOG_DEBUG("Struct - @" << fld_ofs << " = " << v);
                     new_val.write_value(fld_ofs, ::std::move(v));
                 }
                 } break;
             }
-            LOG_DEBUG("- new_val=" << new_val);
-            state.write_lvalue(se.dst, ::std::move(new_val));
             } break;
-        case ::MIR::Statement::TAG_Asm:
-            LOG_TODO(stmt);
-            break;
-        TU_ARM(stmt, Drop, se) {
+        case Op::Drop: {
+            const auto& se = stmt.as_Drop();
             if( se.flag_idx == ~0u || cur_frame.drop_flags.at(se.flag_idx) )
             {
-                ::HIR::TypeRef  ty;
-                auto v = state.get_value_and_type(se.slot, ty);
+                const auto& ty = instr.srcs[0].lv.ty;
+                auto v = state.get_value_ref(instr.srcs[0].lv);
 
                 // - Take a pointer to the inner
                 auto alloc = (v.m_value ? RelocationPtr::new_alloc(v.m_value->borrow("drop")) : v.m_alloc);
@@ -1674,21 +1916,28 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 }
             }
             } break;
-        TU_ARM(stmt, SetDropFlag, se) {
+        case Op::SetDropFlag: {
+            const auto& se = stmt.as_SetDropFlag();
             bool val = (se.other == ~0u ? false : cur_frame.drop_flags.at(se.other)) != se.new_val;
             LOG_DEBUG("- " << val);
             cur_frame.drop_flags.at(se.idx) = val;
             } break;
-        case ::MIR::Statement::TAG_ScopeEnd:
+        case Op::Unsupported:
             LOG_TODO(stmt);
             break;
         }
+        if( stmt.is_Assign() )
+        {
+            LOG_DEBUG("- new_val=" << new_val);
+            state.write_lvalue(instr.dst, ::std::move(new_val));
+        }
 
         cur_frame.stmt_idx += 1;
     }
     else
     {
         LOG_DEBUG("=== F" << cur_frame.frame_index << "  BB" << cur_frame.bb_idx << "/TERM: " << bb.terminator);
+        const auto& term = bb_info.term;
         switch(bb.terminator.tag())
         {
         case ::MIR::Terminator::TAGDEAD:    throw "";
@@ -1708,60 +1957,37 @@ bool InterpreterThread::step_one(Value& out_thread_result)
             LOG_DEBUG("RETURN " << cur_frame.ret);
             return this->pop_stack(out_thread_result);
         TU_ARM(bb.terminator, If, te) {
-            uint8_t v = state.get_value_ref(te.cond).read_u8(0);
+            uint8_t v = state.get_value_ref(term.srcs[0].lv).read_u8(0);
             LOG_ASSERT(v == 0 || v == 1, "");
             cur_frame.bb_idx = v ? te.bb0 : te.bb1;
             } break;
         TU_ARM(bb.terminator, Switch, te) {
-            ::HIR::TypeRef ty;
-            auto v = state.get_value_and_type(te.val, ty);
-            LOG_ASSERT(ty.get_wrapper() == nullptr, "Matching on wrapped value - " << ty);
-            LOG_ASSERT(ty.inner_type == RawType::Composite, "Matching on non-coposite - " << ty);
+            auto v = state.get_value_ref(term.srcs[0].lv);
+            const auto& ty = term.srcs[0].lv.ty;
             LOG_DEBUG("Switch v = " << v);
 
-            const auto& dt = ty.composite_type();
-
-            // Get offset, read the value.
-            ::HIR::TypeRef  tag_ty;
-            size_t tag_ofs = ty.get_field_ofs(dt.tag_path.base_field, dt.tag_path.other_indexes, tag_ty);
-
-            ::std::vector<char> tag_data( tag_ty.get_size() );
-            v.read_bytes(tag_ofs, const_cast<char*>(tag_data.data()), tag_data.size());
+            const auto& tbl = bb_info.variants;
+            // Read the tag value
+            ::std::string tag_data( tbl.tag_size, '\0' );
+            v.read_bytes(tbl.tag_ofs, &tag_data[0], tag_data.size());
             // If there's a relocation, force down the default route
-            bool has_reloc = static_cast<bool>(v.get_relocation(tag_ofs));
+            bool has_reloc = static_cast<bool>(v.get_relocation(tbl.tag_ofs));
 
-            // TODO: Convert the variant list into something that makes it easier to switch on.
             size_t found_target = SIZE_MAX;
-            size_t default_target = SIZE_MAX;
-            for(size_t i = 0; i < dt.variants.size(); i ++)
+            if( !has_reloc )
             {
-                const auto& var = dt.variants[i];
-                if( var.tag_data.size() == 0 )
+                auto it = tbl.variants.find(tag_data);
+                if( it != tbl.variants.end() )
                 {
-                    // Save as the default, error for multiple defaults
-                    if( default_target != SIZE_MAX )
-                    {
-                        LOG_FATAL("Two variants with no tag in Switch - " << ty);
-                    }
-                    default_target = i;
-                }
-                else
-                {
-                    // Read the value bytes
-                    LOG_ASSERT(var.tag_data.size() == tag_data.size(), "Mismatch in tag data size");
-                    if( ! has_reloc && ::std::memcmp(tag_data.data(), var.tag_data.data(), tag_data.size()) == 0 )
-                    {
-                        LOG_DEBUG("Explicit match " << i);
-                        found_target = i;
-                        break ;
-                    }
+                    LOG_DEBUG("Explicit match " << it->second);
+                    found_target = it->second;
                 }
             }
 
-            if( found_target == SIZE_MAX && default_target != SIZE_MAX )
+            if( found_target == SIZE_MAX && tbl.default_variant != SIZE_MAX )
             {
-                LOG_DEBUG("Default match " << default_target);
-                found_target = default_target;
+                LOG_DEBUG("Default match " << tbl.default_variant);
+                found_target = tbl.default_variant;
             }
             if( found_target == SIZE_MAX )
             {
@@ -1770,8 +1996,8 @@ bool InterpreterThread::step_one(Value& out_thread_result)
             cur_frame.bb_idx = te.targets.at(found_target);
             } break;
         TU_ARM(bb.terminator, SwitchValue, te) {
-            ::HIR::TypeRef ty;
-            auto v = state.get_value_and_type(te.val, ty);
+            auto v = state.get_value_ref(term.srcs[0].lv);
+            const auto& ty = term.srcs[0].lv.ty;
             TU_MATCH_HDRA( (te.values), {)
             TU_ARMA(Unsigned, vals) {
                 LOG_ASSERT(vals.size() == te.targets.size(), "Mismatch in SwitchValue target/value list lengths");
@@ -1793,10 +2019,9 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                     LOG_ERROR("Terminator::SwitchValue::Unsigned with unexpected type - " << ty);
                 }
 
-                auto it = ::std::find(vals.begin(), vals.end(), switch_val);
-                if( it != vals.end() )
+                auto idx = bb_info.values.lookup(switch_val);
+                if( idx != SIZE_MAX )
                 {
-                    auto idx = it - vals.begin();
                     LOG_TRACE("- " << switch_val << " matched arm " << idx);
                     cur_frame.bb_idx = te.targets.at(idx);
                 }
@@ -1823,10 +2048,9 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                     LOG_ERROR("Terminator::SwitchValue::Signed with unexpected type - " << ty);
                 }
 
-                auto it = ::std::find(vals.begin(), vals.end(), switch_val);
-                if( it != vals.end() )
+                auto idx = bb_info.values.lookup( static_cast<uint64_t>(switch_val) ^ (1ull << 63) );
+                if( idx != SIZE_MAX )
                 {
-                    auto idx = it - vals.begin();
                     LOG_TRACE("- " << switch_val << " matched arm " << idx);
                     cur_frame.bb_idx = te.targets.at(idx);
                 }
@@ -1858,17 +2082,16 @@ bool InterpreterThread::step_one(Value& out_thread_result)
             }
         TU_ARM(bb.terminator, Call, te) {
             ::std::vector<Value>    sub_args; sub_args.reserve(te.args.size());
-            for(const auto& a : te.args)
+            for(size_t i = 0; i < te.args.size(); i ++)
             {
-                sub_args.push_back( state.param_to_value(a) );
+                sub_args.push_back( state.param_to_value(term.srcs[i]) );
                 LOG_DEBUG("#" << (sub_args.size() - 1) << " " << sub_args.back());
             }
             Value   rv;
             if( te.fcn.is_Intrinsic() )
             {
                 const auto& fe = te.fcn.as_Intrinsic();
-                auto ret_ty = state.get_lvalue_ty(te.ret_val);
-                if( !this->call_intrinsic(rv, ret_ty, fe.name, fe.params, ::std::move(sub_args)) )
+                if( !this->call_intrinsic(rv, term.dst.ty, fe.name, fe.params, ::std::move(sub_args)) )
                 {
                     // Early return, don't want to update stmt_idx yet
                     return false;
@@ -1883,8 +2106,7 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                     fcn_p = &te.fcn.as_Path();
                 }
                 else {
-                    ::HIR::TypeRef ty;
-                    auto v = state.get_value_and_type(te.fcn.as_Value(), ty);
+                    auto v = state.get_value_ref(term.srcs.back().lv);
                     LOG_DEBUG("> Indirect call " << v);
                     // TODO: Assert type
                     // TODO: Assert offset/content.
@@ -1924,7 +2146,21 @@ bool InterpreterThread::step_one(Value& out_thread_result)
                 }
 
                 LOG_DEBUG("Call " << *fcn_p);
-                if( !this->call_path(rv, *fcn_p, ::std::move(sub_args)) )
+                bool done;
+                if( te.fcn.is_Path() )
+                {
+                    // Direct calls are resolved once per call site
+                    if( !bb_info.call.resolved )
+                    {
+                        bb_info.call = this->resolve_call(*fcn_p);
+                    }
+                    done = this->call_target(rv, bb_info.call, *fcn_p, ::std::move(sub_args));
+                }
+                else
+                {
+                    done = this->call_path(rv, *fcn_p, ::std::move(sub_args));
+                }
+                if( !done )
                 {
                     // Early return, don't want to update stmt_idx yet
                     LOG_DEBUG("- Non-immediate return, do not advance yet");
@@ -1941,7 +2177,7 @@ bool InterpreterThread::step_one(Value& out_thread_result)
             else
             {
                 LOG_DEBUG(te.ret_val << " = " << rv << " (resume " << cur_frame.fcn->my_path << ")");
-                state.write_lvalue(te.ret_val, rv);
+                state.write_lvalue(term.dst, rv);
                 cur_frame.bb_idx = te.ret_block;
             }
             } break;
@@ -2006,7 +2242,7 @@ bool InterpreterThread::pop_stack(Value& out_thread_result)
             }
             else
             {
-                state.write_lvalue(te.ret_val, res_v);
+                state.write_lvalue(cur_frame.compiled->blocks[cur_frame.bb_idx].term.dst, res_v);
                 cur_frame.bb_idx = te.ret_block;
             }
         }
@@ -2019,6 +2255,7 @@ unsigned InterpreterThread::StackFrame::s_next_frame_index = 0;
 InterpreterThread::StackFrame::StackFrame(const Function& fcn, ::std::vector<Value> args):
     frame_index(s_next_frame_index++),
     fcn(&fcn),
+    compiled(nullptr),
     ret( fcn.ret_ty == RawType::Unreachable ? Value() : Value(fcn.ret_ty) ),
     args( ::std::move(args) ),
     locals( ),
@@ -2042,12 +2279,20 @@ InterpreterThread::StackFrame::StackFrame(const Function& fcn, ::std::vector<Val
 }
 bool InterpreterThread::call_path(Value& ret, const ::HIR::Path& path, ::std::vector<Value> args)
 {
+    return this->call_target(ret, this->resolve_call(path), path, ::std::move(args));
+}
+CompiledFunction::CallTarget InterpreterThread::resolve_call(const ::HIR::Path& path)
+{
+    CompiledFunction::CallTarget    rv;
+    rv.resolved = true;
+
     // Support overriding certain functions
     {
         auto it = m_global.m_fcn_overrides.find(path.n);
         if( it != m_global.m_fcn_overrides.end() )
         {
-            return it->second(*this, ret, path, args);
+            rv.override_fcn = it->second;
+            return rv;
         }
     }
 
@@ -2060,23 +2305,35 @@ bool InterpreterThread::call_path(Value& ret, const ::HIR::Path& path, ::std::ve
     //}
 
     const auto& fcn = m_global.m_modtree.get_function(path);
+    rv.fcn = &fcn;
 
     if( fcn.external.link_name != "" )
     {
         // Search for a function with both code and this link name
         if(const auto* ext_fcn = m_global.m_modtree.get_ext_function(fcn.external.link_name.c_str()))
         {
-            this->m_stack.push_back(StackFrame(*ext_fcn, ::std::move(args)));
-            return false;
+            rv.fcn = ext_fcn;
         }
         else
         {
             // External function!
-            return this->call_extern(ret, fcn.external.link_name, fcn.external.link_abi, ::std::move(args));
+            rv.is_extern = true;
         }
     }
-
-    this->m_stack.push_back(StackFrame(fcn, ::std::move(args)));
+    return rv;
+}
+bool InterpreterThread::call_target(Value& ret, const CompiledFunction::CallTarget& tgt, const ::HIR::Path& path, ::std::vector<Value> args)
+{
+    assert(tgt.resolved);
+    if( tgt.override_fcn )
+    {
+        return tgt.override_fcn(*this, ret, path, args);
+    }
+    if( tgt.is_extern )
+    {
+        return this->call_extern(ret, tgt.fcn->external.link_name, tgt.fcn->external.link_abi, ::std::move(args));
+    }
+    this->m_stack.push_back(StackFrame(*tgt.fcn, ::std::move(args)));
     return false;
 }
 
@@ -8,6 +8,8 @@
 #pragma once
 #include "module_tree.hpp"
 #include "value.hpp"
+#include <unordered_map>
+#include <memory>
 
 struct ThreadState
 {
@@ -37,6 +39,7 @@ struct ThreadState
 };
 
 class InterpreterThread;
+struct CompiledFunction;
 
 struct GlobalState
 {
@@ -48,7 +51,128 @@ struct GlobalState
 
     std::map<RcString, override_handler_t*>  m_fcn_overrides;
 
+    /// Pre-processed functions (populated on first call)
+    std::unordered_map<const Function*, std::unique_ptr<CompiledFunction>>  m_compiled_functions;
+
     GlobalState(const ModuleTree& modtree);
+    ~GlobalState();
+
+    CompiledFunction& get_compiled(const Function& fcn);
+};
+
+/// Interpreter data pre-computed for a function (indexed by basic block)
+///
+/// Statements are lowered on first entry to a block, with lvalue types and field offsets resolved ahead of time.
+/// Terminators also cache path lookups and switch arm searches.
+struct CompiledFunction
+{
+    /// LValue with the root slot located and the types/offsets of each wrapper resolved
+    struct LValue {
+        struct Step {
+            enum class Ty {
+                /// Field/Downcast - fixed offset into the value
+                Offset,
+                /// Array/slice index - offset is a multiple of `ofs` (the element size)
+                Index,
+                Deref,
+            } ty;
+            /// Offset: byte offset, Index: element size
+            size_t  ofs = 0;
+            /// Offset: size of the field if it's sized (SIZE_MAX otherwise)
+            /// Deref: size of the pointee, or the sized prefix for slice metadata
+            size_t  size = SIZE_MAX;
+            /// Index: local holding the index value
+            unsigned    idx_local = 0;
+            /// Index: indexing a slice (bounds checked using the metadata)
+            bool    is_slice = false;
+            /// Deref: size of the pointer metadata (zero for thin pointers)
+            size_t  meta_size = 0;
+            /// Deref: element size if the metadata is a slice length (SIZE_MAX otherwise)
+            size_t  slice_inner_size = SIZE_MAX;
+            /// Type after this step (for diagnostics)
+            ::HIR::TypeRef  ty_after;
+        };
+        ::MIR::LValue::Storage::Tag root = ::MIR::LValue::Storage::TAGDEAD;
+        unsigned    root_idx = 0;
+        Value*  root_static = nullptr;
+        ::std::vector<Step> steps;
+        /// Type of the final value
+        ::HIR::TypeRef  ty;
+    };
+    struct Param {
+        enum class Ty {
+            Constant,
+            LValue,
+            Borrow,
+        } ty;
+        ::HIR::BorrowType   bt = ::HIR::BorrowType::Shared;
+        /// LValue/Borrow source (for constants, only `lv.ty` is set)
+        LValue  lv;
+        /// Constant value, evaluated when the block is compiled
+        Value   constant;
+    };
+    /// A statement lowered to an operation on resolved lvalues
+    struct Instr {
+        enum class Op {
+            /// `dst = srcs[0]` (Use)
+            Copy,
+            /// `dst = constant`
+            Const,
+            /// `dst = &srcs[0]`
+            Borrow,
+            /// Other rvalues, evaluated from `stmt` with `srcs` standing in for its operands
+            RValue,
+            Drop,
+            SetDropFlag,
+            /// Asm/ScopeEnd
+            Unsupported,
+        } op = Op::Unsupported;
+        const ::MIR::Statement* stmt = nullptr;
+        LValue  dst;
+        /// Operands, in the order they appear in the rvalue (or the dropped slot)
+        ::std::vector<Param>    srcs;
+        Value   constant;
+    };
+
+    /// Call target resolved from a path (overrides first, then `link_name` redirections)
+    struct CallTarget {
+        bool    resolved = false;
+        GlobalState::override_handler_t*    override_fcn = nullptr;
+        const Function* fcn = nullptr;
+        /// `fcn` is an extern with no MIR, call via FFI
+        bool    is_extern = false;
+    };
+    /// Lookup from `SwitchValue` values to arm indexes
+    struct ValueTable {
+        // - Dense jump table (SIZE_MAX for gaps), indexed by `key - base`
+        uint64_t    base = 0;
+        ::std::vector<size_t>   dense;
+        // - Otherwise, (key, arm) pairs sorted by key
+        ::std::vector<::std::pair<uint64_t, size_t>>    sorted;
+
+        void build(::std::vector<uint64_t> keys);
+        /// Returns SIZE_MAX for no match
+        size_t lookup(uint64_t key) const;
+    };
+    /// Tag location and variant lookup for `Switch`
+    struct EnumTable {
+        size_t  tag_ofs = 0;
+        size_t  tag_size = 0;
+        ::std::unordered_map<::std::string, size_t> variants;
+        size_t  default_variant = SIZE_MAX;
+    };
+    struct Block {
+        bool    is_compiled = false;
+        ::std::vector<Instr>    stmts;
+        /// Terminator operands: `dst` is the call return slot, `srcs` the condition/switch value or call arguments (then an indirect callee)
+        Instr   term;
+        CallTarget  call;
+        ValueTable  values;
+        EnumTable   variants;
+    };
+    ::std::vector<Block>    blocks;
+
+    CompiledFunction(const Function& fcn);
 };
 
 class InterpreterThread
@@ -62,6 +186,8 @@ class InterpreterThread
 
         ::std::function<bool(Value&,Value)> cb;
         const Function* fcn;
+        /// Looked up on first step (null for wrappers)
+        CompiledFunction* compiled;
         Value ret;
         ::std::vector<Value>    args;
         ::std::vector<Value>    locals;
@@ -101,6 +227,9 @@ private:
 
     // Returns true if the call was resolved instantly
     bool call_path(Value& ret_val, const HIR::Path& p, ::std::vector<Value> args);
+    CompiledFunction::CallTarget resolve_call(const HIR::Path& p);
+    // Returns true if the call was resolved instantly
+    bool call_target(Value& ret_val, const CompiledFunction::CallTarget& tgt, const HIR::Path& p, ::std::vector<Value> args);
     // Returns true if the call was resolved instantly
     bool call_extern(Value& ret_val, const ::std::string& name, const ::std::string& abi, ::std::vector<Value> args);
     // Returns true if the call was resolved instantly
@@ -11,16 +11,35 @@
 #include "value.hpp"
 #include <iostream>
 #include <algorithm>    // std::find
+#include <fstream>
+#include <cstring>  // memcmp
+#include <sys/stat.h>
+#include <mmir_binary.h>
 #include "debug.hpp"
 
-ModuleTree::ModuleTree()
+ModuleTree::ModuleTree(bool prefer_binary):
+    m_prefer_binary(prefer_binary)
 {
 }
 
+/// Functions/statics defined by one loaded file (used by both `Parser` and `BinaryLoader`)
+/// - Other crates can define the same items (e.g. a generic instantiated in each, the first loaded is used), but
+///   a repeat within one file is an error.
+struct FileDefinedItems
+{
+    ::std::set<RcString>   items;
+
+    /// Returns false if this file has already defined the item
+    bool add(const RcString& p) {
+        return items.insert(p).second;
+    }
+};
+
 struct Parser
 {
     ModuleTree& tree;
     Lexer  lex;
+    FileDefinedItems    defined_items;
     Parser(ModuleTree& tree, const ::std::string& path):
         tree(tree),
         lex(path)
@@ -37,6 +56,90 @@ struct Parser
     const DataType* get_composite(RcString gp);
 };
 
+/// Loader for the binary form of the MIR (`.mir.bin`, see tools/common/mmir_binary.h)
+/// - The file is read into memory in one go and decoded in place, but strings are still copied (interned) once each
+///   and the MIR is rebuilt as the same `::MIR::Function` trees that the text parser produces.
+struct BinaryLoader
+{
+    ModuleTree& tree;
+    ::std::string   path;
+    ::std::vector<char> data;
+    ::mmir_binary::Reader   r;
+
+    ::std::vector<RcString> strings;
+    ::std::vector<::HIR::TypeRef>   types;
+    FileDefinedItems    defined_items;
+
+    BinaryLoader(ModuleTree& tree, ::std::string path, ::std::vector<char> file_data):
+        tree(tree),
+        path(::std::move(path)),
+        data(::std::move(file_data)),
+        r(data.data(), data.size())
+    {
+    }
+
+    void load();
+
+private:
+    const RcString& get_string() {
+        auto idx = r.read_uv();
+        LOG_ASSERT(idx < strings.size(), path << ": String index " << idx << " out of range");
+        return strings[idx];
+    }
+    const ::HIR::TypeRef& get_type() {
+        auto idx = r.read_uv();
+        LOG_ASSERT(idx < types.size(), path << ": Type index " << idx << " out of range");
+        return types[idx];
+    }
+    ::std::vector<::std::string> get_strings() {
+        ::std::vector<::std::string>    rv;
+        auto count = r.read_uv();
+        for(uint64_t i = 0; i < count; i ++)
+            rv.push_back(get_string().c_str());
+        return rv;
+    }
+    static ::HIR::BorrowType borrow_type(::mmir_binary::BorrowKind bk) {
+        switch(bk)
+        {
+        case ::mmir_binary::BorrowKind::Shared: return ::HIR::BorrowType::Shared;
+        case ::mmir_binary::BorrowKind::Unique: return ::HIR::BorrowType::Unique;
+        case ::mmir_binary::BorrowKind::Move:   return ::HIR::BorrowType::Move;
+        }
+        LOG_FATAL("Bad borrow kind " << int(bk));
+    }
+    static RawType raw_type(uint8_t v) {
+        static const RawType MAPPING[] = {
+            RawType::USize, RawType::ISize,
+            RawType::U8, RawType::I8,
+            RawType::U16, RawType::I16,
+            RawType::U32, RawType::I32,
+            RawType::U64, RawType::I64,
+            RawType::U128, RawType::I128,
+            RawType::F32, RawType::F64,
+            RawType::Bool,
+            RawType::Char, RawType::Str,
+            };
+        LOG_ASSERT(v < sizeof(MAPPING)/sizeof(MAPPING[0]), "Bad primitive type " << int(v));
+        return MAPPING[v];
+    }
+    ::HIR::CoreType core_type() {
+        return ::HIR::CoreType { raw_type(r.read_u8()) };
+    }
+
+    ::HIR::TypeRef read_type_def();
+    ::MIR::LValue read_lvalue();
+    ::MIR::Constant read_constant();
+    ::MIR::Param read_param();
+    ::std::vector<::MIR::Param> read_params();
+    ::MIR::RValue read_rvalue();
+    ::MIR::Statement read_statement();
+    ::MIR::Terminator read_terminator();
+
+    void load_function();
+    void load_static();
+    void load_datatype();
+};
+
 void ModuleTree::load_file(const ::std::string& path)
 {
     if( !loaded_files.insert(path).second )
@@ -46,6 +149,24 @@ void ModuleTree::load_file(const ::std::string& path)
     }
 
     TRACE_FUNCTION_R(path, "");
+
+    // Prefer the binary form if it is present (and not older than the text form)
+    auto bin_path = path + ".bin";
+    struct stat bin_st, txt_st;
+    if( m_prefer_binary && stat(bin_path.c_str(), &bin_st) == 0 && (stat(path.c_str(), &txt_st) != 0 || bin_st.st_mtime >= txt_st.st_mtime) )
+    {
+        ::std::ifstream is(bin_path, ::std::ios::binary);
+        ::std::vector<char> data( static_cast<size_t>(bin_st.st_size) );
+        if( !is.read(data.data(), data.size()) )
+            data.clear();
+        if( data.size() >= sizeof(::mmir_binary::MAGIC) && ::std::memcmp(data.data(), ::mmir_binary::MAGIC, sizeof(::mmir_binary::MAGIC)) == 0 )
+        {
+            BinaryLoader(*this, bin_path, ::std::move(data)).load();
+            return ;
+        }
+        LOG_DEBUG("load_file(" << path << ") - " << bin_path << " has a bad header, using text form");
+    }
+
     auto parse = Parser { *this, path };
 
     while(parse.parse_one())
@@ -53,6 +174,7 @@ void ModuleTree::load_file(const ::std::string& path)
         // Keep going!
     }
 }
+
 void ModuleTree::validate()
 {
     TRACE_FUNCTION_R("", "");
@@ -131,6 +253,8 @@ bool Parser::parse_one()
 
             LOG_DEBUG(lex << "fn " << p);
         }
+        if( !defined_items.add(p) )
+            LOG_ERROR(lex << "Duplicate definition of fn " << p);
         auto p2 = p;
         tree.functions.insert( ::std::make_pair(::std::move(p), Function { ::std::move(p2), ::std::move(arg_tys), rv_ty, ::std::move(ext), ::std::move(body) }) );
     }
@@ -184,6 +308,8 @@ bool Parser::parse_one()
         lex.check_consume(';');
 
         LOG_DEBUG(lex << "static " << p);
+        if( !defined_items.add(p) )
+            LOG_ERROR(lex << "Duplicate definition of static " << p);
         tree.statics.insert(::std::make_pair( ::std::move(p), ::std::move(s) ));
     }
     else if( lex.consume_if("type") )
@@ -1175,18 +1301,546 @@ RawType Parser::parse_core_type()
 }
 const DataType* Parser::get_composite(RcString gp)
 {
-    auto it = tree.data_types.find(gp);
-    if( it == tree.data_types.end() )
+    return tree.get_composite_stub(::std::move(gp));
+}
+const DataType* ModuleTree::get_composite_stub(RcString gp)
+{
+    auto it = data_types.find(gp);
+    if( it == data_types.end() )
     {
         // TODO: Later on need to check if the type is valid.
         auto v = ::std::make_unique<DataType>(DataType {});
         v->populated = false;
         v->my_path = gp;
-        auto ir = tree.data_types.insert(::std::make_pair( ::std::move(gp), ::std::move(v)) );
+        auto ir = data_types.insert(::std::make_pair( ::std::move(gp), ::std::move(v)) );
         it = ir.first;
     }
     return it->second.get();
 }
+void BinaryLoader::load()
+{
+    r.read_magic();
+    try
+    {
+        for(;;)
+        {
+            auto rec = r.read_tag<::mmir_binary::Record>();
+            switch(rec)
+            {
+            case ::mmir_binary::Record::End:
+                return ;
+            case ::mmir_binary::Record::String: {
+                size_t  len;
+                const char* p = r.read_bytes(len);
+                strings.push_back(RcString::new_interned(p, len));
+                } break;
+            case ::mmir_binary::Record::Type:
+                types.push_back(read_type_def());
+                break;
+            case ::mmir_binary::Record::Crate: {
+                ::std::string crate_path = get_string().c_str();
+                tree.load_file(crate_path);
+                } break;
+            case ::mmir_binary::Record::Function:
+                load_function();
+                break;
+            case ::mmir_binary::Record::Static:
+                load_static();
+                break;
+            case ::mmir_binary::Record::DataType:
+                load_datatype();
+                break;
+            default:
+                LOG_FATAL(path << ": Unknown record type " << int(rec));
+            }
+        }
+    }
+    catch(const ::std::runtime_error& e)
+    {
+        LOG_FATAL(path << ": " << e.what());
+    }
+}
+::HIR::TypeRef BinaryLoader::read_type_def()
+{
+    auto kind = r.read_tag<::mmir_binary::TypeKind>();
+    switch(kind)
+    {
+    case ::mmir_binary::TypeKind::Unit:
+        return ::HIR::TypeRef::unit();
+    case ::mmir_binary::TypeKind::Diverge:
+        return ::HIR::TypeRef::diverge();
+    case ::mmir_binary::TypeKind::Primitive:
+        return ::HIR::TypeRef(raw_type(r.read_u8()));
+    case ::mmir_binary::TypeKind::Composite:
+        return ::HIR::TypeRef(tree.get_composite_stub(get_string()));
+    case ::mmir_binary::TypeKind::Array: {
+        auto size = r.read_uv();
+        return ::HIR::TypeRef(get_type()).wrap(TypeWrapper::Ty::Array, size);
+        }
+    case ::mmir_binary::TypeKind::Slice:
+        return ::HIR::TypeRef(get_type()).wrap(TypeWrapper::Ty::Slice, 0);
+    case ::mmir_binary::TypeKind::Borrow: {
+        auto bt = borrow_type(r.read_tag<::mmir_binary::BorrowKind>());
+        return ::HIR::TypeRef(get_type()).wrap(TypeWrapper::Ty::Borrow, static_cast<size_t>(bt));
+        }
+    case ::mmir_binary::TypeKind::Pointer: {
+        auto bt = borrow_type(r.read_tag<::mmir_binary::BorrowKind>());
+        return ::HIR::TypeRef(get_type()).wrap(TypeWrapper::Ty::Pointer, static_cast<size_t>(bt));
+        }
+    case ::mmir_binary::TypeKind::Function: {
+        FunctionType    ft;
+        ft.unsafe = r.read_u8() != 0;
+        ft.abi = get_string().c_str();
+        auto count = r.read_uv();
+        for(uint64_t i = 0; i < count; i ++)
+            ft.args.push_back(get_type());
+        ft.ret = get_type();
+        const auto* ft_p = &*tree.function_types.insert(::std::move(ft)).first;
+        return ::HIR::TypeRef(ft_p);
+        }
+    case ::mmir_binary::TypeKind::TraitObject: {
+        auto rv = ::HIR::TypeRef(RawType::TraitObject);
+        rv.ptr.composite_type = tree.get_composite_stub(get_string());
+        return rv;
+        }
+    }
+    LOG_FATAL(path << ": Unknown type kind " << int(kind));
+}
+::MIR::LValue BinaryLoader::read_lvalue()
+{
+    ::MIR::LValue   lv;
+    auto root = r.read_tag<::mmir_binary::LValueRoot>();
+    switch(root)
+    {
+    case ::mmir_binary::LValueRoot::Return:
+        lv = ::MIR::LValue::new_Return();
+        break;
+    case ::mmir_binary::LValueRoot::Argument:
+        lv = ::MIR::LValue::new_Argument(static_cast<unsigned>(r.read_uv()));
+        break;
+    case ::mmir_binary::LValueRoot::Local:
+        lv = ::MIR::LValue::new_Local(static_cast<unsigned>(r.read_uv()));
+        break;
+    case ::mmir_binary::LValueRoot::Static:
+        lv = ::MIR::LValue::new_Static(::HIR::Path { get_string() });
+        break;
+    default:
+        LOG_FATAL(path << ": Unknown lvalue root " << int(root));
+    }
+    auto count = r.read_uv();
+    for(uint64_t i = 0; i < count; i ++)
+    {
+        auto w = r.read_tag<::mmir_binary::LValueWrapper>();
+        switch(w)
+        {
+        case ::mmir_binary::LValueWrapper::Deref:
+            lv = ::MIR::LValue::new_Deref(::std::move(lv));
+            break;
+        case ::mmir_binary::LValueWrapper::Field:
+            lv = ::MIR::LValue::new_Field(::std::move(lv), static_cast<unsigned>(r.read_uv()));
+            break;
+        case ::mmir_binary::LValueWrapper::Downcast:
+            lv = ::MIR::LValue::new_Downcast(::std::move(lv), static_cast<unsigned>(r.read_uv()));
+            break;
+        case ::mmir_binary::LValueWrapper::Index:
+            lv = ::MIR::LValue::new_Index(::std::move(lv), static_cast<unsigned>(r.read_uv()));
+            break;
+        default:
+            LOG_FATAL(path << ": Unknown lvalue wrapper " << int(w));
+        }
+    }
+    return lv;
+}
+::MIR::Constant BinaryLoader::read_constant()
+{
+    auto kind = r.read_tag<::mmir_binary::Constant>();
+    switch(kind)
+    {
+    case ::mmir_binary::Constant::Int: {
+        auto v = r.read_sv();
+        return ::MIR::Constant::make_Int({ v, core_type() });
+        }
+    case ::mmir_binary::Constant::Uint: {
+        auto v = r.read_uv();
+        return ::MIR::Constant::make_Uint({ v, core_type() });
+        }
+    case ::mmir_binary::Constant::Float: {
+        auto bits = r.read_raw64();
+        double  v;
+        ::std::memcpy(&v, &bits, sizeof(double));
+        return ::MIR::Constant::make_Float({ v, core_type() });
+        }
+    case ::mmir_binary::Constant::Bool:
+        return ::MIR::Constant::make_Bool({ r.read_u8() != 0 });
+    case ::mmir_binary::Constant::Bytes: {
+        size_t  len;
+        const auto* p = reinterpret_cast<const uint8_t*>(r.read_bytes(len));
+        return ::MIR::Constant::make_Bytes(::std::vector<uint8_t>(p, p + len));
+        }
+    case ::mmir_binary::Constant::StaticString: {
+        size_t  len;
+        const char* p = r.read_bytes(len);
+        return ::MIR::Constant::make_StaticString(::std::string(p, len));
+        }
+    case ::mmir_binary::Constant::ItemAddr:
+        return ::MIR::Constant::make_ItemAddr({ ::std::make_unique<HIR::Path>(HIR::Path { get_string() }) });
+    }
+    LOG_FATAL(path << ": Unknown constant kind " << int(kind));
+}
+::MIR::Param BinaryLoader::read_param()
+{
+    auto kind = r.read_tag<::mmir_binary::Param>();
+    switch(kind)
+    {
+    case ::mmir_binary::Param::LValue:
+        return read_lvalue();
+    case ::mmir_binary::Param::Borrow: {
+        auto bt = borrow_type(r.read_tag<::mmir_binary::BorrowKind>());
+        return ::MIR::Param::make_Borrow({ bt, read_lvalue() });
+        }
+    case ::mmir_binary::Param::Constant:
+        return read_constant();
+    }
+    LOG_FATAL(path << ": Unknown param kind " << int(kind));
+}
+::std::vector<::MIR::Param> BinaryLoader::read_params()
+{
+    ::std::vector<::MIR::Param> rv;
+    auto count = r.read_uv();
+    rv.reserve(count);
+    for(uint64_t i = 0; i < count; i ++)
+        rv.push_back(read_param());
+    return rv;
+}
+::MIR::RValue BinaryLoader::read_rvalue()
+{
+    auto kind = r.read_tag<::mmir_binary::RValue>();
+    switch(kind)
+    {
+    case ::mmir_binary::RValue::Use:
+        return read_lvalue();
+    case ::mmir_binary::RValue::Constant:
+        return read_constant();
+    case ::mmir_binary::RValue::SizedArray: {
+        auto val = read_param();
+        auto count = static_cast<unsigned>(r.read_uv());
+        return ::MIR::RValue::make_SizedArray({ ::std::move(val), count });
+        }
+    case ::mmir_binary::RValue::Borrow: {
+        auto bt = borrow_type(r.read_tag<::mmir_binary::BorrowKind>());
+        return ::MIR::RValue::make_Borrow({ bt, read_lvalue() });
+        }
+    case ::mmir_binary::RValue::Cast: {
+        auto lv = read_lvalue();
+        return ::MIR::RValue::make_Cast({ ::std::move(lv), get_type() });
+        }
+    case ::mmir_binary::RValue::BinOp: {
+        auto l = read_param();
+        auto op = static_cast<::MIR::eBinOp>(r.read_u8());
+        return ::MIR::RValue::make_BinOp({ ::std::move(l), op, read_param() });
+        }
+    case ::mmir_binary::RValue::UniOp: {
+        auto lv = read_lvalue();
+        return ::MIR::RValue::make_UniOp({ ::std::move(lv), static_cast<::MIR::eUniOp>(r.read_u8()) });
+        }
+    case ::mmir_binary::RValue::DstMeta:
+        return ::MIR::RValue::make_DstMeta({ read_lvalue() });
+    case ::mmir_binary::RValue::DstPtr:
+        return ::MIR::RValue::make_DstPtr({ read_lvalue() });
+    case ::mmir_binary::RValue::MakeDst: {
+        auto ptr = read_param();
+        return ::MIR::RValue::make_MakeDst({ ::std::move(ptr), read_param() });
+        }
+    case ::mmir_binary::RValue::Tuple:
+        return ::MIR::RValue::make_Tuple({ read_params() });
+    case ::mmir_binary::RValue::Array:
+        return ::MIR::RValue::make_Array({ read_params() });
+    case ::mmir_binary::RValue::UnionVariant: {
+        auto p = HIR::GenericPath { get_string() };
+        auto idx = static_cast<unsigned>(r.read_uv());
+        return ::MIR::RValue::make_UnionVariant({ ::std::move(p), idx, read_param() });
+        }
+    case ::mmir_binary::RValue::EnumVariant: {
+        auto p = HIR::GenericPath { get_string() };
+        auto idx = static_cast<unsigned>(r.read_uv());
+        return ::MIR::RValue::make_EnumVariant({ ::std::move(p), idx, read_params() });
+        }
+    case ::mmir_binary::RValue::Struct: {
+        auto p = HIR::GenericPath { get_string() };
+        return ::MIR::RValue::make_Struct({ ::std::move(p), read_params() });
+        }
+    }
+    LOG_FATAL(path << ": Unknown rvalue kind " << int(kind));
+}
+::MIR::Statement BinaryLoader::read_statement()
+{
+    auto kind = r.read_tag<::mmir_binary::Statement>();
+    switch(kind)
+    {
+    case ::mmir_binary::Statement::Assign: {
+        auto dst = read_lvalue();
+        return ::MIR::Statement::make_Assign({ ::std::move(dst), read_rvalue() });
+        }
+    case ::mmir_binary::Statement::SetDropFlag: {
+        auto idx = static_cast<unsigned>(r.read_uv());
+        bool val = r.read_u8() != 0;
+        auto other = static_cast<unsigned>(r.read_uv()) - 1u;
+        return ::MIR::Statement::make_SetDropFlag({ idx, val, other });
+        }
+    case ::mmir_binary::Statement::Drop: {
+        auto kind = static_cast<::MIR::eDropKind>(r.read_u8());
+        auto slot = read_lvalue();
+        auto flag_idx = static_cast<unsigned>(r.read_uv()) - 1u;
+        return ::MIR::Statement::make_Drop({ kind, ::std::move(slot), flag_idx });
+        }
+    case ::mmir_binary::Statement::Asm: {
+        ::std::string tpl = get_string().c_str();
+        ::std::vector<::std::pair<::std::string, ::MIR::LValue>>  lists[2];
+        for(auto& list : lists)
+        {
+            auto count = r.read_uv();
+            for(uint64_t i = 0; i < count; i ++)
+            {
+                ::std::string cons = get_string().c_str();
+                list.push_back(::std::make_pair(::std::move(cons), read_lvalue()));
+            }
+        }
+        auto clobbers = get_strings();
+        auto flags = get_strings();
+        return ::MIR::Statement::make_Asm({
+            ::std::move(tpl), ::std::move(lists[0]), ::std::move(lists[1]), ::std::move(clobbers), ::std::move(flags)
+            });
+        }
+    }
+    LOG_FATAL(path << ": Unknown statement kind " << int(kind));
+}
+::MIR::Terminator BinaryLoader::read_terminator()
+{
+    auto kind = r.read_tag<::mmir_binary::Terminator>();
+    switch(kind)
+    {
+    case ::mmir_binary::Terminator::Incomplete:
+        return ::MIR::Terminator::make_Incomplete({});
+    case ::mmir_binary::Terminator::Return:
+        return ::MIR::Terminator::make_Return({});
+    case ::mmir_binary::Terminator::Diverge:
+        return ::MIR::Terminator::make_Diverge({});
+    case ::mmir_binary::Terminator::Goto:
+        return ::MIR::Terminator::make_Goto(static_cast<unsigned>(r.read_uv()));
+    case ::mmir_binary::Terminator::Panic:
+        return ::MIR::Terminator::make_Panic({ static_cast<unsigned>(r.read_uv()) });
+    case ::mmir_binary::Terminator::If: {
+        auto cond = read_lvalue();
+        auto bb0 = static_cast<unsigned>(r.read_uv());
+        auto bb1 = static_cast<unsigned>(r.read_uv());
+        return ::MIR::Terminator::make_If({ ::std::move(cond), bb0, bb1 });
+        }
+    case ::mmir_binary::Terminator::Switch: {
+        auto val = read_lvalue();
+        ::std::vector<unsigned> targets;
+        auto count = r.read_uv();
+        for(uint64_t i = 0; i < count; i ++)
+            targets.push_back(static_cast<unsigned>(r.read_uv()));
+        return ::MIR::Terminator::make_Switch({ ::std::move(val), ::std::move(targets) });
+        }
+    case ::mmir_binary::Terminator::SwitchValue: {
+        auto val = read_lvalue();
+        auto vkind = r.read_u8();
+        auto count = r.read_uv();
+        ::std::vector<::MIR::BasicBlockId>  targets;
+        ::std::vector<uint64_t> uvals;
+        ::std::vector<int64_t>  svals;
+        ::std::vector<::std::string>    strvals;
+        for(uint64_t i = 0; i < count; i ++)
+        {
+            switch(vkind)
+            {
+            case 0: uvals.push_back(r.read_uv());   break;
+            case 1: svals.push_back(r.read_sv());   break;
+            case 2: strvals.push_back(r.read_string()); break;
+            default:
+                LOG_FATAL(path << ": Unknown SWITCHVALUE kind " << int(vkind));
+            }
+            targets.push_back(static_cast<unsigned>(r.read_uv()));
+        }
+        auto def_tgt = static_cast<unsigned>(r.read_uv());
+        ::MIR::SwitchValues vals;
+        switch(vkind)
+        {
+        case 0: vals = ::MIR::SwitchValues::make_Unsigned(::std::move(uvals));  break;
+        case 1: vals = ::MIR::SwitchValues::make_Signed(::std::move(svals));    break;
+        case 2: vals = ::MIR::SwitchValues::make_String(::std::move(strvals));  break;
+        }
+        return ::MIR::Terminator::make_SwitchValue({ ::std::move(val), def_tgt, ::std::move(targets), ::std::move(vals) });
+        }
+    case ::mmir_binary::Terminator::Call: {
+        ::MIR::CallTarget   ct;
+        auto ct_kind = r.read_u8();
+        switch(ct_kind)
+        {
+        case 0:
+            ct = read_lvalue();
+            break;
+        case 1:
+            ct = HIR::Path { get_string() };
+            break;
+        case 2: {
+            auto name = get_string();
+            ::HIR::PathParams   params;
+            auto count = r.read_uv();
+            for(uint64_t i = 0; i < count; i ++)
+                params.tys.push_back(get_type());
+            ct = ::MIR::CallTarget::make_Intrinsic({ ::std::move(name), ::std::move(params) });
+            } break;
+        default:
+            LOG_FATAL(path << ": Unknown call target kind " << int(ct_kind));
+        }
+        auto args = read_params();
+        auto ret_block = static_cast<unsigned>(r.read_uv());
+        auto panic_block = static_cast<unsigned>(r.read_uv());
+        auto dst = read_lvalue();
+        return ::MIR::Terminator::make_Call({ ret_block, panic_block, ::std::move(dst), ::std::move(ct), ::std::move(args) });
+        }
+    }
+    LOG_FATAL(path << ": Unknown terminator kind " << int(kind));
+}
+void BinaryLoader::load_function()
+{
+    auto p = get_string();
+    ::std::vector<::HIR::TypeRef>  arg_tys;
+    auto count = r.read_uv();
+    for(uint64_t i = 0; i < count; i ++)
+        arg_tys.push_back(get_type());
+    auto rv_ty = get_type();
+
+    Function::ExtInfo   ext;
+    ext.link_name = get_string().c_str();
+    ext.link_abi = get_string().c_str();
+
+    ::MIR::Function body;
+    if( r.read_u8() )
+    {
+        auto n_locals = r.read_uv();
+        for(uint64_t i = 0; i < n_locals; i ++)
+            body.locals.push_back(get_type());
+        auto n_flags = r.read_uv();
+        for(uint64_t i = 0; i < n_flags; i ++)
+            body.drop_flags.push_back(r.read_u8() != 0);
+        auto n_blocks = r.read_uv();
+        body.blocks.reserve(n_blocks);
+        for(uint64_t i = 0; i < n_blocks; i ++)
+        {
+            ::std::vector<::MIR::Statement> stmts;
+            auto n_stmts = r.read_uv();
+            stmts.reserve(n_stmts);
+            for(uint64_t j = 0; j < n_stmts; j ++)
+                stmts.push_back(read_statement());
+            auto term = read_terminator();
+            body.blocks.push_back(::MIR::BasicBlock { ::std::move(stmts), ::std::move(term) });
+        }
+        LOG_DEBUG(path << ": fn " << p);
+    }
+    else
+    {
+        LOG_DEBUG(path << ": extern fn " << p);
+    }
+    if( !defined_items.add(p) )
+        LOG_ERROR(path << ": Duplicate definition of fn " << p);
+    auto p2 = p;
+    tree.functions.insert( ::std::make_pair(::std::move(p), Function { ::std::move(p2), ::std::move(arg_tys), rv_ty, ::std::move(ext), ::std::move(body) }) );
+}
+void BinaryLoader::load_static()
+{
+    auto p = get_string();
+    Static s;
+    s.ty = get_type();
+    size_t  len;
+    const auto* bytes = reinterpret_cast<const uint8_t*>(r.read_bytes(len));
+    s.init.bytes.assign(bytes, bytes + len);
+
+    auto count = r.read_uv();
+    for(uint64_t i = 0; i < count; i ++)
+    {
+        auto ofs = r.read_uv();
+        auto size = r.read_uv();
+        if( r.read_u8() == 0 ) {
+            s.init.relocs.push_back( Static::InitValue::Relocation::new_item(ofs, size, HIR::Path { get_string() }) );
+        }
+        else {
+            s.init.relocs.push_back( Static::InitValue::Relocation::new_string(ofs, size, r.read_string()) );
+        }
+    }
+
+    LOG_DEBUG(path << ": static " << p);
+    if( !defined_items.add(p) )
+        LOG_ERROR(path << ": Duplicate definition of static " << p);
+    tree.statics.insert(::std::make_pair( ::std::move(p), ::std::move(s) ));
+}
+void BinaryLoader::load_datatype()
+{
+    auto p = get_string();
+
+    auto rv = DataType {};
+    rv.populated = true;
+    rv.my_path = p;
+    rv.size = r.read_uv();
+    rv.alignment = r.read_uv();
+    auto flags = r.read_u8();
+    if( flags & 1 )
+    {
+        rv.drop_glue = HIR::Path { get_string() };
+    }
+    if( flags & 2 )
+    {
+        rv.dst_meta = get_type();
+    }
+    else
+    {
+        // Using ! as the metadata type means that the type is Sized (meanwhile, `()` means unsized with no meta)
+        rv.dst_meta = ::HIR::TypeRef::diverge();
+    }
+    auto n_fields = r.read_uv();
+    for(uint64_t i = 0; i < n_fields; i ++)
+    {
+        size_t ofs = r.read_uv();
+        rv.fields.push_back(::std::make_pair(ofs, get_type()));
+    }
+    if( r.read_u8() )
+    {
+        rv.tag_path.base_field = r.read_uv();
+        auto n_idx = r.read_uv();
+        for(uint64_t i = 0; i < n_idx; i ++)
+            rv.tag_path.other_indexes.push_back(r.read_uv());
+        auto n_vars = r.read_uv();
+        for(uint64_t i = 0; i < n_vars; i ++)
+        {
+            DataType::VariantValue  var;
+            if( r.read_u8() )
+                var.tag_data = r.read_string();
+            var.data_field = static_cast<size_t>(r.read_uv()) - 1;
+            rv.variants.push_back(::std::move(var));
+        }
+    }
+
+    if( rv.alignment == 0 && rv.fields.size() != 0 )
+    {
+        LOG_ERROR(path << ": Alignment of zero with fields is invalid, " << p);
+    }
+
+    LOG_DEBUG(path << ": type " << p);
+    auto it = tree.data_types.find(p);
+    if( it != tree.data_types.end() )
+    {
+        if( it->second->alignment == 0 )
+        {
+            *it->second = ::std::move(rv);
+        }
+    }
+    else
+    {
+        tree.data_types.insert(::std::make_pair( ::std::move(p), ::std::make_unique<DataType>(::std::move(rv)) ));
+    }
+}
 
 const Function& ModuleTree::get_function(const HIR::Path& p) const
 {
@@ -67,6 +67,7 @@ struct Static
 class ModuleTree
 {
     friend struct Parser;
+    friend struct BinaryLoader;
 
     ::std::set<::std::string>   loaded_files;
 
@@ -78,8 +79,14 @@ class ModuleTree
     ::std::set<FunctionType>    function_types; // note: insertion doesn't invaliate pointers.
 
     ::std::map<RcString, const Function*> ext_functions;
+
+    /// Load `.mir.bin` files in preference to the text form (when they're up to date)
+    bool    m_prefer_binary;
+
+    /// Get a composite type, creating an unpopulated entry if it hasn't been defined yet
+    const DataType* get_composite_stub(RcString gp);
 public:
-    ModuleTree();
+    ModuleTree(bool prefer_binary=true);
 
     void load_file(const ::std::string& path);
     void validate();
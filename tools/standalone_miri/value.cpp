@@ -36,12 +36,13 @@ namespace {
     }
     void copy_bits(uint8_t* dst, size_t dst_ofs, const uint8_t* src, size_t src_ofs,  size_t len)
     {
-        // Even number of bytes, fast copy
-        if( dst_ofs % 8 == 0 && src_ofs % 8 == 0 && len % 8 == 0 )
+        // Byte-aligned, fast copy (with the trailing partial byte merged in)
+        if( dst_ofs % 8 == 0 && src_ofs % 8 == 0 )
         {
-            for(size_t i = 0; i < len/8; i ++)
+            ::std::memcpy(dst + dst_ofs/8, src + src_ofs/8, len/8);
+            for(size_t i = len & ~size_t(7); i < len; i ++)
             {
-                dst[dst_ofs/8 + i] = src[src_ofs/8 + i];
+                set_bit( dst, dst_ofs+i, get_bit(src, src_ofs+i) );
             }
         }
         else
@@ -52,6 +53,62 @@ namespace {
             }
         }
     }
+    /// Mask of bits `ofs .. ofs+len` within a single byte
+    uint8_t byte_mask(size_t ofs, size_t len) {
+        return static_cast<uint8_t>( ((1u << len) - 1) << ofs );
+    }
+    /// Check that all bits `ofs .. ofs+len` are set, a word at a time
+    bool all_bits_set(const uint8_t* p, size_t ofs, size_t len)
+    {
+        // Leading partial byte
+        if( ofs % 8 != 0 && len > 0 )
+        {
+            size_t n = ::std::min(len, 8 - ofs % 8);
+            auto m = byte_mask(ofs % 8, n);
+            if( (p[ofs/8] & m) != m )
+                return false;
+            ofs += n;
+            len -= n;
+        }
+        const uint8_t* b = p + ofs/8;
+        size_t n_bytes = len / 8;
+        for(; n_bytes >= 8; n_bytes -= 8, b += 8)
+        {
+            uint64_t    w;
+            ::std::memcpy(&w, b, 8);
+            if( w != ~uint64_t(0) )
+                return false;
+        }
+        for(; n_bytes > 0; n_bytes --, b ++)
+        {
+            if( *b != 0xFF )
+                return false;
+        }
+        // Trailing partial byte
+        if( len % 8 != 0 )
+        {
+            auto m = byte_mask(0, len % 8);
+            if( (*b & m) != m )
+                return false;
+        }
+        return true;
+    }
+    /// Set all bits `ofs .. ofs+len`
+    void set_bits(uint8_t* p, size_t ofs, size_t len)
+    {
+        if( ofs % 8 != 0 && len > 0 )
+        {
+            size_t n = ::std::min(len, 8 - ofs % 8);
+            p[ofs/8] |= byte_mask(ofs % 8, n);
+            ofs += n;
+            len -= n;
+        }
+        ::std::memset(p + ofs/8, 0xFF, len / 8);
+        if( len % 8 != 0 )
+        {
+            p[ofs/8 + len/8] |= byte_mask(0, len % 8);
+        }
+    }
 };
 
 ::std::ostream& operator<<(::std::ostream& os, const Allocation* x)
@@ -413,22 +470,16 @@ void Allocation::check_bytes_valid(size_t ofs, size_t size) const
     if( !in_bounds(ofs, size, this->size()) ) {
         LOG_FATAL("Out of range - " << ofs << "+" << size << " > " << this->size());
     }
-    for(size_t i = ofs; i < ofs + size; i++)
+    if( !all_bits_set(this->m_mask.data(), ofs, size) )
     {
-        if( !(this->m_mask[i/8] & (1 << (i%8))) )
-        {
-            LOG_ERROR("Invalid bytes in value - " << ofs << "+" << size << " - " << *this);
-            throw "ERROR";
-        }
+        LOG_ERROR("Invalid bytes in value - " << ofs << "+" << size << " - " << *this);
+        throw "ERROR";
     }
 }
 void Allocation::mark_bytes_valid(size_t ofs, size_t size)
 {
     assert( ofs+size <= this->m_mask.size() * 8 );
-    for(size_t i = ofs; i < ofs + size; i++)
-    {
-        this->m_mask[i/8] |= (1 << (i%8));
-    }
+    set_bits(this->m_mask.data(), ofs, size);
 }
 Value Allocation::read_value(size_t ofs, size_t size) const
 {
@@ -440,26 +491,15 @@ Value Allocation::read_value(size_t ofs, size_t size) const
     LOG_ASSERT( in_bounds(ofs, size, this->size()), "Read out of bounds (" << ofs << "+" << size << " > " << this->size() << ")" );
 
     // Determine if this can become an inline allocation.
-    bool has_reloc = false;
-    for(const auto& r : this->relocations)
-    {
-        if( ofs <= r.slot_ofs && r.slot_ofs < ofs + size )
-        {
-            // NOTE: A relocation at offset zero is allowed
-            if( r.slot_ofs == ofs )
-                continue ;
-            has_reloc = true;
-        }
-    }
+    // NOTE: A relocation at offset zero is allowed
+    auto relocs = this->relocations_in(ofs, size);
+    bool has_reloc = relocs.first != relocs.second && (relocs.first->first != ofs || ::std::next(relocs.first) != relocs.second);
     rv = Value::with_size(size, has_reloc);
     rv.write_bytes(0, this->data_ptr() + ofs, size);
 
-    for(const auto& r : this->relocations)
+    for(auto it = relocs.first; it != relocs.second; ++it)
     {
-        if( ofs <= r.slot_ofs && r.slot_ofs < ofs + size )
-        {
-            rv.set_reloc(r.slot_ofs - ofs, /*r.size*/POINTER_SIZE, r.backing_alloc);
-        }
+        rv.set_reloc(it->first - ofs, /*r.size*/POINTER_SIZE, it->second);
     }
     // Copy the mask bits
     copy_bits(rv.get_mask_mut(), 0, m_mask.data(), ofs, size);
@@ -500,21 +540,19 @@ void Allocation::write_value(size_t ofs, Value v)
         // Take a copy of the source mask
         auto s_mask = src_alloc.m_mask;
         // Save relocations first, because `Foo = Foo` is valid?
-        ::std::vector<Relocation>   new_relocs = src_alloc.relocations;
+        RelocationMap   new_relocs = src_alloc.relocations;
         // - write_bytes removes any relocations in this region.
         write_bytes(ofs, src_alloc.data_ptr(), v_size);
 
         // Find any relocations that apply and copy those in.
         // - Any relocations in the source within `v.meta.indirect_meta.offset` .. `v.meta.indirect_meta.offset + v_size`
-        if( !new_relocs.empty() )
+        // - Inserted with a hint, as they're in order and after anything before `ofs`
+        auto hint = this->relocations.lower_bound(ofs);
+        for(auto& r : new_relocs)
         {
-            // 2. Move the new relocations into this allocation
-            for(auto& r : new_relocs)
-            {
-                //LOG_TRACE("Insert " << r.backing_alloc);
-                r.slot_ofs += ofs;
-                this->relocations.push_back( ::std::move(r) );
-            }
+            //LOG_TRACE("Insert " << r.second);
+            hint = this->relocations.insert(hint, ::std::make_pair(r.first + ofs, ::std::move(r.second)));
+            ++ hint;
         }
 
         // Set mask in destination
@@ -549,18 +587,10 @@ void Allocation::write_bytes(size_t ofs, const void* src, size_t count)
 
 
     // - Remove any relocations already within this region
-    auto& this_relocs = this->relocations;
-    for(auto it = this_relocs.begin(); it != this_relocs.end(); )
+    if( !this->relocations.empty() )
     {
-        if( ofs <= it->slot_ofs && it->slot_ofs < ofs + count)
-        {
-            //LOG_TRACE("Delete " << it->backing_alloc);
-            it = this_relocs.erase(it);
-        }
-        else 
-        {
-            ++it;
-        }
+        auto r = this->relocations_in(ofs, count);
+        this->relocations.erase(r.first, r.second);
     }
 
     ::std::memcpy(this->data_ptr() + ofs, src, count);
@@ -576,21 +606,11 @@ void Allocation::set_reloc(size_t ofs, size_t len, RelocationPtr reloc)
 {
     LOG_ASSERT(ofs % POINTER_SIZE == 0, "Allocation::set_reloc(" << ofs << ", " << len << ", " << reloc << ")");
     LOG_ASSERT(len == POINTER_SIZE, "Allocation::set_reloc(" << ofs << ", " << len << ", " << reloc << ")");
-    // Delete any existing relocation at this position
-    for(auto it = this->relocations.begin(); it != this->relocations.end();)
-    {
-        if( ofs <= it->slot_ofs && it->slot_ofs < ofs + len )
-        {
-            // Slot starts in this updated region
-            // - TODO: Split in half?
-            it = this->relocations.erase(it);
-            continue ;
-        }
-        // TODO: What if the slot ends in the new region?
-        // What if the new region is in the middle of the slot
-        ++ it;
-    }
-    this->relocations.push_back(Relocation { ofs, /*len,*/ ::std::move(reloc) });
+    // Delete any existing relocation starting in this updated region
+    // - TODO: What if the slot ends in the new region? What if the new region is in the middle of the slot?
+    auto r = this->relocations_in(ofs, len);
+    auto it = this->relocations.erase(r.first, r.second);
+    this->relocations.insert(it, ::std::make_pair(ofs, /*len,*/ ::std::move(reloc)));
 }
 ::std::ostream& operator<<(::std::ostream& os, const Allocation& x)
 {
@@ -613,12 +633,10 @@ void Allocation::set_reloc(size_t ofs, size_t len, RelocationPtr reloc)
     os.setf(flags);
 
     os << " {";
-    for(const auto& r : x.relocations)
+    auto relocs = x.relocations_in(0, x.size());
+    for(auto it = relocs.first; it != relocs.second; ++it)
     {
-        if( 0 <= r.slot_ofs && r.slot_ofs < x.size() )
-        {
-            os << " @" << r.slot_ofs << "=" << r.backing_alloc;
-        }
+        os << " @" << it->first << "=" << it->second;
     }
     os << " }";
     return os;
@@ -735,11 +753,15 @@ void Value::check_bytes_valid(size_t ofs, size_t size) const
         throw "ERROR";
     }
     const auto* mask = this->get_mask();
-    for(size_t i = ofs; i < ofs + size; i++)
+    if( !all_bits_set(mask, ofs, size) )
     {
-        if( !get_bit(mask, i) )
+        // Slow path, find the first invalid byte for the error message
+        for(size_t i = ofs; i < ofs + size; i++)
         {
-            LOG_ERROR("Accessing invalid bytes in value, offset " << i << " of " << *this);
+            if( !get_bit(mask, i) )
+            {
+                LOG_ERROR("Accessing invalid bytes in value, offset " << i << " of " << *this);
+            }
         }
     }
 }
@@ -751,10 +773,7 @@ void Value::mark_bytes_valid(size_t ofs, size_t size)
     }
     else
     {
-        for(size_t i = ofs; i < ofs+size; i++)
-        {
-            m_inner.direct.mask[i/8] |= (1 << i%8);
-        }
+        set_bits(m_inner.direct.mask, ofs, size);
     }
 }
 
@@ -834,14 +853,17 @@ void Value::write_value(size_t ofs, Value v)
         // - Copy mask
         copy_bits(this->get_mask_mut(), ofs,  v.get_mask(), 0,  v.size());
 
-        // TODO: Faster way of knowing where there are relocations
-        for(size_t i = 0; i < v.size(); i ++)
+        if( v.m_inner.is_alloc )
         {
-            if( auto r = v.get_relocation(i) )
+            for(const auto& r : v.m_inner.alloc.alloc->relocations)
             {
-                this->set_reloc(ofs + i, POINTER_SIZE, r);
+                this->set_reloc(ofs + r.first, POINTER_SIZE, r.second);
             }
         }
+        else if( v.m_inner.direct.reloc_0 )
+        {
+            this->set_reloc(ofs, POINTER_SIZE, v.m_inner.direct.reloc_0);
+        }
     }
 }
 void Value::write_ptr(size_t ofs, size_t ptr_ofs, RelocationPtr reloc)
@@ -900,12 +922,10 @@ extern ::std::ostream& operator<<(::std::ostream& os, const ValueRef& v)
             os.setf(flags);
 
             os << " {";
-            for(const auto& r : alloc.relocations)
+            auto relocs = alloc.relocations_in(v.m_offset, v.m_size);
+            for(auto it = relocs.first; it != relocs.second; ++it)
             {
-                if( v.m_offset <= r.slot_ofs && r.slot_ofs < v.m_offset + v.m_size )
-                {
-                    os << " @" << (r.slot_ofs - v.m_offset) << "=" << r.backing_alloc;
-                }
+                os << " @" << (it->first - v.m_offset) << "=" << it->second;
             }
             os << " }";
             } break;
@@ -953,12 +973,10 @@ extern ::std::ostream& operator<<(::std::ostream& os, const ValueRef& v)
         os.setf(flags);
 
         os << " {";
-        for(const auto& r : alloc.relocations)
+        auto relocs = alloc.relocations_in(v.m_offset, v.m_size);
+        for(auto it = relocs.first; it != relocs.second; ++it)
         {
-            if( v.m_offset <= r.slot_ofs && r.slot_ofs < v.m_offset + v.m_size )
-            {
-                os << " @" << (r.slot_ofs - v.m_offset) << "=" << r.backing_alloc;
-            }
+            os << " @" << (it->first - v.m_offset) << "=" << it->second;
         }
         os << " }";
     }
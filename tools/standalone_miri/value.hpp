@@ -8,7 +8,9 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include <memory>
+#include <algorithm>    // std::fill
 #include <cstdint>
 #include <cstring>	// memcpy
 #include <cassert>
@@ -178,13 +180,9 @@ private:
         return reinterpret_cast<void*>( reinterpret_cast<uintptr_t>(m_ptr) & ~3 );
     }
 };
-struct Relocation
-{
-    // Offset within parent allocation where this relocation is performed.
-    // TODO: Size?
-    size_t  slot_ofs;
-    RelocationPtr   backing_alloc;
-};
+/// Relocations within an allocation, keyed by the offset of the pointer they apply to (sorted, for range queries)
+// TODO: Size?
+typedef ::std::map<size_t, RelocationPtr>   RelocationMap;
 
 // TODO: Split write and read
 struct ValueCommonRead
@@ -276,8 +274,9 @@ class Allocation:
 
     ::std::vector<uint64_t> m_data;
 public:
+    /// Validity bitmap (one bit per byte)
     ::std::vector<uint8_t> m_mask;
-    ::std::vector<Relocation>   relocations;
+    RelocationMap   relocations;
 public:
     virtual ~Allocation() {}
     static AllocationHandle new_alloc(size_t size, ::std::string tag);
@@ -291,17 +290,19 @@ public:
     const ::std::string& tag() const { return m_tag; }
 
     RelocationPtr get_relocation(size_t ofs) const override {
-        for(const auto& r : relocations) {
-            if(r.slot_ofs == ofs)
-                return r.backing_alloc;
-        }
+        auto it = relocations.find(ofs);
+        if( it != relocations.end() )
+            return it->second;
         return RelocationPtr();
     }
+    /// Iterator range over the relocations with a slot in `ofs .. ofs+size`
+    ::std::pair<RelocationMap::const_iterator, RelocationMap::const_iterator> relocations_in(size_t ofs, size_t size) const {
+        return ::std::make_pair(relocations.lower_bound(ofs), relocations.lower_bound(ofs + size));
+    }
     void mark_as_freed() {
         is_freed = true;
         relocations.clear();
-        for(auto& v : m_mask)
-            v = 0;
+        ::std::fill(m_mask.begin(), m_mask.end(), 0);
     }
 
     void resize(size_t new_size);
@@ -7,6 +7,10 @@
  *
  *
  * Runs all .rs files in a directory, parsing test options out of comments in the file
+ *
+ * - Tests are run by a pool of `-j` worker threads (default 1), their output is buffered and reported in name order.
+ * - A passing test records a hash of its inputs (source, aux sources, flags, and the compiler) in `<name>.pass`, and
+ *   is not re-run while that hash still matches (disable with `--no-cache`).
  */
 #define _CRT_SECURE_NO_WARNINGS
 #include <iostream>
@@ -14,6 +18,13 @@
 #include <vector>
 #include <fstream>
 #include <cctype>   // std::isblank
+#include <cstring>  // std::strcmp
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "../common/debug.h"
 #include "../common/path.h"
 #ifdef _WIN32
@@ -27,6 +38,8 @@
 # include <spawn.h>
 # include <fcntl.h> // O_*
 # include <sys/wait.h>  // waitpid
+# include <signal.h>
+# include <errno.h>
 # define MRUSTC_PATH    "./bin/mrustc"
 #endif
 #include <algorithm>
@@ -37,13 +50,17 @@ struct Options
     const char* input_glob = nullptr;
     ::std::vector<::std::string>    test_list;
 
-    bool    debug_enabled;
+    bool    debug_enabled = false;
     ::std::vector<::std::string>    lib_dirs;
 
     int debug_level = 0;
 
     const char* exceptions_file = nullptr;
     bool fail_fast = false;
+    /// Number of tests to build/run concurrently
+    unsigned n_jobs = 1;
+    /// Don't skip tests that passed with the same inputs in a previous run
+    bool no_cache = false;
 
     int parse(int argc, const char* argv[]);
 
@@ -105,6 +122,56 @@ struct Timestamp
 
 bool run_executable(const ::helpers::path& file, const ::std::vector<const char*>& args, const ::helpers::path& outfile, unsigned timeout_seconds);
 
+/// Parse the `// directive` lines at the start of a test (or auxiliary) source file
+void parse_test_header(const Options& opts, ::std::istream& in, TestDesc& td)
+{
+    do
+    {
+        ::std::string   line;
+        ::std::getline(in, line);
+        if( !(line[0] == '/' && line[1] == '/'/* && line[2] == ' '*/) )
+            continue ;
+        // TODO Parse a skewer-case ident and check against known set?
+
+        size_t start = (line[2] == ' ' ? 3 : 2);
+
+        if( line.substr(start, 10) == "aux-build:" )
+        {
+            td.m_pre_build.push_back( line.substr(start+10) );
+        }
+        else if( line.substr(start, 11) == "ignore-test" )
+        {
+            td.ignore = true;
+        }
+        else if( line.substr(start, 4+1+7) == "skip-codegen" )
+        {
+            td.no_run = true;
+        }
+        else if( line.substr(start, 14) == "compile-flags:" )
+        {
+            auto end = line.find(' ', 3+14);
+            start += 14;
+            do
+            {
+                if( start != end )
+                {
+                    auto a = line.substr(start, end-start);
+                    if( a != "" )
+                    {
+                        if( opts.debug_level > 1 )
+                            DEBUG("+" << a);
+                        td.m_extra_flags.push_back(::std::move(a));
+                    }
+                }
+                if( end == ::std::string::npos )
+                    break;
+                start = end + 1;
+                end = line.find(' ', start);
+            } while(1);
+        }
+    } while( !in.eof() );
+}
+
 bool run_compiler(const Options& opts, const ::helpers::path& source_file, const ::helpers::path& output, const ::std::vector<::std::string>& extra_flags, ::helpers::path libdir={}, bool is_dep=false)
 {
     ::std::vector<const char*>  args;
@@ -153,15 +220,258 @@ bool run_compiler(const Options& opts, const ::helpers::path& source_file, const
     return run_executable(MRUSTC_PATH, args, logfile, 0);
 }
 
-static bool gTimeout = false;
-static bool gInterrupted = false;
-void sigalrm_handler(int) {
-    gTimeout = true;
-}
+static ::std::atomic<bool> gInterrupted { false };
 void sigint_handler(int) {
     gInterrupted = true;
 }
 
+/// FNV-1a (64-bit) hash, used to key the pass cache
+struct Fnv1a
+{
+    uint64_t    m_val = 0xcbf29ce484222325ull;
+
+    void update(const void* data, size_t len) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        for(size_t i = 0; i < len; i ++) {
+            m_val ^= p[i];
+            m_val *= 0x100000001b3ull;
+        }
+    }
+    /// Hash a string (including a terminator, so adjacent strings can't alias)
+    void update(const ::std::string& s) {
+        update(s.data(), s.size() + 1);
+    }
+    /// Hash the contents of a file, returns false if it can't be read
+    bool update_file(const ::helpers::path& p) {
+        ::std::ifstream in(p.str(), ::std::ios::binary);
+        if( !in.good() )
+            return false;
+        char    buf[64*1024];
+        while( in.read(buf, sizeof(buf)) || in.gcount() > 0 )
+            update(buf, static_cast<size_t>(in.gcount()));
+        return true;
+    }
+    ::std::string hex() const {
+        ::std::stringstream ss;
+        ss << ::std::hex << m_val;
+        return ss.str();
+    }
+};
+
+/// Hash the names, sizes and modification times of the libraries in a `-L` directory
+/// - Cheaper than hashing the contents, and any rebuild of a library changes its timestamp
+void hash_lib_dir(Fnv1a& h, const ::helpers::path& dir)
+{
+    static const char* const LIB_SUFFIXES[] = { ".rlib", ".hir", ".a", ".so", ".lib", ".dll" };
+    ::std::vector<::std::string>    names;
+#ifdef _WIN32
+    WIN32_FIND_DATA find_data;
+    auto mask = dir / "*";
+    HANDLE find_handle = FindFirstFile( mask.str().c_str(), &find_data );
+    if( find_handle != INVALID_HANDLE_VALUE )
+    {
+        do
+        {
+            names.push_back(find_data.cFileName);
+        } while( FindNextFile(find_handle, &find_data) );
+        FindClose(find_handle);
+    }
+#else
+    if( auto* dp = opendir(dir.str().c_str()) )
+    {
+        while( const auto* dent = readdir(dp) )
+            names.push_back(dent->d_name);
+        closedir(dp);
+    }
+#endif
+    // Directory iteration order isn't stable
+    ::std::sort(names.begin(), names.end());
+    for(const auto& name : names)
+    {
+        bool is_lib = false;
+        for(const char* sfx : LIB_SUFFIXES)
+        {
+            size_t len = ::std::strlen(sfx);
+            if( name.size() > len && name.compare(name.size() - len, len, sfx) == 0 )
+                is_lib = true;
+        }
+        if( !is_lib )
+            continue ;
+        auto p = dir / name.c_str();
+        ::std::ifstream in(p.str(), ::std::ios::binary | ::std::ios::ate);
+        h.update(name);
+        h.update(::std::to_string(static_cast<long long>(in.tellg())));
+        ::std::stringstream ss;
+        ss << Timestamp::for_file(p);
+        h.update(ss.str());
+    }
+}
+
+/// State shared by all tests in a run
+struct TestEnv
+{
+    ::helpers::path input_path;
+    ::helpers::path outdir;
+    Timestamp   compiler_ts;
+    /// Hash of the compiler binary (empty if the pass cache is disabled)
+    ::std::string   compiler_hash;
+    bool    skip_pass;
+    bool    no_compiler_dep;
+    /// Hash of the libraries in the `-L` directories (see `hash_lib_dir`)
+    ::std::string   libs_hash;
+};
+enum class TestResult
+{
+    Pass,
+    /// Passed in a previous run with identical inputs
+    Cached,
+    CompileFail,
+    RunFail,
+};
+
+/// Get the pass cache key for a test (empty if the cache is disabled, or an input is missing)
+::std::string get_cache_key(const Options& opts, const TestEnv& env, const TestDesc& test)
+{
+    if( env.compiler_hash == "" )
+        return "";
+    Fnv1a   h;
+    h.update(env.compiler_hash);
+    h.update(opts.debug_enabled ? "-g" : "");
+    for(const auto& d : opts.lib_dirs)
+        h.update(d);
+    h.update(env.libs_hash);
+    for(const auto& f : test.m_extra_flags)
+        h.update(f);
+    h.update(test.no_run ? "no-run" : "run");
+    if( !h.update_file(test.m_path) )
+        return "";
+    for(const auto& file : test.m_pre_build)
+    {
+        h.update(file);
+        if( !h.update_file(env.input_path / "auxiliary" / file.c_str()) )
+            return "";
+    }
+    return h.hex();
+}
+
+/// Build (including aux dependencies) and run a single test
+/// - All output files are specific to the test (`<name>.*` and `deps-<name>/`), so tests can run concurrently
+TestResult run_test(const Options& opts, const TestEnv& env, const TestDesc& test)
+{
+    //DEBUG(">> " << test.m_name);
+    auto depdir = env.outdir / "deps-" + test.m_name.c_str();
+    auto test_exe = env.outdir / test.m_name + ".exe";
+    auto test_output = env.outdir / test.m_name + ".out";
+    auto test_pass = env.outdir / test.m_name + ".pass";
+
+    auto cache_key = get_cache_key(opts, env, test);
+    if( cache_key != "" )
+    {
+        ::std::string   prev_key;
+        ::std::ifstream(test_pass.str()) >> prev_key;
+        if( prev_key == cache_key )
+        {
+            if( opts.debug_level > 0 )
+                DEBUG("Cached " << test.m_name);
+            return TestResult::Cached;
+        }
+    }
+    remove(test_pass.str().c_str());
+
+    auto test_exe_ts = Timestamp::for_file(test_exe);
+    auto test_output_ts = Timestamp::for_file(test_output);
+    // (Optional) if the target file doesn't exist, force a re-compile IF the compiler is newer than the
+    // executable.
+    if( env.skip_pass )
+    {
+        // If output is missing (the last run didn't succeed), and the compiler is newer than the executable
+        if( test_output_ts == Timestamp::infinite_past() && test_exe_ts < env.compiler_ts )
+        {
+            // Force a recompile
+            test_exe_ts = Timestamp::infinite_past();
+        }
+    }
+    if( test_exe_ts == Timestamp::infinite_past() || (!env.no_compiler_dep && !env.skip_pass && test_exe_ts < env.compiler_ts) )
+    {
+        for(const auto& file : test.m_pre_build)
+        {
+#ifdef _WIN32
+            CreateDirectoryA(depdir.str().c_str(), NULL);
+#else
+            mkdir(depdir.str().c_str(), 0755);
+#endif
+            auto infile = env.input_path / "auxiliary" / file.c_str();
+            // Auxiliary crates can specify their own `compile-flags`
+            TestDesc    aux_td;
+            {
+                ::std::ifstream in(infile.str());
+                parse_test_header(opts, in, aux_td);
+            }
+            if( !run_compiler(opts, infile, depdir, aux_td.m_extra_flags, depdir, true) )
+            {
+                DEBUG("COMPILE FAIL " << infile << " (dep of " << test.m_name << ")");
+                return TestResult::CompileFail;
+            }
+        }
+
+        // If there's no pre-build files (dependencies), clear the dependency path (cleaner output)
+        if( test.m_pre_build.empty() )
+        {
+            depdir = ::helpers::path();
+        }
+
+        auto compile_logfile = test_exe + "-build.log";
+        if( !run_compiler(opts, test.m_path, test_exe, test.m_extra_flags, depdir) )
+        {
+            DEBUG("COMPILE FAIL " << test.m_name << ", log in " << compile_logfile);
+            return TestResult::CompileFail;
+        }
+        test_exe_ts = Timestamp::for_file(test_exe);
+    }
+    // - Run the test
+    if( test.no_run )
+    {
+        ::std::ofstream(test_output.str()) << "";
+        if( opts.debug_level > 0 )
+            DEBUG("No run " << test.m_name);
+    }
+    else if( test_output_ts < test_exe_ts )
+    {
+        auto run_out_file_tmp = test_output + ".tmp";
+        if( !run_executable(test_exe, { test_exe.str().c_str() }, run_out_file_tmp, 10) )
+        {
+            DEBUG("RUN FAIL " << test.m_name);
+
+            // Move the failing output file
+            auto fail_file = test_output + "_failed";
+            remove(fail_file.str().c_str());
+            rename(run_out_file_tmp.str().c_str(), fail_file.str().c_str());
+            DEBUG("- Output in " << fail_file);
+
+            return TestResult::RunFail;
+        }
+        else
+        {
+            remove(test_output.str().c_str());
+            rename(run_out_file_tmp.str().c_str(), test_output.str().c_str());
+        }
+    }
+    else
+    {
+        if( opts.debug_level > 0 )
+            DEBUG("Unchanged " << test.m_name);
+    }
+
+    if( cache_key != "" )
+    {
+        ::std::ofstream(test_pass.str()) << cache_key << ::std::endl;
+    }
+    return TestResult::Pass;
+}
+
+/// When set, debug output from the current thread is captured (instead of going to stdout)
+static thread_local ::std::ostream* t_debug_capture = nullptr;
+
 int main(int argc, const char* argv[])
 {
     Options opts;
@@ -172,12 +482,7 @@ int main(int argc, const char* argv[])
 
 #ifdef _WIN32
 #else
-    {
-        struct sigaction    sa = {0};
-        sa.sa_handler = sigalrm_handler;
-        sigaction(SIGALRM, &sa, NULL);
-        signal(SIGINT, sigint_handler);
-    }
+    signal(SIGINT, sigint_handler);
 #endif
 
     ::std::vector<::std::string>    skip_list;
@@ -262,53 +567,7 @@ int main(int argc, const char* argv[])
             }
 
             TestDesc    td;
-            td.ignore = false;
-
-            do
-            {
-                ::std::string   line;
-                ::std::getline(in, line);
-                if( !(line[0] == '/' && line[1] == '/'/* && line[2] == ' '*/) )
-                    continue ;
-                // TODO Parse a skewer-case ident and check against known set?
-
-                size_t start = (line[2] == ' ' ? 3 : 2);
-
-                if( line.substr(start, 10) == "aux-build:" )
-                {
-                    td.m_pre_build.push_back( line.substr(start+10) );
-                }
-                else if( line.substr(start, 11) == "ignore-test" )
-                {
-                    td.ignore = true;
-                }
-                else if( line.substr(start, 4+1+7) == "skip-codegen" )
-                {
-                    td.no_run = true;
-                }
-                else if( line.substr(start, 14) == "compile-flags:" )
-                {
-                    auto end = line.find(' ', 3+14);
-                    start += 14;
-                    do
-                    {
-                        if( start != end )
-                        {
-                            auto a = line.substr(start, end-start);
-                            if( a != "" )
-                            {
-                                if( opts.debug_level > 1 )
-                                    DEBUG("+" << a);
-                                td.m_extra_flags.push_back(::std::move(a));
-                            }
-                        }
-                        if( end == ::std::string::npos )
-                            break;
-                        start = end + 1;
-                        end = line.find(' ', start);
-                    } while(1);
-                }
-            } while( !in.eof() );
+            parse_test_header(opts, in, td);
 
             td.m_name = test_file_path.basename();
             td.m_name.pop_back();
@@ -329,19 +588,34 @@ int main(int argc, const char* argv[])
         ::std::sort(tests.begin(), tests.end(), [](const auto& a, const auto& b){ return a.m_name < b.m_name; });
 
         // ---
-        const bool SKIP_PASS = (getenv("TESTRUNNER_SKIPPASS") != nullptr);
-        const bool NO_COMPILER_DEP = (getenv("TESTRUNNER_NOCOMPILERDEP") != nullptr);
-        const auto compiler_ts = Timestamp::for_file(MRUSTC_PATH);
+        TestEnv env {
+            input_path,
+            outdir,
+            Timestamp::for_file(MRUSTC_PATH),
+            "",
+            getenv("TESTRUNNER_SKIPPASS") != nullptr,
+            getenv("TESTRUNNER_NOCOMPILERDEP") != nullptr,
+            };
+        if( !opts.no_cache )
+        {
+            Fnv1a   h;
+            if( h.update_file(MRUSTC_PATH) )
+                env.compiler_hash = h.hex();
+            Fnv1a   lh;
+            for(const auto& d : opts.lib_dirs)
+                hash_lib_dir(lh, ::helpers::path(d));
+            env.libs_hash = lh.hex();
+        }
         unsigned n_skip = 0;
         unsigned n_cfail = 0;
         unsigned n_fail = 0;
         unsigned n_ok = 0;
+        unsigned n_cached = 0;
+
+        // Filter the test list before handing it to the workers
+        ::std::vector<const TestDesc*>  selected;
         for(const auto& test : tests)
         {
-            if( gInterrupted ) {
-                DEBUG(">> Interrupted");
-                return 1;
-            }
             if( !opts.test_list.empty() && ::std::find(opts.test_list.begin(), opts.test_list.end(), test.m_name) == opts.test_list.end() )
             {
                 if( opts.debug_level > 0 )
@@ -361,113 +635,103 @@ int main(int argc, const char* argv[])
                 n_skip ++;
                 continue ;
             }
+            selected.push_back(&test);
+        }
 
-            //DEBUG(">> " << test.m_name);
-            auto depdir = outdir / "deps-" + test.m_name.c_str();
-            auto test_exe = outdir / test.m_name + ".exe";
-            auto test_output = outdir / test.m_name + ".out";
+        struct Outcome {
+            bool    complete = false;
+            TestResult  result = TestResult::Pass;
+            /// Debug output from the test (reported once all earlier tests have been reported)
+            ::std::string   log;
+        };
+        ::std::vector<Outcome>  outcomes(selected.size());
+        ::std::mutex    outcomes_lock;
+        ::std::condition_variable   outcomes_cv;
+        ::std::atomic<size_t>   next_test { 0 };
+        ::std::atomic<bool> stop { false };
+        unsigned    n_live_workers = 0;
 
-            auto test_exe_ts = Timestamp::for_file(test_exe);
-            auto test_output_ts = Timestamp::for_file(test_output);
-            // (Optional) if the target file doesn't exist, force a re-compile IF the compiler is newer than the
-            // executable.
-            if( SKIP_PASS )
-            {
-                // If output is missing (the last run didn't succeed), and the compiler is newer than the executable
-                if( test_output_ts == Timestamp::infinite_past() && test_exe_ts < compiler_ts )
-                {
-                    // Force a recompile
-                    test_exe_ts = Timestamp::infinite_past();
-                }
-            }
-            if( test_exe_ts == Timestamp::infinite_past() || (!NO_COMPILER_DEP && !SKIP_PASS && test_exe_ts < compiler_ts) )
+        auto worker = [&]() {
+            while( !gInterrupted && !stop )
             {
-                bool pre_build_failed = false;
-                for(const auto& file : test.m_pre_build)
-                {
-#ifdef _WIN32
-                    CreateDirectoryA(depdir.str().c_str(), NULL);
-#else
-                    mkdir(depdir.str().c_str(), 0755);
-#endif
-                    auto infile = input_path / "auxiliary" / file;
-                    if( !run_compiler(opts, infile, depdir, {}, depdir, true) )
-                    {
-                        DEBUG("COMPILE FAIL " << infile << " (dep of " << test.m_name << ")");
-                        n_cfail ++;
-                        pre_build_failed = true;
-                        break;
-                    }
-                }
-                if( pre_build_failed )
-                {
-                    if( opts.fail_fast )
-                        return 1;
-                    else
-                        continue;
-                }
+                size_t idx = next_test ++;
+                if( idx >= selected.size() )
+                    break;
+                ::std::stringstream log;
+                t_debug_capture = &log;
+                auto res = run_test(opts, env, *selected[idx]);
+                t_debug_capture = nullptr;
+                if( opts.fail_fast && (res == TestResult::CompileFail || res == TestResult::RunFail) )
+                    stop = true;
 
-                // If there's no pre-build files (dependencies), clear the dependency path (cleaner output)
-                if( test.m_pre_build.empty() )
-                {
-                    depdir = ::helpers::path();
-                }
+                ::std::lock_guard<::std::mutex> lh { outcomes_lock };
+                outcomes[idx].complete = true;
+                outcomes[idx].result = res;
+                outcomes[idx].log = log.str();
+                outcomes_cv.notify_all();
+            }
+            ::std::lock_guard<::std::mutex> lh { outcomes_lock };
+            n_live_workers --;
+            outcomes_cv.notify_all();
+        };
+        ::std::vector<::std::thread>    workers;
+        // With a single job, run in this thread so output isn't delayed until the test completes
+        if( opts.n_jobs > 1 )
+        {
+            n_live_workers = opts.n_jobs;
+            for(unsigned i = 0; i < opts.n_jobs; i ++)
+                workers.push_back(::std::thread(worker));
+        }
 
-                auto compile_logfile = test_exe + "-build.log";
-                if( !run_compiler(opts, test.m_path, test_exe, test.m_extra_flags, depdir) )
-                {
-                    DEBUG("COMPILE FAIL " << test.m_name << ", log in " << compile_logfile);
-                    n_cfail ++;
-                    if( opts.fail_fast )
-                        return 1;
-                    else
-                        continue;
-                }
-                test_exe_ts = Timestamp::for_file(test_exe);
+        // Report results in test order (as they complete)
+        bool failed_fast = false;
+        for(size_t i = 0; i < selected.size(); i ++)
+        {
+            TestResult  res;
+            if( workers.empty() )
+            {
+                if( gInterrupted )
+                    break;
+                res = run_test(opts, env, *selected[i]);
             }
-            // - Run the test
-            if( test.no_run )
+            else
             {
-                ::std::ofstream(test_output.str()) << "";
-                if( opts.debug_level > 0 )
-                    DEBUG("No run " << test.m_name);
+                ::std::unique_lock<::std::mutex>    lh { outcomes_lock };
+                outcomes_cv.wait(lh, [&]{ return outcomes[i].complete || n_live_workers == 0; });
+                if( !outcomes[i].complete )
+                    break;
+                ::std::cout << outcomes[i].log << ::std::flush;
+                res = outcomes[i].result;
             }
-            else if( test_output_ts < test_exe_ts )
+
+            switch(res)
             {
-                auto run_out_file_tmp = test_output + ".tmp";
-                if( !run_executable(test_exe, { test_exe.str().c_str() }, run_out_file_tmp, 10) )
-                {
-                    DEBUG("RUN FAIL " << test.m_name);
-
-                    // Move the failing output file
-                    auto fail_file = test_output + "_failed";
-                    remove(fail_file.str().c_str());
-                    rename(run_out_file_tmp.str().c_str(), fail_file.str().c_str());
-                    DEBUG("- Output in " << fail_file);
-
-                    n_fail ++;
-                    if( opts.fail_fast )
-                        return 1;
-                    else
-                        continue;
-                }
-                else
-                {
-                    remove(test_output.str().c_str());
-                    rename(run_out_file_tmp.str().c_str(), test_output.str().c_str());
-                }
+            case TestResult::Pass:  n_ok ++;    break;
+            case TestResult::Cached:    n_ok ++;    n_cached ++;    break;
+            case TestResult::CompileFail:   n_cfail ++; break;
+            case TestResult::RunFail:   n_fail ++;  break;
             }
-            else
+            if( opts.fail_fast && (res == TestResult::CompileFail || res == TestResult::RunFail) )
             {
-                if( opts.debug_level > 0 )
-                    DEBUG("Unchanged " << test.m_name);
+                stop = true;
+                failed_fast = true;
+                break;
             }
+        }
+        for(auto& t : workers)
+            t.join();
 
-            n_ok ++;
+        if( gInterrupted ) {
+            DEBUG(">> Interrupted");
+            return 1;
         }
+        if( failed_fast )
+            return 1;
 
         ::std::cout << "TESTS COMPLETED" << ::std::endl;
         ::std::cout << n_ok << " passed, " << n_fail << " failed, " << n_cfail << " errored, " << n_skip << " skipped" << ::std::endl;
+        if( n_cached > 0 )
+            ::std::cout << "(" << n_cached << " passed in a previous run with identical inputs)" << ::std::endl;
 
         if( n_fail > 0 || n_cfail > 0 )
             return 1;
@@ -521,6 +785,15 @@ int Options::parse(int argc, const char* argv[])
                 }
                 this->lib_dirs.push_back( argv[++i] );
                 break;
+            case 'j': {
+                // Accept both `-j N` and `-jN`
+                const char* v = arg[2] ? arg + 2 : (i+1 < argc ? argv[++i] : nullptr);
+                if( !v || !::std::isdigit(*v) ) {
+                    this->usage_short();
+                    return 1;
+                }
+                this->n_jobs = ::std::max(1ul, ::std::strtoul(v, nullptr, 10));
+                } break;
 
             default:
                 this->usage_short();
@@ -562,6 +835,10 @@ int Options::parse(int argc, const char* argv[])
             {
                 this->fail_fast = true;
             }
+            else if( 0 == ::std::strcmp(arg, "--no-cache") )
+            {
+                this->no_cache = true;
+            }
             else
             {
                 this->usage_short();
@@ -632,10 +909,16 @@ bool run_executable(const ::helpers::path& exe_name, const ::std::vector<const c
     CreateProcessA(exe_name.str().c_str(), (LPSTR)cmdline_str.c_str(), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
     SetErrorMode(em);
     CloseHandle(si.hStdOutput);
-    // TODO: Use timeout_seconds
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    if( WaitForSingleObject(pi.hProcess, timeout_seconds > 0 ? timeout_seconds * 1000 : INFINITE) == WAIT_TIMEOUT )
+    {
+        DEBUG(exe_name << " timed out, killing it");
+        TerminateProcess(pi.hProcess, 1);
+        WaitForSingleObject(pi.hProcess, INFINITE);
+    }
     DWORD status = 1;
     GetExitCodeProcess(pi.hProcess, &status);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
     if (status != 0)
     {
         DEBUG("Executable exited with non-zero exit status " << status);
@@ -670,16 +953,28 @@ bool run_executable(const ::helpers::path& exe_name, const ::std::vector<const c
     posix_spawn_file_actions_destroy(&file_actions);
 
     int status = -1;
-    // NOTE: `alarm(0)` clears any pending alarm, so no need to check before
-    // calling
-    alarm(timeout_seconds);
-    if( waitpid(pid, &status, 0) <= 0 )
+    // Poll for completion instead of using `alarm`, as the alarm is process-wide (and tests run on several threads)
+    auto deadline = ::std::chrono::steady_clock::now() + ::std::chrono::seconds(timeout_seconds);
+    for(;;)
     {
-        DEBUG(exe_name << " timed out, killing it");
-        kill(pid, SIGKILL);
-        return false;
+        auto r = waitpid(pid, &status, timeout_seconds > 0 ? WNOHANG : 0);
+        if( r == pid )
+            break;
+        if( r < 0 && errno != EINTR )
+        {
+            DEBUG("Error in waitpid of " << exe_name << " - " << errno);
+            return false;
+        }
+        if( timeout_seconds > 0 && ::std::chrono::steady_clock::now() >= deadline )
+        {
+            DEBUG(exe_name << " timed out, killing it");
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            return false;
+        }
+        if( r == 0 )
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
     }
-    alarm(0);
     if( status != 0 )
     {
         if( WIFEXITED(status) )
@@ -725,27 +1020,34 @@ Timestamp Timestamp::for_file(const ::helpers::path& path)
 }
 
 
-static int giIndentLevel = 0;
+static thread_local int giIndentLevel = 0;
+static ::std::ostream& debug_stream()
+{
+    return t_debug_capture ? *t_debug_capture : ::std::cout;
+}
 void Debug_Print(::std::function<void(::std::ostream& os)> cb)
 {
+    auto& os = debug_stream();
     for(auto i = giIndentLevel; i --; )
-        ::std::cout << " ";
-    cb(::std::cout);
-    ::std::cout << ::std::endl;
+        os << " ";
+    cb(os);
+    os << ::std::endl;
 }
 void Debug_EnterScope(const char* name, dbg_cb_t cb)
 {
+    auto& os = debug_stream();
     for(auto i = giIndentLevel; i --; )
-        ::std::cout << " ";
-    ::std::cout << ">>> " << name << "(";
-    cb(::std::cout);
-    ::std::cout << ")" << ::std::endl;
+        os << " ";
+    os << ">>> " << name << "(";
+    cb(os);
+    os << ")" << ::std::endl;
     giIndentLevel ++;
 }
 void Debug_LeaveScope(const char* name, dbg_cb_t cb)
 {
+    auto& os = debug_stream();
     giIndentLevel --;
     for(auto i = giIndentLevel; i --; )
-        ::std::cout << " ";
-    ::std::cout << "<<< " << name << ::std::endl;
+        os << " ";
+    os << "<<< " << name << ::std::endl;
 }